@@ -20,6 +20,7 @@
 #include "RZA1/system/iodefine.h"
 #include "definitions_cxx.hpp"
 #include "drivers/pic/pic.h"
+#include "dsp/convolution/impulse_response.h"
 #include "dsp/stereo_sample.h"
 #include "gui/context_menu/audio_input_selector.h"
 #include "gui/context_menu/clear_song.h"
@@ -710,6 +711,8 @@ extern "C" int32_t deluge_main(void) {
 
 	MIDIDeviceManager::readDevicesFromFile(); // Hopefully we can read this file now.
 
+	loadUserImpulseResponse(); // If there's no file, the analog delay just keeps its built-in IR
+
 	setupBlankSong(); // Can only happen after settings, which includes default settings, have been read
 
 #ifdef TEST_BST
@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "dsp/convolution/impulse_response.h"
+#include "definitions_cxx.hpp"
+#include "dsp/convolution/impulse_response_processor.h"
+#include "dsp/fft/fft_config_manager.h"
+#include "io/debug/print.h"
+#include "memory/general_memory_allocator.h"
+#include "storage/storage_manager.h"
+#include "util/functions.h"
+#include <math.h>
+#include <string.h>
+
+ImpulseResponse userImpulseResponse;
+
+ImpulseResponse::ImpulseResponse() {
+	numTaps = 0;
+	numChannels = 0;
+	numFFTPartitions = 0;
+	partitionSpectra[0] = NULL;
+	partitionSpectra[1] = NULL;
+	fftConfig = NULL;
+}
+
+void ImpulseResponse::unload() {
+	if (partitionSpectra[0]) {
+		GeneralMemoryAllocator::get().dealloc(partitionSpectra[0]);
+	}
+	partitionSpectra[0] = NULL;
+	partitionSpectra[1] = NULL;
+	numTaps = 0;
+	numChannels = 0;
+	numFFTPartitions = 0;
+}
+
+// Returns error code. Only mono or stereo PCM / float WAV files are accepted, and anything past kIRMaxNumTaps gets
+// ignored. The file's sample rate isn't looked at - it's assumed to be ours.
+int32_t ImpulseResponse::loadFromFile(char const* filePath) {
+
+	unload();
+
+	int32_t error = storageManager.initSD();
+	if (error) {
+		return error;
+	}
+
+	FIL* file = &fileSystemStuff.currentFile;
+	FRESULT result = f_open(file, filePath, FA_READ);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	UINT bytesRead;
+	uint32_t riffHeader[3];
+	result = f_read(file, riffHeader, sizeof(riffHeader), &bytesRead);
+	if (result || bytesRead != sizeof(riffHeader) || riffHeader[0] != charsToIntegerConstant('R', 'I', 'F', 'F')
+	    || riffHeader[2] != charsToIntegerConstant('W', 'A', 'V', 'E')) {
+		error = ERROR_FILE_UNSUPPORTED;
+		goto closeAndReturn;
+	}
+
+	{
+		int32_t byteDepth = 0;
+		bool isFloat = false;
+
+		while (true) {
+			struct {
+				uint32_t name;
+				uint32_t length;
+			} thisChunk;
+
+			result = f_read(file, &thisChunk, sizeof(thisChunk), &bytesRead);
+			if (result || bytesRead != sizeof(thisChunk)) {
+				error = ERROR_FILE_UNSUPPORTED; // Got to the end and there was no data chunk
+				goto closeAndReturn;
+			}
+
+			// If chunk size is odd, skip the extra byte of padding at the end too
+			uint32_t nextChunkPos = f_tell(file) + ((thisChunk.length + 1) & ~(uint32_t)1);
+
+			switch (thisChunk.name) {
+
+			case charsToIntegerConstant('f', 'm', 't', ' '): {
+				uint32_t header[4];
+				result = f_read(file, header, sizeof(header), &bytesRead);
+				if (result || bytesRead != sizeof(header)) {
+					error = ERROR_FILE_UNSUPPORTED;
+					goto closeAndReturn;
+				}
+
+				uint16_t format = header[0];
+				uint16_t bits = header[3] >> 16;
+				numChannels = header[0] >> 16;
+
+				if ((format != WAV_FORMAT_PCM && !(format == WAV_FORMAT_FLOAT && bits == 32))
+				    || (bits != 16 && bits != 24 && bits != 32) || (numChannels != 1 && numChannels != 2)) {
+					error = ERROR_FILE_UNSUPPORTED;
+					goto closeAndReturn;
+				}
+
+				byteDepth = bits >> 3;
+				isFloat = (format == WAV_FORMAT_FLOAT);
+				break;
+			}
+
+			case charsToIntegerConstant('d', 'a', 't', 'a'): {
+				if (!byteDepth) {
+					error = ERROR_FILE_UNSUPPORTED; // No "fmt " chunk seen yet
+					goto closeAndReturn;
+				}
+
+				int32_t* taps = (int32_t*)GeneralMemoryAllocator::get().alloc(kIRMaxNumTaps * 2 * sizeof(int32_t));
+				if (!taps) {
+					error = ERROR_INSUFFICIENT_RAM;
+					goto closeAndReturn;
+				}
+				int32_t* tapsPerChannel[2] = {taps, taps + kIRMaxNumTaps};
+
+				error = readSamples(tapsPerChannel, thisChunk.length, byteDepth, isFloat);
+				if (!error) {
+					error = setupFromTaps(tapsPerChannel);
+				}
+
+				GeneralMemoryAllocator::get().dealloc(taps);
+				goto closeAndReturn;
+			}
+			}
+
+			result = f_lseek(file, nextChunkPos);
+			if (result) {
+				error = ERROR_FILE_UNSUPPORTED;
+				goto closeAndReturn;
+			}
+		}
+	}
+
+closeAndReturn:
+	f_close(file);
+	if (error) {
+		unload();
+	}
+	return error;
+}
+
+// Reads the "data" chunk into full-scale int32 taps, de-interleaving as we go
+int32_t ImpulseResponse::readSamples(int32_t* destination[2], uint32_t dataLengthBytes, int32_t byteDepth,
+                                     bool isFloat) {
+
+	int32_t bytesPerFrame = byteDepth * numChannels;
+	numTaps = std::min<int32_t>(dataLengthBytes / bytesPerFrame, kIRMaxNumTaps);
+	if (!numTaps) {
+		return ERROR_FILE_UNSUPPORTED;
+	}
+
+	uint8_t readBuffer[480]; // A whole number of frames for any format we accept
+	int32_t framesPerRead = sizeof(readBuffer) / bytesPerFrame;
+
+	for (int32_t frame = 0; frame < numTaps; frame += framesPerRead) {
+		int32_t framesNow = std::min(framesPerRead, numTaps - frame);
+
+		UINT bytesRead;
+		FRESULT result = f_read(&fileSystemStuff.currentFile, readBuffer, framesNow * bytesPerFrame, &bytesRead);
+		if (result || bytesRead != framesNow * bytesPerFrame) {
+			return ERROR_FILE_CORRUPTED;
+		}
+
+		uint8_t* readPos = readBuffer;
+		for (int32_t f = 0; f < framesNow; f++) {
+			for (int32_t c = 0; c < numChannels; c++) {
+				// Little-endian, so stack the bytes up from the top of the word
+				uint32_t value32 = 0;
+				for (int32_t b = 0; b < byteDepth; b++) {
+					value32 |= (uint32_t)*(readPos++) << ((4 - byteDepth + b) << 3);
+				}
+				if (isFloat) {
+					value32 = floatBitPatternToInt(value32);
+				}
+				destination[c][frame + f] = value32;
+			}
+		}
+	}
+
+	return NO_ERROR;
+}
+
+// Scales the raw taps so the IR carries the same energy as the built-in one - it sits in the delay's feedback loop, so
+// this keeps the delay's behaviour about the same. Then sets up the direct-form taps and the partition spectra.
+int32_t ImpulseResponse::setupFromTaps(int32_t* taps[2]) {
+
+	fftConfig = FFTConfigManager::getConfig(kIRFFTSizeMagnitude);
+	if (!fftConfig) {
+		return ERROR_INSUFFICIENT_RAM;
+	}
+
+	// The built-in IR gets applied with a 32-bit right-shift rather than our 31, hence the extra quartering
+	float builtInEnergy = 0;
+	for (int32_t i = 0; i < IR_SIZE; i++) {
+		float tap = (float)ir[i] / 2147483648.0f;
+		builtInEnergy += tap * tap;
+	}
+	builtInEnergy *= 0.25f;
+
+	float biggestEnergy = 0;
+	for (int32_t c = 0; c < numChannels; c++) {
+		float energy = 0;
+		for (int32_t i = 0; i < numTaps; i++) {
+			float tap = (float)taps[c][i] / 2147483648.0f;
+			energy += tap * tap;
+		}
+		biggestEnergy = std::max(biggestEnergy, energy);
+	}
+
+	if (biggestEnergy == 0) {
+		return ERROR_FILE_UNSUPPORTED; // Silent file - not much of an IR
+	}
+
+	float scale = sqrtf(builtInEnergy / biggestEnergy);
+	for (int32_t c = 0; c < numChannels; c++) {
+		for (int32_t i = 0; i < numTaps; i++) {
+			taps[c][i] = (float)taps[c][i] * scale;
+		}
+		for (int32_t i = numTaps; i < kIRMaxNumTaps; i++) {
+			taps[c][i] = 0;
+		}
+	}
+
+	numFFTPartitions = (numTaps - 1) >> kIRPartitionSizeMagnitude;
+
+	if (numFFTPartitions) {
+		partitionSpectra[0] = (ne10_fft_cpx_int32_t*)GeneralMemoryAllocator::get().alloc(
+		    numFFTPartitions * kIRNumBins * numChannels * sizeof(ne10_fft_cpx_int32_t), NULL, false, true);
+		if (!partitionSpectra[0]) {
+			return ERROR_INSUFFICIENT_RAM;
+		}
+		partitionSpectra[1] = partitionSpectra[0] + ((numChannels == 2) ? numFFTPartitions * kIRNumBins : 0);
+	}
+
+	for (int32_t c = 0; c < numChannels; c++) {
+		memcpy(directTaps[c], taps[c], sizeof(directTaps[c]));
+
+		// Each later partition, zero-padded to the FFT size
+		int32_t frame[kIRFFTSize];
+		for (int32_t p = 0; p < numFFTPartitions; p++) {
+			memcpy(frame, &taps[c][(p + 1) << kIRPartitionSizeMagnitude], kIRPartitionSize * sizeof(int32_t));
+			memset(&frame[kIRPartitionSize], 0, kIRPartitionSize * sizeof(int32_t));
+			ne10_fft_r2c_1d_int32_neon(&partitionSpectra[c][p * kIRNumBins], frame, fftConfig, true);
+		}
+	}
+
+	if (numChannels == 1) {
+		memcpy(directTaps[1], directTaps[0], sizeof(directTaps[1]));
+	}
+
+	return NO_ERROR;
+}
+
+void loadUserImpulseResponse() {
+	int32_t error = userImpulseResponse.loadFromFile(USER_IMPULSE_RESPONSE_FILE_PATH);
+	if (!error) {
+		Debug::print("loaded delay IR, taps: ");
+		Debug::println(userImpulseResponse.numTaps);
+	}
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "NE10.h"
+#include <cstdint>
+
+// The first partition of an IR is done as a direct-form FIR, so there's no added latency. Every partition after that is
+// done in the frequency domain, one FFT of twice the partition size each time a partition's worth of input has come in.
+constexpr int32_t kIRPartitionSizeMagnitude = 6;
+constexpr int32_t kIRPartitionSize = 1 << kIRPartitionSizeMagnitude;
+constexpr int32_t kIRFFTSizeMagnitude = kIRPartitionSizeMagnitude + 1;
+constexpr int32_t kIRFFTSize = 1 << kIRFFTSizeMagnitude;
+constexpr int32_t kIRNumBins = (kIRFFTSize >> 1) + 1;
+constexpr int32_t kIRMaxNumPartitions = 64;
+constexpr int32_t kIRMaxNumTaps = kIRPartitionSize * kIRMaxNumPartitions; // About 93mS
+
+#define USER_IMPULSE_RESPONSE_FILE_PATH "IR/DELAY.WAV"
+
+// An IR loaded from a WAV file, ready to be convolved with. Shared by all the ImpulseResponseProcessors using it - they
+// each keep their own running state.
+class ImpulseResponse {
+public:
+	ImpulseResponse();
+	int32_t loadFromFile(char const* filePath);
+	int32_t setupFromTaps(int32_t* taps[2]);
+	void unload();
+	inline bool isLoaded() { return (numTaps != 0); }
+
+	int32_t numTaps;
+	int32_t numChannels;
+	int32_t numFFTPartitions; // Not counting the first, direct-form one
+
+	// Taps are Q31, to be applied with a rounding doubling multiply, so they end up the same scale as the built-in IR
+	int32_t directTaps[2][kIRPartitionSize];
+
+	// numFFTPartitions * kIRNumBins for each channel
+	ne10_fft_cpx_int32_t* partitionSpectra[2];
+
+	ne10_fft_r2c_cfg_int32_t fftConfig;
+
+private:
+	int32_t readSamples(int32_t* destination[2], uint32_t dataLengthBytes, int32_t byteDepth, bool isFloat);
+};
+
+extern ImpulseResponse userImpulseResponse;
+
+void loadUserImpulseResponse();
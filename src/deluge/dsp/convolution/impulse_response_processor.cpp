@@ -17,15 +17,358 @@
 
 #include "dsp/convolution/impulse_response_processor.h"
 
+#include "io/debug/print.h"
+#include "memory/general_memory_allocator.h"
 #include "util/functions.h"
+#include <math.h>
 #include <string.h>
 
+extern "C" {
+#include "RZA1/mtu/mtu.h"
+}
+
+#include "arm_neon.h"
+
 const int32_t ir[IR_SIZE] = {
     -3203916,   8857848,   24813136,  41537808, 35217472,  15195632,  -27538592, -61984128, 1944654848,
     1813580928, 438462784, 101125088, 6042048,  -22429488, -46218864, -56638560, -64785312, -52108528,
     -37256992,  -11863856, 1390352,   14663296, 12784464,  14254800,  5690912,   4490736,
 };
 
+// processBlock() gets called while rendering, so mustn't go allocating anything. Instead it asks for its state here,
+// and allocateWantedConvolutionStates() sets that up from the main loop. Until then, it uses the built-in IR
+constexpr int32_t kMaxNumConvolutionStateRequests = 16;
+ImpulseResponseProcessor* convolutionStateRequests[kMaxNumConvolutionStateRequests];
+int32_t numConvolutionStateRequests = 0;
+
 ImpulseResponseProcessor::ImpulseResponseProcessor() {
 	memset(buffer, 0, sizeof(buffer));
+	convolutionState = NULL;
+	convolutionStateRequested = false;
+	convolutionStateAllocationFailed = false;
+}
+
+ImpulseResponseProcessor::~ImpulseResponseProcessor() {
+	discardConvolutionState();
+}
+
+void ImpulseResponseProcessor::discardConvolutionState() {
+	cancelConvolutionStateRequest();
+	convolutionStateAllocationFailed = false;
+	if (convolutionState) {
+		GeneralMemoryAllocator::get().dealloc(convolutionState);
+		convolutionState = NULL;
+	}
+}
+
+void ImpulseResponseProcessor::requestConvolutionState() {
+	if (convolutionStateRequested || convolutionStateAllocationFailed
+	    || numConvolutionStateRequests == kMaxNumConvolutionStateRequests) {
+		return;
+	}
+	convolutionStateRequests[numConvolutionStateRequests++] = this;
+	convolutionStateRequested = true;
+}
+
+void ImpulseResponseProcessor::cancelConvolutionStateRequest() {
+	if (!convolutionStateRequested) {
+		return;
+	}
+	for (int32_t i = 0; i < numConvolutionStateRequests; i++) {
+		if (convolutionStateRequests[i] == this) {
+			convolutionStateRequests[i] = convolutionStateRequests[--numConvolutionStateRequests];
+			break;
+		}
+	}
+	convolutionStateRequested = false;
+}
+
+// Call from the main loop, not while rendering
+void ImpulseResponseProcessor::allocateWantedConvolutionStates() {
+	while (numConvolutionStateRequests) {
+		ImpulseResponseProcessor* processor = convolutionStateRequests[--numConvolutionStateRequests];
+		processor->convolutionStateRequested = false;
+
+		if (userImpulseResponse.isLoaded() && !processor->setupConvolutionState(&userImpulseResponse)) {
+			processor->convolutionStateAllocationFailed = true;
+			Debug::println("no RAM for IR convolution - delay using built-in IR");
+		}
+	}
+}
+
+// Returns false if there wasn't the RAM
+bool ImpulseResponseProcessor::setupConvolutionState(ImpulseResponse* impulseResponse) {
+	int32_t numFFTPartitions = impulseResponse->numFFTPartitions;
+
+	if (convolutionState && convolutionState->numFFTPartitions == numFFTPartitions) {
+		return true;
+	}
+	if (convolutionState) {
+		GeneralMemoryAllocator::get().dealloc(convolutionState);
+		convolutionState = NULL;
+	}
+
+	int32_t fdlSize = numFFTPartitions * kIRNumBins * sizeof(ne10_fft_cpx_int32_t);
+	int32_t allocSize = sizeof(ImpulseResponseConvolutionState) + fdlSize * 2;
+	ImpulseResponseConvolutionState* newState =
+	    (ImpulseResponseConvolutionState*)GeneralMemoryAllocator::get().alloc(allocSize, NULL, false, true);
+	if (!newState) {
+		return false;
+	}
+
+	memset(newState, 0, allocSize);
+	newState->numFFTPartitions = numFFTPartitions;
+	newState->fdl[0] = (ne10_fft_cpx_int32_t*)(newState + 1);
+	newState->fdl[1] = newState->fdl[0] + numFFTPartitions * kIRNumBins;
+	convolutionState = newState; // Only once it's all set up, in case a render happens in the meantime
+	return true;
+}
+
+// Buffer is interleaved stereo, and gets processed in place. With no user IR loaded, or until the state for
+// convolving with it has been allocated, this is just the built-in one.
+void ImpulseResponseProcessor::processBlock(int32_t* buffer, int32_t numSamples) {
+	ImpulseResponse* impulseResponse = &userImpulseResponse;
+
+	if (!impulseResponse->isLoaded() || !convolutionState
+	    || convolutionState->numFFTPartitions != impulseResponse->numFFTPartitions) {
+		if (impulseResponse->isLoaded()) {
+			requestConvolutionState();
+		}
+		int32_t* bufferEnd = buffer + numSamples * 2;
+		do {
+			process(buffer[0], buffer[1], &buffer[0], &buffer[1]);
+			buffer += 2;
+		} while (buffer != bufferEnd);
+		return;
+	}
+
+	convolve(impulseResponse, buffer, numSamples);
+}
+
+// The actual convolution with a user IR, once convolutionState is set up for it
+void ImpulseResponseProcessor::convolve(ImpulseResponse* impulseResponse, int32_t* buffer, int32_t numSamples) {
+	ImpulseResponseConvolutionState* state = convolutionState;
+
+	// No point multiplying by the zeros past the end of a short IR
+	int32_t numDirectTaps = (std::min(impulseResponse->numTaps, kIRPartitionSize) + 3) & ~3;
+
+	for (int32_t s = 0; s < numSamples; s++) {
+		if (--state->historyPos < 0) {
+			state->historyPos = kIRPartitionSize - 1;
+		}
+
+		for (int32_t c = 0; c < 2; c++) {
+			int32_t input = buffer[s * 2 + c];
+			state->history[c][state->historyPos] = input;
+			state->history[c][state->historyPos + kIRPartitionSize] = input;
+
+			// The first partition, direct-form. history[historyPos + j] is the input from j samples ago
+			int32_t const* historyNow = &state->history[c][state->historyPos];
+			int32_t const* taps = impulseResponse->directTaps[c];
+			int32x4_t sum = vdupq_n_s32(0);
+			for (int32_t j = 0; j < numDirectTaps; j += 4) {
+				sum = vaddq_s32(sum, vqrdmulhq_s32(vld1q_s32(&historyNow[j]), vld1q_s32(&taps[j])));
+			}
+			int32x2_t sumHalved = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+			int32_t output = vget_lane_s32(vpadd_s32(sumHalved, sumHalved), 0);
+
+			if (state->numFFTPartitions) {
+				output += state->tail[c][state->posInBlock];
+				state->inputFrame[c][kIRPartitionSize + state->posInBlock] = input >> 2;
+			}
+
+			buffer[s * 2 + c] = output;
+		}
+
+		if (state->numFFTPartitions && ++state->posInBlock == kIRPartitionSize) {
+			convolveBlock(impulseResponse);
+			state->posInBlock = 0;
+		}
+	}
+}
+
+// Called each time a whole partition's worth of input has come in. Works out what all the partitions after the first
+// contribute to the next partition's worth of output, and stores that in tail.
+void ImpulseResponseProcessor::convolveBlock(ImpulseResponse* impulseResponse) {
+	ImpulseResponseConvolutionState* state = convolutionState;
+	int32_t numFFTPartitions = state->numFFTPartitions;
+
+	if (++state->newestFDLSlot == numFFTPartitions) {
+		state->newestFDLSlot = 0;
+	}
+
+	for (int32_t c = 0; c < 2; c++) {
+		ne10_fft_r2c_1d_int32_neon(&state->fdl[c][state->newestFDLSlot * kIRNumBins], state->inputFrame[c],
+		                           impulseResponse->fftConfig, true);
+		memcpy(state->inputFrame[c], &state->inputFrame[c][kIRPartitionSize], kIRPartitionSize * sizeof(int32_t));
+
+		// Partition k gets multiplied by the input from k - 1 blocks before the newest one
+		ne10_fft_cpx_int32_t const* inputs[kIRMaxNumPartitions];
+		int32_t slot = state->newestFDLSlot;
+		for (int32_t k = 0; k < numFFTPartitions; k++) {
+			inputs[k] = &state->fdl[c][slot * kIRNumBins];
+			if (--slot < 0) {
+				slot = numFFTPartitions - 1;
+			}
+		}
+		ne10_fft_cpx_int32_t const* partitions = impulseResponse->partitionSpectra[c];
+
+		// Complex multiply-accumulate, 4 bins at a time, with the 64-bit totals staying in registers through all the
+		// partitions. Each product goes in shifted down by 8, for headroom.
+		// Both spectra were scaled down by the FFT size, and the input by 4 more, so shifting the totals down by 16
+		// more and the unscaled inverse below land the result back on the direct-form partition's scale
+		int32_t b = 0;
+		for (; b + 4 <= kIRNumBins; b += 4) {
+			int64x2_t totalRLow = vdupq_n_s64(0);
+			int64x2_t totalRHigh = vdupq_n_s64(0);
+			int64x2_t totalILow = vdupq_n_s64(0);
+			int64x2_t totalIHigh = vdupq_n_s64(0);
+
+			for (int32_t k = 0; k < numFFTPartitions; k++) {
+				int32x4x2_t input = vld2q_s32((int32_t const*)&inputs[k][b]);
+				int32x4x2_t partition = vld2q_s32((int32_t const*)&partitions[k * kIRNumBins + b]);
+
+				int32x2_t inputRLow = vget_low_s32(input.val[0]);
+				int32x2_t inputILow = vget_low_s32(input.val[1]);
+				int32x2_t partitionRLow = vget_low_s32(partition.val[0]);
+				int32x2_t partitionILow = vget_low_s32(partition.val[1]);
+				int64x2_t r = vmlsl_s32(vmull_s32(inputRLow, partitionRLow), inputILow, partitionILow);
+				int64x2_t i = vmlal_s32(vmull_s32(inputRLow, partitionILow), inputILow, partitionRLow);
+				totalRLow = vsraq_n_s64(totalRLow, r, 8);
+				totalILow = vsraq_n_s64(totalILow, i, 8);
+
+				int32x2_t inputRHigh = vget_high_s32(input.val[0]);
+				int32x2_t inputIHigh = vget_high_s32(input.val[1]);
+				int32x2_t partitionRHigh = vget_high_s32(partition.val[0]);
+				int32x2_t partitionIHigh = vget_high_s32(partition.val[1]);
+				r = vmlsl_s32(vmull_s32(inputRHigh, partitionRHigh), inputIHigh, partitionIHigh);
+				i = vmlal_s32(vmull_s32(inputRHigh, partitionIHigh), inputIHigh, partitionRHigh);
+				totalRHigh = vsraq_n_s64(totalRHigh, r, 8);
+				totalIHigh = vsraq_n_s64(totalIHigh, i, 8);
+			}
+
+			int32x4x2_t output;
+			output.val[0] = vcombine_s32(vqshrn_n_s64(totalRLow, 16), vqshrn_n_s64(totalRHigh, 16));
+			output.val[1] = vcombine_s32(vqshrn_n_s64(totalILow, 16), vqshrn_n_s64(totalIHigh, 16));
+			vst2q_s32((int32_t*)&state->accumulatedSpectrum[b], output);
+		}
+
+		// Whatever's left over - just the Nyquist bin
+		for (; b < kIRNumBins; b++) {
+			int64_t totalR = 0;
+			int64_t totalI = 0;
+			for (int32_t k = 0; k < numFFTPartitions; k++) {
+				ne10_fft_cpx_int32_t const* input = &inputs[k][b];
+				ne10_fft_cpx_int32_t const* partition = &partitions[k * kIRNumBins + b];
+				totalR += ((int64_t)input->r * partition->r - (int64_t)input->i * partition->i) >> 8;
+				totalI += ((int64_t)input->r * partition->i + (int64_t)input->i * partition->r) >> 8;
+			}
+			state->accumulatedSpectrum[b].r = std::clamp<int64_t>(totalR >> 16, INT32_MIN, INT32_MAX);
+			state->accumulatedSpectrum[b].i = std::clamp<int64_t>(totalI >> 16, INT32_MIN, INT32_MAX);
+		}
+
+		ne10_fft_c2r_1d_int32_neon(state->outputFrame, state->accumulatedSpectrum, impulseResponse->fftConfig, false);
+
+		// Overlap-save: only the second half is valid
+		for (int32_t i = 0; i < kIRPartitionSize; i++) {
+			state->tail[c][i] = lshiftAndSaturate<2>(state->outputFrame[kIRPartitionSize + i]);
+		}
+	}
+}
+
+// For the on-device benchmark. Convolves noise with a decaying-noise IR of a few lengths, checking the result against a
+// double-precision direct convolution of the same taps, and timing it. Not for use while the audio engine is running.
+void ImpulseResponseProcessor::runBenchmark() {
+	constexpr int32_t kNumSamples = 8192;
+	constexpr int32_t kWindowSize = 128;
+	int32_t const irLengths[] = {kIRPartitionSize, 1024, kIRMaxNumTaps};
+
+	int32_t memorySize = (kIRMaxNumTaps + kNumSamples * 2) * 2 * sizeof(int32_t);
+	int32_t* memory = (int32_t*)GeneralMemoryAllocator::get().alloc(memorySize);
+	if (!memory) {
+		Debug::println("IR benchmark: no RAM");
+		return;
+	}
+	int32_t* taps[2] = {memory, memory + kIRMaxNumTaps};
+	int32_t* input = memory + kIRMaxNumTaps * 2;
+	int32_t* output = input + kNumSamples * 2;
+
+	uint32_t randomState = 12345;
+	auto nextRandom = [&randomState]() {
+		randomState = randomState * 1664525 + 1013904223;
+		return (int32_t)randomState;
+	};
+
+	// Half full scale, so the sum of the two can't clip anywhere
+	for (int32_t i = 0; i < kNumSamples * 2; i++) {
+		input[i] = nextRandom() >> 1;
+	}
+
+	for (int32_t irLength : irLengths) {
+		ImpulseResponse impulseResponse;
+		impulseResponse.numTaps = irLength;
+		impulseResponse.numChannels = 2;
+		for (int32_t c = 0; c < 2; c++) {
+			float level = 1;
+			float decay = expf(-6.0f / irLength); // Down by about 50dB by the end
+			for (int32_t i = 0; i < irLength; i++) {
+				taps[c][i] = (float)(nextRandom() >> 1) * level;
+				level *= decay;
+			}
+		}
+		if (impulseResponse.setupFromTaps(taps)) { // Scales the taps in place, so they're what gets compared against
+			Debug::println("IR benchmark: couldn't set up IR");
+			impulseResponse.unload();
+			break;
+		}
+
+		ImpulseResponseProcessor processor;
+		if (!processor.setupConvolutionState(&impulseResponse)) {
+			Debug::println("IR benchmark: no RAM");
+			impulseResponse.unload();
+			break;
+		}
+
+		memcpy(output, input, kNumSamples * 2 * sizeof(int32_t));
+		uint32_t totalTimeUS = 0;
+		uint32_t maxTimeUS = 0;
+		for (int32_t s = 0; s < kNumSamples; s += kWindowSize) {
+			uint16_t startTime = *TCNT[TIMER_SYSTEM_FAST];
+			processor.convolve(&impulseResponse, &output[s * 2], kWindowSize);
+			uint16_t endTime = *TCNT[TIMER_SYSTEM_FAST];
+			uint32_t timeUS = fastTimerCountToUS((uint16_t)(endTime - startTime));
+			totalTimeUS += timeUS;
+			maxTimeUS = std::max(maxTimeUS, timeUS);
+		}
+
+		// Taps are applied as Q31
+		double signalPower = 0;
+		double errorPower = 0;
+		for (int32_t s = 0; s < kNumSamples; s++) {
+			for (int32_t c = 0; c < 2; c++) {
+				double expected = 0;
+				int32_t numTapsNow = std::min(irLength, s + 1);
+				for (int32_t i = 0; i < numTapsNow; i++) {
+					expected += (double)input[(s - i) * 2 + c] * taps[c][i];
+				}
+				expected *= (1.0 / 2147483648.0);
+				double error = output[s * 2 + c] - expected;
+				signalPower += expected * expected;
+				errorPower += error * error;
+			}
+		}
+
+		Debug::print("IR benchmark, taps: ");
+		Debug::print(irLength);
+		Debug::print(", SNR dB x10: ");
+		Debug::print(errorPower ? (int32_t)(100 * log10(signalPower / errorPower)) : 9999);
+		Debug::print(", uS per 128 samples avg / max: ");
+		Debug::print(totalTimeUS / (kNumSamples / kWindowSize));
+		Debug::print(" / ");
+		Debug::println(maxTimeUS);
+
+		impulseResponse.unload();
+	}
+
+	GeneralMemoryAllocator::get().dealloc(memory);
 }
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "dsp/convolution/impulse_response.h"
 #include "dsp/stereo_sample.h"
 #include <cstdint>
 
@@ -25,9 +26,31 @@ extern const int32_t ir[];
 #define IR_SIZE 26
 #define IR_BUFFER_SIZE (IR_SIZE - 1)
 
+// Running state for convolving with a user ImpulseResponse. Allocated only while it's needed, with the FDL (the
+// spectra of the last numFFTPartitions input frames, per channel) tacked onto the end.
+struct ImpulseResponseConvolutionState {
+	int32_t numFFTPartitions;
+	int32_t posInBlock;
+	int32_t historyPos;
+	int32_t newestFDLSlot;
+	int32_t history[2][kIRPartitionSize * 2]; // Mirrored, so a whole partition's worth is always contiguous
+	int32_t inputFrame[2][kIRFFTSize];        // Previous block, then current one, each sample >> 2 for headroom
+	int32_t tail[2][kIRPartitionSize];        // The later partitions' contribution to the current block
+	int32_t outputFrame[kIRFFTSize];
+	ne10_fft_cpx_int32_t accumulatedSpectrum[kIRNumBins];
+	ne10_fft_cpx_int32_t* fdl[2];
+};
+
 class ImpulseResponseProcessor {
 public:
 	ImpulseResponseProcessor();
+	~ImpulseResponseProcessor();
+
+	void processBlock(int32_t* buffer, int32_t numSamples);
+	void discardConvolutionState();
+
+	static void allocateWantedConvolutionStates();
+	static void runBenchmark();
 
 	StereoSample buffer[IR_BUFFER_SIZE];
 
@@ -44,4 +67,15 @@ public:
 		buffer[IR_BUFFER_SIZE - 1].l = multiply_32x32_rshift32_rounded(inputL, ir[IR_BUFFER_SIZE]);
 		buffer[IR_BUFFER_SIZE - 1].r = multiply_32x32_rshift32_rounded(inputR, ir[IR_BUFFER_SIZE]);
 	}
+
+private:
+	bool setupConvolutionState(ImpulseResponse* impulseResponse);
+	void convolve(ImpulseResponse* impulseResponse, int32_t* buffer, int32_t numSamples);
+	void convolveBlock(ImpulseResponse* impulseResponse);
+	void requestConvolutionState();
+	void cancelConvolutionStateRequest();
+
+	ImpulseResponseConvolutionState* convolutionState;
+	bool convolutionStateRequested;
+	bool convolutionStateAllocationFailed; // So we don't keep trying. Cleared when the delay stops
 };
@@ -232,6 +232,7 @@ void Delay::hasWrapped() {
 void Delay::discardBuffers() {
 	primaryBuffer.discard();
 	secondaryBuffer.discard();
+	impulseResponseProcessor.discardConvolutionState();
 	prevFeedback = 0;
 	repeatsUntilAbandon = 0;
 }
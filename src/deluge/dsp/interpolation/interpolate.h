@@ -15,6 +15,13 @@
  * If not, see <https://www.gnu.org/licenses/>.
 */
 
+// Includers whose interpolation buffer isn't laid out as int16x4_t[2][kInterpolationMaxNumSamples >> 2] can define this
+// to say how to load a vector of 4 samples from it
+#ifndef INTERPOLATION_BUFFER_VECTOR
+#define INTERPOLATION_BUFFER_VECTOR(c, i) interpolationBuffer[c][i]
+#define INTERPOLATION_BUFFER_VECTOR_IS_DEFAULT
+#endif
+
 #define numBitsInTableSize 8
 #define rshiftAmount                                                                                                   \
 	((24 + kInterpolationMaxNumSamplesMagnitude) - 16 - numBitsInTableSize                                             \
@@ -45,11 +52,11 @@ int32x4_t multiplied;
 for (int32_t i = 0; i < (kInterpolationMaxNumSamples >> 3); i++) {
 
 	if (i == 0)
-		multiplied = vmull_s16(vget_low_s16(kernelVector[i]), interpolationBuffer[0][i << 1]);
+		multiplied = vmull_s16(vget_low_s16(kernelVector[i]), INTERPOLATION_BUFFER_VECTOR(0, i << 1));
 	else
-		multiplied = vmlal_s16(multiplied, vget_low_s16(kernelVector[i]), interpolationBuffer[0][i << 1]);
+		multiplied = vmlal_s16(multiplied, vget_low_s16(kernelVector[i]), INTERPOLATION_BUFFER_VECTOR(0, i << 1));
 
-	multiplied = vmlal_s16(multiplied, vget_high_s16(kernelVector[i]), interpolationBuffer[0][(i << 1) + 1]);
+	multiplied = vmlal_s16(multiplied, vget_high_s16(kernelVector[i]), INTERPOLATION_BUFFER_VECTOR(0, (i << 1) + 1));
 }
 
 int32x2_t twosies = vadd_s32(vget_high_s32(multiplied), vget_low_s32(multiplied));
@@ -63,14 +70,19 @@ if (numChannelsNow == 2) {
 	for (int32_t i = 0; i < (kInterpolationMaxNumSamples >> 3); i++) {
 
 		if (i == 0)
-			multiplied = vmull_s16(vget_low_s16(kernelVector[i]), interpolationBuffer[1][i << 1]);
+			multiplied = vmull_s16(vget_low_s16(kernelVector[i]), INTERPOLATION_BUFFER_VECTOR(1, i << 1));
 		else
-			multiplied = vmlal_s16(multiplied, vget_low_s16(kernelVector[i]), interpolationBuffer[1][i << 1]);
+			multiplied = vmlal_s16(multiplied, vget_low_s16(kernelVector[i]), INTERPOLATION_BUFFER_VECTOR(1, i << 1));
 
-		multiplied = vmlal_s16(multiplied, vget_high_s16(kernelVector[i]), interpolationBuffer[1][(i << 1) + 1]);
+		multiplied = vmlal_s16(multiplied, vget_high_s16(kernelVector[i]), INTERPOLATION_BUFFER_VECTOR(1, (i << 1) + 1));
 	}
 
 	int32x2_t twosies = vadd_s32(vget_high_s32(multiplied), vget_low_s32(multiplied));
 
 	sampleRead[1] = vget_lane_s32(twosies, 0) + vget_lane_s32(twosies, 1);
 }
+
+#ifdef INTERPOLATION_BUFFER_VECTOR_IS_DEFAULT
+#undef INTERPOLATION_BUFFER_VECTOR
+#undef INTERPOLATION_BUFFER_VECTOR_IS_DEFAULT
+#endif
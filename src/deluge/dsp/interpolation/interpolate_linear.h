@@ -15,10 +15,20 @@
  * If not, see <https://www.gnu.org/licenses/>.
 */
 
+#ifndef INTERPOLATION_BUFFER_SAMPLE
+#define INTERPOLATION_BUFFER_SAMPLE(c, i) interpolationBuffer[c][0][i]
+#define INTERPOLATION_BUFFER_SAMPLE_IS_DEFAULT
+#endif
+
 int16_t strength2 = oscPos >> 9;
 int16_t strength1 = 32767 - strength2;
 
-sampleRead[0] = (interpolationBuffer[0][0][1] * strength1) + (interpolationBuffer[0][0][0] * strength2);
+sampleRead[0] = (INTERPOLATION_BUFFER_SAMPLE(0, 1) * strength1) + (INTERPOLATION_BUFFER_SAMPLE(0, 0) * strength2);
 if (numChannelsNow == 2) {
-	sampleRead[1] = (interpolationBuffer[1][0][1] * strength1) + (interpolationBuffer[1][0][0] * strength2);
+	sampleRead[1] = (INTERPOLATION_BUFFER_SAMPLE(1, 1) * strength1) + (INTERPOLATION_BUFFER_SAMPLE(1, 0) * strength2);
 }
+
+#ifdef INTERPOLATION_BUFFER_SAMPLE_IS_DEFAULT
+#undef INTERPOLATION_BUFFER_SAMPLE
+#undef INTERPOLATION_BUFFER_SAMPLE_IS_DEFAULT
+#endif
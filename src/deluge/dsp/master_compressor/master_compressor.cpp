@@ -17,10 +17,17 @@
 
 #include "dsp/master_compressor/master_compressor.h"
 #include "dsp/stereo_sample.h"
+#include <arm_neon.h>
+#include <string.h>
+
+// The envelope gets snapped to 0 below this, so a long release into silence can't end up in denormals
+constexpr float kEnvelopeFloor = 1.0E-20f;
+
+constexpr float kDBPerOctave = 6.0205999f;        // 20 * log10(2)
+constexpr float kOctavesPerDB = 1.f / kDBPerOctave;
 
 MasterCompressor::MasterCompressor() {
 	compressor.setSampleRate(kSampleRate);
-	compressor.initRuntime();
 	compressor.setAttack(10.0);
 	compressor.setRelease(100.0);
 	compressor.setThresh(0.0);       //threshold (dB) 0...-69
@@ -28,46 +35,134 @@ MasterCompressor::MasterCompressor() {
 	makeup = 1.0;                    //value;
 	gr = 0.0;
 	wet = 1.0;
+	envelope = 0;
+}
+
+// log2(x), for x >= 0, to within about 0.0001 (which is under 0.001dB). The float's exponent gives the integer part,
+// and a polynomial does the mantissa. 0 comes out as -127, which is plenty quiet enough
+static inline float32x4_t log2Approx(float32x4_t x) {
+	int32x4_t bits = vreinterpretq_s32_f32(x);
+	float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(127)));
+	float32x4_t mantissa = vreinterpretq_f32_s32(
+	    vorrq_s32(vandq_s32(bits, vdupq_n_s32(0x007FFFFF)), vdupq_n_s32(0x3F800000))); // 1 to 2
+	float32x4_t t = vsubq_f32(mantissa, vdupq_n_f32(1.f));
+
+	float32x4_t result = vmlaq_f32(vdupq_n_f32(0.312269477f), t, vdupq_n_f32(-0.0784406762f));
+	result = vmlaq_f32(vdupq_n_f32(-0.670882679f), t, result);
+	result = vmlaq_f32(vdupq_n_f32(1.4368749f), t, result);
+	result = vmlaq_f32(vdupq_n_f32(0.00011457996f), t, result);
+	return vaddq_f32(exponent, result);
+}
+
+// 2^x, for x between -126 and 127, to within a relative 0.00001 or so. Works the other way round from the above
+static inline float32x4_t exp2Approx(float32x4_t x) {
+	x = vmaxq_f32(vminq_f32(x, vdupq_n_f32(127.f)), vdupq_n_f32(-126.f));
+
+	// Conversion rounds towards zero, so take one off the negative ones to get floor()
+	int32x4_t whole = vcvtq_s32_f32(x);
+	float32x4_t wholeFloat = vcvtq_f32_s32(whole);
+	uint32x4_t roundedUp = vcgtq_f32(wholeFloat, x);
+	whole = vaddq_s32(whole, vreinterpretq_s32_u32(roundedUp)); // "True" is all ones, i.e. -1
+	wholeFloat = vcvtq_f32_s32(whole);
+	float32x4_t t = vsubq_f32(x, wholeFloat); // 0 to 1
+
+	float32x4_t result = vmlaq_f32(vdupq_n_f32(0.0517449978f), t, vdupq_n_f32(0.0136703095f));
+	result = vmlaq_f32(vdupq_n_f32(0.241604357f), t, result);
+	result = vmlaq_f32(vdupq_n_f32(0.692972922f), t, result);
+	result = vmlaq_f32(vdupq_n_f32(1.00000349f), t, result);
+
+	// Put the whole part straight into the exponent
+	return vreinterpretq_f32_s32(vaddq_s32(vreinterpretq_s32_f32(result), vshlq_n_s32(whole, 23)));
 }
 
+// Works on 4 samples at a time: first the level of each against the threshold, all in one go, then the attack /
+// release envelope, which has to be done one sample at a time, then the gain for each and applying that, 4 at a time
+// again. That's all in single precision - there's no need for anything more when it's only deciding on a gain.
 void MasterCompressor::render(StereoSample* buffer, uint16_t numSamples, int32_t masterVolumeAdjustmentL,
                               int32_t masterVolumeAdjustmentR) {
 
-	StereoSample* thisSample = buffer;
-	StereoSample* bufferEnd = buffer + numSamples;
-	if (compressor.getThresh() < -0.001) {
-		double adjustmentL = (masterVolumeAdjustmentL) / 4294967296.0; //  *2.0 is <<1 from multiply_32x32_rshift32
-		double adjustmentR = (masterVolumeAdjustmentR) / 4294967296.0;
-		if (adjustmentL < 0.000001)
-			adjustmentL = 0.000001;
-		if (adjustmentR < 0.000001)
-			adjustmentR = 0.000001;
-		do {
-			double l = thisSample->l / (double)ONE_Q31 / adjustmentL;
-			double r = thisSample->r / (double)ONE_Q31 / adjustmentR;
-			double rawl = l;
-			double rawr = r;
-			compressor.process(l, r);
-			if (thisSample == bufferEnd - 1 && fabs(rawl) > 0.00000001 && fabs(rawr) > 0.00000001) {
-				gr = chunkware_simple::lin2dB(l / rawl);
-				gr = std::min(gr, chunkware_simple::lin2dB(r / rawr));
-			}
-
-			l = l * makeup;
-			r = r * makeup;
-
-			if (wet < 0.9999) {
-				l = rawl * (1.0 - wet) + l * wet;
-				r = rawr * (1.0 - wet) + r * wet;
-			}
-
-			thisSample->l = l * ONE_Q31;
-			thisSample->r = r * ONE_Q31;
-			thisSample->l = multiply_32x32_rshift32(thisSample->l, masterVolumeAdjustmentL);
-			thisSample->r = multiply_32x32_rshift32(thisSample->r, masterVolumeAdjustmentR);
-
-		} while (++thisSample != bufferEnd);
+	if (compressor.getThresh() >= -0.001) {
+		return;
+	}
+
+	// Levels are measured as if the master volume adjustment had been applied already, and that gets applied here too
+	float adjustmentL = std::max(masterVolumeAdjustmentL / 4294967296.f, 0.000001f);
+	float adjustmentR = std::max(masterVolumeAdjustmentR / 4294967296.f, 0.000001f);
+
+	float32x4_t toLevelL = vdupq_n_f32(1.f / (float)ONE_Q31 / adjustmentL);
+	float32x4_t toLevelR = vdupq_n_f32(1.f / (float)ONE_Q31 / adjustmentR);
+	float32x4_t threshold = vdupq_n_f32(compressor.getThresh());
+	float32x4_t zero = vdupq_n_f32(0.f);
+
+	// Any last few samples which don't make up a whole 4 get done in a separate, padded buffer
+	int32_t numWholeGroups = numSamples >> 2;
+	int32_t numLeftOver = numSamples & 3;
+	int32_t numGroups = numWholeGroups + (numLeftOver != 0);
+	StereoSample leftOver[4];
+	memset(leftOver, 0, sizeof(leftOver));
+	memcpy(leftOver, &buffer[numWholeGroups << 2], numLeftOver * sizeof(StereoSample));
+
+	float working[SSI_TX_BUFFER_NUM_SAMPLES] __attribute__((aligned(16)));
+
+	// Amount over threshold, in dB
+	for (int32_t g = 0; g < numGroups; g++) {
+		StereoSample* group = (g < numWholeGroups) ? &buffer[g << 2] : leftOver;
+		int32x4x2_t samples = vld2q_s32((int32_t*)group);
+
+		float32x4_t levelL = vmulq_f32(vabsq_f32(vcvtq_f32_s32(samples.val[0])), toLevelL);
+		float32x4_t levelR = vmulq_f32(vabsq_f32(vcvtq_f32_s32(samples.val[1])), toLevelR);
+		float32x4_t leveldB = vmulq_n_f32(log2Approx(vmaxq_f32(levelL, levelR)), kDBPerOctave);
+
+		vst1q_f32(&working[g << 2], vmaxq_f32(vsubq_f32(leveldB, threshold), zero));
+	}
+
+	// Attack / release
+	float attackCoef = compressor.getAttackCoef();
+	float releaseCoef = compressor.getReleaseCoef();
+	float envelopeNow = envelope;
+	for (int32_t i = 0; i < numSamples; i++) {
+		float over = working[i];
+		envelopeNow = over + ((over > envelopeNow) ? attackCoef : releaseCoef) * (envelopeNow - over);
+		working[i] = envelopeNow;
+	}
+	if (envelopeNow < kEnvelopeFloor) {
+		envelopeNow = 0;
+	}
+	envelope = envelopeNow;
+
+	float ratioMinusOne = compressor.getRatio() - 1.0;
+	gr = envelopeNow * ratioMinusOne; // For the meter
+
+	// Gain curve, with makeup and wet/dry mix folded in
+	float32x4_t gainReductionOctaves = vdupq_n_f32(ratioMinusOne * kOctavesPerDB);
+	bool mixing = (wet < 0.9999);
+	float32x4_t dryGain = vdupq_n_f32(mixing ? (1.0 - wet) : 0.f);
+	float32x4_t wetGain = vdupq_n_f32(mixing ? (wet * makeup) : makeup);
+
+	// And from gain to what the samples get multiplied by, taking the volume adjustment back off
+	float32x4_t fromLevelL = vdupq_n_f32(1.f / adjustmentL);
+	float32x4_t fromLevelR = vdupq_n_f32(1.f / adjustmentR);
+	int32x4_t volumeL = vdupq_n_s32(masterVolumeAdjustmentL);
+	int32x4_t volumeR = vdupq_n_s32(masterVolumeAdjustmentR);
+
+	for (int32_t g = 0; g < numGroups; g++) {
+		StereoSample* group = (g < numWholeGroups) ? &buffer[g << 2] : leftOver;
+		int32x4x2_t samples = vld2q_s32((int32_t*)group);
+
+		float32x4_t gain = exp2Approx(vmulq_f32(vld1q_f32(&working[g << 2]), gainReductionOctaves));
+		gain = vmlaq_f32(dryGain, gain, wetGain);
+
+		// Conversion back saturates, which is where this clips - same as it used to
+		int32x4_t l = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(samples.val[0]), vmulq_f32(gain, fromLevelL)));
+		int32x4_t r = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(samples.val[1]), vmulq_f32(gain, fromLevelR)));
+
+		// Same as multiply_32x32_rshift32()
+		samples.val[0] = vshrq_n_s32(vqdmulhq_s32(l, volumeL), 1);
+		samples.val[1] = vshrq_n_s32(vqdmulhq_s32(r, volumeR), 1);
+		vst2q_s32((int32_t*)group, samples);
 	}
+
+	memcpy(&buffer[numWholeGroups << 2], leftOver, numLeftOver * sizeof(StereoSample));
 }
 
 namespace chunkware_simple {
@@ -121,7 +216,7 @@ void AttRelEnvelope::setSampleRate(double sampleRate) {
 //-------------------------------------------------------------
 // simple compressor
 //-------------------------------------------------------------
-SimpleComp::SimpleComp() : AttRelEnvelope(10.0, 100.0), threshdB_(0.0), ratio_(1.0), envdB_(DC_OFFSET) {
+SimpleComp::SimpleComp() : AttRelEnvelope(10.0, 100.0), threshdB_(0.0), ratio_(1.0) {
 }
 //-------------------------------------------------------------
 void SimpleComp::setThresh(double dB) {
@@ -132,9 +227,5 @@ void SimpleComp::setRatio(double ratio) {
 	assert(ratio > 0.0);
 	ratio_ = ratio;
 }
-//-------------------------------------------------------------
-void SimpleComp::initRuntime(void) {
-	envdB_ = DC_OFFSET;
-}
 
 } // end namespace chunkware_simple
@@ -50,21 +50,6 @@ namespace chunkware_simple {
  *	DEALINGS IN THE SOFTWARE.
  */
 //-------------------------------------------------------------
-// gain functions
-//-------------------------------------------------------------
-// linear -> dB conversion
-static INLINE double lin2dB(double lin) {
-	static const double LOG_2_DB = 8.6858896380650365530225783783321; // 20 / ln( 10 )
-	return log(lin) * LOG_2_DB;
-}
-// dB -> linear conversion
-static INLINE double dB2lin(double dB) {
-	static const double DB_2_LOG = 0.11512925464970228420089957273422; // ln( 10 ) / 20
-	return exp(dB * DB_2_LOG);
-}
-
-static const double DC_OFFSET = 1.0E-25;
-//-------------------------------------------------------------
 // envelope detector
 //-------------------------------------------------------------
 class EnvelopeDetector {
@@ -80,8 +65,8 @@ public:
 	virtual void setSampleRate(double sampleRate);
 	virtual double getSampleRate(void) const { return sampleRate_; }
 
-	// runtime function
-	INLINE void run(double in, double& state) { state = in + nSamplesInverse_ * (state - in); }
+	// per-sample coefficient, for whoever's running the envelope
+	virtual double getCoef(void) const { return nSamplesInverse_; }
 
 protected:
 	double sampleRate_;         // sample rate
@@ -111,20 +96,9 @@ public:
 	virtual void setSampleRate(double sampleRate);
 	virtual double getSampleRate(void) const { return attackEnvelope_.getSampleRate(); }
 
-	// runtime function
-	INLINE void run(double in, double& state) {
-
-		/* assumes that:
-			* positive delta = attack
-			* negative delta = release
-			* good for linear & log values
-			*/
-
-		if (in > state)
-			attackEnvelope_.run(in, state); // attack
-		else
-			releaseEnvelope_.run(in, state); // release
-	}
+	// per-sample coefficients
+	virtual double getAttackCoef(void) const { return attackEnvelope_.getCoef(); }
+	virtual double getReleaseCoef(void) const { return releaseEnvelope_.getCoef(); }
 
 private:
 	EnvelopeDetector attackEnvelope_;
@@ -144,69 +118,11 @@ public:
 	virtual double getThresh(void) const { return threshdB_; }
 	virtual double getRatio(void) const { return ratio_; }
 
-	// runtime
-	virtual void initRuntime(void); // call before runtime (in resume())
-	//void process(double& in1, double& in2);                   // compressor runtime process
-	//void process(double& in1, double& in2, double keyLinked); // with stereo-linked key in
-
-	INLINE void process(double& in1, double& in2) {
-		// create sidechain
-
-		double rect1 = fabs(in1); // rectify input
-		double rect2 = fabs(in2);
-
-		/* if desired, one could use another EnvelopeDetector to smooth
-			 * the rectified signal.
-			 */
-
-		double link = std::max(rect1, rect2); // link channels with greater of 2
-
-		process(in1, in2, link); // rest of process
-	}
-
-	//-------------------------------------------------------------
-	INLINE void process(double& in1, double& in2, double keyLinked) {
-		keyLinked = fabs(keyLinked); // rectify (just in case)
-
-		// convert key to dB
-		keyLinked += DC_OFFSET;           // add DC offset to avoid log( 0 )
-		double keydB = lin2dB(keyLinked); // convert linear -> dB
-
-		// threshold
-		double overdB = keydB - threshdB_; // delta over threshold
-		if (overdB < 0.0)
-			overdB = 0.0;
-
-		// attack/release
-
-		overdB += DC_OFFSET;                 // add DC offset to avoid denormal
-		AttRelEnvelope::run(overdB, envdB_); // run attack/release envelope
-		overdB = envdB_ - DC_OFFSET;         // subtract DC offset
-
-		/* REGARDING THE DC OFFSET: In this case, since the offset is added before
-			 * the attack/release processes, the envelope will never fall below the offset,
-			 * thereby avoiding denormals. However, to prevent the offset from causing
-			 * constant gain reduction, we must subtract it from the envelope, yielding
-			 * a minimum value of 0dB.
-			 */
-
-		// transfer function
-		double gr = overdB * (ratio_ - 1.0); // gain reduction (dB)
-		gr = dB2lin(gr);                     // convert dB -> linear
-
-		// output gain
-		in1 *= gr; // apply gain reduction to input
-		in2 *= gr;
-	}
-
 private:
 	// transfer function
 	double threshdB_; // threshold (dB)
 	double ratio_;    // ratio (compression: < 1 ; expansion: > 1)
 
-	// runtime variables
-	double envdB_; // over-threshold envelope (dB)
-
 }; // end SimpleComp class
 
 } // end namespace chunkware_simple
@@ -231,4 +147,7 @@ public:
 	inline double getMakeup() { return 20.0 * log10(makeup); }
 
 	chunkware_simple::SimpleComp compressor;
+
+private:
+	float envelope; // Amount over threshold, in dB, after attack / release
 };
@@ -46,4 +46,27 @@ float allpass::getfeedback() {
 	return (float)feedback / 2147483648u;
 }
 
+// Same as calling process() on each sample in place, but with the buffer wrap checked once per segment rather than
+// once per sample
+void allpass::processBlock(int32_t* samples, int32_t numSamples) {
+	while (numSamples) {
+		int32_t numSamplesThisSegment = std::min(numSamples, bufsize - bufidx);
+
+		int32_t* __restrict__ bufferPos = &buffer[bufidx];
+		int32_t* const segmentEnd = bufferPos + numSamplesThisSegment;
+		do {
+			int32_t input = *samples;
+			int32_t bufout = *bufferPos;
+			*bufferPos = input + (bufout >> 1);
+			*(samples++) = -input + bufout;
+		} while (++bufferPos != segmentEnd);
+
+		bufidx += numSamplesThisSegment;
+		if (bufidx >= bufsize) {
+			bufidx = 0;
+		}
+		numSamples -= numSamplesThisSegment;
+	}
+}
+
 //ends
@@ -30,6 +30,7 @@ public:
 	allpass();
 	void setbuffer(int32_t* buf, int32_t size);
 	inline int32_t process(int32_t inp);
+	void processBlock(int32_t* samples, int32_t numSamples);
 	void mute();
 	void setfeedback(float val);
 	float getfeedback();
@@ -57,4 +57,55 @@ int32_t comb::getfeedback() {
 	return feedback;
 }
 
+// Same as calling process() on each sample for both combs and accumulating the outputs. The two combs' recursions are
+// independent, so interleaving them lets one's multiplies run while the other's are still in the pipeline. Wrapping is
+// checked once per segment - each comb buffer is longer than an audio window, so that's at most three segments.
+void comb::processBlockStereo(comb& combL, comb& combR, int32_t const* input, int32_t* outputL, int32_t* outputR,
+                              int32_t numSamples) {
+	int32_t filterstoreL = combL.filterstore;
+	int32_t filterstoreR = combR.filterstore;
+
+	while (numSamples) {
+		int32_t numSamplesThisSegment =
+		    std::min(numSamples, std::min(combL.bufsize - combL.bufidx, combR.bufsize - combR.bufidx));
+
+		int32_t* __restrict__ bufferPosL = &combL.buffer[combL.bufidx];
+		int32_t* __restrict__ bufferPosR = &combR.buffer[combR.bufidx];
+		int32_t* const segmentEndL = bufferPosL + numSamplesThisSegment;
+		do {
+			int32_t bufoutL = *bufferPosL;
+			int32_t bufoutR = *bufferPosR;
+
+			filterstoreL = (multiply_32x32_rshift32_rounded(bufoutL, combL.damp2)
+			                + multiply_32x32_rshift32_rounded(filterstoreL, combL.damp1))
+			               << 1;
+			filterstoreR = (multiply_32x32_rshift32_rounded(bufoutR, combR.damp2)
+			                + multiply_32x32_rshift32_rounded(filterstoreR, combR.damp1))
+			               << 1;
+
+			*bufferPosL = *input + (multiply_32x32_rshift32_rounded(filterstoreL, combL.feedback) << 1);
+			*bufferPosR = *input + (multiply_32x32_rshift32_rounded(filterstoreR, combR.feedback) << 1);
+			input++;
+
+			*(outputL++) += bufoutL;
+			*(outputR++) += bufoutR;
+
+			bufferPosR++;
+		} while (++bufferPosL != segmentEndL);
+
+		combL.bufidx += numSamplesThisSegment;
+		if (combL.bufidx >= combL.bufsize) {
+			combL.bufidx = 0;
+		}
+		combR.bufidx += numSamplesThisSegment;
+		if (combR.bufidx >= combR.bufsize) {
+			combR.bufidx = 0;
+		}
+		numSamples -= numSamplesThisSegment;
+	}
+
+	combL.filterstore = filterstoreL;
+	combR.filterstore = filterstoreR;
+}
+
 // ends
@@ -31,6 +31,8 @@ public:
 	comb();
 	void setbuffer(int32_t* buf, int32_t size);
 	inline int32_t process(int32_t inp);
+	static void processBlockStereo(comb& combL, comb& combR, int32_t const* input, int32_t* outputL,
+	                               int32_t* outputR, int32_t numSamples);
 	void mute();
 	void setdamp(float val);
 	float getdamp();
@@ -22,6 +22,9 @@
  */
 
 #include "dsp/reverb/freeverb/revmodel.hpp"
+#include "definitions_cxx.hpp"
+#include "dsp/stereo_sample.h"
+#include <string.h>
 
 revmodel::revmodel() {
 	// Tie the components to their buffers
@@ -85,6 +88,34 @@ void revmodel::mute() {
 	}
 }
 
+void revmodel::processBlock(int32_t const* input, StereoSample* output, int32_t numSamples, int32_t amplitudeL,
+                            int32_t amplitudeR) {
+	int32_t outL[SSI_TX_BUFFER_NUM_SAMPLES];
+	int32_t outR[SSI_TX_BUFFER_NUM_SAMPLES];
+	memset(outL, 0, numSamples * sizeof(int32_t));
+	memset(outR, 0, numSamples * sizeof(int32_t));
+
+	// Accumulate comb filters in parallel
+	for (int32_t i = 0; i < numcombs; i++) {
+		comb::processBlockStereo(combL[i], combR[i], input, outL, outR, numSamples);
+	}
+
+	// Feed through allpasses in series
+	for (int32_t i = 0; i < numallpasses; i++) {
+		allpassL[i].processBlock(outL, numSamples);
+		allpassR[i].processBlock(outR, numSamples);
+	}
+
+	// Calculate output, and mix it in
+	for (int32_t i = 0; i < numSamples; i++) {
+		int32_t reverbOutL = outL[i] + (multiply_32x32_rshift32_rounded(outR[i], wet2)) << 1;
+		int32_t reverbOutR = outR[i] + (multiply_32x32_rshift32_rounded(outL[i], wet2)) << 1;
+
+		output[i].l += multiply_32x32_rshift32_rounded(reverbOutL, amplitudeL);
+		output[i].r += multiply_32x32_rshift32_rounded(reverbOutR, amplitudeR);
+	}
+}
+
 void revmodel::update() {
 	// Recalculate internal values after parameter change
 
@@ -27,6 +27,8 @@
 #include "dsp/reverb/freeverb/comb.hpp"
 #include "dsp/reverb/freeverb/tuning.h"
 
+class StereoSample;
+
 class revmodel {
 public:
 	revmodel();
@@ -67,6 +69,11 @@ public:
 		*outputR = outR + (multiply_32x32_rshift32_rounded(outL, wet2)) << 1;
 	}
 
+	// Processes a whole audio window at once, mixing the reverb output into output at the given amplitudes.
+	// numSamples must be no more than SSI_TX_BUFFER_NUM_SAMPLES.
+	void processBlock(int32_t const* input, StereoSample* output, int32_t numSamples, int32_t amplitudeL,
+	                  int32_t amplitudeR);
+
 private:
 	void update();
 
@@ -31,10 +31,15 @@
 #include "storage/cluster/cluster.h"
 #include "storage/storage_manager.h"
 #include "util/functions.h"
+#include <arm_neon.h>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 
+extern "C" {
+#include "RZA1/mtu/mtu.h"
+}
+
 #define MEASURE_HOP_END_PERFORMANCE 0
 
 bool TimeStretcher::init(Sample* sample, VoiceSample* voiceSample, SamplePlaybackGuide* guide, int64_t newSamplePosBig,
@@ -236,6 +241,361 @@ const int16_t lookaheadFine[] = {
 };
 */
 
+// How many candidate offsets the phase search in hopEnd() looks at in one go. Must be a multiple of 4
+constexpr int32_t kHopSearchBlockSize = 16;
+
+// For the next numCandidates offsets in the phase search, reads the sample at each moving-average boundary (advancing
+// currentPos), updates the running totals, and works out how different each offset's totals are from the old head's.
+// The reading has to be done one at a time, what with odd byte depths, but the comparisons are done 4 offsets at once
+static void compareHopCandidates(char const** currentPos, int32_t numCandidates, int32_t numChannels,
+                                 int32_t byteDepth, int32_t bytesPerSampleTimesSearchDirection,
+                                 int32_t searchDirectionRelativeToPlayDirection, int32_t const* oldHeadTotals,
+                                 int32_t* runningTotals, int32_t* differencesAbs, int32_t* totalChanges) {
+	constexpr int32_t kNumAverages = TimeStretch::Crossfade::kNumMovingAverages;
+
+	int32_t values[kNumAverages + 1][kHopSearchBlockSize];
+	for (int32_t i = 0; i < kNumAverages + 1; i++) {
+		char const* pos = currentPos[i];
+		for (int32_t c = 0; c < numCandidates; c++) {
+			int32_t value = *(int32_t*)pos >> 16;
+			if (numChannels == 2) {
+				value += *(int32_t*)(pos + byteDepth) >> 16;
+			}
+			values[i][c] = value * searchDirectionRelativeToPlayDirection;
+			pos += bytesPerSampleTimesSearchDirection;
+		}
+		currentPos[i] = pos;
+	}
+
+	// Each step, each moving average gains the value at its front boundary and loses the one at its back boundary
+	int32_t totals[kNumAverages][kHopSearchBlockSize];
+	for (int32_t i = 0; i < kNumAverages; i++) {
+		int32_t total = runningTotals[i];
+		for (int32_t c = 0; c < numCandidates; c++) {
+			total += values[i + 1][c] - values[i][c];
+			totals[i][c] = total;
+		}
+		runningTotals[i] = total;
+	}
+
+	int32_t oldHeadTotalsSum = 0;
+	for (int32_t i = 0; i < kNumAverages; i++) {
+		oldHeadTotalsSum += oldHeadTotals[i];
+	}
+
+	// Any values past numCandidates are junk, but they just give junk results which never get looked at
+	for (int32_t c = 0; c < numCandidates; c += 4) {
+		int32x4_t differenceAbs = vdupq_n_s32(0);
+		int32x4_t totalChange = vdupq_n_s32(-oldHeadTotalsSum);
+		for (int32_t i = 0; i < kNumAverages; i++) {
+			int32x4_t total = vld1q_s32(&totals[i][c]);
+			differenceAbs = vabaq_s32(differenceAbs, total, vdupq_n_s32(oldHeadTotals[i]));
+			totalChange = vaddq_s32(totalChange, total);
+		}
+		vst1q_s32(&differencesAbs[c], differenceAbs);
+		vst1q_s32(&totalChanges[c], totalChange);
+	}
+}
+
+// The same, one candidate at a time, which is how the search used to go. Only used by the benchmark, to check against
+static void compareHopCandidatesScalar(char const** currentPos, int32_t numCandidates, int32_t numChannels,
+                                       int32_t byteDepth, int32_t bytesPerSampleTimesSearchDirection,
+                                       int32_t searchDirectionRelativeToPlayDirection, int32_t const* oldHeadTotals,
+                                       int32_t* runningTotals, int32_t* differencesAbs, int32_t* totalChanges) {
+	constexpr int32_t kNumAverages = TimeStretch::Crossfade::kNumMovingAverages;
+
+	for (int32_t c = 0; c < numCandidates; c++) {
+		int32_t values[kNumAverages + 1];
+		for (int32_t i = 0; i < kNumAverages + 1; i++) {
+			int32_t value = *(int32_t*)currentPos[i] >> 16;
+			if (numChannels == 2) {
+				value += *(int32_t*)(currentPos[i] + byteDepth) >> 16;
+			}
+			values[i] = value * searchDirectionRelativeToPlayDirection;
+			currentPos[i] += bytesPerSampleTimesSearchDirection;
+		}
+
+		int32_t differenceAbs = 0;
+		int32_t totalChange = 0;
+		for (int32_t i = 0; i < kNumAverages; i++) {
+			runningTotals[i] += values[i + 1] - values[i];
+			differenceAbs += std::abs(runningTotals[i] - oldHeadTotals[i]);
+			totalChange += runningTotals[i] - oldHeadTotals[i];
+		}
+		differencesAbs[c] = differenceAbs;
+		totalChanges[c] = totalChange;
+	}
+}
+
+bool TimeStretcher::benchmarkUsingScalarSearch = false;
+int32_t* TimeStretcher::benchmarkHopLog = NULL;
+int32_t TimeStretcher::benchmarkHopLogLength = 0;
+int32_t TimeStretcher::benchmarkHopLogMaxLength = 0;
+
+constexpr int32_t kWholeHopBenchmarkBlockSize = 128;
+constexpr int32_t kWholeHopBenchmarkNumSourceSeconds = 3;
+
+// Plays the start of the Sample through a TimeStretcher for a second of output. Returns false if it stopped early
+static bool playThroughTimeStretcher(Sample* sample, VoiceSample* voiceSample, int32_t timeStretchRatio,
+                                     bool usingScalarSearch, int32_t* hopLog, int32_t* numHops,
+                                     uint32_t* outputHash, uint32_t* timeUS) {
+	SamplePlaybackGuide guide;
+	guide.audioFileHolder = NULL; // Only needed for caching, which we don't do
+	guide.playDirection = 1;
+	guide.startPlaybackAtByte = sample->audioDataStartPosBytes;
+	guide.endPlaybackAtByte = sample->audioDataStartPosBytes
+	                          + sample->sampleRate * kWholeHopBenchmarkNumSourceSeconds * sample->numChannels
+	                                * sample->byteDepth;
+	guide.sequenceSyncLengthTicks = 0;
+
+	jcong = 380116160; // So the random part of the hop lengths comes out the same every time
+	TimeStretcher::benchmarkUsingScalarSearch = usingScalarSearch;
+	TimeStretcher::benchmarkHopLog = hopLog;
+	TimeStretcher::benchmarkHopLogLength = 0;
+
+	voiceSample->noteOn(&guide, 0, 1);
+	bool stillActive = voiceSample->setupClusersForInitialPlay(&guide, sample, 0, false, 1);
+
+	int32_t outputBuffer[kWholeHopBenchmarkBlockSize * 2];
+	uint32_t hash = 2166136261;
+	*numHops = 0;
+	*timeUS = 0;
+
+	for (int32_t done = 0; done < (int32_t)sample->sampleRate && stillActive; done += kWholeHopBenchmarkBlockSize) {
+		memset(outputBuffer, 0, sizeof(outputBuffer));
+		AudioEngine::numHopsEndedThisRoutineCall = 0; // Or hops would start getting put off to spread the load
+
+		uint16_t startTime = *TCNT[TIMER_SYSTEM_FAST];
+		stillActive = voiceSample->render(&guide, outputBuffer, kWholeHopBenchmarkBlockSize, sample,
+		                                  sample->numChannels, LoopType::NONE, 16777216, timeStretchRatio, 134217728,
+		                                  0, kInterpolationMaxNumSamples, InterpolationMode::SMOOTH, 1);
+		uint16_t endTime = *TCNT[TIMER_SYSTEM_FAST];
+		*timeUS += fastTimerCountToUS((uint16_t)(endTime - startTime));
+		*numHops += AudioEngine::numHopsEndedThisRoutineCall;
+
+		for (int32_t i = 0; i < kWholeHopBenchmarkBlockSize * 2; i++) {
+			hash = (hash ^ outputBuffer[i]) * 16777619;
+		}
+	}
+
+	voiceSample->beenUnassigned();
+	TimeStretcher::benchmarkUsingScalarSearch = false;
+	TimeStretcher::benchmarkHopLog = NULL;
+
+	*outputHash = hash;
+	return stillActive;
+}
+
+// Then whole hops, on the first Sample in the song that's long enough, at a few ratios. Each one gets played through
+// once to get its percussiveness worked out, then timed with the NEON search and with the scalar one, which should
+// pick exactly the same hops and make exactly the same output
+static void runWholeHopBenchmark() {
+	constexpr int32_t kMaxNumClusters = 128;
+	constexpr int32_t kMaxNumHops = 512;
+	static const int32_t timeStretchRatios[] = {8388608, 12582912, 25165824, 33554432}; // 0.5, 0.75, 1.5, 2
+
+	Sample* sample = NULL;
+	for (int32_t e = 0; e < audioFileManager.audioFiles.getNumElements(); e++) {
+		AudioFile* audioFile = (AudioFile*)audioFileManager.audioFiles.getElement(e);
+		if (audioFile->type == AudioFileType::SAMPLE && !((Sample*)audioFile)->unplayable
+		    && ((Sample*)audioFile)->lengthInSamples
+		           >= (uint64_t)((Sample*)audioFile)->sampleRate * kWholeHopBenchmarkNumSourceSeconds) {
+			sample = (Sample*)audioFile;
+			break;
+		}
+	}
+	if (!sample) {
+		Debug::println("Whole hop benchmark: needs a song with a sample of at least 3 seconds");
+		return;
+	}
+
+	uint32_t endByte = sample->audioDataStartPosBytes
+	                   + sample->sampleRate * kWholeHopBenchmarkNumSourceSeconds * sample->numChannels
+	                         * sample->byteDepth;
+	int32_t numClustersNeeded = ((endByte - 1) >> audioFileManager.clusterSizeMagnitude) + 1;
+	if (numClustersNeeded > kMaxNumClusters) {
+		Debug::println("Whole hop benchmark: clusters too small");
+		return;
+	}
+
+	// Get it all loaded first, so both searches see the same thing
+	Cluster* clusters[kMaxNumClusters];
+	int32_t numClusters = 0;
+	while (numClusters < numClustersNeeded) {
+		Cluster* cluster =
+		    sample->clusters.getElement(numClusters)->getCluster(sample, numClusters, CLUSTER_LOAD_IMMEDIATELY);
+		if (!cluster) {
+			break;
+		}
+		clusters[numClusters++] = cluster;
+	}
+
+	int32_t* hopLogs = (int32_t*)GeneralMemoryAllocator::get().alloc(kMaxNumHops * 2 * sizeof(int32_t));
+	VoiceSample* voiceSample = AudioEngine::solicitVoiceSample();
+
+	if (numClusters < numClustersNeeded || !hopLogs || !voiceSample) {
+		Debug::println("Whole hop benchmark: couldn't load sample, or no RAM");
+	}
+	else {
+		TimeStretcher::benchmarkHopLogMaxLength = kMaxNumHops;
+
+		for (int32_t timeStretchRatio : timeStretchRatios) {
+			int32_t numHops[2];
+			uint32_t outputHashes[2];
+			uint32_t timesUS[2];
+			bool finished = playThroughTimeStretcher(sample, voiceSample, timeStretchRatio, false, hopLogs,
+			                                         &numHops[0], &outputHashes[0], &timesUS[0]);
+			for (int32_t scalar = 0; scalar < 2 && finished; scalar++) {
+				finished = playThroughTimeStretcher(sample, voiceSample, timeStretchRatio, scalar,
+				                                    &hopLogs[scalar * kMaxNumHops], &numHops[scalar],
+				                                    &outputHashes[scalar], &timesUS[scalar]);
+			}
+			if (!finished) {
+				Debug::println("Whole hop benchmark: playback stopped early");
+				break;
+			}
+
+			int32_t numHopsLogged = std::min(numHops[0], kMaxNumHops);
+			int32_t firstDifferentHop = -1;
+			if (numHops[0] != numHops[1]) {
+				firstDifferentHop = numHopsLogged;
+			}
+			for (int32_t h = 0; h < numHopsLogged && h < numHops[1]; h++) {
+				if (hopLogs[h] != hopLogs[kMaxNumHops + h]) {
+					firstDifferentHop = h;
+					break;
+				}
+			}
+
+			Debug::print("Whole hop benchmark, ratio x1000: ");
+			Debug::print(((int64_t)timeStretchRatio * 1000) >> 24);
+			Debug::print(", hops: ");
+			Debug::print(numHops[0]);
+			Debug::print(", hops per sec NEON / scalar: ");
+			Debug::print(timesUS[0] ? (uint32_t)((uint64_t)numHops[0] * 1000000 / timesUS[0]) : 0);
+			Debug::print(" / ");
+			Debug::print(timesUS[1] ? (uint32_t)((uint64_t)numHops[1] * 1000000 / timesUS[1]) : 0);
+			Debug::print(", first different hop: ");
+			Debug::print(firstDifferentHop);
+			Debug::print(", output ");
+			Debug::println((outputHashes[0] == outputHashes[1]) ? "same" : "DIFFERENT");
+		}
+
+		TimeStretcher::benchmarkHopLogMaxLength = 0;
+	}
+
+	if (voiceSample) {
+		AudioEngine::voiceSampleUnassigned(voiceSample);
+	}
+	if (hopLogs) {
+		GeneralMemoryAllocator::get().dealloc(hopLogs);
+	}
+	for (int32_t c = 0; c < numClusters; c++) {
+		audioFileManager.removeReasonFromCluster(clusters[c], "E459");
+	}
+}
+
+// Times compareHopCandidates() over a full-length search on made-up audio, and checks it gets the same answers as
+// working through the candidates one at a time. Then does the same for whole hops, with runWholeHopBenchmark()
+void TimeStretcher::runHopSearchBenchmark() {
+	constexpr int32_t kNumAverages = TimeStretch::Crossfade::kNumMovingAverages;
+	constexpr int32_t kLengthToAverageEach = TimeStretch::Crossfade::kMovingAverageLength;
+	constexpr int32_t kSearchSize = 441; // The most a search in one direction will go, at 44.1kHz
+	constexpr int32_t kNumSearches = 64;
+	constexpr int32_t kNumChannels = 2;
+	constexpr int32_t kByteDepth = 2;
+	constexpr int32_t kBytesPerSample = kNumChannels * kByteDepth;
+
+	// A bit spare at the start, because reads begin 4 bytes back from the end of each sample
+	int32_t numSamples = kNumAverages * kLengthToAverageEach + kSearchSize + 2;
+	int32_t memorySize = numSamples * kBytesPerSample;
+	char* memory = (char*)GeneralMemoryAllocator::get().alloc(memorySize);
+	if (!memory) {
+		Debug::println("Hop search benchmark: no RAM");
+		return;
+	}
+
+	// Low-ish frequency sawtooths plus noise, so the totals actually go up and down and change sign
+	uint32_t randomState = 12345;
+	int16_t* samples = (int16_t*)memory;
+	for (int32_t i = 0; i < numSamples * kNumChannels; i++) {
+		randomState = randomState * 1664525 + 1013904223;
+		samples[i] = (int16_t)((i * 97) & 0x3FFF) - 0x2000 + ((int32_t)randomState >> 20);
+	}
+
+	int32_t oldHeadTotals[kNumAverages];
+	for (int32_t i = 0; i < kNumAverages; i++) {
+		oldHeadTotals[i] = (i - 1) * 1000;
+	}
+
+	uint32_t totalTimeUS = 0;
+	uint32_t maxTimeUS = 0;
+	int32_t numMismatches = 0;
+
+	for (int32_t search = 0; search < kNumSearches; search++) {
+		int32_t startTotals[kNumAverages];
+		for (int32_t i = 0; i < kNumAverages; i++) {
+			startTotals[i] = search * 100 - i * 500;
+		}
+
+		char const* firstPos = memory + kBytesPerSample - 4 + kByteDepth;
+
+		char const* currentPos[kNumAverages + 1];
+		int32_t runningTotals[kNumAverages];
+		for (int32_t i = 0; i < kNumAverages + 1; i++) {
+			currentPos[i] = firstPos + i * kLengthToAverageEach * kBytesPerSample;
+		}
+		memcpy(runningTotals, startTotals, sizeof(runningTotals));
+
+		int32_t differencesAbs[kSearchSize + kHopSearchBlockSize];
+		int32_t totalChanges[kSearchSize + kHopSearchBlockSize];
+
+		uint16_t startTime = *TCNT[TIMER_SYSTEM_FAST];
+		for (int32_t c = 0; c < kSearchSize; c += kHopSearchBlockSize) {
+			int32_t numCandidates = std::min(kSearchSize - c, kHopSearchBlockSize);
+			compareHopCandidates(currentPos, numCandidates, kNumChannels, kByteDepth, kBytesPerSample, 1, oldHeadTotals,
+			                     runningTotals, &differencesAbs[c], &totalChanges[c]);
+		}
+		uint16_t endTime = *TCNT[TIMER_SYSTEM_FAST];
+		uint32_t timeUS = fastTimerCountToUS((uint16_t)(endTime - startTime));
+		totalTimeUS += timeUS;
+		maxTimeUS = std::max(maxTimeUS, timeUS);
+
+		// And the straightforward way
+		memcpy(runningTotals, startTotals, sizeof(runningTotals));
+		for (int32_t c = 0; c < kSearchSize; c++) {
+			int32_t values[kNumAverages + 1];
+			for (int32_t i = 0; i < kNumAverages + 1; i++) {
+				char const* pos = firstPos + (i * kLengthToAverageEach + c) * kBytesPerSample;
+				values[i] = (*(int32_t*)pos >> 16) + (*(int32_t*)(pos + kByteDepth) >> 16);
+			}
+			int32_t differenceAbs = 0;
+			int32_t totalChange = 0;
+			for (int32_t i = 0; i < kNumAverages; i++) {
+				runningTotals[i] += values[i + 1] - values[i];
+				differenceAbs += std::abs(runningTotals[i] - oldHeadTotals[i]);
+				totalChange += runningTotals[i] - oldHeadTotals[i];
+			}
+			if (differenceAbs != differencesAbs[c] || totalChange != totalChanges[c]) {
+				numMismatches++;
+			}
+		}
+	}
+
+	Debug::print("Hop search benchmark, candidates: ");
+	Debug::print(kSearchSize);
+	Debug::print(", mismatches: ");
+	Debug::print(numMismatches);
+	Debug::print(", uS per search avg / max: ");
+	Debug::print(totalTimeUS / kNumSearches);
+	Debug::print(" / ");
+	Debug::println(maxTimeUS);
+
+	GeneralMemoryAllocator::get().dealloc(memory);
+
+	runWholeHopBenchmark();
+}
+
 // Returns false if sound needs to cut due to a load error or similar
 bool TimeStretcher::hopEnd(SamplePlaybackGuide* guide, VoiceSample* voiceSample, Sample* sample, int32_t numChannels,
                            int32_t timeStretchRatio, int32_t phaseIncrement, uint64_t combinedIncrement,
@@ -737,92 +1097,83 @@ startSearch:
 				currentPos[i] = &cluster->data[bytePosWithinCluster] - 4 + byteDepth;
 			}
 
-			// Alright, read those samples for our currently worked out little bit until we reach a cluster boundary or something
-			int32_t endOffset = offsetNow + numSamplesThisRead * bytesPerSampleTimesSearchDirection;
-			do { // For each individual sample (well, actually, we're gonna read like 3 different, spaced ones at a time)
-
-				int32_t readValueRelativeToBothDirections;
-				int32_t thisRunningTotal;
-				int32_t i = 0;
-
-				goto entryPoint;
-
-				// Grab this sample for each moving-average-boundary
-				for (; i < TimeStretch::Crossfade::kNumMovingAverages + 1; i++) { // Manually unrolling didn't speed up
-
-					thisRunningTotal = newHeadRunningTotals[i - 1]
-					                   - readValueRelativeToBothDirections; // Subtracts the one from last iteration
-entryPoint:
+			// Alright, read those samples for our currently worked out little bit until we reach a cluster boundary or
+			// something - a block of candidate offsets at a time
+			int32_t numSamplesLeftThisRead = numSamplesThisRead;
+			while (numSamplesLeftThisRead) {
+				int32_t numCandidates = std::min(numSamplesLeftThisRead, kHopSearchBlockSize);
+
+				int32_t differencesAbs[kHopSearchBlockSize];
+				int32_t totalChanges[kHopSearchBlockSize];
+				if (benchmarkUsingScalarSearch) {
+					compareHopCandidatesScalar(
+					    currentPos, numCandidates, numChannels, byteDepth, bytesPerSampleTimesSearchDirection,
+					    searchDirectionRelativeToPlayDirection, oldHeadTotals, newHeadRunningTotals, differencesAbs,
+					    totalChanges);
+				}
+				else {
+					compareHopCandidates(currentPos, numCandidates, numChannels, byteDepth,
+					                     bytesPerSampleTimesSearchDirection, searchDirectionRelativeToPlayDirection,
+					                     oldHeadTotals, newHeadRunningTotals, differencesAbs, totalChanges);
+				}
 
-					int32_t readValueHere = *(int32_t*)currentPos[i] >> 16;
+				// Then go through the results in order, as if we'd done them one by one
+				for (int32_t c = 0; c < numCandidates; c++) {
+					int32_t differenceAbs = differencesAbs[c];
 
-					if (numChannels == 2) {
-						readValueHere += *(int32_t*)(currentPos[i] + byteDepth) >> 16;
+					// If our very first read is worse, let's switch search direction right now - that'll improve our odds
+					if (offsetNow == 0 && searchDirectionRelativeToPlayDirection == 1 && !numFullDirectionsSearched
+					    && differenceAbs > bestDifferenceAbs) {
+						goto restartSearchWithOtherDirection;
 					}
 
-					currentPos[i] += bytesPerSampleTimesSearchDirection;
-
-					readValueRelativeToBothDirections = readValueHere * searchDirectionRelativeToPlayDirection;
+					offsetNow += bytesPerSampleTimesSearchDirection;
 
-					if (i > 0) {
-						thisRunningTotal += readValueRelativeToBothDirections;
-						newHeadRunningTotals[i - 1] = thisRunningTotal;
+					// Keep track of best match
+					bool thisOffsetIsBestMatch = (differenceAbs < bestDifferenceAbs);
+					if (thisOffsetIsBestMatch) {
+						bestDifferenceAbs = differenceAbs;
+						bestOffset = offsetNow;
 					}
-				}
-
-				int32_t differenceAbs = getTotalDifferenceAbs(oldHeadTotals, newHeadRunningTotals);
 
-				// If our very first read is worse, let's switch search direction right now - that'll improve our odds
-				if (offsetNow == 0 && searchDirectionRelativeToPlayDirection == 1 && !numFullDirectionsSearched
-				    && differenceAbs > bestDifferenceAbs) {
-					goto restartSearchWithOtherDirection;
-				}
-
-				offsetNow += bytesPerSampleTimesSearchDirection;
-
-				// Keep track of best match
-				bool thisOffsetIsBestMatch = (differenceAbs < bestDifferenceAbs);
-				if (thisOffsetIsBestMatch) {
-					bestDifferenceAbs = differenceAbs;
-					bestOffset = offsetNow;
-				}
-
-				int32_t thisTotalChange = getTotalChange(oldHeadTotals, newHeadRunningTotals);
-
-				// If sign just flipped...
-				if (((uint32_t)thisTotalChange >> 31) != ((uint32_t)lastTotalChange >> 31)) {
-
-					// Try going in between the samples for the most accurate positioning, lining-up-wise.
-					// The benefit of this is visible on a spectrum analysis if you're pitching a high-pitched sine wave right down, while also time stretching it
-					if (phaseIncrement != 16777216
-					    && (thisOffsetIsBestMatch
-					        || bestOffset
-					               == offsetNow
-					                      - bytesPerSampleTimesSearchDirection)) { // If best was this one or last one
-						uint32_t thisTotalDifferenceAbs = std::abs(thisTotalChange);
-						uint32_t lastTotalDifferenceAbs = std::abs(lastTotalChange);
-						additionalOscPos = ((uint64_t)lastTotalDifferenceAbs << 24)
-						                   / (uint32_t)(lastTotalDifferenceAbs + thisTotalDifferenceAbs);
-						if (searchDirectionRelativeToPlayDirection == -1) {
-							additionalOscPos = 16777216 - additionalOscPos;
+					int32_t thisTotalChange = totalChanges[c];
+
+					// If sign just flipped...
+					if (((uint32_t)thisTotalChange >> 31) != ((uint32_t)lastTotalChange >> 31)) {
+
+						// Try going in between the samples for the most accurate positioning, lining-up-wise.
+						// The benefit of this is visible on a spectrum analysis if you're pitching a high-pitched sine wave right down, while also time stretching it
+						// (If best was this one or last one)
+						if (phaseIncrement != 16777216
+						    && (thisOffsetIsBestMatch
+						        || bestOffset == offsetNow - bytesPerSampleTimesSearchDirection)) {
+							uint32_t thisTotalDifferenceAbs = std::abs(thisTotalChange);
+							uint32_t lastTotalDifferenceAbs = std::abs(lastTotalChange);
+							additionalOscPos = ((uint64_t)lastTotalDifferenceAbs << 24)
+							                   / (uint32_t)(lastTotalDifferenceAbs + thisTotalDifferenceAbs);
+							if (searchDirectionRelativeToPlayDirection == -1) {
+								additionalOscPos = 16777216 - additionalOscPos;
+							}
+							if (thisOffsetIsBestMatch != (searchDirectionRelativeToPlayDirection == -1)) {
+								bestOffset -= bytesPerSample * playDirection;
+							}
 						}
-						if (thisOffsetIsBestMatch != (searchDirectionRelativeToPlayDirection == -1)) {
-							bestOffset -= bytesPerSample * playDirection;
-						}
-					}
 
-					// After sign has flipped a certain number of times (in total, including both search directions), we can be fairly sure we've found a good fit
-					// This needs to be 4. Any less, and we start getting lots of bad alignments - I did tests. But 4 sounds basically as good as no limit.
-					timesSignFlipped++;
+						// After sign has flipped a certain number of times (in total, including both search directions), we can be fairly sure we've found a good fit
+						// This needs to be 4. Any less, and we start getting lots of bad alignments - I did tests. But 4 sounds basically as good as no limit.
+						timesSignFlipped++;
 #if !MEASURE_HOP_END_PERFORMANCE
-					if (timesSignFlipped >= 4) {
-						goto stopSearch;
-					}
+						if (timesSignFlipped >= 4) {
+							goto stopSearch;
+						}
 #endif
+					}
+
+					lastTotalChange = thisTotalChange;
 				}
 
-				lastTotalChange = thisTotalChange;
-			} while (offsetNow != endOffset);
+				numSamplesLeftThisRead -= numCandidates;
+			}
 
 			numSamplesLeftThisSearch -= numSamplesThisRead;
 
@@ -862,6 +1213,10 @@ stopSearch:
 
 skipSearch:
 
+	if (benchmarkHopLog && benchmarkHopLogLength < benchmarkHopLogMaxLength) {
+		benchmarkHopLog[benchmarkHopLogLength++] = newHeadBytePos;
+	}
+
 #if TIME_STRETCH_ENABLE_BUFFER
 	// If we might want to set up reading from buffer...
 	if (bufferFillingMode != BUFFER_FILLING_OFF // If not OFF, it can only be OLDER or NEITHER - it gets changed above
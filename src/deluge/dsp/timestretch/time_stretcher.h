@@ -50,6 +50,15 @@ public:
 	            int32_t timeStretchRatio, int32_t phaseIncrement, uint64_t combinedIncrement, int32_t playDirection,
 	            LoopType loopingType, int32_t priorityRating);
 
+	static void runHopSearchBenchmark();
+
+	// Only for the benchmark. Has hopEnd() compare the search's candidates one at a time, and note down where each
+	// hop's new play-head starts
+	static bool benchmarkUsingScalarSearch;
+	static int32_t* benchmarkHopLog;
+	static int32_t benchmarkHopLogLength;
+	static int32_t benchmarkHopLogMaxLength;
+
 	void rememberPercCacheCluster(Cluster* cluster);
 	void updateClustersForPercLookahead(Sample* sample, uint32_t sourceBytePos, int32_t playDirection);
 
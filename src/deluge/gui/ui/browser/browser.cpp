@@ -32,6 +32,7 @@
 #include "model/song/song.h"
 #include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
+#include "storage/directory_index.h"
 #include "storage/file_item.h"
 #include "storage/storage_manager.h"
 #include "util/functions.h"
@@ -225,6 +226,25 @@ deleteFromRightSide:
 	}
 }
 
+static bool shouldShowItem(char const* filename, bool isFolder, bool allowFolders,
+                           char const** allowedFileExtensionsHere) {
+	if (isFolder) {
+		return allowFolders;
+	}
+
+	char const* dotPos = strrchr(filename, '.');
+	if (!dotPos) {
+		return false;
+	}
+	char const* fileExtension = dotPos + 1;
+	for (char const** thisExtension = allowedFileExtensionsHere; *thisExtension; thisExtension++) {
+		if (!strcasecmp(fileExtension, *thisExtension)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 int32_t Browser::readFileItemsForFolder(char const* filePrefixHere, bool allowFolders,
                                         char const** allowedFileExtensionsHere, char const* filenameToStartAt,
                                         int32_t newMaxNumFileItems, int32_t newCatalogSearchDirection) {
@@ -259,6 +279,31 @@ int32_t Browser::readFileItemsForFolder(char const* filePrefixHere, bool allowFo
 	maxNumFileItemsNow = newMaxNumFileItems;
 	filenameToStartSearchAt = filenameToStartAt;
 
+	// On OLED, where display names are just the filenames, we can use the folder's sorted index if there is one, and
+	// only look at the entries around where we want to be
+	if (display->haveOLED()) {
+		error = DirectoryIndex::open(currentDir.get(), &staticDIR, shouldInterpretNoteNamesForThisBrowser);
+		if (!error) {
+			error = readFileItemsFromDirectoryIndex(allowFolders, allowedFileExtensionsHere);
+			DirectoryIndex::close();
+			f_closedir(&staticDIR);
+			if (error) {
+				emptyFileItems();
+			}
+			return error;
+		}
+
+		// Otherwise, read the folder the normal way
+		Debug::print("couldn't use directory index: ");
+		Debug::println(error);
+		error = NO_ERROR;
+		result = f_readdir(&staticDIR, NULL); // Rewind
+		if (result) {
+			f_closedir(&staticDIR);
+			return fresultToDelugeErrorCode(result);
+		}
+	}
+
 	int32_t filePrefixLength;
 
 	if (display->have7SEG()) {
@@ -282,25 +327,8 @@ int32_t Browser::readFileItemsForFolder(char const* filePrefixHere, bool allowFo
 			continue; /* Ignore dot entry */
 		}
 		bool isFolder = staticFNO.fattrib & AM_DIR;
-		if (isFolder) {
-			if (!allowFolders) {
-				continue;
-			}
-		}
-		else {
-			char const* dotPos = strrchr(staticFNO.fname, '.');
-			if (!dotPos) {
-extensionNotSupported:
-				continue;
-			}
-			char const* fileExtension = dotPos + 1;
-			char const** thisExtension = allowedFileExtensionsHere;
-			while (strcasecmp(fileExtension, *thisExtension)) {
-				thisExtension++;
-				if (!*thisExtension) {
-					goto extensionNotSupported; // If reached end of list
-				}
-			}
+		if (!shouldShowItem(staticFNO.fname, isFolder, allowFolders, allowedFileExtensionsHere)) {
+			continue;
 		}
 
 		FileItem* thisItem = getNewFileItem();
@@ -366,6 +394,132 @@ nonNumericFile:
 	return error;
 }
 
+// Fills fileItems with the same window of the folder's contents that reading the whole folder and culling it as we go
+// would have left us with - but reading just that window (and one more entry either side) from the DirectoryIndex.
+// DirectoryIndex must be open. Returns error
+int32_t Browser::readFileItemsFromDirectoryIndex(bool allowFolders, char const** allowedFileExtensionsHere) {
+	DirectoryIndex::Entry entry;
+	int32_t error;
+
+	int32_t startIndex = 0; // Where the search term would go, or the start if there isn't one
+	if (filenameToStartSearchAt && *filenameToStartSearchAt) {
+		error = DirectoryIndex::search(filenameToStartSearchAt, &startIndex);
+		if (error) {
+			return error;
+		}
+	}
+	else if (catalogSearchDirection == CATALOG_SEARCH_LEFT) {
+		startIndex = DirectoryIndex::numEntries;
+	}
+
+	// Work out our window, [windowStart, windowEnd), of index entries. Going right from startIndex first, then left,
+	// in the proportions the search direction wants
+	int32_t numWantedRight = (catalogSearchDirection == CATALOG_SEARCH_RIGHT)  ? maxNumFileItemsNow
+	                         : (catalogSearchDirection == CATALOG_SEARCH_LEFT) ? 0
+	                                                                           : (maxNumFileItemsNow >> 1);
+	int32_t windowStart = startIndex;
+	int32_t windowEnd = startIndex;
+	int32_t numInWindow = 0;
+	bool anyFurtherRight = false;
+	bool anyFurtherLeft = false;
+
+	while (windowEnd < DirectoryIndex::numEntries) {
+		error = DirectoryIndex::readEntry(windowEnd, &entry);
+		if (error) {
+			return error;
+		}
+		if (shouldShowItem(entry.name, entry.isFolder, allowFolders, allowedFileExtensionsHere)) {
+			if (numInWindow >= numWantedRight) {
+				anyFurtherRight = true;
+				break;
+			}
+			numInWindow++;
+		}
+		windowEnd++;
+	}
+
+	// When searching right, anything to the left would just get deleted again, so we only need to know if it's there
+	int32_t maxNumInWindow = (catalogSearchDirection == CATALOG_SEARCH_RIGHT) ? numInWindow : maxNumFileItemsNow;
+
+	while (windowStart > 0) {
+		error = DirectoryIndex::readEntry(windowStart - 1, &entry);
+		if (error) {
+			return error;
+		}
+		if (shouldShowItem(entry.name, entry.isFolder, allowFolders, allowedFileExtensionsHere)) {
+			if (numInWindow >= maxNumInWindow) {
+				anyFurtherLeft = true;
+				break;
+			}
+			numInWindow++;
+		}
+		windowStart--;
+	}
+
+	// If we ran out to the left, give any spare room to the right
+	if (!anyFurtherLeft && anyFurtherRight && catalogSearchDirection == CATALOG_SEARCH_BOTH) {
+		anyFurtherRight = false;
+		while (windowEnd < DirectoryIndex::numEntries) {
+			error = DirectoryIndex::readEntry(windowEnd, &entry);
+			if (error) {
+				return error;
+			}
+			if (shouldShowItem(entry.name, entry.isFolder, allowFolders, allowedFileExtensionsHere)) {
+				if (numInWindow >= maxNumFileItemsNow) {
+					anyFurtherRight = true;
+					break;
+				}
+				numInWindow++;
+			}
+			windowEnd++;
+		}
+	}
+
+	// Now actually read the window in
+	for (int32_t i = windowStart; i < windowEnd; i++) {
+		audioFileManager.loadAnyEnqueuedClusters();
+
+		error = DirectoryIndex::readEntry(i, &entry);
+		if (error) {
+			return error;
+		}
+		if (!shouldShowItem(entry.name, entry.isFolder, allowFolders, allowedFileExtensionsHere)) {
+			continue;
+		}
+
+		FileItem* thisItem = getNewFileItem();
+		if (!thisItem) {
+			return ERROR_INSUFFICIENT_RAM;
+		}
+		error = thisItem->filename.set(entry.name);
+		if (error) {
+			return error;
+		}
+		thisItem->isFolder = entry.isFolder;
+		thisItem->filePointer = entry.filePointer;
+		thisItem->displayName = thisItem->filename.get();
+	}
+
+	// Record what's beyond the window in the same way cullSomeFileItems() would have. Items before or after the search
+	// term, when that's the direction we're not looking in, don't get a "remaining" name - sortFileItems() deals with
+	// those
+	if (anyFurtherLeft) {
+		numFileItemsDeletedAtStart = 1;
+		if (catalogSearchDirection != CATALOG_SEARCH_RIGHT && fileItems.getNumElements()) {
+			firstFileItemRemaining = ((FileItem*)fileItems.getElementAddress(0))->displayName;
+		}
+	}
+	if (anyFurtherRight) {
+		numFileItemsDeletedAtEnd = 1;
+		if (catalogSearchDirection != CATALOG_SEARCH_LEFT && fileItems.getNumElements()) {
+			lastFileItemRemaining =
+			    ((FileItem*)fileItems.getElementAddress(fileItems.getNumElements() - 1))->displayName;
+		}
+	}
+
+	return NO_ERROR;
+}
+
 void Browser::deleteFolderAndDuplicateItems(Availability instrumentAvailabilityRequirement) {
 	int32_t writeI = 0;
 	FileItem* nextItem = (FileItem*)fileItems.getElementAddress(0);
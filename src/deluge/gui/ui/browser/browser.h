@@ -118,6 +118,7 @@ protected:
 	                                         bool allowFoldersint,
 	                                         Availability availabilityRequirement = Availability::ANY,
 	                                         int32_t newCatalogSearchDirection = CATALOG_SEARCH_RIGHT);
+	int32_t readFileItemsFromDirectoryIndex(bool allowFolders, char const** allowedFileExtensionsHere);
 
 	static int32_t
 	    fileIndexSelected; // If -1, we have not selected any real file/folder. Maybe there are no files, or maybe we're typing a new name.
@@ -53,6 +53,7 @@
 #include "model/instrument/instrument.h"
 #include "model/model_stack.h"
 #include "model/note/note_row.h"
+#include "model/sample/sample_analysis.h"
 #include "model/song/song.h"
 #include "modulation/automation/auto_param.h"
 #include "modulation/params/param_manager.h"
@@ -588,6 +589,10 @@ void SampleBrowser::previewIfPossible(int32_t movementDirection) {
 				waveformBasicNavigator.sample = (Sample*)sample;
 				waveformBasicNavigator.opened();
 
+				// User may well be about to load it, so get its levels ready in the meantime. That reads in its
+				// pitch too, if that's been detected before
+				SampleAnalysis::analysisWanted((Sample*)sample);
+
 				// If want scrolling animation
 				if (movementDirection) {
 					waveformRenderer.renderFullScreen(waveformBasicNavigator.sample, waveformBasicNavigator.xScroll,
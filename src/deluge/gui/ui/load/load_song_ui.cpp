@@ -41,8 +41,11 @@
 #include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
 #include "storage/file_item.h"
+#include "storage/song_index.h"
 #include "storage/storage_manager.h"
 #include "util/functions.h"
+#include "util/lookuptables/lookuptables.h"
+#include <algorithm>
 #include <new>
 #include <string.h>
 
@@ -60,6 +63,7 @@ LoadSongUI::LoadSongUI() {
 	qwertyAlwaysVisible = false;
 	filePrefix = "SONG";
 	title = "Load song";
+	songInfoText[0] = 0;
 }
 
 bool LoadSongUI::opened() {
@@ -152,6 +156,7 @@ void LoadSongUI::enterKeyPress() {
 
 		if (error) {
 			display->displayError(error);
+			SongIndex::close();
 			close(); // Don't use goBackToSoundEditor() because that would do a left-scroll
 			return;
 		}
@@ -237,6 +242,7 @@ void LoadSongUI::performLoad() {
 	}
 
 	actionLogger.deleteAllLogs();
+	SongIndex::close();
 
 	if (arrangement.hasPlaybackActive()) {
 		playbackHandler.switchToSession();
@@ -504,6 +510,7 @@ void LoadSongUI::exitActionWithError() {
 
 void LoadSongUI::exitThisUI() {
 	currentUIMode = UI_MODE_NONE;
+	SongIndex::close();
 	close();
 }
 
@@ -687,30 +694,15 @@ void LoadSongUI::exitAction() {
 	timerCallback();
 }
 
-void LoadSongUI::drawSongPreview(bool toStore) {
-
-	uint8_t(*imageStore)[kDisplayWidth + kSideBarWidth][3];
-	if (toStore) {
-		imageStore = PadLEDs::imageStore;
-	}
-	else {
-		imageStore = PadLEDs::image;
-	}
+// Returns error. If there's no error but the preview couldn't all be read, *gotWholePreview comes back false
+static int32_t readSongPreviewFromFile(FileItem* fileItem,
+                                       uint8_t preview[kDisplayHeight][kDisplayWidth + kSideBarWidth][3],
+                                       bool* gotWholePreview) {
+	*gotWholePreview = false;
 
-	memset(imageStore, 0, kDisplayHeight * (kDisplayWidth + kSideBarWidth) * 3);
-
-	FileItem* currentFileItem = getCurrentFileItem();
-
-	if (!currentFileItem || currentFileItem->isFolder) {
-		return;
-	}
-
-	int32_t error = storageManager.openXMLFile(&currentFileItem->filePointer, "song", "", true);
+	int32_t error = storageManager.openXMLFile(&fileItem->filePointer, "song", "", true);
 	if (error) {
-		if (error) {
-			display->displayError(error);
-			return;
-		}
+		return error;
 	}
 
 	char const* tagName;
@@ -731,7 +723,6 @@ void LoadSongUI::drawSongPreview(bool toStore) {
 				endX = 14;
 				startY = 2;
 				endY = 6;
-				memset(imageStore, 0, sizeof(imageStore));
 			}
 			else {
 				startX = startY = 0;
@@ -754,12 +745,12 @@ void LoadSongUI::drawSongPreview(bool toStore) {
 
 				for (int32_t x = startX; x < endX; x++) {
 					for (int32_t colour = 0; colour < 3; colour++) {
-						imageStore[y][x][colour] = hexToByte(hexChars);
+						preview[y][x][colour] = hexToByte(hexChars);
 						hexChars += 2;
 					}
-					greyColourOut(imageStore[y][x], imageStore[y][x], 6500000);
 				}
 			}
+			*gotWholePreview = true;
 			goto stopLoadingPreview;
 		}
 		else {
@@ -768,6 +759,104 @@ void LoadSongUI::drawSongPreview(bool toStore) {
 	}
 stopLoadingPreview:
 	storageManager.closeFile();
+	return NO_ERROR;
+}
+
+void LoadSongUI::drawSongPreview(bool toStore) {
+
+	uint8_t(*imageStore)[kDisplayWidth + kSideBarWidth][3];
+	if (toStore) {
+		imageStore = PadLEDs::imageStore;
+	}
+	else {
+		imageStore = PadLEDs::image;
+	}
+
+	memset(imageStore, 0, kDisplayHeight * (kDisplayWidth + kSideBarWidth) * 3);
+
+	FileItem* currentFileItem = getCurrentFileItem();
+
+	if (!currentFileItem || currentFileItem->isFolder) {
+		setSongInfoText(NULL);
+		return;
+	}
+
+	String filename;
+	int32_t error = currentFileItem->getFilenameWithExtension(&filename);
+	if (error) {
+		setSongInfoText(NULL);
+		display->displayError(error);
+		return;
+	}
+
+	// If the song's in the index, we don't need to go anywhere near its XML file
+	SongIndex::Info info;
+	if (!SongIndex::find(currentDir.get(), filename.get(), &currentFileItem->filePointer, &info)) {
+		memset(info.preview, 0, sizeof(info.preview));
+		bool gotWholePreview;
+		error = readSongPreviewFromFile(currentFileItem, info.preview, &gotWholePreview);
+		if (error) {
+			setSongInfoText(NULL);
+			display->displayError(error);
+			return;
+		}
+
+		// So it's there next time
+		info.flags = 0;
+		if (gotWholePreview) {
+			SongIndex::add(currentDir.get(), filename.get(), &currentFileItem->filePointer, &info);
+		}
+	}
+
+	setSongInfoText((info.flags & SONG_INFO_HAS_METADATA) ? &info : NULL);
+
+	for (int32_t y = 0; y < kDisplayHeight; y++) {
+		for (int32_t x = 0; x < kDisplayWidth + kSideBarWidth; x++) {
+			greyColourOut(info.preview[y][x], imageStore[y][x], 6500000);
+		}
+	}
+}
+
+// Gets called after the browser's already drawn the OLED for the newly selected file, so draws it again if need be
+void LoadSongUI::setSongInfoText(SongIndex::Info const* info) {
+	char newText[sizeof(songInfoText)];
+	newText[0] = 0;
+
+	if (info && display->haveOLED()) {
+		intToString(std::clamp<int32_t>(info->tempoBPM + 0.5f, 0, 9999), newText);
+		strcat(newText, " BPM ");
+		int32_t noteCodeWithinOctave = (uint16_t)(info->rootNote + 120) % (uint8_t)12;
+		char* thisChar = &newText[strlen(newText)];
+		*(thisChar++) = noteCodeToNoteLetter[noteCodeWithinOctave];
+		if (noteCodeIsSharp[noteCodeWithinOctave]) {
+			*(thisChar++) = '#';
+		}
+		*thisChar = 0;
+		if (info->presetScale < NUM_PRESET_SCALES) {
+			strcat(newText, " ");
+			strcat(newText, presetScaleNames[info->presetScale]);
+		}
+	}
+
+	if (strcmp(newText, songInfoText)) {
+		strcpy(songInfoText, newText);
+		if (display->haveOLED()) {
+			renderUIsForOled();
+		}
+	}
+}
+
+void LoadSongUI::renderOLED(uint8_t image[][OLED_MAIN_WIDTH_PIXELS]) {
+	LoadUI::renderOLED(image);
+
+	// If we know the selected song's tempo and key, they go where the title was
+	if (songInfoText[0]) {
+		int32_t startY = ((OLED_MAIN_HEIGHT_PIXELS == 64) ? 0 : 1) + OLED_MAIN_TOPMOST_PIXEL;
+		deluge::hid::display::OLED::clearAreaExact(0, startY, OLED_MAIN_WIDTH_PIXELS - 1,
+		                                           startY + kTextTitleSizeY - 1, image);
+		deluge::hid::display::OLED::drawString(songInfoText, 0, startY + 1, image[0], OLED_MAIN_WIDTH_PIXELS,
+		                                       kTextSpacingX, kTextSpacingY);
+	}
 }
 
 void LoadSongUI::displayText(bool blinkImmediately) {
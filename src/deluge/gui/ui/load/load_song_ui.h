@@ -20,6 +20,10 @@
 #include "gui/ui/load/load_ui.h"
 #include "hid/button.h"
 
+namespace SongIndex {
+struct Info;
+}
+
 class LoadSongUI final : public LoadUI {
 public:
 	LoadSongUI();
@@ -33,6 +37,7 @@ public:
 	void selectEncoderAction(int8_t offset);
 	void performLoad();
 	void displayLoopsRemainingPopup();
+	void renderOLED(uint8_t image[][OLED_MAIN_WIDTH_PIXELS]);
 
 	bool deletedPartsOfOldSong;
 
@@ -46,8 +51,10 @@ protected:
 private:
 	void drawSongPreview(bool toStore = true);
 	void displayArmedPopup();
+	void setSongInfoText(SongIndex::Info const* info);
 
 	bool scrollingIntoSlot;
+	char songInfoText[24]; // Tempo and key of the selected song, if the song index knew them. Shown on OLED
 	//int32_t findNextFile(int32_t offset);
 	void exitThisUI();
 	void exitActionWithError();
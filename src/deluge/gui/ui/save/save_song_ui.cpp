@@ -30,6 +30,7 @@
 #include "model/sample/sample.h"
 #include "model/song/song.h"
 #include "storage/audio/audio_file_manager.h"
+#include "storage/song_index.h"
 #include "storage/storage_manager.h"
 #include "util/functions.h"
 #include "util/lookuptables/lookuptables.h"
@@ -455,6 +456,9 @@ cardError:
 		}
 	}
 
+	// So the song browser can show it without reading the whole file. The preview's still in PadLEDs::imageStore
+	SongIndex::songSaved(currentDir.get(), filePath.get());
+
 	display->removeWorkingAnimation();
 	char const* message = anyErrorMovingTempFiles
 	                          ? (deluge::l10n::get(deluge::l10n::String::STRING_FOR_ERROR_MOVING_TEMP_FILES))
@@ -320,8 +320,10 @@ void doAnyPendingUIRendering() {
 		return;
 	}
 
-	if (uartGetTxBufferSpace(UART_ITEM_PIC_PADS) <= (kNumBytesInMainPadRedraw + kNumBytesInSidebarRedraw) * 2) {
-		return; // Trialling the *2 to fix flickering when flicking through presets very fast
+	// The sending functions check for room for just the column pairs that changed, and send the whole lot a bit later
+	// if it's not there, so we only need room for one pair to be worth rendering now
+	if (uartGetTxBufferSpace(UART_ITEM_PIC_PADS) <= kNumBytesInColUpdateMessage) {
+		return;
 	}
 
 	pendingUIRenderingLock = true;
@@ -2630,7 +2630,7 @@ ActionResult ArrangerView::horizontalEncoderAction(int32_t offset) {
 
 				if (offset >= 0) {
 					void* consMemory =
-					    GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceArrangerParamsTimeInserted));
+					    action ? action->allocConsequenceMemory(sizeof(ConsequenceArrangerParamsTimeInserted)) : NULL;
 					if (consMemory) {
 						ConsequenceArrangerParamsTimeInserted* consequence = new (consMemory)
 						    ConsequenceArrangerParamsTimeInserted(currentSong->xScroll[NAVIGATION_ARRANGEMENT],
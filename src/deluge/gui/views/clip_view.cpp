@@ -23,7 +23,6 @@
 #include "hid/buttons.h"
 #include "hid/display/display.h"
 #include "hid/matrix/matrix_driver.h"
-#include "memory/general_memory_allocator.h"
 #include "model/action/action_logger.h"
 #include "model/clip/clip.h"
 #include "model/clip/clip_minder.h"
@@ -267,7 +266,7 @@ doReRender:
 			action = actionLogger.getNewAction(ACTION_CLIP_HORIZONTAL_SHIFT, ACTION_ADDITION_NOT_ALLOWED);
 			if (action) {
 addConsequenceToAction:
-				void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceClipHorizontalShift));
+				void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceClipHorizontalShift));
 
 				if (consMemory) {
 					ConsequenceClipHorizontalShift* newConsequence =
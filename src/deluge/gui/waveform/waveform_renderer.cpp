@@ -26,6 +26,7 @@
 #include "io/debug/print.h"
 #include "model/instrument/instrument.h"
 #include "model/sample/sample.h"
+#include "model/sample/sample_peak_pyramid.h"
 #include "model/sample/sample_recorder.h"
 #include "model/voice/voice_sample.h"
 #include "processing/engines/audio_engine.h"
@@ -262,6 +263,17 @@ bool WaveformRenderer::findPeaksPerCol(Sample* sample, int64_t xScrollSamples, u
 
 	bool hadAnyTroubleLoading = false;
 
+	// Once a Sample's finished recording, wide columns can come from its peak pyramid. That fills itself in for the
+	// whole Sample in the background, and we fill it in below too, for any Clusters we load anyway. Until it's got
+	// everything a column needs, that column gets worked out from the audio data as usual
+	SamplePeakPyramid* peakPyramid = NULL;
+	if (!recorder && xZoomSamples >= SamplePeakPyramid::kMinSamplesPerCol) {
+		peakPyramid = sample->getPeakPyramid();
+		if (peakPyramid) {
+			peakPyramid->fillWanted();
+		}
+	}
+
 	for (int32_t col = xStart; col < xEnd; col++) {
 
 		if (data->colStatus[col] == COL_STATUS_INVESTIGATED) {
@@ -296,6 +308,12 @@ bool WaveformRenderer::findPeaksPerCol(Sample* sample, int64_t xScrollSamples, u
 			continue;
 		}
 
+		if (peakPyramid
+		    && peakPyramid->getPeaks(sample, colStartSample, colEndSample, &data->minPerCol[col],
+		                             &data->maxPerCol[col])) {
+			continue;
+		}
+
 		int32_t colStartByte =
 		    colStartSample * sample->numChannels * sample->byteDepth + sample->audioDataStartPosBytes;
 		int32_t colEndByte = colEndSample * sample->numChannels * sample->byteDepth + sample->audioDataStartPosBytes;
@@ -560,6 +578,11 @@ cantReadData:
 			data->maxPerCol[col] = maxThisCol;
 			data->minPerCol[col] = minThisCol;
 
+			// While we've got this Cluster loaded, get all its peaks, so next time this stretch needn't be read again
+			if (peakPyramid) {
+				peakPyramid->addCluster(sample, clusterIndexToDo, cluster);
+			}
+
 			audioFileManager.removeReasonFromCluster(cluster, "E340"); // Ron R got this, when error was "iiuh"
 			if (nextCluster) {
 				audioFileManager.removeReasonFromCluster(nextCluster, "9700");
@@ -49,6 +49,9 @@ uint8_t OLED::oledMainConsoleImage[kConsoleImageNumRows][OLED_MAIN_WIDTH_PIXELS]
     __attribute__((aligned(alignof(int32_t))));
 uint8_t OLED::oledMainPopupImage[OLED_MAIN_HEIGHT_PIXELS >> 3][OLED_MAIN_WIDTH_PIXELS]
     __attribute__((aligned(alignof(int32_t))));
+uint8_t OLED::oledSentImage[OLED_MAIN_HEIGHT_PIXELS >> 3][OLED_MAIN_WIDTH_PIXELS]
+    __attribute__((aligned(alignof(int32_t))));
+bool OLED::sentImageValid = false;
 
 uint8_t (*OLED::oledCurrentImage)[OLED_MAIN_WIDTH_PIXELS] = oledMainImage;
 
@@ -714,7 +717,33 @@ void OLED::sendMainImage() {
 	uartPrintNumber((uint16_t)(renderStopTime - renderStartTime));
 #endif
 
-	enqueueSPITransfer(0, oledCurrentImage[0]);
+	// See what's actually changed since last time. Often it's nothing at all - e.g. when a UI re-renders everything
+	// just because one value might have changed
+	constexpr int32_t kNumWords = sizeof(oledSentImage) >> 2;
+	uint32_t const* newWords = (uint32_t const*)oledCurrentImage[0];
+	uint32_t* sentWords = (uint32_t*)oledSentImage[0];
+
+	int32_t firstChange = 0;
+	int32_t lastChange = kNumWords - 1;
+	if (sentImageValid) {
+		while (firstChange < kNumWords && newWords[firstChange] == sentWords[firstChange]) {
+			firstChange++;
+		}
+		if (firstChange == kNumWords) {
+			return;
+		}
+		while (newWords[lastChange] == sentWords[lastChange]) {
+			lastChange--;
+		}
+	}
+
+	// The OLED can't be told to just update part of itself without extra round trips to the PIC to switch it into
+	// command mode, so it still gets the whole image - but only when there's actually something new to send
+	memcpy(&sentWords[firstChange], &newWords[firstChange], (lastChange - firstChange + 1) << 2);
+	sentImageValid = true;
+	enqueueSPITransfer(0, oledSentImage[0]);
+
+	HIDSysex::oledImageChanged(firstChange << 2, (lastChange << 2) + 3);
 	HIDSysex::sendDisplayIfChanged();
 }
 
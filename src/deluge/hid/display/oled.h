@@ -32,6 +32,7 @@ public:
 		if (l10n::chosenLanguage == nullptr || l10n::chosenLanguage == &l10n::built_in::seven_segment) {
 			l10n::chosenLanguage = &l10n::built_in::english;
 		}
+		sentImageValid = false; // Whatever's on the screen, it's not something we know about
 	}
 
 	static void drawOnePixel(int32_t x, int32_t y);
@@ -96,6 +97,11 @@ public:
 	// pointer to one of the three above (the one currently displayed)
 	static uint8_t (*oledCurrentImage)[OLED_MAIN_WIDTH_PIXELS];
 
+	// What's actually been handed to the SPI transfer queue. Only sendMainImage() changes this, and only the parts that
+	// differ, so a transfer that's still waiting to happen never picks up a half-drawn image
+	static uint8_t oledSentImage[OLED_MAIN_HEIGHT_PIXELS >> 3][OLED_MAIN_WIDTH_PIXELS];
+	static bool sentImageValid;
+
 	static const uint8_t folderIcon[];
 	static const uint8_t waveIcon[];
 	static const uint8_t songIcon[];
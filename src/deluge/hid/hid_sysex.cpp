@@ -4,18 +4,22 @@
 #include "gui/ui_timer_manager.h"
 #include "hid/display/oled.h"
 #include "hid/display/seven_segment.h"
+#include "io/debug/render_profiler.h"
 #include "io/midi/midi_device.h"
 #include "io/midi/midi_engine.h"
-#include "memory/general_memory_allocator.h"
 #include "processing/engines/audio_engine.h"
 #include "util/pack.h"
+#include <algorithm>
 #include <cstring>
 
 MIDIDevice* midiDisplayDevice = nullptr;
 int32_t midiDisplayUntil = 0;
-uint8_t* oledDeltaImage = nullptr;
 bool oledDeltaForce = true;
 
+// Which bytes of the OLED image have changed since we last sent a delta. Kept up to date by the OLED itself
+int32_t oledDeltaFirstByte = 9000;
+int32_t oledDeltaLastByte = -1;
+
 void HIDSysex::sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len) {
 	if (len < 6) {
 		return;
@@ -30,6 +34,10 @@ void HIDSysex::sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len) {
 		request7SegDisplay(device, data, len);
 		break;
 
+	case 2:
+		RenderProfiler::sysexReceived(device, data, len);
+		break;
+
 	default:
 		break;
 	}
@@ -48,11 +56,6 @@ void HIDSysex::requestOLEDDisplay(MIDIDevice* device, uint8_t* data, int32_t len
 			if (force) {
 				oledDeltaForce = true;
 			}
-
-			if (oledDeltaImage == nullptr) {
-				oledDeltaImage = (uint8_t*)GeneralMemoryAllocator::get().alloc(
-				    sizeof(uint8_t[OLED_MAIN_HEIGHT_PIXELS >> 3][OLED_MAIN_WIDTH_PIXELS]), NULL, false, true);
-			}
 		}
 		sendDisplayIfChanged();
 		if (force && display->have7SEG()) {
@@ -144,40 +147,33 @@ void HIDSysex::send7SegData(MIDIDevice* device) {
 	}
 }
 
+void HIDSysex::oledImageChanged(int32_t firstByte, int32_t lastByte) {
+	oledDeltaFirstByte = std::min(oledDeltaFirstByte, firstByte);
+	oledDeltaLastByte = std::max(oledDeltaLastByte, lastByte);
+}
+
 void HIDSysex::sendOLEDDataDelta(MIDIDevice* device, bool force) {
 	const int32_t data_size = 768;
 	const int32_t max_packed_size = 922;
 
-	uint8_t* current = deluge::hid::display::OLED::oledCurrentImage[0];
-
-	int32_t first_change = 9000;
-	int32_t last_change = 0;
-	int32_t* blkdata_new = (int32_t*)current;
-	int32_t* blkdata_old = (int32_t*)oledDeltaImage;
+	// What the OLED itself was last sent, which is what the changed range refers to
+	uint8_t* current = deluge::hid::display::OLED::oledSentImage[0];
 
-	const int32_t word_size = data_size >> 2;
+	int32_t first_change = oledDeltaFirstByte;
+	int32_t last_change = oledDeltaLastByte;
 
 	if (force || oledDeltaForce) {
 		first_change = 0;
-		last_change = word_size - 1;
-	}
-	else {
-		for (int32_t blk = 0; blk < word_size; blk++) {
-			if (blkdata_new[blk] != blkdata_old[blk]) {
-				if (first_change > blk) {
-					first_change = blk;
-				}
-				last_change = blk;
-			}
-		}
+		last_change = data_size - 1;
 	}
 
-	if (first_change > word_size) {
+	if (first_change > last_change) {
 		return;
 	}
 
-	int start = first_change / 2;
-	int len = (last_change / 2) - start + 1;
+	// Deltas are in blocks of 8 bytes
+	int start = first_change / 8;
+	int len = (last_change / 8) - start + 1;
 
 	uint8_t reply_hdr[5] = {0xf0, 0x7d, 0x02, 0x40, 0x02};
 	uint8_t* reply = midiEngine.sysex_fmt_buffer;
@@ -189,7 +185,8 @@ void HIDSysex::sendOLEDDataDelta(MIDIDevice* device, bool force) {
 	if (packed <= 0) {
 		return;
 	}
-	memcpy(oledDeltaImage + (8 * start), current + (8 * start), 8 * len);
+	oledDeltaFirstByte = 9000;
+	oledDeltaLastByte = -1;
 	oledDeltaForce = false;
 	reply[7 + packed] = 0xf7; // end of transmission
 	device->sendSysex(reply, packed + 8);
@@ -9,4 +9,5 @@ void sendOLEDData(MIDIDevice* device, bool rle);
 void sendOLEDDataDelta(MIDIDevice* device, bool force);
 void send7SegData(MIDIDevice* device);
 void sendDisplayIfChanged();
+void oledImageChanged(int32_t firstByte, int32_t lastByte);
 } // namespace HIDSysex
@@ -111,8 +111,20 @@ uint32_t transitionStartTime;
 uint32_t greyoutCols;
 uint32_t greyoutRows;
 
+// What we last sent the PIC for each column pair (the last one being the sidebar), so that only the ones that have
+// changed need sending again
+constexpr int32_t kNumColumnPairs = (kDisplayWidth + kSideBarWidth) >> 1;
+std::array<Colour, kDisplayHeight * 2> columnPairsSent[kNumColumnPairs];
+uint32_t columnPairsSentValid; // One bit per column pair
+
 void init() {
 	memset(slowFlashSquares, 255, sizeof(slowFlashSquares));
+	forgetWhatsBeenSent();
+}
+
+// Call when the PIC's been told to change its pads other than by being sent whole column pairs - e.g. scrolling
+void forgetWhatsBeenSent() {
+	columnPairsSentValid = 0;
 }
 
 bool shouldNotRenderDuringTimerRoutine() {
@@ -237,6 +249,28 @@ void clearSideBar() {
 
 Colour prepareColour(int32_t x, int32_t y, Colour colourSource);
 
+void prepareColumnPair(int32_t x, std::array<Colour, kDisplayHeight * 2>& doubleColumn) {
+	size_t total = 0;
+	for (size_t y = 0; y < kDisplayHeight; y++) {
+		doubleColumn[total++] = prepareColour(x, y, Colour::fromArray(image[y][x]));
+	}
+	for (size_t y = 0; y < kDisplayHeight; y++) {
+		doubleColumn[total++] = prepareColour(x + 1, y, Colour::fromArray(image[y][x + 1]));
+	}
+}
+
+bool columnPairNeedsSending(int32_t pair, const std::array<Colour, kDisplayHeight * 2>& doubleColumn) {
+	return !(columnPairsSentValid & (1 << pair))
+	       || memcmp(columnPairsSent[pair].data(), doubleColumn.data(), sizeof(Colour) * kDisplayHeight * 2);
+}
+
+void sendColumnPair(int32_t pair, const std::array<Colour, kDisplayHeight * 2>& doubleColumn) {
+	PIC::setColourForTwoColumns(pair, doubleColumn);
+	columnPairsSent[pair] = doubleColumn;
+	columnPairsSentValid |= (1 << pair);
+}
+
+// Only actually sends anything if the column pair has changed since we last sent it.
 // You'll want to call uartFlushToPICIfNotSending() after this
 void sortLedsForCol(int32_t x) {
 	AudioEngine::logAction("MatrixDriver::sortLedsForCol");
@@ -244,14 +278,10 @@ void sortLedsForCol(int32_t x) {
 	x &= 0b11111110;
 
 	std::array<Colour, kDisplayHeight * 2> doubleColumn{};
-	size_t total = 0;
-	for (size_t y = 0; y < kDisplayHeight; y++) {
-		doubleColumn[total++] = prepareColour(x, y, Colour::fromArray(image[y][x]));
-	}
-	for (size_t y = 0; y < kDisplayHeight; y++) {
-		doubleColumn[total++] = prepareColour(x + 1, y, Colour::fromArray(image[y][x + 1]));
+	prepareColumnPair(x, doubleColumn);
+	if (columnPairNeedsSending(x >> 1, doubleColumn)) {
+		sendColumnPair(x >> 1, doubleColumn);
 	}
-	PIC::setColourForTwoColumns((x >> 1), doubleColumn);
 }
 
 const uint8_t flashColours[3][3] = {
@@ -909,18 +939,33 @@ stopFade:
 
 void sendOutMainPadColours() {
 	AudioEngine::logAction("sendOutMainPadColours 1");
-	if (uartGetTxBufferSpace(UART_ITEM_PIC_PADS) <= kNumBytesInMainPadRedraw) {
-		sendOutMainPadColoursSoon();
-		return;
-	}
 
-	for (int32_t col = 0; col < kDisplayWidth; col++) {
-		if (col & 1) {
-			sortLedsForCol(col - 1);
+	// See which column pairs have actually changed, so we only need room in the buffer for those
+	std::array<Colour, kDisplayHeight * 2> doubleColumns[kDisplayWidth >> 1];
+	uint32_t pairsToSend = 0;
+	int32_t numPairsToSend = 0;
+	for (int32_t pair = 0; pair < (kDisplayWidth >> 1); pair++) {
+		prepareColumnPair(pair << 1, doubleColumns[pair]);
+		if (columnPairNeedsSending(pair, doubleColumns[pair])) {
+			pairsToSend |= (1 << pair);
+			numPairsToSend++;
 		}
 	}
 
-	PIC::flush();
+	if (numPairsToSend) {
+		if (uartGetTxBufferSpace(UART_ITEM_PIC_PADS) <= kNumBytesInColUpdateMessage * numPairsToSend) {
+			sendOutMainPadColoursSoon();
+			return;
+		}
+
+		for (int32_t pair = 0; pair < (kDisplayWidth >> 1); pair++) {
+			if (pairsToSend & (1 << pair)) {
+				sendColumnPair(pair, doubleColumns[pair]);
+			}
+		}
+
+		PIC::flush();
+	}
 
 	needToSendOutMainPadColours = false;
 
@@ -934,14 +979,18 @@ void sendOutMainPadColoursSoon() {
 
 void sendOutSidebarColours() {
 
-	if (uartGetTxBufferSpace(UART_ITEM_PIC_PADS) <= kNumBytesInSidebarRedraw) {
-		sendOutSidebarColoursSoon();
-		return;
-	}
+	std::array<Colour, kDisplayHeight * 2> doubleColumn{};
+	prepareColumnPair(kDisplayWidth, doubleColumn);
+	if (columnPairNeedsSending(kDisplayWidth >> 1, doubleColumn)) {
+		if (uartGetTxBufferSpace(UART_ITEM_PIC_PADS) <= kNumBytesInSidebarRedraw) {
+			sendOutSidebarColoursSoon();
+			return;
+		}
 
-	sortLedsForCol(kDisplayWidth);
+		sendColumnPair(kDisplayWidth >> 1, doubleColumn);
 
-	PIC::flush();
+		PIC::flush();
+	}
 
 	needToSendOutSidebarColours = false;
 }
@@ -1278,6 +1327,9 @@ void horizontal::renderScroll() {
 	PIC::doneSendingRows();
 	PIC::flush();
 
+	// The PIC has shifted its pads along itself, so we no longer know exactly what it's showing
+	forgetWhatsBeenSent();
+
 	if (squaresScrolled >= areaToScroll) {
 		getCurrentUI()->scrollFinished();
 	}
@@ -1330,6 +1382,7 @@ void vertical::renderScroll() {
 	}
 	PIC::doVerticalScroll(scrollDirection > 0, colours);
 	PIC::flush();
+	forgetWhatsBeenSent();
 }
 
 void vertical::setupScroll(int8_t thisScrollDirection, bool scrollIntoNothing) {
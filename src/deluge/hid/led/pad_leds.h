@@ -58,6 +58,7 @@ extern bool zoomingIn;
 extern int8_t zoomMagnitude;
 
 void init();
+void forgetWhatsBeenSent();
 void sortLedsForCol(int32_t x);
 void writeToSideBar(uint8_t sideBarX, uint8_t yDisplay, uint8_t red, uint8_t green, uint8_t blue);
 void renderInstrumentClipCollapseAnimation(int32_t xStart, int32_t xEnd, int32_t progress);
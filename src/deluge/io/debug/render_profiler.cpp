@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "io/debug/render_profiler.h"
+#include "io/midi/midi_device.h"
+#include "io/midi/midi_engine.h"
+#include "model/output.h"
+#include "model/song/song.h"
+#include "util/cfunctions.h"
+#include "util/pack.h"
+#include <algorithm>
+#include <string.h>
+
+namespace RenderProfiler {
+
+bool enabled = false;
+
+// Only ever goes up, so things waiting on the card can tell how much rendering happened meanwhile
+uint32_t totalWindowTicks = 0;
+
+SectionStats stats[kNumSections];
+
+// For the window currently being rendered
+uint32_t windowTicks[kNumSections];
+uint16_t windowCalls[kNumSections];
+
+char const* const fixedSectionNames[NUM_FIXED_SECTIONS] = {
+    "window", "voices", "reverb", "master compressor", "cluster loading",
+};
+
+void reset() {
+	memset(stats, 0, sizeof(stats));
+	memset(windowTicks, 0, sizeof(windowTicks));
+	memset(windowCalls, 0, sizeof(windowCalls));
+	for (int32_t s = 0; s < kNumSections; s++) {
+		stats[s].minTicks = 65535;
+	}
+}
+
+void addTicks(int32_t section, uint16_t ticks) {
+	windowTicks[section] += ticks;
+	windowCalls[section]++;
+}
+
+void stopExcludingRendering(int32_t section, uint16_t startTime, uint32_t totalWindowTicksAtStart) {
+	if (!enabled) {
+		return;
+	}
+	uint32_t ticks = (uint16_t)(getTime() - startTime);
+	uint32_t renderingTicks = totalWindowTicks - totalWindowTicksAtStart;
+	windowTicks[section] += (ticks > renderingTicks) ? (ticks - renderingTicks) : 0;
+	windowCalls[section]++;
+}
+
+// Call at the end of each render window. Folds everything timed since the last one into the stats
+void windowRendered(int32_t numSamples, uint16_t thisWindowTicks) {
+	totalWindowTicks += thisWindowTicks;
+
+	if (!enabled) {
+		return;
+	}
+
+	windowTicks[SECTION_WINDOW] = thisWindowTicks;
+	windowCalls[SECTION_WINDOW] = 1;
+
+	uint32_t budgetTicks = usToFastTimerCount((uint32_t)numSamples * 1000000 / kSampleRate);
+	if (!budgetTicks) {
+		budgetTicks = 1;
+	}
+
+	for (int32_t s = 0; s < kNumSections; s++) {
+		if (!windowCalls[s]) {
+			continue;
+		}
+
+		uint32_t ticks = std::min<uint32_t>(windowTicks[s], 65535);
+		SectionStats* sectionStats = &stats[s];
+		sectionStats->numWindows++;
+		sectionStats->totalTicks += ticks;
+		sectionStats->totalCalls += windowCalls[s];
+		sectionStats->minTicks = std::min<uint32_t>(sectionStats->minTicks, ticks);
+		sectionStats->maxTicks = std::max<uint32_t>(sectionStats->maxTicks, ticks);
+
+		int32_t bucket = std::min<uint32_t>(ticks * 10 / budgetTicks, kNumHistogramBuckets - 1);
+		if (sectionStats->histogram[bucket] != 65535) {
+			sectionStats->histogram[bucket]++;
+		}
+
+		windowTicks[s] = 0;
+		windowCalls[s] = 0;
+	}
+}
+
+// What actually gets sent for each section, with times converted to uS
+struct SectionReport {
+	uint32_t numWindows;
+	uint32_t minUS;
+	uint32_t avgUS;
+	uint32_t maxUS;
+	uint32_t callsPerWindowTimes100;
+	uint16_t histogram[kNumHistogramBuckets];
+};
+
+static char const* getSectionName(int32_t section) {
+	if (section < NUM_FIXED_SECTIONS) {
+		return fixedSectionNames[section];
+	}
+	if (!currentSong) {
+		return "";
+	}
+	int32_t outputIndex = section - NUM_FIXED_SECTIONS;
+	for (Output* output = currentSong->firstOutput; output; output = output->next) {
+		if (!outputIndex--) {
+			return output->name.get();
+		}
+	}
+	return "";
+}
+
+// Reply is 0xf0, 0x7d, 0x02, 0x42, section, packed SectionReport, section name, 0xf7 - one per section that has been
+// timed at all. Then a final one with section 0x7f and nothing else, to say that's the lot
+static void sendStats(MIDIDevice* device) {
+	uint8_t* reply = midiEngine.sysex_fmt_buffer;
+
+	for (int32_t s = 0; s < kNumSections; s++) {
+		SectionStats* sectionStats = &stats[s];
+		if (!sectionStats->numWindows) {
+			continue;
+		}
+
+		SectionReport report;
+		report.numWindows = sectionStats->numWindows;
+		report.minUS = fastTimerCountToUS(sectionStats->minTicks);
+		report.avgUS = fastTimerCountToUS(sectionStats->totalTicks / sectionStats->numWindows);
+		report.maxUS = fastTimerCountToUS(sectionStats->maxTicks);
+		report.callsPerWindowTimes100 = (uint64_t)sectionStats->totalCalls * 100 / sectionStats->numWindows;
+		memcpy(report.histogram, sectionStats->histogram, sizeof(report.histogram));
+
+		reply[0] = 0xf0;
+		reply[1] = 0x7d;
+		reply[2] = 0x02;
+		reply[3] = 0x42;
+		reply[4] = s;
+		int32_t pos = 5;
+		pos += pack_8bit_to_7bit(&reply[pos], 64, (uint8_t*)&report, sizeof(report));
+
+		char const* name = getSectionName(s);
+		int32_t nameLength = std::min<int32_t>(strlen(name), 32);
+		for (int32_t i = 0; i < nameLength; i++) {
+			reply[pos++] = name[i] & 0x7F;
+		}
+
+		reply[pos++] = 0xf7;
+		device->sendSysex(reply, pos);
+	}
+
+	uint8_t endReply[6] = {0xf0, 0x7d, 0x02, 0x42, 0x7f, 0xf7};
+	device->sendSysex(endReply, sizeof(endReply));
+}
+
+// data[4]: 0 to switch off, 1 to switch on (from fresh), 2 to send the stats so far, 3 to reset them
+void sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len) {
+	switch (data[4]) {
+	case 0:
+		enabled = false;
+		break;
+
+	case 1:
+		reset();
+		enabled = true;
+		break;
+
+	case 2:
+		sendStats(device);
+		break;
+
+	case 3:
+		reset();
+		break;
+
+	default:
+		break;
+	}
+}
+
+} // namespace RenderProfiler
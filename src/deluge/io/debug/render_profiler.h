@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RZA1/mtu/mtu.h"
+#include "definitions_cxx.hpp"
+#include <cstdint>
+
+class MIDIDevice;
+
+// Always compiled in, but does nothing beyond reading the timer until switched on over sysex. Times are accumulated per
+// section over each render window, then folded into min / avg / max and a histogram of how much of that window's
+// real-time budget the section used. Sections can nest - each Output's time includes its Voices'.
+namespace RenderProfiler {
+
+enum Section : uint8_t {
+	SECTION_WINDOW, // The whole of renderWindow()
+	SECTION_VOICES, // All Voice::render() calls in the window, summed
+	SECTION_REVERB,
+	SECTION_MASTER_COMPRESSOR,
+	SECTION_CLUSTER_LOADING, // Not counting any rendering that happened while waiting on the card
+	NUM_FIXED_SECTIONS,
+};
+
+// Outputs get a section each, in the order they're in in the Song. Any past this don't get profiled individually
+constexpr int32_t kMaxNumProfiledOutputs = 32;
+constexpr int32_t kNumSections = NUM_FIXED_SECTIONS + kMaxNumProfiledOutputs;
+
+// Each bucket is 10% of the window's budget. The last one is anything over budget
+constexpr int32_t kNumHistogramBuckets = 11;
+
+struct SectionStats {
+	uint32_t numWindows;
+	uint32_t totalTicks;
+	uint16_t minTicks;
+	uint16_t maxTicks;
+	uint32_t totalCalls;
+	uint16_t histogram[kNumHistogramBuckets];
+};
+
+extern bool enabled;
+extern uint32_t totalWindowTicks;
+
+inline uint16_t getTime() {
+	return *TCNT[TIMER_SYSTEM_FAST];
+}
+
+void addTicks(int32_t section, uint16_t ticks);
+
+inline void stop(int32_t section, uint16_t startTime) {
+	if (enabled) {
+		addTicks(section, getTime() - startTime);
+	}
+}
+
+// For when the caller needed the time anyway
+inline void record(int32_t section, uint16_t ticks) {
+	if (enabled) {
+		addTicks(section, ticks);
+	}
+}
+
+inline void stopOutput(int32_t outputIndex, uint16_t startTime) {
+	if (enabled && outputIndex < kMaxNumProfiledOutputs) {
+		addTicks(NUM_FIXED_SECTIONS + outputIndex, getTime() - startTime);
+	}
+}
+
+// For sections which might have had render windows happen during them (i.e. anything waiting on the card), pass in what
+// totalWindowTicks was at the start, so that time can be taken back out
+void stopExcludingRendering(int32_t section, uint16_t startTime, uint32_t totalWindowTicksAtStart);
+
+void windowRendered(int32_t numSamples, uint16_t windowTicks);
+void reset();
+void sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len);
+
+} // namespace RenderProfiler
@@ -22,7 +22,9 @@
 #include "io/midi/midi_device.h"
 #include "io/midi/midi_engine.h"
 #include "memory/general_memory_allocator.h"
+#include "memory/slab_allocator.h"
 #include "model/settings/runtime_feature_settings.h"
+#include "processing/engines/audio_engine.h"
 #include "util/chainload.h"
 #include "util/functions.h"
 #include "util/pack.h"
@@ -55,11 +57,36 @@ void Debug::sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len) {
 #endif
 		break;
 
+	case 3:
+		renderBenchmarkRequested(data, len);
+		break;
+
+	case 4:
+		SlabAllocator::get().printStats();
+		break;
+
 	default:
 		break;
 	}
 }
 
+// data[4]: number of seconds to render, data[5]: window size / 4 (0 for the default), data[6]: 1 to also write a WAV file
+// 0 seconds runs the individual DSP component benchmarks instead
+void Debug::renderBenchmarkRequested(uint8_t* data, int32_t len) {
+	if (len < 8) {
+		return;
+	}
+
+	int32_t numSeconds = data[4];
+	if (!numSeconds) {
+		AudioEngine::runComponentBenchmarks();
+		return;
+	}
+	int32_t windowSize = data[5] ? (data[5] << 2) : SSI_TX_BUFFER_NUM_SAMPLES;
+
+	AudioEngine::renderOfflineBenchmark(numSeconds, windowSize, data[6] == 1);
+}
+
 void Debug::sysexDebugPrint(MIDIDevice* device, const char* msg, bool nl) {
 	if (!msg) {
 		return; // Do not do that
@@ -26,6 +26,7 @@ namespace Debug {
 
 void sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len);
 void sysexDebugPrint(MIDIDevice* device, const char* msg, bool nl);
+void renderBenchmarkRequested(uint8_t* data, int32_t len);
 
 #ifdef ENABLE_SYSEX_LOAD
 void loadPacketReceived(uint8_t* data, int32_t len);
@@ -0,0 +1,194 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "memory/slab_allocator.h"
+#include "io/debug/print.h"
+#include "memory/general_memory_allocator.h"
+#include <algorithm>
+
+struct Slab {
+	Slab* next; // Within its size class's list of slabs with space
+	Slab* prev;
+	SlabSizeClass* sizeClass;
+	void* firstFreeSlot;
+	uint16_t numInUse;
+	uint16_t numNeverUsed; // Slots past the free list which have never been handed out
+	// Slots follow
+};
+
+// Sits just before each slot's object. Two words, so the objects stay 8-byte aligned
+struct SlotHeader {
+	Slab* slab;
+	uint32_t padding;
+};
+
+static constexpr uint32_t kSlabHeaderSize = (sizeof(Slab) + 7) & ~7;
+
+SlabAllocator::SlabAllocator() {
+	numSizeClasses = 0;
+}
+
+int32_t SlabAllocator::addSizeClass(uint32_t objectSize) {
+	if (numSizeClasses == kMaxNumSlabSizeClasses) {
+		return -1;
+	}
+
+	SlabSizeClass* sizeClass = &sizeClasses[numSizeClasses];
+	sizeClass->slotSize = ((objectSize + 7) & ~7) + sizeof(SlotHeader);
+	sizeClass->numSlotsPerSlab = std::clamp<int32_t>(kSlabTargetSize / sizeClass->slotSize, 2, kMaxNumSlotsPerSlab);
+	sizeClass->firstSlabWithSpace = NULL;
+	sizeClass->spareSlab = NULL;
+	sizeClass->numSlabs = 0;
+	sizeClass->numInUse = 0;
+	sizeClass->peakNumInUse = 0;
+	sizeClass->numFailedAllocations = 0;
+
+	return numSizeClasses++;
+}
+
+// Returns NULL if there's no size class big enough, or no RAM for a new slab
+void* SlabAllocator::alloc(uint32_t requiredSize) {
+	uint32_t requiredSlotSize = requiredSize + sizeof(SlotHeader);
+
+	// Smallest one that fits
+	SlabSizeClass* sizeClass = NULL;
+	for (int32_t i = 0; i < numSizeClasses; i++) {
+		if (sizeClasses[i].slotSize >= requiredSlotSize
+		    && (!sizeClass || sizeClasses[i].slotSize < sizeClass->slotSize)) {
+			sizeClass = &sizeClasses[i];
+		}
+	}
+	if (!sizeClass) {
+		return NULL;
+	}
+
+	Slab* slab = sizeClass->firstSlabWithSpace;
+
+	if (!slab) {
+		slab = sizeClass->spareSlab;
+		if (slab) {
+			sizeClass->spareSlab = NULL;
+		}
+		else {
+			slab = (Slab*)GeneralMemoryAllocator::get().alloc(
+			    kSlabHeaderSize + sizeClass->slotSize * sizeClass->numSlotsPerSlab, NULL, false, true);
+			if (!slab) {
+				sizeClass->numFailedAllocations++;
+				return NULL;
+			}
+			slab->sizeClass = sizeClass;
+			slab->firstFreeSlot = NULL;
+			slab->numInUse = 0;
+			slab->numNeverUsed = sizeClass->numSlotsPerSlab;
+			sizeClass->numSlabs++;
+		}
+
+		slab->prev = NULL;
+		slab->next = NULL;
+		sizeClass->firstSlabWithSpace = slab;
+	}
+
+	SlotHeader* slot;
+	if (slab->firstFreeSlot) {
+		slot = (SlotHeader*)slab->firstFreeSlot;
+		slab->firstFreeSlot = *(void**)(slot + 1);
+	}
+	else {
+		// Hand out never-used slots from the end backwards, so there's no need to build a free list up front
+		slab->numNeverUsed--;
+		slot = (SlotHeader*)((char*)slab + kSlabHeaderSize + slab->numNeverUsed * sizeClass->slotSize);
+	}
+	slot->slab = slab;
+	slab->numInUse++;
+
+	// If that filled it, it's no longer got space
+	if (slab->numInUse == sizeClass->numSlotsPerSlab) {
+		sizeClass->firstSlabWithSpace = slab->next;
+		if (slab->next) {
+			slab->next->prev = NULL;
+		}
+	}
+
+	sizeClass->numInUse++;
+	sizeClass->peakNumInUse = std::max(sizeClass->peakNumInUse, sizeClass->numInUse);
+
+	return slot + 1;
+}
+
+void SlabAllocator::dealloc(void* address) {
+	SlotHeader* slot = (SlotHeader*)address - 1;
+	Slab* slab = slot->slab;
+	SlabSizeClass* sizeClass = slab->sizeClass;
+
+	bool wasFull = (slab->numInUse == sizeClass->numSlotsPerSlab);
+
+	*(void**)address = slab->firstFreeSlot;
+	slab->firstFreeSlot = slot;
+	slab->numInUse--;
+	sizeClass->numInUse--;
+
+	if (wasFull) {
+		slab->prev = NULL;
+		slab->next = sizeClass->firstSlabWithSpace;
+		if (slab->next) {
+			slab->next->prev = slab;
+		}
+		sizeClass->firstSlabWithSpace = slab;
+	}
+
+	if (!slab->numInUse) {
+		if (slab->prev) {
+			slab->prev->next = slab->next;
+		}
+		else {
+			sizeClass->firstSlabWithSpace = slab->next;
+		}
+		if (slab->next) {
+			slab->next->prev = slab->prev;
+		}
+
+		if (!sizeClass->spareSlab) {
+			sizeClass->spareSlab = slab;
+		}
+		else {
+			freeSlab(slab);
+		}
+	}
+}
+
+void SlabAllocator::freeSlab(Slab* slab) {
+	slab->sizeClass->numSlabs--;
+	GeneralMemoryAllocator::get().dealloc(slab);
+}
+
+void SlabAllocator::printStats() {
+	for (int32_t i = 0; i < numSizeClasses; i++) {
+		SlabSizeClass* sizeClass = &sizeClasses[i];
+		Debug::print("slab size ");
+		Debug::print(sizeClass->slotSize);
+		Debug::print(": slabs ");
+		Debug::print(sizeClass->numSlabs);
+		Debug::print(", in use ");
+		Debug::print(sizeClass->numInUse);
+		Debug::print(" of ");
+		Debug::print(sizeClass->numSlabs * sizeClass->numSlotsPerSlab);
+		Debug::print(", peak ");
+		Debug::print(sizeClass->peakNumInUse);
+		Debug::print(", failed ");
+		Debug::println(sizeClass->numFailedAllocations);
+	}
+}
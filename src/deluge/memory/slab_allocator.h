@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * For small objects that get allocated and deallocated all the time while playing - Voices, VoiceSamples and
+ * TimeStretchers, once their static pools have run out. Rather than each one being its own allocation from the
+ * GeneralMemoryAllocator, which has to search for space, they're handed out from "slabs" of several same-sized slots,
+ * which are themselves allocated (preferably from internal RAM) only when all existing slabs of that size are full.
+ *
+ * Every slot is preceded by a pointer to its slab, so both alloc() and dealloc() are constant-time. A slab that
+ * becomes completely empty is kept as a spare for its size class, or given back if there's already a spare, so a busy
+ * moment doesn't leave internal RAM tied up forever.
+ */
+
+constexpr int32_t kMaxNumSlabSizeClasses = 4;
+constexpr int32_t kSlabTargetSize = 8192;
+constexpr int32_t kMaxNumSlotsPerSlab = 16;
+
+struct Slab;
+
+struct SlabSizeClass {
+	uint32_t slotSize; // Including the header
+	uint16_t numSlotsPerSlab;
+	Slab* firstSlabWithSpace;
+	Slab* spareSlab;
+
+	// Occupancy stats
+	uint16_t numSlabs;
+	uint16_t numInUse;
+	uint16_t peakNumInUse;
+	uint16_t numFailedAllocations;
+};
+
+class SlabAllocator {
+public:
+	SlabAllocator();
+
+	// Returns the size class's index, or -1 if there are too many already. Objects of any size up to objectSize can
+	// then be allocated from it. Must all be added before anything gets allocated
+	int32_t addSizeClass(uint32_t objectSize);
+
+	void* alloc(uint32_t requiredSize);
+	void dealloc(void* address);
+	void printStats();
+
+	static SlabAllocator& get() {
+		static SlabAllocator slabAllocator;
+		return slabAllocator;
+	}
+
+private:
+	void freeSlab(Slab* slab);
+
+	SlabSizeClass sizeClasses[kMaxNumSlabSizeClasses];
+	int32_t numSizeClasses;
+};
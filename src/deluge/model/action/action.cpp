@@ -32,10 +32,12 @@
 #include "model/consequence/consequence_param_change.h"
 #include "model/model_stack.h"
 #include "model/note/note.h"
+#include "model/note/note_row.h"
 #include "model/song/song.h"
 #include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
 #include "util/functions.h"
+#include <algorithm>
 #include <cstdint>
 #include <new>
 
@@ -50,8 +52,22 @@ Action::Action(int32_t newActionType) {
 	creationTime = AudioEngine::audioSampleTimer;
 
 	offset = 0;
+
+	firstConsequenceMemoryChunk = NULL;
+	consequenceMemorySize = 0;
+	consequenceBackupSize = 0;
 }
 
+// Consequences get put one after another in these. Most are well under 100 bytes, so lots fit in each chunk
+struct ConsequenceMemoryChunk {
+	ConsequenceMemoryChunk* next;
+	uint32_t size; // Not including this header
+	uint32_t used;
+	uint32_t padding;
+};
+
+constexpr uint32_t kConsequenceMemoryChunkSize = 1024;
+
 // Call this before the destructor!
 void Action::prepareForDestruction(int32_t whichQueueActionIn, Song* song) {
 
@@ -62,6 +78,41 @@ void Action::prepareForDestruction(int32_t whichQueueActionIn, Song* song) {
 	}
 }
 
+// Memory for a new Consequence. It's never deallocated individually - just destruct the Consequence when done with it,
+// and the memory goes when the Action does
+void* Action::allocConsequenceMemory(uint32_t size) {
+	size = (size + 7) & ~(uint32_t)7;
+
+	ConsequenceMemoryChunk* chunk = firstConsequenceMemoryChunk;
+	if (!chunk || chunk->size - chunk->used < size) {
+		uint32_t chunkSize = std::max(size, kConsequenceMemoryChunkSize);
+		uint32_t allocSize = sizeof(ConsequenceMemoryChunk) + chunkSize;
+		chunk = (ConsequenceMemoryChunk*)GeneralMemoryAllocator::get().alloc(allocSize);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->next = firstConsequenceMemoryChunk;
+		chunk->size = chunkSize;
+		chunk->used = 0;
+		firstConsequenceMemoryChunk = chunk;
+		consequenceMemorySize += sizeof(ConsequenceMemoryChunk) + chunkSize;
+	}
+
+	void* address = (char*)(chunk + 1) + chunk->used;
+	chunk->used += size;
+	return address;
+}
+
+// Only once there are no Consequences left in any of these chunks!
+void Action::freeConsequenceMemory(ConsequenceMemoryChunk* chunk) {
+	while (chunk) {
+		ConsequenceMemoryChunk* toFree = chunk;
+		chunk = chunk->next;
+		consequenceMemorySize -= sizeof(ConsequenceMemoryChunk) + toFree->size;
+		GeneralMemoryAllocator::get().dealloc(toFree);
+	}
+}
+
 void Action::deleteAllConsequences(int32_t whichQueueActionIn, Song* song, bool destructing) {
 	Consequence* currentConsequence = firstConsequence;
 	while (currentConsequence) {
@@ -70,8 +121,10 @@ void Action::deleteAllConsequences(int32_t whichQueueActionIn, Song* song, bool
 		currentConsequence = currentConsequence->next;
 		toDelete->prepareForDestruction(whichQueueActionIn, song);
 		toDelete->~Consequence();
-		GeneralMemoryAllocator::get().dealloc(toDelete);
 	}
+	freeConsequenceMemory(firstConsequenceMemoryChunk);
+	firstConsequenceMemoryChunk = NULL;
+	consequenceBackupSize = 0;
 	if (!destructing) {
 		firstConsequence = NULL;
 	}
@@ -80,18 +133,37 @@ void Action::deleteAllConsequences(int32_t whichQueueActionIn, Song* song, bool
 void Action::addConsequence(Consequence* consequence) {
 	consequence->next = firstConsequence;
 	firstConsequence = consequence;
+	consequenceBackupSize += consequence->getMemoryUsed(BEFORE);
 }
 
 // Returns error code
 int32_t Action::revert(TimeType time, ModelStack* modelStack) {
 
+	// Get everything that's going to need memory to revert, before changing anything
+	for (Consequence* thisCons = firstConsequence; thisCons; thisCons = thisCons->next) {
+		int32_t error = thisCons->prepareToRevert();
+		if (error) {
+			for (Consequence* prepared = firstConsequence; prepared != thisCons; prepared = prepared->next) {
+				prepared->abandonRevert();
+			}
+			return error;
+		}
+	}
+
+	// Once reverted, we'll be in the other queue
+	int32_t whichQueueActionInAfter = 1 - time;
+
 	Consequence* thisConsequence = firstConsequence;
 
 	// If we're a record-arrangement-from-session Action, there's a trick - we know that whether we're being undone or redone, this will involve
 	// clearing the arrangement to the right of a certain pos. So we'll do that, and we'll record the Consequences involved in doing so, so that
 	// this Action can then be reverted in the opposite direction next time
+	// The new Consequences get their own memory, so the old ones' can go once they're deleted below.
+	ConsequenceMemoryChunk* oldConsequenceMemory = NULL;
 	if (type == ACTION_ARRANGEMENT_RECORD) {
 		firstConsequence = NULL;
+		oldConsequenceMemory = firstConsequenceMemoryChunk;
+		firstConsequenceMemoryChunk = NULL;
 		currentSong->clearArrangementBeyondPos(posToClearArrangementFrom, this);
 		time = BEFORE;
 	}
@@ -122,7 +194,6 @@ int32_t Action::revert(TimeType time, ModelStack* modelStack) {
 			    modelStack
 			        ->song); // Have to put AFTER. See the effect this will have in ConsequenceCDelete::prepareForDestruction()
 			thisConsequence->~Consequence();
-			GeneralMemoryAllocator::get().dealloc(thisConsequence);
 		}
 
 		// Or, normal case
@@ -138,6 +209,11 @@ int32_t Action::revert(TimeType time, ModelStack* modelStack) {
 	if (type != ACTION_ARRANGEMENT_RECORD) {
 		firstConsequence = newFirstConsequence;
 	}
+	else {
+		freeConsequenceMemory(oldConsequenceMemory);
+	}
+
+	recalculateMemoryUsed(whichQueueActionInAfter);
 
 	return error;
 }
@@ -174,7 +250,7 @@ void Action::recordParamChangeIfNotAlreadySnapshotted(ModelStackWithAutoParam co
 
 void Action::recordParamChangeDefinitely(ModelStackWithAutoParam const* modelStack, bool stealData) {
 
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceParamChange));
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceParamChange));
 
 	if (consMemory) {
 		ConsequenceParamChange* newCons = new (consMemory) ConsequenceParamChange(modelStack, stealData);
@@ -188,7 +264,9 @@ bool Action::containsConsequenceNoteArrayChange(InstrumentClip* clip, int32_t no
 		Consequence* thisCons = *prevPointer;
 		if (thisCons->type == Consequence::NOTE_ARRAY_CHANGE) {
 			ConsequenceNoteArrayChange* thisNoteArrayChange = (ConsequenceNoteArrayChange*)thisCons;
-			if (thisNoteArrayChange->clip == clip && thisNoteArrayChange->noteRowId == noteRowId) {
+			// One that's been made into a diff only goes with the notes as they were at the time, so doesn't count
+			if (thisNoteArrayChange->clip == clip && thisNoteArrayChange->noteRowId == noteRowId
+			    && !thisNoteArrayChange->isDiff) {
 				if (moveToFrontIfFound) {
 					*prevPointer = thisCons->next;
 
@@ -215,7 +293,23 @@ int32_t Action::recordNoteArrayChangeIfNotAlreadySnapshotted(InstrumentClip* cli
 
 int32_t Action::recordNoteArrayChangeDefinitely(InstrumentClip* clip, int32_t noteRowId, NoteVector* noteVector,
                                                 bool stealData) {
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceNoteArrayChange));
+
+	// Any previous snapshot of this NoteRow in this Action will now only ever be reverted to from the state it's in
+	// now, so it only needs to keep what's different from that
+	if (mayCompactNoteArrayChanges()) {
+		for (Consequence* thisCons = firstConsequence; thisCons; thisCons = thisCons->next) {
+			if (thisCons->type == Consequence::NOTE_ARRAY_CHANGE) {
+				ConsequenceNoteArrayChange* thisNoteArrayChange = (ConsequenceNoteArrayChange*)thisCons;
+				if (thisNoteArrayChange->clip == clip && thisNoteArrayChange->noteRowId == noteRowId
+				    && !thisNoteArrayChange->isDiff) {
+					makeNoteArrayChangeDiff(thisNoteArrayChange, noteVector);
+					break;
+				}
+			}
+		}
+	}
+
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceNoteArrayChange));
 
 	if (!consMemory) {
 		return ERROR_INSUFFICIENT_RAM;
@@ -234,7 +328,7 @@ void Action::recordNoteExistenceChange(InstrumentClip* clip, int32_t noteRowId,
 		return;
 	}
 
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceNoteExistence));
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceNoteExistence));
 
 	if (consMemory) {
 		ConsequenceNoteExistence* newConsequence =
@@ -245,7 +339,7 @@ void Action::recordNoteExistenceChange(InstrumentClip* clip, int32_t noteRowId,
 
 void Action::recordClipInstanceExistenceChange(Output* output, ClipInstance* clipInstance, ExistenceChangeType type) {
 
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceClipInstanceExistence));
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceClipInstanceExistence));
 
 	if (consMemory) {
 		ConsequenceClipInstanceExistence* newConsequence =
@@ -266,7 +360,7 @@ void Action::recordClipLengthChange(Clip* clip, int32_t oldLength) {
 		}
 	}
 
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceClipLength));
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceClipLength));
 
 	if (consMemory) {
 		ConsequenceClipLength* consequenceClipLength = new (consMemory) ConsequenceClipLength(clip, oldLength);
@@ -275,7 +369,7 @@ void Action::recordClipLengthChange(Clip* clip, int32_t oldLength) {
 }
 
 bool Action::recordClipExistenceChange(Song* song, ClipArray* clipArray, Clip* clip, ExistenceChangeType type) {
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceClipExistence));
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceClipExistence));
 	if (!consMemory) {
 		return false;
 	}
@@ -298,13 +392,63 @@ bool Action::recordClipExistenceChange(Song* song, ClipArray* clipArray, Clip* c
 
 // Call this *before* you change the Sample or its filePath
 void Action::recordAudioClipSampleChange(AudioClip* clip) {
-	void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceAudioClipSetSample));
+	void* consMemory = allocConsequenceMemory(sizeof(ConsequenceAudioClipSetSample));
 	if (consMemory) {
 		ConsequenceAudioClipSetSample* cons = new (consMemory) ConsequenceAudioClipSetSample(clip);
 		addConsequence(cons);
 	}
 }
 
+// Call when nothing more is going to get added to this Action
+void Action::close() {
+	openForAdditions = false;
+
+	if (!mayCompactNoteArrayChanges()) {
+		return;
+	}
+
+	// Each remaining full snapshot now only needs to keep what's different from its NoteRow as it is now
+	for (Consequence* thisCons = firstConsequence; thisCons; thisCons = thisCons->next) {
+		if (thisCons->type == Consequence::NOTE_ARRAY_CHANGE) {
+			ConsequenceNoteArrayChange* thisNoteArrayChange = (ConsequenceNoteArrayChange*)thisCons;
+			if (!thisNoteArrayChange->isDiff) {
+				NoteRow* noteRow = thisNoteArrayChange->clip->getNoteRowFromId(thisNoteArrayChange->noteRowId);
+				if (noteRow) {
+					makeNoteArrayChangeDiff(thisNoteArrayChange, &noteRow->notes);
+				}
+			}
+		}
+	}
+}
+
+// A diff relies on its NoteRow being exactly as it was when the diff was made by the time it gets reverted. Some
+// Consequences' reverts change notes without recording that - e.g. shortening a NoteRow or Clip trims them - so we only
+// make diffs in the kinds of Action which are made up of just note array and param changes, and which were where all
+// the big copies were coming from anyway.
+bool Action::mayCompactNoteArrayChanges() {
+	return (type == ACTION_NOTE_NUDGE || type == ACTION_NOTE_REPEAT_EDIT || type == ACTION_EUCLIDEAN_NUM_EVENTS_EDIT);
+}
+
+// Only ever happens while we're in the undo queue
+void Action::makeNoteArrayChangeDiff(ConsequenceNoteArrayChange* noteArrayChange, NoteVector* currentNotes) {
+	consequenceBackupSize -= noteArrayChange->getMemoryUsed(BEFORE);
+	noteArrayChange->makeDiff(currentNotes);
+	consequenceBackupSize += noteArrayChange->getMemoryUsed(BEFORE);
+}
+
+// Roughly how much memory this Action is taking up, including everything its Consequences have backed up
+uint32_t Action::getMemoryUsed() {
+	return sizeof(Action) + numClipStates * sizeof(ActionClipState) + consequenceMemorySize + consequenceBackupSize;
+}
+
+// For when Consequences have changed under us, e.g. by being reverted
+void Action::recalculateMemoryUsed(int32_t whichQueueActionIn) {
+	consequenceBackupSize = 0;
+	for (Consequence* thisCons = firstConsequence; thisCons; thisCons = thisCons->next) {
+		consequenceBackupSize += thisCons->getMemoryUsed(whichQueueActionIn);
+	}
+}
+
 void Action::updateYScrollClipViewAfter(InstrumentClip* clip) {
 	if (!numClipStates) {
 		return;
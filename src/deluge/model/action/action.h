@@ -26,6 +26,7 @@ class ParamCollection;
 class Sound;
 class AutoParam;
 class ConsequenceParamChange;
+class ConsequenceNoteArrayChange;
 class Note;
 class ActionClipState;
 class UI;
@@ -39,6 +40,7 @@ class AudioClip;
 class NoteVector;
 class ModelStackWithAutoParam;
 class ModelStack;
+struct ConsequenceMemoryChunk;
 
 #define ACTION_MISC 0
 #define ACTION_NOTE_EDIT 1
@@ -92,6 +94,10 @@ public:
 	bool recordClipExistenceChange(Song* song, ClipArray* clipArray, Clip* clip, ExistenceChangeType type);
 	void recordAudioClipSampleChange(AudioClip* clip);
 	void deleteAllConsequences(int32_t whichQueueActionIn, Song* song, bool destructing = false);
+	void* allocConsequenceMemory(uint32_t size);
+	void close();
+	uint32_t getMemoryUsed();
+	void recalculateMemoryUsed(int32_t whichQueueActionIn);
 
 	uint8_t type;
 	bool openForAdditions;
@@ -139,4 +145,16 @@ public:
 	int8_t offset; // Recorded for the purpose of knowing when we can do those "partial undos"
 
 private:
+	void freeConsequenceMemory(ConsequenceMemoryChunk* chunk);
+	bool mayCompactNoteArrayChanges();
+	void makeNoteArrayChangeDiff(ConsequenceNoteArrayChange* noteArrayChange, NoteVector* currentNotes);
+
+	// All our Consequences live in these, one after another, and the memory all goes in one go with the Action - so
+	// Consequences must never be individually deallocated, only destructed.
+	ConsequenceMemoryChunk* firstConsequenceMemoryChunk;
+	uint32_t consequenceMemorySize; // Total of the chunks, in bytes
+
+	// What the Consequences are holding on to beyond themselves, in bytes. Kept up to date as they're added and
+	// reverted, so getMemoryUsed() doesn't have to go through them all
+	uint32_t consequenceBackupSize;
 };
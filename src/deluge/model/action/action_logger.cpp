@@ -122,7 +122,8 @@ Action* ActionLogger::getNewAction(int32_t newActionType, int32_t addToExistingI
 
 		// Make sure we close off any existing action
 		if (firstAction[BEFORE]) {
-			firstAction[BEFORE]->openForAdditions = false;
+			firstAction[BEFORE]->close();
+			deleteOldActionsBeyondMemoryBudget();
 		}
 
 		// And make a new one
@@ -265,7 +266,7 @@ void ActionLogger::recordSwingChange(int8_t swingBefore, int8_t swingAfter) {
 		consequence->swing[AFTER] = swingAfter;
 	}
 	else {
-		void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceSwingChange));
+		void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceSwingChange));
 
 		if (consMemory) {
 			ConsequenceSwingChange* newConsequence = new (consMemory) ConsequenceSwingChange(swingBefore, swingAfter);
@@ -288,7 +289,7 @@ void ActionLogger::recordTempoChange(uint64_t timePerBigBefore, uint64_t timePer
 	}
 	else {
 
-		void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceTempoChange));
+		void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceTempoChange));
 
 		if (consMemory) {
 			ConsequenceTempoChange* newConsequence =
@@ -714,15 +715,54 @@ currentClipSwitchedOver:
 }
 
 void ActionLogger::closeAction(int32_t actionType) {
-	if (firstAction[BEFORE] && firstAction[BEFORE]->type == actionType) {
-		firstAction[BEFORE]->openForAdditions = false;
+	if (firstAction[BEFORE] && firstAction[BEFORE]->type == actionType && firstAction[BEFORE]->openForAdditions) {
+		firstAction[BEFORE]->close();
+		deleteOldActionsBeyondMemoryBudget();
 	}
 }
 
 void ActionLogger::closeActionUnlessCreatedJustNow(int32_t actionType) {
-	if (firstAction[BEFORE] && firstAction[BEFORE]->type == actionType
+	if (firstAction[BEFORE] && firstAction[BEFORE]->type == actionType && firstAction[BEFORE]->openForAdditions
 	    && firstAction[BEFORE]->creationTime != AudioEngine::audioSampleTimer) {
-		firstAction[BEFORE]->openForAdditions = false;
+		firstAction[BEFORE]->close();
+		deleteOldActionsBeyondMemoryBudget();
+	}
+}
+
+// Once the undo history's taking up more than its budget, the oldest Actions go. The most recent one always stays.
+// The redo queue counts towards the budget too, but it's left alone - it all gets deleted the next time something new
+// is done anyway
+void ActionLogger::deleteOldActionsBeyondMemoryBudget() {
+	uint32_t totalMemoryUsed = 0;
+	for (Action* action = firstAction[AFTER]; action; action = action->nextAction) {
+		totalMemoryUsed += action->getMemoryUsed();
+	}
+
+	for (Action* action = firstAction[BEFORE]; action; action = action->nextAction) {
+		Action* nextAction = action->nextAction;
+		if (!nextAction) {
+			return;
+		}
+
+		totalMemoryUsed += action->getMemoryUsed();
+		if (totalMemoryUsed + nextAction->getMemoryUsed() > kUndoHistoryMemoryBudget) {
+			action->nextAction = NULL;
+
+			int32_t numDeleted = 0;
+			while (nextAction) {
+				Action* toDelete = nextAction;
+				nextAction = nextAction->nextAction;
+
+				toDelete->prepareForDestruction(BEFORE, currentSong);
+				toDelete->~Action();
+				GeneralMemoryAllocator::get().dealloc(toDelete);
+				numDeleted++;
+			}
+
+			Debug::print("undo history over budget, deleted actions: ");
+			Debug::println(numDeleted);
+			return;
+		}
 	}
 }
 
@@ -850,12 +890,12 @@ gotMultipleConsequencesPerNoteRow:
 				firstAction[BEFORE]->firstConsequence = firstConsequence->next;
 
 				firstConsequence->prepareForDestruction(BEFORE, modelStack->song);
-				firstConsequence->~Consequence();
-				GeneralMemoryAllocator::get().dealloc(firstConsequence);
+				firstConsequence->~Consequence(); // Its memory goes with the Action
 				firstConsequence = firstAction[BEFORE]->firstConsequence;
 			} while (thisConsequence->type != Consequence::NOTE_ARRAY_CHANGE
 			         || ((ConsequenceNoteArrayChange*)firstConsequence)->noteRowId != firstNoteRowId);
 
+			firstAction[BEFORE]->recalculateMemoryUsed(BEFORE);
 			Debug::println("did secret undo, just one Consequence");
 		}
 
@@ -29,6 +29,9 @@ class ModelStack;
 #define ACTION_ADDITION_ALLOWED 1
 #define ACTION_ADDITION_ALLOWED_ONLY_IF_NO_TIME_PASSED 2
 
+// Roughly how much memory the undo history may take up before the oldest Actions get deleted
+constexpr uint32_t kUndoHistoryMemoryBudget = 2 * 1024 * 1024;
+
 class ActionLogger {
 public:
 	ActionLogger();
@@ -55,6 +58,7 @@ private:
 	void revertAction(Action* action, bool updateVisually, bool doNavigation, TimeType time);
 	void deleteLastActionIfEmpty();
 	void deleteLastAction();
+	void deleteOldActionsBeyondMemoryBudget();
 };
 
 extern ActionLogger actionLogger;
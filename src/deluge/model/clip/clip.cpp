@@ -23,7 +23,6 @@
 #include "gui/views/view.h"
 #include "hid/display/display.h"
 #include "io/debug/print.h"
-#include "memory/general_memory_allocator.h"
 #include "model/action/action_logger.h"
 #include "model/clip/audio_clip.h"
 #include "model/clip/clip_instance.h"
@@ -387,7 +386,7 @@ bool Clip::opportunityToBeginSessionLinearRecording(ModelStackWithTimelineCounte
 				                                  ExistenceChangeType::CREATE);
 
 				if (*newOutputCreated) {
-					void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceOutputExistence));
+					void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceOutputExistence));
 					if (consMemory) {
 						ConsequenceOutputExistence* cons =
 						    new (consMemory) ConsequenceOutputExistence(output, ExistenceChangeType::CREATE);
@@ -398,7 +397,7 @@ bool Clip::opportunityToBeginSessionLinearRecording(ModelStackWithTimelineCounte
 		}
 		else {
 			if (action) {
-				void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceClipBeginLinearRecord));
+				void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceClipBeginLinearRecord));
 				if (consMemory) {
 					ConsequenceClipBeginLinearRecord* cons = new (consMemory) ConsequenceClipBeginLinearRecord(this);
 					action->addConsequence(cons);
@@ -16,7 +16,6 @@
 */
 
 #include "model/clip/clip_instance.h"
-#include "memory/general_memory_allocator.h"
 #include "model/action/action.h"
 #include "model/clip/instrument_clip.h"
 #include "model/consequence/consequence_clip_instance_change.h"
@@ -39,7 +38,7 @@ void ClipInstance::getColour(uint8_t* colour) {
 
 void ClipInstance::change(Action* action, Output* output, int32_t newPos, int32_t newLength, Clip* newClip) {
 	if (action) {
-		void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceClipInstanceChange));
+		void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceClipInstanceChange));
 
 		if (consMemory) {
 			ConsequenceClipInstanceChange* newConsequence =
@@ -79,6 +79,11 @@ InstrumentClip::InstrumentClip(Song* song) : Clip(CLIP_TYPE_INSTRUMENT) {
 
 	currentlyRecordingLinearly = false;
 
+	for (int32_t i = 0; i < kDrumNoteRowCacheSize; i++) {
+		drumNoteRowCache[i].drum = NULL;
+	}
+	drumNoteRowCacheChangeCount = noteRows.changeCount;
+
 	if (song) {
 		colourOffset -= song->rootNote;
 	}
@@ -467,8 +472,7 @@ int32_t InstrumentClip::beginLinearRecording(ModelStackWithTimelineCounter* mode
 				thisDrum->earlyNoteVelocity = 0;
 
 				int32_t noteRowIndex;
-				NoteRow* noteRow = getNoteRowForDrum(
-				    thisDrum, &noteRowIndex); // Remember, I'm planning to introduce a faster search/index for this
+				NoteRow* noteRow = getNoteRowForDrum(thisDrum, &noteRowIndex);
 				if (noteRow) {
 
 					if (!action) {
@@ -935,7 +939,7 @@ void InstrumentClip::toggleNoteRowMute(ModelStackWithNoteRow* modelStack) {
 	// Record action
 	Action* action = actionLogger.getNewAction(ACTION_MISC);
 	if (action) {
-		void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceNoteRowMute));
+		void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceNoteRowMute));
 
 		if (consMemory) {
 			ConsequenceNoteRowMute* newConsequence =
@@ -1028,17 +1032,49 @@ ModelStackWithNoteRow* InstrumentClip::getNoteRowForDrum(ModelStackWithTimelineC
 
 NoteRow* InstrumentClip::getNoteRowForDrum(Drum* drum, int32_t* getIndex) {
 
-	for (int32_t i = 0; i < noteRows.getNumElements(); i++) {
-		NoteRow* thisNoteRow = noteRows.getElement(i);
+	int32_t i;
+	NoteRow* thisNoteRow;
+
+	// Try where it was last time first
+	DrumNoteRowCacheEntry* cacheEntry = NULL;
+	if (drum) {
+		if (drumNoteRowCacheChangeCount != noteRows.changeCount) {
+			for (int32_t c = 0; c < kDrumNoteRowCacheSize; c++) {
+				drumNoteRowCache[c].drum = NULL;
+			}
+			drumNoteRowCacheChangeCount = noteRows.changeCount;
+		}
+
+		cacheEntry = &drumNoteRowCache[((uintptr_t)drum >> 4) & (kDrumNoteRowCacheSize - 1)];
+		if (cacheEntry->drum == drum) {
+			i = cacheEntry->noteRowIndex;
+			if (i < noteRows.getNumElements()) {
+				thisNoteRow = noteRows.getElement(i);
+				if (thisNoteRow->drum == drum) {
+					goto foundIt;
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < noteRows.getNumElements(); i++) {
+		thisNoteRow = noteRows.getElement(i);
 		if (thisNoteRow->drum == drum) {
-			if (getIndex) {
-				*getIndex = i;
+			if (cacheEntry) {
+				cacheEntry->drum = drum;
+				cacheEntry->noteRowIndex = i;
 			}
-			return thisNoteRow;
+			goto foundIt;
 		}
 	}
 
 	return NULL;
+
+foundIt:
+	if (getIndex) {
+		*getIndex = i;
+	}
+	return thisNoteRow;
 }
 
 // Should only be called for Kit Clips
@@ -1101,7 +1137,7 @@ ModelStackWithNoteRow* InstrumentClip::getOrCreateNoteRowForYNote(int32_t yNote,
 				thisNoteRow->notes.empty(); // Undo our "total hack", above
 
 				if (action) {
-					void* consMemory = GeneralMemoryAllocator::get().alloc(sizeof(ConsequenceScaleAddNote));
+					void* consMemory = action->allocConsequenceMemory(sizeof(ConsequenceScaleAddNote));
 
 					if (consMemory) {
 						ConsequenceScaleAddNote* newConsequence =
@@ -48,6 +48,8 @@ class ModelStackWithNoteRow;
 
 struct PendingNoteOn;
 
+constexpr int32_t kDrumNoteRowCacheSize = 32; // Must be a power of 2
+
 extern uint8_t undefinedColour[];
 
 class InstrumentClip final : public Clip {
@@ -124,6 +126,17 @@ public:
 
 	NoteRowVector noteRows;
 
+	// Where some Drums' NoteRows were the last time they got looked up, so a big Kit doesn't need to go through all
+	// its NoteRows for every MIDI note. Drums can be in more than one Clip, so this lives here rather than on the Drum.
+	// Forgotten whenever noteRows.changeCount moves on, and still checked on use, because NoteRows get their Drums
+	// reassigned directly in lots of places
+	struct DrumNoteRowCacheEntry {
+		Drum* drum;
+		int32_t noteRowIndex;
+	};
+	DrumNoteRowCacheEntry drumNoteRowCache[kDrumNoteRowCacheSize];
+	uint32_t drumNoteRowCacheChangeCount;
+
 	bool wrapEditing;
 	uint32_t wrapEditLevel;
 
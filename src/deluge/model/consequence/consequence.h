@@ -38,6 +38,17 @@ public:
 
 	virtual void prepareForDestruction(int32_t whichQueueActionIn, Song* song) {}
 	virtual int32_t revert(TimeType time, ModelStack* modelStack) = 0;
+
+	// Called on every Consequence in an Action before any of them get reverted, so anything which needs memory to
+	// revert can get it here, and if there isn't enough, the Action gets left how it was. Returns error code
+	virtual int32_t prepareToRevert() { return NO_ERROR; }
+
+	// If a later Consequence's prepareToRevert() failed, this gives back whatever ours got
+	virtual void abandonRevert() {}
+
+	// Memory we're holding on to beyond our own object - backed-up notes, or a Clip or Output that's currently deleted
+	virtual uint32_t getMemoryUsed(int32_t whichQueueActionIn) { return 0; }
+
 	Consequence* next;
 	uint8_t type;
 };
@@ -25,6 +25,7 @@
 #include "model/clip/instrument_clip.h"
 #include "model/instrument/instrument.h"
 #include "model/model_stack.h"
+#include "model/note/note_row.h"
 #include "model/output.h"
 #include "model/song/song.h"
 #include "playback/mode/arrangement.h"
@@ -56,6 +57,26 @@ void ConsequenceClipExistence::prepareForDestruction(int32_t whichQueueActionIn,
 	}
 }
 
+// While the Clip's deleted, it's ours - see prepareForDestruction(). The rest of the time it's the Song's
+uint32_t ConsequenceClipExistence::getMemoryUsed(int32_t whichQueueActionIn) {
+	if (whichQueueActionIn == util::to_underlying(type)) {
+		return 0;
+	}
+
+	uint32_t memoryUsed = GeneralMemoryAllocator::get().getAllocatedSize(clip);
+
+	if (clip->type == CLIP_TYPE_INSTRUMENT) {
+		NoteRowVector* noteRows = &((InstrumentClip*)clip)->noteRows;
+		memoryUsed += noteRows->getNumElements() * noteRows->elementSize;
+		for (int32_t i = 0; i < noteRows->getNumElements(); i++) {
+			NoteVector* notes = &noteRows->getElement(i)->notes;
+			memoryUsed += notes->getNumElements() * notes->elementSize;
+		}
+	}
+
+	return memoryUsed;
+}
+
 int32_t ConsequenceClipExistence::revert(TimeType time, ModelStack* modelStack) {
 	ModelStackWithTimelineCounter* modelStackWithTimelineCounter = modelStack->addTimelineCounter(clip);
 
@@ -29,6 +29,7 @@ public:
 	ConsequenceClipExistence(Clip* newClip, ClipArray* newClipArray, ExistenceChangeType newType);
 	void prepareForDestruction(int32_t whichQueueActionIn, Song* song);
 	int32_t revert(TimeType time, ModelStack* modelStack);
+	uint32_t getMemoryUsed(int32_t whichQueueActionIn);
 
 	Clip* clip;
 	ClipArray* clipArray;
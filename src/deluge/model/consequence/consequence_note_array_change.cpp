@@ -17,14 +17,18 @@
 
 #include "model/consequence/consequence_note_array_change.h"
 #include "definitions_cxx.hpp"
+#include "io/debug/print.h"
 #include "model/clip/instrument_clip.h"
+#include "model/note/note.h"
 #include "model/note/note_row.h"
+#include <algorithm>
 
 ConsequenceNoteArrayChange::ConsequenceNoteArrayChange(InstrumentClip* newClip, int32_t newNoteRowId,
                                                        NoteVector* newNoteVector, bool stealData) {
 	type = Consequence::NOTE_ARRAY_CHANGE;
 	clip = newClip;
 	noteRowId = newNoteRowId;
+	isDiff = false;
 
 	// Either steal the data...
 	if (stealData) {
@@ -37,6 +41,78 @@ ConsequenceNoteArrayChange::ConsequenceNoteArrayChange(InstrumentClip* newClip,
 	}
 }
 
+static bool notesAreSame(Note* a, Note* b) {
+	return (a->pos == b->pos && a->length == b->length && a->velocity == b->velocity
+	        && a->probability == b->probability && a->lift == b->lift);
+}
+
+static uint32_t getChecksum(NoteVector* notes) {
+	uint32_t checksum = notes->getNumElements();
+	for (int32_t i = 0; i < notes->getNumElements(); i++) {
+		Note* note = notes->getElement(i);
+		checksum = checksum * 31 + note->pos;
+		checksum = checksum * 31 + note->length;
+		checksum = checksum * 31 + (note->velocity | (note->probability << 8) | (note->lift << 16));
+	}
+	return checksum;
+}
+
+// From now on, we'll only ever get reverted from the NoteRow being exactly as currentNotes are now, so we can drop
+// all the backed-up notes at the start and end which are the same as those
+void ConsequenceNoteArrayChange::makeDiff(NoteVector* currentNotes) {
+	int32_t numBackedUp = backedUpNoteVector.getNumElements();
+	int32_t numCurrent = currentNotes->getNumElements();
+	int32_t maxSame = std::min(numBackedUp, numCurrent);
+
+	int32_t numSameAtStart = 0;
+	while (numSameAtStart < maxSame
+	       && notesAreSame(backedUpNoteVector.getElement(numSameAtStart), currentNotes->getElement(numSameAtStart))) {
+		numSameAtStart++;
+	}
+
+	int32_t numSameAtEnd = 0;
+	while (numSameAtEnd < maxSame - numSameAtStart
+	       && notesAreSame(backedUpNoteVector.getElement(numBackedUp - 1 - numSameAtEnd),
+	                       currentNotes->getElement(numCurrent - 1 - numSameAtEnd))) {
+		numSameAtEnd++;
+	}
+
+	if (numSameAtEnd) {
+		backedUpNoteVector.deleteAtIndex(numBackedUp - numSameAtEnd, numSameAtEnd);
+	}
+	if (numSameAtStart) {
+		backedUpNoteVector.deleteAtIndex(0, numSameAtStart);
+	}
+
+	isDiff = true;
+	numNotesSameAtStart = numSameAtStart;
+	numNotesSameAtEnd = numSameAtEnd;
+	numNotesToReplace = numCurrent - numSameAtStart - numSameAtEnd;
+	checksumToRevertFrom = getChecksum(currentNotes);
+}
+
+// If we're a diff, the NoteRow has to be put back together in memory of its own, which we get now
+int32_t ConsequenceNoteArrayChange::prepareToRevert() {
+	if (!isDiff) {
+		return NO_ERROR;
+	}
+
+	int32_t numAfterRevert = numNotesSameAtStart + backedUpNoteVector.getNumElements() + numNotesSameAtEnd;
+	if (numAfterRevert && !revertedNotes.ensureEnoughSpaceAllocated(numAfterRevert)) {
+		return ERROR_INSUFFICIENT_RAM;
+	}
+
+	return NO_ERROR;
+}
+
+void ConsequenceNoteArrayChange::abandonRevert() {
+	revertedNotes.empty();
+}
+
+uint32_t ConsequenceNoteArrayChange::getMemoryUsed(int32_t whichQueueActionIn) {
+	return backedUpNoteVector.getNumElements() * backedUpNoteVector.elementSize;
+}
+
 int32_t ConsequenceNoteArrayChange::revert(TimeType time, ModelStack* modelStack) {
 
 	NoteRow* noteRow = clip->getNoteRowFromId(noteRowId);
@@ -44,7 +120,55 @@ int32_t ConsequenceNoteArrayChange::revert(TimeType time, ModelStack* modelStack
 		return ERROR_BUG;
 	}
 
-	noteRow->notes.swapStateWith(&backedUpNoteVector);
+	if (!isDiff) {
+		noteRow->notes.swapStateWith(&backedUpNoteVector);
+		return NO_ERROR;
+	}
+
+	// If the notes aren't how they were when we made the diff, something changed them without recording it, and we
+	// can't get back to how they were before
+	if (noteRow->notes.getNumElements() != numNotesSameAtStart + numNotesToReplace + numNotesSameAtEnd
+	    || getChecksum(&noteRow->notes) != checksumToRevertFrom) {
+		Debug::println("note array diff doesn't match");
+		return ERROR_BUG;
+	}
+
+	// Put the reverted notes together in the memory prepareToRevert() got us - so this won't need to allocate
+	int32_t numToPutIn = backedUpNoteVector.getNumElements();
+	int32_t numAfterRevert = numNotesSameAtStart + numToPutIn + numNotesSameAtEnd;
+	if (numAfterRevert) {
+		int32_t error = revertedNotes.insertAtIndex(0, numAfterRevert);
+		if (error) {
+			return error;
+		}
+	}
+
+	for (int32_t i = 0; i < numNotesSameAtStart; i++) {
+		*revertedNotes.getElement(i) = *noteRow->notes.getElement(i);
+	}
+	for (int32_t i = 0; i < numToPutIn; i++) {
+		*revertedNotes.getElement(numNotesSameAtStart + i) = *backedUpNoteVector.getElement(i);
+	}
+	for (int32_t i = 0; i < numNotesSameAtEnd; i++) {
+		*revertedNotes.getElement(numNotesSameAtStart + numToPutIn + i) =
+		    *noteRow->notes.getElement(numNotesSameAtStart + numNotesToReplace + i);
+	}
+
+	// The notes the NoteRow had become our new diff, once we've dropped the ones that are the same either way.
+	// Deleting from the ends only ever gives memory back
+	noteRow->notes.swapStateWith(&revertedNotes);
+	backedUpNoteVector.swapStateWith(&revertedNotes);
+	revertedNotes.empty();
+
+	if (numNotesSameAtEnd) {
+		backedUpNoteVector.deleteAtIndex(numNotesSameAtStart + numNotesToReplace, numNotesSameAtEnd);
+	}
+	if (numNotesSameAtStart) {
+		backedUpNoteVector.deleteAtIndex(0, numNotesSameAtStart);
+	}
+
+	numNotesToReplace = numToPutIn;
+	checksumToRevertFrom = getChecksum(&noteRow->notes);
 
 	return NO_ERROR;
 }
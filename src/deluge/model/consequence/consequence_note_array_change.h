@@ -28,9 +28,25 @@ public:
 	ConsequenceNoteArrayChange(InstrumentClip* newClip, int32_t newNoteRowId, NoteVector* newNoteVector,
 	                           bool stealData);
 	int32_t revert(TimeType time, ModelStack* modelStack);
+	int32_t prepareToRevert();
+	void abandonRevert();
+	uint32_t getMemoryUsed(int32_t whichQueueActionIn);
+	void makeDiff(NoteVector* currentNotes);
 
 	InstrumentClip* clip;
 	int32_t noteRowId;
 
+	// Either all the notes, or if isDiff, just the ones between the first numNotesSameAtStart and the last
+	// numNotesSameAtEnd, which are the same either way
 	NoteVector backedUpNoteVector;
+
+	bool isDiff;
+	int32_t numNotesSameAtStart;
+	int32_t numNotesSameAtEnd;
+	int32_t numNotesToReplace; // How many the NoteRow will have between those when we revert
+	uint32_t checksumToRevertFrom;
+
+	// If isDiff, prepareToRevert() allocates room here for all the notes the NoteRow will have once we've reverted,
+	// so the revert itself can't fail
+	NoteVector revertedNotes;
 };
@@ -18,6 +18,7 @@
 #include "model/consequence/consequence_output_existence.h"
 #include "definitions_cxx.hpp"
 #include "hid/display/display.h"
+#include "memory/general_memory_allocator.h"
 #include "model/model_stack.h"
 #include "model/output.h"
 #include "model/song/song.h"
@@ -47,3 +48,11 @@ int32_t ConsequenceOutputExistence::revert(TimeType time, ModelStack* modelStack
 
 	return NO_ERROR;
 }
+
+// Same as for ConsequenceClipExistence - the Output's only ours to count while it's out of the Song
+uint32_t ConsequenceOutputExistence::getMemoryUsed(int32_t whichQueueActionIn) {
+	if (whichQueueActionIn == util::to_underlying(type)) {
+		return 0;
+	}
+	return GeneralMemoryAllocator::get().getAllocatedSize(dynamic_cast<void*>(output));
+}
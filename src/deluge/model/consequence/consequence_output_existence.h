@@ -26,6 +26,7 @@ class ConsequenceOutputExistence final : public Consequence {
 public:
 	ConsequenceOutputExistence(Output* newOutput, ExistenceChangeType newType);
 	int32_t revert(TimeType time, ModelStack* modelStack) override;
+	uint32_t getMemoryUsed(int32_t whichQueueActionIn) override;
 
 	Output* output;
 	int32_t outputIndex;
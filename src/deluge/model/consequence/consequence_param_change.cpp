@@ -49,3 +49,7 @@ int32_t ConsequenceParamChange::revert(TimeType time, ModelStack* modelStackWith
 
 	return NO_ERROR;
 }
+
+uint32_t ConsequenceParamChange::getMemoryUsed(int32_t whichQueueActionIn) {
+	return state.nodes.getNumElements() * state.nodes.elementSize;
+}
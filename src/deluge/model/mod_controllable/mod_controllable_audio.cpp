@@ -39,6 +39,7 @@
 #include "storage/storage_manager.h"
 #include "util/fast_fixed_math.h"
 #include "util/misc.h"
+#include <arm_neon.h>
 #include <string.h>
 extern "C" {}
 
@@ -249,228 +250,32 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 			grainFeedbackVol = grainVol >> 3;
 		}
 
-		StereoSample* currentSample = buffer;
-		do {
-
-			int32_t lfoOutput = modFXLFO.render(1, modFXLFOWaveType, modFXRate);
+		// Each type gets its own kernel, so there's nothing to branch on per sample
+		if (modFXType == ModFXType::GRAIN) {
+			modFXLFO.tick(numSamples, modFXRate); // Not used, but keep it moving like it always has
+			processGrainFX(buffer, numSamples);
+			AudioEngine::logAction("grain end");
+		}
+		else {
+			// The LFO gets rendered just once for the whole block
+			int32_t lfoValues[SSI_TX_BUFFER_NUM_SAMPLES];
+			modFXLFO.renderBlock(lfoValues, numSamples, modFXLFOWaveType, modFXRate);
 
 			if (modFXType == ModFXType::PHASER) {
-
-				// "1" is sorta represented by 1073741824 here
-				int32_t _a1 =
-				    1073741824
-				    - multiply_32x32_rshift32_rounded((((uint32_t)lfoOutput + (uint32_t)2147483648) >> 1), modFXDepth);
-
-				phaserMemory.l = currentSample->l + (multiply_32x32_rshift32_rounded(phaserMemory.l, feedback) << 1);
-				phaserMemory.r = currentSample->r + (multiply_32x32_rshift32_rounded(phaserMemory.r, feedback) << 1);
-
-				// Do the allpass filters
-				for (auto& sample : allpassMemory) {
-					StereoSample whatWasInput = phaserMemory;
-
-					phaserMemory.l = (multiply_32x32_rshift32_rounded(phaserMemory.l, -_a1) << 2) + sample.l;
-					sample.l = (multiply_32x32_rshift32_rounded(phaserMemory.l, _a1) << 2) + whatWasInput.l;
-
-					phaserMemory.r = (multiply_32x32_rshift32_rounded(phaserMemory.r, -_a1) << 2) + sample.r;
-					sample.r = (multiply_32x32_rshift32_rounded(phaserMemory.r, _a1) << 2) + whatWasInput.r;
-				}
-
-				currentSample->l += phaserMemory.l;
-				currentSample->r += phaserMemory.r;
+				processPhaserFX(buffer, numSamples, lfoValues, modFXDepth, feedback);
 			}
-			else if (modFXType == ModFXType::GRAIN) {
-
-				int32_t writeIndex = modFXGrainBufferWriteIndex & kModFXGrainBufferIndexMask; // % kModFXGrainBufferSize
-				if (modFXGrainBufferWriteIndex % grainRate == 0) {
-					for (int32_t i = 0; i < 8; i++) {
-						if (grains[i].length <= 0) {
-							grains[i].length = grainSize;
-							int32_t spray = random(kModFXGrainBufferSize >> 1) - (kModFXGrainBufferSize >> 2);
-							grains[i].startPoint =
-							    (modFXGrainBufferWriteIndex + kModFXGrainBufferSize - grainShift + spray)
-							    & kModFXGrainBufferIndexMask;
-							grains[i].counter = 0;
-							grains[i].rev = (getRandom255() < 76);
-
-							int32_t pitchRand = getRandom255();
-							switch (grainPitchType) {
-							case -2:
-								grains[i].pitch = (pitchRand < 76) ? 2048 : 1024; //unison + octave + reverse
-								grains[i].rev = 1;
-								break;
-							case -1:
-								grains[i].pitch = (pitchRand < 76) ? 512 : 1024; //unison + octave lower
-								break;
-							case 0:
-								grains[i].pitch = (pitchRand < 76) ? 2048 : 1024; //unison + octave (default)
-								break;
-							case 1:
-								grains[i].pitch = (pitchRand < 76) ? 1534 : 2048; //5th + octave
-								break;
-							case 2:
-								grains[i].pitch = (pitchRand < 25)    ? 512
-								                  : (pitchRand < 153) ? 2048
-								                                      : 1024; // unison + octave + octave lower
-								break;
-							}
-							if (grains[i].rev) {
-								grains[i].startPoint =
-								    (writeIndex + kModFXGrainBufferSize - 1) & kModFXGrainBufferIndexMask;
-								grains[i].length =
-								    (grains[i].pitch > 1024)
-								        ? std::min<int32_t>(grains[i].length, 21659)  // Buffer length*0.3305
-								        : std::min<int32_t>(grains[i].length, 30251); // 1.48s - 0.8s
-							}
-							else {
-								if (grains[i].pitch > 1024) {
-									int32_t startPointMax =
-									    (writeIndex + grains[i].length - ((grains[i].length * grains[i].pitch) >> 10)
-									     + kModFXGrainBufferSize)
-									    & kModFXGrainBufferIndexMask;
-									if (!(grains[i].startPoint < startPointMax && grains[i].startPoint > writeIndex)) {
-										grains[i].startPoint =
-										    (startPointMax + kModFXGrainBufferSize - 1) & kModFXGrainBufferIndexMask;
-									}
-								}
-								else if (grains[i].pitch < 1024) {
-									int32_t startPointMax =
-									    (writeIndex + grains[i].length - ((grains[i].length * grains[i].pitch) >> 10)
-									     + kModFXGrainBufferSize)
-									    & kModFXGrainBufferIndexMask;
-
-									if (!(grains[i].startPoint > startPointMax && grains[i].startPoint < writeIndex)) {
-										grains[i].startPoint =
-										    (writeIndex + kModFXGrainBufferSize - 1) & kModFXGrainBufferIndexMask;
-									}
-								}
-							}
-							if (!grainInitialized) {
-								if (!grains[i].rev) { //forward
-									grains[i].pitch = 1024;
-									if (modFXGrainBufferWriteIndex > 13231) {
-										int32_t newStartPoint =
-										    std::max<int32_t>(440, random(modFXGrainBufferWriteIndex - 2));
-										grains[i].startPoint = (writeIndex - newStartPoint + kModFXGrainBufferSize)
-										                       & kModFXGrainBufferIndexMask;
-									}
-									else {
-										grains[i].length = 0;
-									}
-								}
-								else {
-									grains[i].pitch = std::min<int32_t>(grains[i].pitch, 1024);
-									if (modFXGrainBufferWriteIndex > 13231) {
-										grains[i].length =
-										    std::min<int32_t>(grains[i].length, modFXGrainBufferWriteIndex - 2);
-										grains[i].startPoint =
-										    (writeIndex - 1 + kModFXGrainBufferSize) & kModFXGrainBufferIndexMask;
-									}
-									else {
-										grains[i].length = 0;
-									}
-								}
-							}
-							if (grains[i].length > 0) {
-								grains[i].volScale = (2147483647 / (grains[i].length >> 1));
-								grains[i].volScaleMax = grains[i].volScale * (grains[i].length >> 1);
-								shouldDoPanning((getRandom255() - 128) << 23, &grains[i].panVolL,
-								                &grains[i].panVolR); //Pan Law 0
-							}
-							break;
-						}
-					}
-				}
-
-				int32_t grains_l = 0;
-				int32_t grains_r = 0;
-				for (int32_t i = 0; i < 8; i++) {
-					if (grains[i].length > 0) {
-						//triangle window
-						int32_t vol = grains[i].counter <= (grains[i].length >> 1)
-						                  ? grains[i].counter * grains[i].volScale
-						                  : grains[i].volScaleMax
-						                        - (grains[i].counter - (grains[i].length >> 1)) * grains[i].volScale;
-						int32_t delta = grains[i].counter * (grains[i].rev == 1 ? -1 : 1);
-						if (grains[i].pitch != 1024) {
-							delta = ((delta * grains[i].pitch) >> 10);
-						}
-						int32_t pos =
-						    (grains[i].startPoint + delta + kModFXGrainBufferSize) & kModFXGrainBufferIndexMask;
-
-						grains_l = multiply_accumulate_32x32_rshift32_rounded(
-						    grains_l, multiply_32x32_rshift32(modFXGrainBuffer[pos].l, vol) << 0, grains[i].panVolL);
-						grains_r = multiply_accumulate_32x32_rshift32_rounded(
-						    grains_r, multiply_32x32_rshift32(modFXGrainBuffer[pos].r, vol) << 0, grains[i].panVolR);
-
-						grains[i].counter++;
-						if (grains[i].counter >= grains[i].length) {
-							grains[i].length = 0;
-						}
-					}
-				}
-
-				grains_l <<= 3;
-				grains_r <<= 3;
-				//Feedback (Below grainFeedbackVol means "grainVol >> 4")
-				modFXGrainBuffer[writeIndex].l =
-				    multiply_accumulate_32x32_rshift32_rounded(currentSample->l, grains_l, grainFeedbackVol);
-				modFXGrainBuffer[writeIndex].r =
-				    multiply_accumulate_32x32_rshift32_rounded(currentSample->r, grains_r, grainFeedbackVol);
-				//WET and DRY Vol
-				currentSample->l = add_saturation(multiply_32x32_rshift32(currentSample->l, grainDryVol) << 1,
-				                                  multiply_32x32_rshift32(grains_l, grainVol) << 1);
-				currentSample->r = add_saturation(multiply_32x32_rshift32(currentSample->r, grainDryVol) << 1,
-				                                  multiply_32x32_rshift32(grains_r, grainVol) << 1);
-				modFXGrainBufferWriteIndex++;
+			else if (modFXType == ModFXType::FLANGER) {
+				processModFXDelay<ModFXType::FLANGER>(buffer, numSamples, lfoValues, modFXDelayOffset,
+				                                      thisModFXDelayDepth, feedback);
+			}
+			else if (modFXType == ModFXType::CHORUS_STEREO) {
+				processModFXDelay<ModFXType::CHORUS_STEREO>(buffer, numSamples, lfoValues, modFXDelayOffset,
+				                                            thisModFXDelayDepth, feedback);
 			}
 			else {
-
-				int32_t delayTime = multiply_32x32_rshift32(lfoOutput, thisModFXDelayDepth) + modFXDelayOffset;
-
-				int32_t strength2 = (delayTime & 65535) << 15;
-				int32_t strength1 = (65535 << 15) - strength2;
-				int32_t sample1Pos = modFXBufferWriteIndex - ((delayTime) >> 16);
-
-				int32_t scaledValue1L =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[sample1Pos & kModFXBufferIndexMask].l, strength1);
-				int32_t scaledValue2L =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[(sample1Pos - 1) & kModFXBufferIndexMask].l, strength2);
-				int32_t modFXOutputL = scaledValue1L + scaledValue2L;
-
-				if (modFXType == ModFXType::CHORUS_STEREO) {
-					delayTime = multiply_32x32_rshift32(lfoOutput, -thisModFXDelayDepth) + modFXDelayOffset;
-					strength2 = (delayTime & 65535) << 15;
-					strength1 = (65535 << 15) - strength2;
-					sample1Pos = modFXBufferWriteIndex - ((delayTime) >> 16);
-				}
-
-				int32_t scaledValue1R =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[sample1Pos & kModFXBufferIndexMask].r, strength1);
-				int32_t scaledValue2R =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[(sample1Pos - 1) & kModFXBufferIndexMask].r, strength2);
-				int32_t modFXOutputR = scaledValue1R + scaledValue2R;
-
-				if (modFXType == ModFXType::FLANGER) {
-					modFXOutputL = multiply_32x32_rshift32_rounded(modFXOutputL, feedback) << 2;
-					modFXBuffer[modFXBufferWriteIndex].l = modFXOutputL + currentSample->l; // Feedback
-					modFXOutputR = multiply_32x32_rshift32_rounded(modFXOutputR, feedback) << 2;
-					modFXBuffer[modFXBufferWriteIndex].r = modFXOutputR + currentSample->r; // Feedback
-				}
-
-				else { // Chorus
-					modFXOutputL <<= 1;
-					modFXBuffer[modFXBufferWriteIndex].l = currentSample->l; // Feedback
-					modFXOutputR <<= 1;
-					modFXBuffer[modFXBufferWriteIndex].r = currentSample->r; // Feedback
-				}
-
-				currentSample->l += modFXOutputL;
-				currentSample->r += modFXOutputR;
-				modFXBufferWriteIndex = (modFXBufferWriteIndex + 1) & kModFXBufferIndexMask;
+				processModFXDelay<ModFXType::CHORUS>(buffer, numSamples, lfoValues, modFXDelayOffset,
+				                                     thisModFXDelayDepth, feedback);
 			}
-		} while (++currentSample != bufferEnd);
-		if (modFXType == ModFXType::GRAIN) {
-			AudioEngine::logAction("grain end");
 		}
 	}
 
@@ -628,15 +433,7 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 
 		if (delay.analog) {
 
-			{
-				int32_t* workingBufferPos = delayWorkingBuffer;
-				do {
-					delay.impulseResponseProcessor.process(workingBufferPos[0], workingBufferPos[1],
-					                                       &workingBufferPos[0], &workingBufferPos[1]);
-
-					workingBufferPos += 2;
-				} while (workingBufferPos != workingBufferEnd);
-			}
+			delay.impulseResponseProcessor.processBlock(delayWorkingBuffer, numSamples);
 
 			{
 				int32_t* workingBufferPos = delayWorkingBuffer;
@@ -856,6 +653,264 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 	}
 }
 
+// "1" is sorta represented by 1073741824 here. The allpass chain runs on L and R together, as a vector
+void ModControllableAudio::processPhaserFX(StereoSample* buffer, int32_t numSamples, int32_t const* lfoValues,
+                                           int32_t modFXDepth, int32_t feedback) {
+	int32x2_t memory = vld1_s32(&phaserMemory.l);
+	int32x2_t allpass[kNumAllpassFiltersPhaser];
+	for (int32_t f = 0; f < kNumAllpassFiltersPhaser; f++) {
+		allpass[f] = vld1_s32(&allpassMemory[f].l);
+	}
+	int32x2_t feedbackVector = vdup_n_s32(feedback);
+
+	int32_t* __restrict__ currentSample = &buffer->l;
+	for (int32_t i = 0; i < numSamples; i++) {
+		int32_t _a1 = 1073741824
+		              - multiply_32x32_rshift32_rounded((((uint32_t)lfoValues[i] + (uint32_t)2147483648) >> 1),
+		                                                modFXDepth);
+		int32x2_t a1 = vdup_n_s32(_a1);
+		int32x2_t minusA1 = vdup_n_s32(-_a1);
+
+		int32x2_t input = vld1_s32(currentSample);
+		memory = vadd_s32(input, vqrdmulh_s32(memory, feedbackVector));
+
+		// Do the allpass filters
+		for (int32_t f = 0; f < kNumAllpassFiltersPhaser; f++) {
+			int32x2_t whatWasInput = memory;
+			memory = vadd_s32(vshl_n_s32(vqrdmulh_s32(memory, minusA1), 1), allpass[f]);
+			allpass[f] = vadd_s32(vshl_n_s32(vqrdmulh_s32(memory, a1), 1), whatWasInput);
+		}
+
+		vst1_s32(currentSample, vadd_s32(input, memory));
+		currentSample += 2;
+	}
+
+	vst1_s32(&phaserMemory.l, memory);
+	for (int32_t f = 0; f < kNumAllpassFiltersPhaser; f++) {
+		vst1_s32(&allpassMemory[f].l, allpass[f]);
+	}
+}
+
+// Flanger and both choruses
+template <ModFXType modFXType>
+void ModControllableAudio::processModFXDelay(StereoSample* buffer, int32_t numSamples, int32_t const* lfoValues,
+                                             int32_t modFXDelayOffset, int32_t thisModFXDelayDepth,
+                                             int32_t feedback) {
+	StereoSample* currentSample = buffer;
+	StereoSample* bufferEnd = buffer + numSamples;
+	int32_t const* lfoValue = lfoValues;
+
+	do {
+		int32_t lfoOutput = *(lfoValue++);
+		int32_t delayTime = multiply_32x32_rshift32(lfoOutput, thisModFXDelayDepth) + modFXDelayOffset;
+
+		int32_t strength2 = (delayTime & 65535) << 15;
+		int32_t strength1 = (65535 << 15) - strength2;
+		int32_t sample1Pos = modFXBufferWriteIndex - ((delayTime) >> 16);
+
+		int32_t scaledValue1L =
+		    multiply_32x32_rshift32_rounded(modFXBuffer[sample1Pos & kModFXBufferIndexMask].l, strength1);
+		int32_t scaledValue2L =
+		    multiply_32x32_rshift32_rounded(modFXBuffer[(sample1Pos - 1) & kModFXBufferIndexMask].l, strength2);
+		int32_t modFXOutputL = scaledValue1L + scaledValue2L;
+
+		if constexpr (modFXType == ModFXType::CHORUS_STEREO) {
+			delayTime = multiply_32x32_rshift32(lfoOutput, -thisModFXDelayDepth) + modFXDelayOffset;
+			strength2 = (delayTime & 65535) << 15;
+			strength1 = (65535 << 15) - strength2;
+			sample1Pos = modFXBufferWriteIndex - ((delayTime) >> 16);
+		}
+
+		int32_t scaledValue1R =
+		    multiply_32x32_rshift32_rounded(modFXBuffer[sample1Pos & kModFXBufferIndexMask].r, strength1);
+		int32_t scaledValue2R =
+		    multiply_32x32_rshift32_rounded(modFXBuffer[(sample1Pos - 1) & kModFXBufferIndexMask].r, strength2);
+		int32_t modFXOutputR = scaledValue1R + scaledValue2R;
+
+		if constexpr (modFXType == ModFXType::FLANGER) {
+			modFXOutputL = multiply_32x32_rshift32_rounded(modFXOutputL, feedback) << 2;
+			modFXBuffer[modFXBufferWriteIndex].l = modFXOutputL + currentSample->l; // Feedback
+			modFXOutputR = multiply_32x32_rshift32_rounded(modFXOutputR, feedback) << 2;
+			modFXBuffer[modFXBufferWriteIndex].r = modFXOutputR + currentSample->r; // Feedback
+		}
+
+		else { // Chorus
+			modFXOutputL <<= 1;
+			modFXBuffer[modFXBufferWriteIndex].l = currentSample->l; // Feedback
+			modFXOutputR <<= 1;
+			modFXBuffer[modFXBufferWriteIndex].r = currentSample->r; // Feedback
+		}
+
+		currentSample->l += modFXOutputL;
+		currentSample->r += modFXOutputR;
+		modFXBufferWriteIndex = (modFXBufferWriteIndex + 1) & kModFXBufferIndexMask;
+	} while (++currentSample != bufferEnd);
+}
+
+void ModControllableAudio::processGrainFX(StereoSample* buffer, int32_t numSamples) {
+
+	// Rather than a modulo every sample, work out once how long til the next grain might start
+	int32_t samplesTilNextGrain = (grainRate - (int32_t)(modFXGrainBufferWriteIndex % grainRate)) % grainRate;
+
+	// And only look at the grains that are actually playing
+	uint32_t activeGrains = 0;
+	for (int32_t i = 0; i < 8; i++) {
+		if (grains[i].length > 0) {
+			activeGrains |= (1 << i);
+		}
+	}
+
+	StereoSample* currentSample = buffer;
+	StereoSample* bufferEnd = buffer + numSamples;
+	do {
+		int32_t writeIndex = modFXGrainBufferWriteIndex & kModFXGrainBufferIndexMask; // % kModFXGrainBufferSize
+		if (!samplesTilNextGrain) {
+			int32_t i = startGrain(writeIndex);
+			if (i >= 0) {
+				activeGrains |= (1 << i);
+			}
+			samplesTilNextGrain = grainRate;
+		}
+		samplesTilNextGrain--;
+
+		int32_t grains_l = 0;
+		int32_t grains_r = 0;
+		for (uint32_t toDo = activeGrains; toDo; toDo &= toDo - 1) {
+			int32_t i = __builtin_ctz(toDo);
+
+			//triangle window
+			int32_t vol = grains[i].counter <= (grains[i].length >> 1)
+			                  ? grains[i].counter * grains[i].volScale
+			                  : grains[i].volScaleMax
+			                        - (grains[i].counter - (grains[i].length >> 1)) * grains[i].volScale;
+			int32_t delta = grains[i].counter * (grains[i].rev == 1 ? -1 : 1);
+			if (grains[i].pitch != 1024) {
+				delta = ((delta * grains[i].pitch) >> 10);
+			}
+			int32_t pos = (grains[i].startPoint + delta + kModFXGrainBufferSize) & kModFXGrainBufferIndexMask;
+
+			grains_l = multiply_accumulate_32x32_rshift32_rounded(
+			    grains_l, multiply_32x32_rshift32(modFXGrainBuffer[pos].l, vol) << 0, grains[i].panVolL);
+			grains_r = multiply_accumulate_32x32_rshift32_rounded(
+			    grains_r, multiply_32x32_rshift32(modFXGrainBuffer[pos].r, vol) << 0, grains[i].panVolR);
+
+			grains[i].counter++;
+			if (grains[i].counter >= grains[i].length) {
+				grains[i].length = 0;
+				activeGrains &= ~(1 << i);
+			}
+		}
+
+		grains_l <<= 3;
+		grains_r <<= 3;
+		//Feedback (Below grainFeedbackVol means "grainVol >> 4")
+		modFXGrainBuffer[writeIndex].l =
+		    multiply_accumulate_32x32_rshift32_rounded(currentSample->l, grains_l, grainFeedbackVol);
+		modFXGrainBuffer[writeIndex].r =
+		    multiply_accumulate_32x32_rshift32_rounded(currentSample->r, grains_r, grainFeedbackVol);
+		//WET and DRY Vol
+		currentSample->l = add_saturation(multiply_32x32_rshift32(currentSample->l, grainDryVol) << 1,
+		                                  multiply_32x32_rshift32(grains_l, grainVol) << 1);
+		currentSample->r = add_saturation(multiply_32x32_rshift32(currentSample->r, grainDryVol) << 1,
+		                                  multiply_32x32_rshift32(grains_r, grainVol) << 1);
+		modFXGrainBufferWriteIndex++;
+	} while (++currentSample != bufferEnd);
+}
+
+// Starts a new grain in the first free slot, if there is one. Returns which slot, or -1 if none - or if it ended up
+// with no length because there's not enough in the buffer yet
+int32_t ModControllableAudio::startGrain(int32_t writeIndex) {
+	for (int32_t i = 0; i < 8; i++) {
+		if (grains[i].length <= 0) {
+			grains[i].length = grainSize;
+			int32_t spray = random(kModFXGrainBufferSize >> 1) - (kModFXGrainBufferSize >> 2);
+			grains[i].startPoint =
+			    (modFXGrainBufferWriteIndex + kModFXGrainBufferSize - grainShift + spray) & kModFXGrainBufferIndexMask;
+			grains[i].counter = 0;
+			grains[i].rev = (getRandom255() < 76);
+
+			int32_t pitchRand = getRandom255();
+			switch (grainPitchType) {
+			case -2:
+				grains[i].pitch = (pitchRand < 76) ? 2048 : 1024; //unison + octave + reverse
+				grains[i].rev = 1;
+				break;
+			case -1:
+				grains[i].pitch = (pitchRand < 76) ? 512 : 1024; //unison + octave lower
+				break;
+			case 0:
+				grains[i].pitch = (pitchRand < 76) ? 2048 : 1024; //unison + octave (default)
+				break;
+			case 1:
+				grains[i].pitch = (pitchRand < 76) ? 1534 : 2048; //5th + octave
+				break;
+			case 2:
+				grains[i].pitch = (pitchRand < 25)    ? 512
+				                  : (pitchRand < 153) ? 2048
+				                                      : 1024; // unison + octave + octave lower
+				break;
+			}
+			if (grains[i].rev) {
+				grains[i].startPoint = (writeIndex + kModFXGrainBufferSize - 1) & kModFXGrainBufferIndexMask;
+				grains[i].length = (grains[i].pitch > 1024)
+				                   ? std::min<int32_t>(grains[i].length, 21659)  // Buffer length*0.3305
+				                   : std::min<int32_t>(grains[i].length, 30251); // 1.48s - 0.8s
+			}
+			else {
+				if (grains[i].pitch > 1024) {
+					int32_t startPointMax =
+					    (writeIndex + grains[i].length - ((grains[i].length * grains[i].pitch) >> 10)
+					     + kModFXGrainBufferSize)
+					    & kModFXGrainBufferIndexMask;
+					if (!(grains[i].startPoint < startPointMax && grains[i].startPoint > writeIndex)) {
+						grains[i].startPoint = (startPointMax + kModFXGrainBufferSize - 1) & kModFXGrainBufferIndexMask;
+					}
+				}
+				else if (grains[i].pitch < 1024) {
+					int32_t startPointMax =
+					    (writeIndex + grains[i].length - ((grains[i].length * grains[i].pitch) >> 10)
+					     + kModFXGrainBufferSize)
+					    & kModFXGrainBufferIndexMask;
+
+					if (!(grains[i].startPoint > startPointMax && grains[i].startPoint < writeIndex)) {
+						grains[i].startPoint = (writeIndex + kModFXGrainBufferSize - 1) & kModFXGrainBufferIndexMask;
+					}
+				}
+			}
+			if (!grainInitialized) {
+				if (!grains[i].rev) { //forward
+					grains[i].pitch = 1024;
+					if (modFXGrainBufferWriteIndex > 13231) {
+						int32_t newStartPoint = std::max<int32_t>(440, random(modFXGrainBufferWriteIndex - 2));
+						grains[i].startPoint = (writeIndex - newStartPoint + kModFXGrainBufferSize)
+						                       & kModFXGrainBufferIndexMask;
+					}
+					else {
+						grains[i].length = 0;
+					}
+				}
+				else {
+					grains[i].pitch = std::min<int32_t>(grains[i].pitch, 1024);
+					if (modFXGrainBufferWriteIndex > 13231) {
+						grains[i].length = std::min<int32_t>(grains[i].length, modFXGrainBufferWriteIndex - 2);
+						grains[i].startPoint = (writeIndex - 1 + kModFXGrainBufferSize) & kModFXGrainBufferIndexMask;
+					}
+					else {
+						grains[i].length = 0;
+					}
+				}
+			}
+			if (grains[i].length > 0) {
+				grains[i].volScale = (2147483647 / (grains[i].length >> 1));
+				grains[i].volScaleMax = grains[i].volScale * (grains[i].length >> 1);
+				shouldDoPanning((getRandom255() - 128) << 23, &grains[i].panVolL, &grains[i].panVolR); //Pan Law 0
+			}
+			return (grains[i].length > 0) ? i : -1;
+		}
+	}
+	return -1;
+}
+
 void ModControllableAudio::processReverbSendAndVolume(StereoSample* buffer, int32_t numSamples, int32_t* reverbBuffer,
                                                       int32_t postFXVolume, int32_t postReverbVolume,
                                                       int32_t reverbSendAmount, int32_t pan, bool doAmplitudeIncrement,
@@ -173,6 +173,13 @@ protected:
 private:
 	void initializeSecondaryDelayBuffer(int32_t newNativeRate, bool makeNativeRatePreciseRelativeToOtherBuffer);
 	void doEQ(bool doBass, bool doTreble, int32_t* inputL, int32_t* inputR, int32_t bassAmount, int32_t trebleAmount);
+	void processPhaserFX(StereoSample* buffer, int32_t numSamples, int32_t const* lfoValues, int32_t modFXDepth,
+	                     int32_t feedback);
+	template <ModFXType modFXType>
+	void processModFXDelay(StereoSample* buffer, int32_t numSamples, int32_t const* lfoValues,
+	                       int32_t modFXDelayOffset, int32_t thisModFXDelayDepth, int32_t feedback);
+	void processGrainFX(StereoSample* buffer, int32_t numSamples);
+	int32_t startGrain(int32_t writeIndex);
 	ModelStackWithThreeMainThings* addNoteRowIndexAndStuff(ModelStackWithTimelineCounter* modelStack,
 	                                                       int32_t noteRowIndex);
 };
@@ -22,6 +22,7 @@
 #include <new>
 
 NoteRowVector::NoteRowVector() : OrderedResizeableArray(sizeof(NoteRow), 16, 0, 16, 7) {
+	changeCount = 0;
 }
 
 NoteRowVector::~NoteRowVector() {
@@ -37,6 +38,7 @@ NoteRow* NoteRowVector::insertNoteRowAtIndex(int32_t index) {
 	if (error) {
 		return NULL;
 	}
+	changeCount++;
 	void* memory = getElementAddress(index);
 
 	return new (memory) NoteRow();
@@ -47,6 +49,17 @@ void NoteRowVector::deleteNoteRowAtIndex(int32_t startIndex, int32_t numToDelete
 		getElement(i)->~NoteRow();
 	}
 	deleteAtIndex(startIndex, numToDelete);
+	changeCount++;
+}
+
+void NoteRowVector::swapElements(int32_t i1, int32_t i2) {
+	OrderedResizeableArray::swapElements(i1, i2);
+	changeCount++;
+}
+
+void NoteRowVector::repositionElement(int32_t iFrom, int32_t iTo) {
+	OrderedResizeableArray::repositionElement(iFrom, iTo);
+	changeCount++;
 }
 
 NoteRow* NoteRowVector::insertNoteRowAtY(int32_t y, int32_t* getIndex) {
@@ -30,4 +30,9 @@ public:
 	NoteRow* insertNoteRowAtIndex(int32_t index);
 	NoteRow* insertNoteRowAtY(int32_t y, int32_t* getIndex = NULL);
 	void deleteNoteRowAtIndex(int32_t index, int32_t numToDelete = 1);
+	void swapElements(int32_t i1, int32_t i2);
+	void repositionElement(int32_t iFrom, int32_t iTo);
+
+	// Goes up whenever NoteRows get inserted, deleted or moved, so anything remembering indexes knows to forget them
+	uint32_t changeCount;
 };
@@ -23,7 +23,10 @@
 #include "hid/display/display.h"
 #include "io/debug/print.h"
 #include "memory/general_memory_allocator.h"
+#include "model/sample/sample_analysis.h"
 #include "model/sample/sample_cache.h"
+#include "model/sample/sample_peak_pyramid.h"
+#include "model/sample/sample_perc_cache_file.h"
 #include "model/sample/sample_perc_cache_zone.h"
 #include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
@@ -82,6 +85,13 @@ Sample::Sample()
 	percCacheClusters[0] = NULL;
 	percCacheClusters[1] = NULL;
 
+	percCacheFileStatus[0] = PercCacheFileStatus::UNKNOWN;
+	percCacheFileStatus[1] = PercCacheFileStatus::UNKNOWN;
+
+	peakPyramid = NULL;
+
+	analysis.flags = 0;
+
 	fileLoopStartSamples = 0;
 	fileLoopEndSamples = 0;
 	midiNoteFromFile = -1;
@@ -108,6 +118,8 @@ Sample::~Sample() {
 		clusters.getElement(c)->~SampleCluster();
 	}
 
+	SamplePercCacheFile::sampleBeingDeleted(this);
+	SampleAnalysis::sampleBeingDeleted(this);
 	deletePercCache(true);
 
 	for (int32_t i = 0; i < caches.getNumElements(); i++) {
@@ -115,6 +127,11 @@ Sample::~Sample() {
 		element->cache->~SampleCache();
 		GeneralMemoryAllocator::get().dealloc(element->cache);
 	}
+
+	if (peakPyramid) {
+		peakPyramid->~SamplePeakPyramid();
+		GeneralMemoryAllocator::get().dealloc(peakPyramid);
+	}
 }
 
 void Sample::deletePercCache(bool beingDestructed) {
@@ -154,6 +171,87 @@ void Sample::deletePercCache(bool beingDestructed) {
 	}
 }
 
+int32_t Sample::getPercCacheSize() {
+	int32_t lengthInSamplesAfterReduction = ((lengthInSamples - 1) >> kPercBufferReductionMagnitude) + 1;
+	return std::max(lengthInSamplesAfterReduction, 1_i32); // Can't allocate less than 1 byte
+}
+
+// Long Samples have their perc cache in Clusters. Short ones just get a bit of memory
+bool Sample::isPercCacheDoneWithClusters() {
+	return (getPercCacheSize() >= (audioFileManager.clusterSize >> 1));
+}
+
+// Makes sure there's somewhere to put the perc cache for this direction - the memory, or the array of Cluster pointers,
+// which start out all NULL. Returns error
+int32_t Sample::preparePercCacheStorage(int32_t reversed) {
+	int32_t lengthInSamplesAfterReduction = getPercCacheSize();
+
+	if (isPercCacheDoneWithClusters()) {
+		if (!percCacheClusters[reversed]) {
+			numPercCacheClusters = ((lengthInSamplesAfterReduction - 1) >> audioFileManager.clusterSizeMagnitude)
+			                       + 1; // Stores this number for the future too
+			int32_t memorySize = numPercCacheClusters * sizeof(Cluster*);
+			percCacheClusters[reversed] = (Cluster**)GeneralMemoryAllocator::get().alloc(memorySize, NULL, false, true);
+			if (!percCacheClusters[reversed]) {
+				return ERROR_INSUFFICIENT_RAM;
+			}
+
+			memset(percCacheClusters[reversed], 0, memorySize);
+		}
+	}
+
+	else {
+
+		if (!percCacheMemory[reversed]) {
+			int32_t percCacheSize = lengthInSamplesAfterReduction;
+
+			percCacheMemory[reversed] = (uint8_t*)GeneralMemoryAllocator::get().alloc(percCacheSize);
+			if (!percCacheMemory[reversed]) {
+				return ERROR_INSUFFICIENT_RAM;
+			}
+
+			//Debug::println("allocated percCacheMemory");
+		}
+	}
+
+	return NO_ERROR;
+}
+
+// Whether one zone covers the whole Sample, in this direction
+bool Sample::isPercCacheComplete(int32_t reversed) {
+	if (percCacheZones[reversed].getNumElements() != 1) {
+		return false;
+	}
+	SamplePercCacheZone* zone = (SamplePercCacheZone*)percCacheZones[reversed].getElementAddress(0);
+	if (reversed) {
+		return (zone->startPos >= (int32_t)lengthInSamples - 1 && zone->endPos == -1);
+	}
+	else {
+		return (zone->startPos <= 0 && zone->endPos >= (int32_t)lengthInSamples);
+	}
+}
+
+// For when the perc cache for this whole direction has been filled in from elsewhere (i.e. the card). All Clusters must
+// be there already. Returns error
+int32_t Sample::setPercCacheComplete(int32_t reversed) {
+	LOCK_ENTRY
+
+	percCacheZones[reversed].empty();
+	int32_t error = percCacheZones[reversed].insertAtIndex(0, 1, this);
+	if (error) {
+		LOCK_EXIT
+		return error;
+	}
+
+	int32_t startPos = reversed ? ((int32_t)lengthInSamples - 1) : 0;
+	SamplePercCacheZone* zone = new (percCacheZones[reversed].getElementAddress(0)) SamplePercCacheZone(startPos);
+	zone->endPos = reversed ? -1 : (int32_t)lengthInSamples;
+	zone->samplesAtStartWhichShouldBeReplaced = lengthInSamples;
+
+	LOCK_EXIT
+	return NO_ERROR;
+}
+
 void Sample::workOutBitMask() {
 	bitMask = 0xFFFFFFFF << ((4 - byteDepth) * 8);
 }
@@ -294,40 +392,12 @@ int32_t Sample::fillPercCache(TimeStretcher* timeStretcher, int32_t startPosSamp
 
 	AudioEngine::logAction("fillPercCache");
 
-	//int32_t lengthInSamplesAfterReduction = ((lengthInSamples + (kPercBufferReductionSize >> 1)) >> PERC_BUFFER_REDUCTION_MAGNITUDE);
-	int32_t lengthInSamplesAfterReduction = ((lengthInSamples - 1) >> kPercBufferReductionMagnitude) + 1;
-	lengthInSamplesAfterReduction = std::max(lengthInSamplesAfterReduction, 1_i32); // Can't allocate less than 1 byte
-
-	bool percCacheDoneWithClusters = (lengthInSamplesAfterReduction >= (audioFileManager.clusterSize >> 1));
-
-	if (percCacheDoneWithClusters) {
-		if (!percCacheClusters[reversed]) {
-			numPercCacheClusters = ((lengthInSamplesAfterReduction - 1) >> audioFileManager.clusterSizeMagnitude)
-			                       + 1; // Stores this number for the future too
-			int32_t memorySize = numPercCacheClusters * sizeof(Cluster*);
-			percCacheClusters[reversed] = (Cluster**)GeneralMemoryAllocator::get().alloc(memorySize, NULL, false, true);
-			if (!percCacheClusters[reversed]) {
-				LOCK_EXIT
-				return ERROR_INSUFFICIENT_RAM;
-			}
-
-			memset(percCacheClusters[reversed], 0, memorySize);
-		}
-	}
-
-	else {
+	bool percCacheDoneWithClusters = isPercCacheDoneWithClusters();
 
-		if (!percCacheMemory[reversed]) {
-			int32_t percCacheSize = lengthInSamplesAfterReduction;
-
-			percCacheMemory[reversed] = (uint8_t*)GeneralMemoryAllocator::get().alloc(percCacheSize);
-			if (!percCacheMemory[reversed]) {
-				LOCK_EXIT
-				return ERROR_INSUFFICIENT_RAM;
-			}
-
-			//Debug::println("allocated percCacheMemory");
-		}
+	int32_t error = preparePercCacheStorage(reversed);
+	if (error) {
+		LOCK_EXIT
+		return error;
 	}
 
 	int32_t bytesPerSample = numChannels * byteDepth;
@@ -341,7 +411,6 @@ int32_t Sample::fillPercCache(TimeStretcher* timeStretcher, int32_t startPosSamp
 		i = percCacheZones[reversed].search(startPosSamples, GREATER_OR_EQUAL);
 	}
 
-	int32_t error = NO_ERROR;
 	SamplePercCacheZone* percCacheZone;
 	if (i >= 0 && i < percCacheZones[reversed].getNumElements()) {
 		percCacheZone = (SamplePercCacheZone*)percCacheZones[reversed].getElementAddress(i);
@@ -447,6 +516,12 @@ doReturnNoError:
 		i++;
 	}
 
+	// We're about to have to work out some perc cache that we don't have. If there's a file on the card with it all,
+	// get that read in - it'll probably arrive before we've got very far working it out here.
+	if (percCacheFileStatus[reversed] != PercCacheFileStatus::NOT_ON_CARD) {
+		SamplePercCacheFile::percCacheWanted(this, reversed);
+	}
+
 	error = percCacheZones[reversed].insertAtIndex(
 	    i, 1,
 	    this); // Tell it not to steal other perc cache zones from this Sample, which would result in modification of the same array during operation.
@@ -689,6 +764,11 @@ doLoading:
 
 	// TODO: what if that next zone doesn't extend all the way to the end we want? Though that'd only very rarely happen, and only hold us up very briefly
 
+	// If that's finished it off for this direction, it can go on the card so we don't have to do this again
+	if (percCacheFileStatus[reversed] != PercCacheFileStatus::ON_CARD && isPercCacheComplete(reversed)) {
+		SamplePercCacheFile::percCacheCompleted(this, reversed);
+	}
+
 #if MEASURE_PERC_CACHE_PERFORMANCE
 	{
 		uint16_t endTime = MTU2.TCNT_0;
@@ -879,6 +959,25 @@ uint8_t* Sample::prepareToReadPercCache(int32_t pixellatedPos, int32_t playDirec
 	}
 }
 
+// Returns NULL if there wasn't RAM for it
+SamplePeakPyramid* Sample::getPeakPyramid() {
+	if (!peakPyramid) {
+		void* memory = GeneralMemoryAllocator::get().alloc(sizeof(SamplePeakPyramid));
+		if (!memory) {
+			return NULL;
+		}
+		SamplePeakPyramid* newPyramid = new (memory) SamplePeakPyramid();
+		int32_t error = newPyramid->setup(this);
+		if (error) {
+			newPyramid->~SamplePeakPyramid();
+			GeneralMemoryAllocator::get().dealloc(memory);
+			return NULL;
+		}
+		peakPyramid = newPyramid;
+	}
+	return peakPyramid;
+}
+
 void Sample::percCacheClusterStolen(Cluster* cluster) {
 	LOCK_ENTRY
 
@@ -1010,6 +1109,9 @@ void Sample::workOutMIDINote(bool doingSingleCycle, float minFreqHz, float maxFr
 
 		float freq;
 
+		// As the pitch gets stored with, so it doesn't have to be detected again next time
+		bool usingDefaultSettings = (minFreqHz == 20 && maxFreqHz == 10000 && doPrimeTest);
+
 		// If doing single-cycle, easy!
 		if (doingSingleCycle) {
 			freq = (float)sampleRate / lengthInSamples;
@@ -1021,6 +1123,9 @@ void Sample::workOutMIDINote(bool doingSingleCycle, float minFreqHz, float maxFr
 			midiNote = midiNoteFromFile;
 		}
 
+		// Or if it's been detected before, with the same settings we'd be using...
+		else if (usingDefaultSettings && SampleAnalysis::getStoredPitch(this, &midiNote)) {}
+
 		// And finally, detect the pitch the hard way
 		else {
 			freq = determinePitch(doingSingleCycle, minFreqHz, maxFreqHz, doPrimeTest);
@@ -1033,6 +1138,10 @@ void Sample::workOutMIDINote(bool doingSingleCycle, float minFreqHz, float maxFr
 calculateMIDINote:
 				midiNote = 69 + log2f(freq / 440) * 12;
 			}
+
+			if (usingDefaultSettings && !doingSingleCycle) {
+				SampleAnalysis::pitchDetected(this, midiNote);
+			}
 		}
 	}
 
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "NE10_types.h"
+#include "model/sample/sample_analysis.h"
 #include "model/sample/sample_cluster.h"
 #include "model/sample/sample_cluster_array.h"
 #include "storage/audio/audio_file.h"
@@ -38,11 +39,19 @@
 #define MIDI_NOTE_UNSET -999
 #define MIDI_NOTE_ERROR -1000
 
+// Whether there's a perc cache file for the Sample on the card - see sample_perc_cache_file.h
+enum class PercCacheFileStatus : uint8_t {
+	UNKNOWN,
+	NOT_ON_CARD, // Or there is one, but it's out of date
+	ON_CARD,
+};
+
 class LoadedSamplePosReason;
 class SampleCache;
 class MultisampleRange;
 class TimeStretcher;
 class SampleHolder;
+class SamplePeakPyramid;
 
 class Sample final : public AudioFile {
 public:
@@ -64,8 +73,14 @@ public:
 	                      int32_t playDirection, int32_t maxNumSamplesToProcess);
 	void percCacheClusterStolen(Cluster* cluster);
 	void deletePercCache(bool beingDestructed = false);
+	int32_t getPercCacheSize();
+	bool isPercCacheDoneWithClusters();
+	int32_t preparePercCacheStorage(int32_t reversed);
+	bool isPercCacheComplete(int32_t reversed);
+	int32_t setPercCacheComplete(int32_t reversed);
 	uint8_t* prepareToReadPercCache(int32_t pixellatedPos, int32_t playDirection, int32_t* earliestPixellatedPos,
 	                                int32_t* latestPixellatedPos);
+	SamplePeakPyramid* getPeakPyramid();
 	bool getAveragesForCrossfade(int32_t* totals, int32_t startBytePos, int32_t crossfadeLengthSamples,
 	                             int32_t playDirection, int32_t lengthToAverageEach);
 	void convertDataOnAnyClustersIfNecessary();
@@ -133,6 +148,11 @@ public:
 
 	Cluster** percCacheClusters[2]; // One for each play-direction: 0=forwards; 1=reversed
 	int32_t numPercCacheClusters;
+	PercCacheFileStatus percCacheFileStatus[2]; // One for each play-direction: 0=forwards; 1=reversed
+
+	SamplePeakPyramid* peakPyramid; // For drawing the waveform. Only gets created when first needed
+
+	SampleAnalysisRecord analysis; // Filled in in the background by SampleAnalysis - check its flags
 
 	int32_t beginningOffsetForPitchDetection;
 	bool beginningOffsetForPitchDetectionFound;
@@ -0,0 +1,399 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "model/sample/sample_analysis.h"
+#include "definitions_cxx.hpp"
+#include "io/debug/print.h"
+#include "model/sample/sample.h"
+#include "model/sample/sample_cluster.h"
+#include "model/sample/sample_peak_pyramid.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/cluster/cluster.h"
+#include "util/d_string.h"
+#include <algorithm>
+#include <string.h>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+extern uint8_t currentlyAccessingCard;
+
+namespace SampleAnalysis {
+
+constexpr uint32_t kFileMagic = 0x4C4E4144; // "DANL"
+constexpr uint8_t kFileVersion = 2;
+
+struct FileHeader {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t reserved[3];
+
+	// So we can tell if the audio file has been changed since
+	uint32_t audioFileSize;
+	uint32_t audioFileDateTime;
+	uint32_t lengthInSamples;
+};
+
+enum class Stage : uint8_t {
+	READ_FILE,
+	LEVELS,
+	WRITE_FILE,
+};
+
+struct Job {
+	Sample* sample;
+	Stage stage;
+	bool foundAnythingNew; // If not, no need to write the file
+	uint8_t numFailures;
+
+	// Progress through the LEVELS stage
+	int32_t nextCluster;
+	int32_t minValue;
+	int32_t maxValue;
+	uint32_t numValues;
+};
+
+constexpr int32_t kMaxNumJobs = 4;
+
+// If a Cluster won't load this many times in a row, give up on the job, so the others don't get stuck behind it
+constexpr int32_t kMaxNumFailures = 4;
+
+Job jobs[kMaxNumJobs];
+int32_t numJobs = 0;
+
+FIL file; // Our own, so we don't interfere with anything else that's got a file open
+
+// Returns NULL if there's no room for another job
+Job* getJob(Sample* sample) {
+	for (int32_t j = 0; j < numJobs; j++) {
+		if (jobs[j].sample == sample) {
+			return &jobs[j];
+		}
+	}
+
+	// If there's no room, just forget it. It'll get asked for again if it's still needed
+	if (numJobs == kMaxNumJobs) {
+		return NULL;
+	}
+
+	Job* job = &jobs[numJobs];
+	job->sample = sample;
+	job->stage = Stage::READ_FILE;
+	job->foundAnythingNew = false;
+	job->numFailures = 0;
+	job->nextCluster = sample->getFirstClusterIndexWithAudioData();
+	job->minValue = 2147483647;
+	job->maxValue = -2147483648;
+	job->numValues = 0;
+	numJobs++;
+	return job;
+}
+
+void analysisWanted(Sample* sample) {
+	if (sample->analysis.flags & SAMPLE_ANALYSIS_LEVELS_DONE) {
+		return;
+	}
+
+	getJob(sample);
+}
+
+void finishJob(int32_t j) {
+	numJobs--;
+	memmove(&jobs[j], &jobs[j + 1], (numJobs - j) * sizeof(Job));
+}
+
+void sampleBeingDeleted(Sample* sample) {
+	for (int32_t j = 0; j < numJobs; j++) {
+		if (jobs[j].sample == sample) {
+			finishJob(j);
+			return;
+		}
+	}
+}
+
+// Returns error
+int32_t getPaths(Sample* sample, String* audioFilePath, String* analysisFilePath) {
+	// If it got loaded from the song's alternate folder, that's where it really is
+	audioFilePath->set(sample->loadedFromAlternatePath.isEmpty() ? &sample->filePath
+	                                                              : &sample->loadedFromAlternatePath);
+	analysisFilePath->set(audioFilePath);
+	return analysisFilePath->concatenate(".anl");
+}
+
+// Returns error
+int32_t getHeaderForAudioFile(Sample* sample, String* audioFilePath, FileHeader* header) {
+	FILINFO fileInfo;
+	FRESULT result = f_stat(audioFilePath->get(), &fileInfo);
+	if (result != FR_OK) {
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	memset(header, 0, sizeof(FileHeader));
+	header->magic = kFileMagic;
+	header->version = kFileVersion;
+	header->audioFileSize = fileInfo.fsize;
+	header->audioFileDateTime = ((uint32_t)fileInfo.fdate << 16) | fileInfo.ftime;
+	header->lengthInSamples = sample->lengthInSamples;
+	return NO_ERROR;
+}
+
+void gotLevels(Sample* sample) {
+	// These are exact, so better than anything the WaveformRenderer has found
+	sample->minValueFound = sample->analysis.minValue;
+	sample->maxValueFound = sample->analysis.maxValue;
+}
+
+// Returns error
+int32_t readFile(Sample* sample) {
+	if (sample->analysis.flags & SAMPLE_ANALYSIS_FILE_READ) {
+		return NO_ERROR;
+	}
+	sample->analysis.flags |= SAMPLE_ANALYSIS_FILE_READ;
+
+	String audioFilePath;
+	String analysisFilePath;
+	int32_t error = getPaths(sample, &audioFilePath, &analysisFilePath);
+	if (error) {
+		return error;
+	}
+
+	FileHeader headerWanted;
+	error = getHeaderForAudioFile(sample, &audioFilePath, &headerWanted);
+	if (error) {
+		return error;
+	}
+
+	FRESULT result = f_open(&file, analysisFilePath.get(), FA_READ);
+	if (result != FR_OK) {
+		return NO_ERROR; // Not there - fine, we'll make it
+	}
+
+	FileHeader header;
+	SampleAnalysisRecord record;
+	UINT numBytesRead;
+	result = f_read(&file, &header, sizeof(header), &numBytesRead);
+	if (result == FR_OK && numBytesRead == sizeof(header) && !memcmp(&header, &headerWanted, sizeof(header))) {
+		result = f_read(&file, &record, sizeof(record), &numBytesRead);
+		if (result == FR_OK && numBytesRead == sizeof(record)) {
+			sample->analysis = record;
+			sample->analysis.flags |= SAMPLE_ANALYSIS_FILE_READ;
+			if (record.flags & SAMPLE_ANALYSIS_LEVELS_DONE) {
+				gotLevels(sample);
+			}
+		}
+	}
+	f_close(&file);
+
+	return NO_ERROR;
+}
+
+// Returns error
+int32_t writeFile(Sample* sample) {
+	String audioFilePath;
+	String analysisFilePath;
+	int32_t error = getPaths(sample, &audioFilePath, &analysisFilePath);
+	if (error) {
+		return error;
+	}
+
+	FileHeader header;
+	error = getHeaderForAudioFile(sample, &audioFilePath, &header);
+	if (error) {
+		return error;
+	}
+
+	FRESULT result = f_open(&file, analysisFilePath.get(), FA_CREATE_ALWAYS | FA_WRITE);
+	if (result != FR_OK) {
+		return ERROR_SD_CARD;
+	}
+
+	UINT numBytesWritten;
+	result = f_write(&file, &header, sizeof(header), &numBytesWritten);
+	if (result == FR_OK) {
+		result = f_write(&file, &sample->analysis, sizeof(SampleAnalysisRecord), &numBytesWritten);
+	}
+
+	FRESULT closeResult = f_close(&file);
+	if (result == FR_OK) {
+		result = closeResult;
+	}
+
+	if (result != FR_OK) {
+		f_unlink(analysisFilePath.get()); // Don't leave a half-written one lying around
+		return ERROR_SD_CARD;
+	}
+	return NO_ERROR;
+}
+
+// Goes through one Cluster. Returns error
+int32_t doLevelsForNextCluster(Job* job) {
+	Sample* sample = job->sample;
+	int32_t clusterIndex = job->nextCluster;
+
+	Cluster* cluster = sample->clusters.getElement(clusterIndex)->getCluster(sample, clusterIndex,
+	                                                                         CLUSTER_LOAD_IMMEDIATELY);
+	if (!cluster) {
+		return ERROR_SD_CARD; // We'll just try again next time, up to kMaxNumFailures
+	}
+
+	// Which bytes of this Cluster are audio data. Samples straddling the boundary get read from the Cluster they
+	// start in - the Cluster data has enough spare bytes after it for that
+	int32_t bytesPerSample = sample->numChannels * sample->byteDepth;
+	int64_t clusterStartByte = (int64_t)clusterIndex << audioFileManager.clusterSizeMagnitude;
+	int64_t startByteRelativeToAudio = clusterStartByte - sample->audioDataStartPosBytes;
+	int64_t startSample =
+	    (startByteRelativeToAudio <= 0) ? 0 : (startByteRelativeToAudio + bytesPerSample - 1) / bytesPerSample;
+	int64_t endSample = (startByteRelativeToAudio + audioFileManager.clusterSize + bytesPerSample - 1) / bytesPerSample;
+	endSample = std::min<int64_t>(endSample, sample->lengthInSamples);
+
+	if (endSample > startSample) {
+		// Misalign, to align with non-32-bit data
+		int32_t bytePos = startSample * bytesPerSample - startByteRelativeToAudio + sample->byteDepth - 4;
+		int32_t numValues = (endSample - startSample) * sample->numChannels;
+
+		int32_t minValue = job->minValue;
+		int32_t maxValue = job->maxValue;
+		for (int32_t i = 0; i < numValues; i++) {
+			int32_t value = *(int32_t*)&cluster->data[bytePos] & sample->bitMask;
+			minValue = std::min(minValue, value);
+			maxValue = std::max(maxValue, value);
+			bytePos += sample->byteDepth;
+		}
+
+		job->minValue = minValue;
+		job->maxValue = maxValue;
+		job->numValues += numValues;
+	}
+
+	// The peak pyramid might as well have this Cluster too while we've got it
+	if (sample->peakPyramid) {
+		sample->peakPyramid->addCluster(sample, clusterIndex, cluster);
+	}
+
+	audioFileManager.removeReasonFromCluster(cluster, "E456");
+
+	job->nextCluster++;
+	return NO_ERROR;
+}
+
+void finishLevels(Job* job) {
+	SampleAnalysisRecord* record = &job->sample->analysis;
+
+	if (job->numValues) {
+		record->minValue = job->minValue;
+		record->maxValue = job->maxValue;
+	}
+	else {
+		record->minValue = 0;
+		record->maxValue = 0;
+	}
+	record->flags |= SAMPLE_ANALYSIS_LEVELS_DONE;
+
+	gotLevels(job->sample);
+}
+
+bool getStoredPitch(Sample* sample, float* midiNote) {
+	if (!(sample->analysis.flags & SAMPLE_ANALYSIS_FILE_READ)) {
+		int32_t error = readFile(sample);
+		if (error) {
+			return false;
+		}
+	}
+
+	if (!(sample->analysis.flags & SAMPLE_ANALYSIS_PITCH_DONE)) {
+		return false;
+	}
+	*midiNote = sample->analysis.midiNote;
+	return true;
+}
+
+void pitchDetected(Sample* sample, float midiNote) {
+	sample->analysis.midiNote = midiNote;
+	sample->analysis.flags |= SAMPLE_ANALYSIS_PITCH_DONE;
+
+	// Get it into the file. The levels will get done while we're at it, if they haven't been. If there's no room for
+	// another job, it'll just have to be detected again next time
+	Job* job = getJob(sample);
+	if (job) {
+		job->foundAnythingNew = true;
+	}
+}
+
+void routine() {
+	if (!numJobs || currentlyAccessingCard || audioFileManager.cardEjected || audioFileManager.cardDisabled) {
+		return;
+	}
+
+	Job* job = &jobs[0];
+	Sample* sample = job->sample;
+
+	// Recordings that are still happening (or that haven't been given their proper name yet) can wait
+	if (sample->unloadable || !sample->tempFilePathForRecording.isEmpty()) {
+		finishJob(0);
+		return;
+	}
+
+	// Make sure the Sample doesn't get stolen while we're accessing the card
+	sample->addReason();
+
+	int32_t error = NO_ERROR;
+
+	switch (job->stage) {
+	case Stage::READ_FILE:
+		error = readFile(sample);
+		job->stage = Stage::LEVELS;
+		break;
+
+	case Stage::LEVELS:
+		if (sample->analysis.flags & SAMPLE_ANALYSIS_LEVELS_DONE) {
+			job->stage = Stage::WRITE_FILE;
+		}
+		else if (job->nextCluster < sample->getFirstClusterIndexWithNoAudioData()) {
+			error = doLevelsForNextCluster(job);
+			if (error) {
+				if (++job->numFailures >= kMaxNumFailures) {
+					finishJob(0);
+				}
+				break;
+			}
+			job->numFailures = 0;
+		}
+		else {
+			finishLevels(job);
+			job->foundAnythingNew = true;
+			job->stage = Stage::WRITE_FILE;
+		}
+		break;
+
+	case Stage::WRITE_FILE:
+		if (job->foundAnythingNew) {
+			error = writeFile(sample);
+		}
+		finishJob(0);
+		break;
+	}
+
+	if (error) {
+		Debug::print("sample analysis error: ");
+		Debug::println(error);
+	}
+
+	sample->removeReason("E457");
+}
+
+} // namespace SampleAnalysis
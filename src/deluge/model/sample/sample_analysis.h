@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+class Sample;
+
+// What we've found out about a Sample by going through all of its audio. Values are full-scale 32-bit
+struct SampleAnalysisRecord {
+	int32_t minValue;
+	int32_t maxValue;
+	float midiNote; // As workOutMIDINote() found with its default settings. May be MIDI_NOTE_ERROR
+	uint8_t flags;
+};
+
+#define SAMPLE_ANALYSIS_LEVELS_DONE 1
+#define SAMPLE_ANALYSIS_PITCH_DONE 2
+#define SAMPLE_ANALYSIS_FILE_READ 4 // Whether we've looked for the file yet. Not meaningful in the file itself
+
+// Works out a Sample's exact peak levels in the background, a Cluster at a time from the main loop, so nothing has to
+// stop and wait for it. The results go in Sample::analysis, and into a file next to the audio file - e.g.
+// "SAMPLES/KICK.WAV.anl" - so they're there straight away next time the Sample's loaded. So does the pitch, once
+// workOutMIDINote() has had to detect it, so auto-transpose doesn't have to do that again next time.
+namespace SampleAnalysis {
+
+// Call when something will probably want to know about this Sample soon
+void analysisWanted(Sample* sample);
+
+// For workOutMIDINote(). Returns whether the pitch was found before, reading the file in first if we haven't yet.
+// May access the card
+bool getStoredPitch(Sample* sample, float* midiNote);
+
+// For workOutMIDINote(), once it's detected the pitch with its default settings. Stores it in the file, in the
+// background
+void pitchDetected(Sample* sample, float midiNote);
+
+// So we don't try and do anything with a Sample that no longer exists
+void sampleBeingDeleted(Sample* sample);
+
+// Call regularly from the main loop, where the card may be accessed. Does one small piece of work each time
+void routine();
+
+} // namespace SampleAnalysis
@@ -0,0 +1,461 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "model/sample/sample_cache_prerenderer.h"
+#include "definitions_cxx.hpp"
+#include "model/clip/instrument_clip.h"
+#include "model/drum/drum.h"
+#include "model/note/note_row.h"
+#include "model/sample/sample.h"
+#include "model/sample/sample_cache.h"
+#include "model/sample/sample_holder_for_voice.h"
+#include "model/song/song.h"
+#include "model/voice/voice_sample.h"
+#include "model/voice/voice_sample_playback_guide.h"
+#include "model/voice/voice_unison_part_source.h"
+#include "modulation/params/param_set.h"
+#include "modulation/patch/patch_cable_set.h"
+#include "processing/engines/audio_engine.h"
+#include "processing/sound/sound_drum.h"
+#include "processing/sound/sound_instrument.h"
+#include "storage/cluster/cluster.h"
+#include "storage/multi_range/multi_range.h"
+#include "util/cfunctions.h"
+#include "util/lookuptables/lookuptables.h"
+#include <cstdlib>
+
+extern "C" {
+#include "RZA1/mtu/mtu.h"
+#include "drivers/ssi/ssi.h"
+}
+
+extern int32_t spareRenderingBuffer[][SSI_TX_BUFFER_NUM_SAMPLES];
+
+namespace SampleCachePrerenderer {
+
+// How much cache we'll write per song. Past that, caches just get filled as Voices play them, like normal
+constexpr int32_t kMemoryBudget = 8 << 20;
+
+// How long each call to routine() may spend rendering
+constexpr int32_t kMaxTimePerRoutineUS = 500;
+
+// So that Clusters we ask for load after all the ones that are actually needed for playback
+constexpr uint32_t kPriorityRating = 0xFFFFFFFF;
+
+// Everything that determines which cache a Voice would use, and how it'd fill it
+struct Target {
+	Sound* sound;
+	Source* source;
+	SampleHolderForVoice* holder;
+	Sample* sample;
+	uint32_t phaseIncrement;
+	uint32_t timeStretchRatio;
+	LoopType loopingType;
+	bool reversed;
+
+	// So we notice if the user moves any markers
+	uint64_t startPos;
+	uint64_t endPos;
+	uint32_t loopStartPos;
+	uint32_t loopEndPos;
+};
+
+Song* songScanned = NULL;
+int32_t nextCandidateIndex;
+int32_t bytesWritten;
+bool passFinished;
+
+// The job in progress, if voiceSample isn't NULL
+VoiceSample* voiceSample = NULL;
+VoiceSamplePlaybackGuide guide;
+Target target;
+int32_t lastCacheBytePos;
+
+// Where the job came from, so it can be re-checked without going through the whole Song
+Clip* targetClip;
+int32_t targetNoteRowIndex;
+int32_t targetSourceIndex;
+int32_t targetUnisonIndex;
+
+// Works out which Sound a NoteRow plays, and at what note. Returns false if it's not one we'd prerender for
+static bool getSoundForNoteRow(Clip* clip, NoteRow* noteRow, Sound** sound, ParamManager** paramManager,
+                               int32_t* noteCode) {
+	if (clip->type != CLIP_TYPE_INSTRUMENT || noteRow->hasNoNotes()) {
+		return false;
+	}
+
+	if (clip->output->type == InstrumentType::SYNTH) {
+		*sound = (SoundInstrument*)clip->output;
+		*paramManager = &clip->paramManager;
+		*noteCode = noteRow->y;
+		return true;
+	}
+	else if (clip->output->type == InstrumentType::KIT) {
+		if (!noteRow->drum || noteRow->drum->type != DrumType::SOUND) {
+			return false;
+		}
+		*sound = (SoundDrum*)noteRow->drum;
+		*paramManager = &noteRow->paramManager;
+		*noteCode = kNoteForDrum;
+		return true;
+	}
+	return false;
+}
+
+// Calls back for every source and unison part of every note that each Sound will play in the Song, until the callback
+// returns true. Returns whether that happened
+template <typename Callback>
+static bool forEachCandidate(Callback callback) {
+	for (int32_t a = 0; a < 2; a++) {
+		ClipArray* clips = a ? &currentSong->arrangementOnlyClips : &currentSong->sessionClips;
+
+		for (int32_t c = 0; c < clips->getNumElements(); c++) {
+			Clip* clip = clips->getClipAtIndex(c);
+			if (clip->type != CLIP_TYPE_INSTRUMENT) {
+				continue;
+			}
+
+			InstrumentClip* instrumentClip = (InstrumentClip*)clip;
+			for (int32_t i = 0; i < instrumentClip->noteRows.getNumElements(); i++) {
+				Sound* sound;
+				ParamManager* paramManager;
+				int32_t noteCode;
+				if (!getSoundForNoteRow(clip, instrumentClip->noteRows.getElement(i), &sound, &paramManager,
+				                        &noteCode)) {
+					continue;
+				}
+
+				for (int32_t s = 0; s < kNumSources; s++) {
+					for (int32_t u = 0; u < sound->numUnison; u++) {
+						if (callback(clip, i, sound, paramManager, noteCode, s, u)) {
+							return true;
+						}
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+// The same sums Voice::calculatePhaseIncrements() does for a sample source. Returns 0 if too high to play
+static uint32_t getPhaseIncrement(Sound* sound, SampleHolderForVoice* holder, int32_t noteCode, int32_t u) {
+	int32_t transposedNoteCode = noteCode + sound->transpose + holder->transpose;
+
+	int32_t noteWithinOctave = (uint16_t)(transposedNoteCode + 240) % 12;
+	int32_t octave = (uint16_t)(transposedNoteCode + 120) / 12;
+
+	uint32_t phaseIncrement =
+	    multiply_32x32_rshift32(noteIntervalTable[noteWithinOctave], holder->neutralPhaseIncrement);
+
+	int32_t shiftRightAmount = 13 - octave;
+	if (shiftRightAmount >= 0) {
+		phaseIncrement >>= shiftRightAmount;
+	}
+	else {
+		int32_t shiftLeftAmount = 0 - shiftRightAmount;
+		if (phaseIncrement >= (2026954652 >> shiftLeftAmount)) {
+			return 0;
+		}
+		phaseIncrement <<= shiftLeftAmount;
+	}
+
+	phaseIncrement = holder->fineTuner.detune(phaseIncrement);
+
+	if (sound->numUnison > 1) {
+		phaseIncrement = sound->unisonDetuners[u].detune(phaseIncrement);
+	}
+	return phaseIncrement;
+}
+
+// Works out what cache a Voice would write to for this, if any. Anything where modulation or the like could change the
+// pitch is left alone - we'd likely just be caching a pitch that never gets played
+static bool getTarget(Sound* sound, ParamManager* paramManager, int32_t noteCode, int32_t s, int32_t u,
+                      Target* target) {
+	Source* source = &sound->sources[s];
+
+	if (sound->getSynthMode() == SynthMode::FM || source->oscType != OscType::SAMPLE
+	    || source->repeatMode == SampleRepeatMode::STRETCH
+	    || source->sampleControls.interpolationMode != InterpolationMode::SMOOTH) {
+		return false;
+	}
+
+	if (!paramManager->containsAnyMainParamCollections() || !sound->isSourceActiveEver(s, paramManager)) {
+		return false;
+	}
+
+	int32_t const pitchParams[2] = {Param::Local::PITCH_ADJUST, Param::Local::OSC_A_PITCH_ADJUST + s};
+
+	PatchedParamSet* patchedParams = paramManager->getPatchedParamSet();
+	for (int32_t p : pitchParams) {
+		if (patchedParams->getValue(p) || patchedParams->params[p].isAutomated()) {
+			return false;
+		}
+	}
+
+	PatchCableSet* patchCableSet = paramManager->getPatchCableSet();
+	for (int32_t c = 0; c < patchCableSet->numUsablePatchCables; c++) {
+		for (int32_t p : pitchParams) {
+			if (patchCableSet->patchCables[c].destinationParamDescriptor.isSetToParamWithNoSource(p)) {
+				return false;
+			}
+		}
+	}
+
+	MultiRange* range = source->getRange(noteCode + sound->transpose);
+	if (!range) {
+		return false;
+	}
+	SampleHolderForVoice* holder = (SampleHolderForVoice*)range->getAudioFileHolder();
+	Sample* sample = (Sample*)holder->audioFile;
+	if (!sample || sample->unplayable) {
+		return false;
+	}
+
+	uint32_t phaseIncrement = getPhaseIncrement(sound, holder, noteCode, u);
+	if (!phaseIncrement || phaseIncrement == 16777216
+	    || source->sampleControls.getInterpolationBufferSize(phaseIncrement) != kInterpolationMaxNumSamples) {
+		return false;
+	}
+
+	uint32_t timeStretchRatio =
+	    VoiceUnisonPartSource::getSpeedParamForNoSyncing(source, phaseIncrement, holder->neutralPhaseIncrement);
+
+	bool reversed = source->sampleControls.reversed;
+
+	VoiceSamplePlaybackGuide loopingGuide;
+	loopingGuide.audioFileHolder = holder;
+	loopingGuide.sequenceSyncLengthTicks = 0;
+	loopingGuide.noteOffReceived = false;
+	loopingGuide.setupPlaybackBounds(reversed);
+	LoopType loopingType = loopingGuide.getLoopingType(source);
+
+	// Same check as Voice does - caching a too-short loop doesn't sound right, so it won't use one
+	if (loopingType != LoopType::NONE) {
+		int32_t loopStart = holder->loopStartPos ? holder->loopStartPos : holder->startPos;
+		int32_t loopEnd = holder->loopEndPos ? holder->loopEndPos : holder->endPos;
+		int32_t loopLength = std::abs(loopEnd - loopStart);
+		uint64_t combinedIncrement = ((uint64_t)phaseIncrement * timeStretchRatio) >> 24;
+		if (((uint64_t)(uint32_t)loopLength << 24) / combinedIncrement < 2205) {
+			return false;
+		}
+	}
+
+	target->sound = sound;
+	target->source = source;
+	target->holder = holder;
+	target->sample = sample;
+	target->phaseIncrement = phaseIncrement;
+	target->timeStretchRatio = timeStretchRatio;
+	target->loopingType = loopingType;
+	target->reversed = reversed;
+	target->startPos = holder->startPos;
+	target->endPos = holder->endPos;
+	target->loopStartPos = holder->loopStartPos;
+	target->loopEndPos = holder->loopEndPos;
+	return true;
+}
+
+static bool sameTarget(Target* a, Target* b) {
+	return (a->sound == b->sound && a->source == b->source && a->holder == b->holder && a->sample == b->sample
+	        && a->phaseIncrement == b->phaseIncrement && a->timeStretchRatio == b->timeStretchRatio
+	        && a->loopingType == b->loopingType && a->reversed == b->reversed && a->startPos == b->startPos
+	        && a->endPos == b->endPos && a->loopStartPos == b->loopStartPos && a->loopEndPos == b->loopEndPos);
+}
+
+// Anything could have happened to the Song since last time - so re-find what we were working on from its Clip and
+// NoteRow, only comparing pointers until we know they're still valid
+static bool jobStillWanted() {
+	if (currentSong->sessionClips.getIndexForClip(targetClip) == -1
+	    && currentSong->arrangementOnlyClips.getIndexForClip(targetClip) == -1) {
+		return false;
+	}
+	if (targetClip->type != CLIP_TYPE_INSTRUMENT) {
+		return false;
+	}
+
+	InstrumentClip* instrumentClip = (InstrumentClip*)targetClip;
+	if (targetNoteRowIndex >= instrumentClip->noteRows.getNumElements()) {
+		return false;
+	}
+
+	Sound* sound;
+	ParamManager* paramManager;
+	int32_t noteCode;
+	if (!getSoundForNoteRow(targetClip, instrumentClip->noteRows.getElement(targetNoteRowIndex), &sound, &paramManager,
+	                        &noteCode)
+	    || sound != target.sound || targetUnisonIndex >= sound->numUnison) {
+		return false;
+	}
+
+	Target targetNow;
+	return getTarget(sound, paramManager, noteCode, targetSourceIndex, targetUnisonIndex, &targetNow)
+	       && sameTarget(&targetNow, &target);
+}
+
+static void endJob() {
+	if (!voiceSample) {
+		return;
+	}
+	voiceSample->beenUnassigned();
+	AudioEngine::voiceSampleUnassigned(voiceSample);
+	voiceSample = NULL;
+	target.sample->removeReason("E452");
+}
+
+static bool startJob(Target* newTarget, Clip* clip, int32_t noteRowIndex, int32_t s, int32_t u) {
+
+	voiceSample = AudioEngine::solicitVoiceSample();
+	if (!voiceSample) {
+		return false;
+	}
+
+	// If it's already all there - whether we did it or a Voice did - there's nothing to do. This only looks - the cache
+	// gets created by possiblySetUpCache() below, same as for a Voice
+	bool created;
+	SampleCache* existingCache =
+	    newTarget->sample->getOrCreateCache(newTarget->holder, newTarget->phaseIncrement, newTarget->timeStretchRatio,
+	                                        newTarget->reversed, false, &created);
+	if (existingCache && existingCache->writeBytePos == existingCache->waveformLengthBytes) {
+		AudioEngine::voiceSampleUnassigned(voiceSample);
+		voiceSample = NULL;
+		return false;
+	}
+
+	target = *newTarget;
+	targetClip = clip;
+	targetNoteRowIndex = noteRowIndex;
+	targetSourceIndex = s;
+	targetUnisonIndex = u;
+	lastCacheBytePos = 0;
+
+	// Make sure the Sample, and so its caches, can't be deleted while we're still pointing at it
+	target.sample->addReason();
+
+	guide.audioFileHolder = target.holder;
+	guide.sequenceSyncLengthTicks = 0;
+	guide.noteOffReceived = false;
+	guide.setupPlaybackBounds(target.reversed);
+
+	// Just as a Voice would start
+	voiceSample->noteOn(&guide, 0, kPriorityRating);
+	if (!voiceSample->setupClusersForInitialPlay(&guide, target.sample, 0, false, kPriorityRating)
+	    || !voiceSample->possiblySetUpCache(&target.source->sampleControls, &guide, target.phaseIncrement,
+	                                        target.timeStretchRatio, kPriorityRating, target.loopingType)
+	    || !voiceSample->cache) {
+		endJob();
+		return false;
+	}
+
+	return true;
+}
+
+static void startNextJob() {
+	int32_t i = 0;
+	bool started = forEachCandidate([&](Clip* clip, int32_t noteRowIndex, Sound* sound, ParamManager* paramManager,
+	                                    int32_t noteCode, int32_t s, int32_t u) {
+		if (i++ < nextCandidateIndex) {
+			return false;
+		}
+		nextCandidateIndex = i;
+		Target newTarget;
+		return getTarget(sound, paramManager, noteCode, s, u, &newTarget)
+		       && startJob(&newTarget, clip, noteRowIndex, s, u);
+	});
+
+	if (!started) {
+		passFinished = true;
+	}
+}
+
+enum class RenderResult {
+	CONTINUE,
+	WAIT,
+	FINISHED,
+};
+
+static RenderResult renderSome() {
+
+	// Don't get ahead of the card
+	if (voiceSample->clusters[1] && !voiceSample->clusters[1]->loaded) {
+		return RenderResult::WAIT;
+	}
+
+	// Rendered at zero amplitude - it's only what goes into the cache that we want. Stereo spills into buffer 3
+	int32_t numChannels = (target.sample->numChannels == 2) ? 2 : 1;
+	bool stillGoing = voiceSample->render(&guide, spareRenderingBuffer[2], SSI_TX_BUFFER_NUM_SAMPLES, target.sample,
+	                                      numChannels, target.loopingType, target.phaseIncrement,
+	                                      target.timeStretchRatio, 0, 0, kInterpolationMaxNumSamples,
+	                                      InterpolationMode::SMOOTH, kPriorityRating);
+
+	// Cache given up on (probably had a Cluster stolen), or looped back to what's already written, or reached the end
+	if (!stillGoing || !voiceSample->cache || voiceSample->cacheBytePos < lastCacheBytePos) {
+		return RenderResult::FINISHED;
+	}
+
+	if (voiceSample->writingToCache) {
+		bytesWritten += voiceSample->cacheBytePos - lastCacheBytePos;
+	}
+	lastCacheBytePos = voiceSample->cacheBytePos;
+	return RenderResult::CONTINUE;
+}
+
+void routine() {
+	if (currentSong != songScanned) {
+		endJob();
+		songScanned = currentSong;
+		nextCandidateIndex = 0;
+		bytesWritten = 0;
+		passFinished = false;
+	}
+
+	if (!currentSong || passFinished || AudioEngine::cpuDireness) {
+		return;
+	}
+
+	uint16_t startTime = *TCNT[TIMER_SYSTEM_FAST];
+	uint16_t maxTicks = usToFastTimerCount(kMaxTimePerRoutineUS);
+
+	if (voiceSample && !jobStillWanted()) {
+		endJob();
+	}
+
+	while ((uint16_t)(*TCNT[TIMER_SYSTEM_FAST] - startTime) < maxTicks) {
+		if (bytesWritten >= kMemoryBudget) {
+			endJob();
+			passFinished = true;
+			return;
+		}
+
+		if (!voiceSample) {
+			startNextJob();
+			if (!voiceSample) {
+				return;
+			}
+		}
+
+		RenderResult result = renderSome();
+		if (result == RenderResult::WAIT) {
+			return;
+		}
+		if (result == RenderResult::FINISHED) {
+			endJob();
+		}
+	}
+}
+
+} // namespace SampleCachePrerenderer
@@ -0,0 +1,34 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// SampleCaches normally only get filled in as a Voice plays, so the first time a repitched Sample plays, it costs
+// the full sinc interpolation, and if a song launches with lots of those at once, that's a CPU spike. This fills them in
+// ahead of time, when there's CPU to spare: for each note each kit row and synth clip in the song will play, it works
+// out the pitch and time-stretch amount that a Voice would cache at, and renders into that cache a bit at a time.
+//
+// It only does this up to a memory budget per song. Cache Clusters written here go into the same stealable queue as any
+// other, so if the RAM is needed for something else, they just get stolen as usual.
+namespace SampleCachePrerenderer {
+
+// Call regularly from the main loop - not from anywhere that might be in the middle of changing the Song
+void routine();
+
+} // namespace SampleCachePrerenderer
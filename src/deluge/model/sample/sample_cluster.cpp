@@ -28,6 +28,7 @@ SampleCluster::SampleCluster() {
 	cluster = NULL;
 
 	investigatedWholeLength = false;
+	peaksInPyramid = false;
 	minValue = 127;
 	maxValue = -128;
 	sdAddress = 0; // 0 means invalid, and we check for this as a last resort before writing
@@ -38,4 +38,5 @@ public:
 	int8_t minValue;
 	int8_t maxValue;
 	bool investigatedWholeLength;
+	bool peaksInPyramid; // Whether this Cluster's audio has been added to the Sample's SamplePeakPyramid yet
 };
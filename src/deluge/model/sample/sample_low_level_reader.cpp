@@ -25,6 +25,7 @@
 #include "model/sample/sample.h"
 #include "model/voice/voice.h"
 #include "model/voice/voice_sample_playback_guide.h"
+#include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
 #include "storage/cluster/cluster.h"
 
@@ -34,6 +35,8 @@ SampleLowLevelReader::SampleLowLevelReader() {
 	for (int32_t l = 0; l < kNumClustersLoadedAhead; l++) {
 		clusters[l] = NULL;
 	}
+	phaseIncrementLastTime = 16777216;
+	interpolationBufferPos = 0;
 }
 
 SampleLowLevelReader::~SampleLowLevelReader() {
@@ -84,6 +87,28 @@ void SampleLowLevelReader::setupForPlayPosMovedIntoNewCluster(SamplePlaybackGuid
 	currentPlayPos = clusters[0]->data + bytePosWithinNewCluster;
 
 	setupReassessmentLocation(guide, sample);
+
+	updateDeadlinesForUpcomingClusters(guide, sample);
+}
+
+// Tells the loading queue roughly when, in audioSampleTimer terms, the play-head will reach any upcoming Clusters
+// which are still waiting to be loaded, assuming the current pitch holds. That way, whichever voice is closest to
+// running out of audio gets its Cluster loaded first.
+void SampleLowLevelReader::updateDeadlinesForUpcomingClusters(SamplePlaybackGuide* guide, Sample* sample) {
+	int32_t bytesPerSample = sample->numChannels * sample->byteDepth;
+	int32_t bytePosWithinCluster = (uint32_t)currentPlayPos - (uint32_t)&clusters[0]->data;
+	int32_t bytesLeftInCluster =
+	    (guide->playDirection == 1) ? (audioFileManager.clusterSize - bytePosWithinCluster) : bytePosWithinCluster;
+	int32_t phaseIncrement = std::max(phaseIncrementLastTime, 1_i32);
+
+	for (int32_t l = 1; l < kNumClustersLoadedAhead; l++) {
+		if (clusters[l] && !clusters[l]->loaded) {
+			int32_t bytesAway = std::max(bytesLeftInCluster, 0_i32) + (l - 1) * audioFileManager.clusterSize;
+			uint64_t samplesAway = ((uint64_t)(bytesAway / bytesPerSample) << 24) / phaseIncrement;
+			audioFileManager.loadingQueue.updateDeadline(
+			    clusters[l], AudioEngine::audioSampleTimer + (uint32_t)std::min(samplesAway, (uint64_t)0x3FFFFFFF));
+		}
+	}
 }
 
 void SampleLowLevelReader::misalignPlaybackParameters(Sample* sample) {
@@ -467,9 +492,9 @@ void SampleLowLevelReader::fillInterpolationBufferRetrospectively(Sample* sample
 
 		if (!clusters[0]) {
 justWriteZeros:
-			interpolationBuffer[0][0][i] = 0;
+			setInterpolationSample(0, i, 0);
 			if (sample->numChannels == 2) {
-				interpolationBuffer[1][0][i] = 0;
+				setInterpolationSample(1, i, 0);
 			}
 		}
 
@@ -481,10 +506,10 @@ justWriteZeros:
 
 			// If there was valid audio data there...
 			if (bytesPastClusterStart >= 0) {
-				interpolationBuffer[0][0][i] = *(int16_t*)(thisPlayPos + 2);
+				setInterpolationSample(0, i, *(int16_t*)(thisPlayPos + 2));
 
 				if (sample->numChannels == 2) {
-					interpolationBuffer[1][0][i] = *(int16_t*)(thisPlayPos + 2 + sample->byteDepth);
+					setInterpolationSample(1, i, *(int16_t*)(thisPlayPos + 2 + sample->byteDepth));
 				}
 			}
 
@@ -503,9 +528,9 @@ bool SampleLowLevelReader::fillInterpolationBufferForward(SamplePlaybackGuide* g
 
 		if (!clusters[0]) {
 doZeroesFillingBuffer:
-			interpolationBuffer[0][0][i] = 0;
+			setInterpolationSample(0, i, 0);
 			if (sample->numChannels == 2) {
-				interpolationBuffer[1][0][i] = 0;
+				setInterpolationSample(1, i, 0);
 			}
 			currentPlayPos++;
 			if ((uint32_t)currentPlayPos >= interpolationBufferSize) {
@@ -520,9 +545,9 @@ doZeroesFillingBuffer:
 				goto doZeroesFillingBuffer;
 			}
 
-			interpolationBuffer[0][0][i] = *(int16_t*)(currentPlayPos + 2);
+			setInterpolationSample(0, i, *(int16_t*)(currentPlayPos + 2));
 			if (sample->numChannels == 2) {
-				interpolationBuffer[1][0][i] = *(int16_t*)(currentPlayPos + 2 + sample->byteDepth);
+				setInterpolationSample(1, i, *(int16_t*)(currentPlayPos + 2 + sample->byteDepth));
 			}
 
 			// And move forward one more
@@ -569,6 +594,8 @@ bool SampleLowLevelReader::considerUpcomingWindow(SamplePlaybackGuide* guide, Sa
 		display->freezeWithError("E228");
 	}
 
+	phaseIncrementLastTime = phaseIncrement;
+
 	int32_t bytesPerSample = sample->numChannels * sample->byteDepth;
 
 	// Interpolating
@@ -618,9 +645,9 @@ bool SampleLowLevelReader::considerUpcomingWindow(SamplePlaybackGuide* guide, Sa
 				int32_t offset = difference >> 1;
 
 				for (int32_t i = 0; i < interpolationBufferSize; i++) {
-					interpolationBuffer[0][0][i] = interpolationBuffer[0][0][i + offset];
+					setInterpolationSample(0, i, getInterpolationSample(0, i + offset));
 					if (sample->numChannels == 2) {
-						interpolationBuffer[1][0][i] = interpolationBuffer[1][0][i + offset];
+						setInterpolationSample(1, i, getInterpolationSample(1, i + offset));
 					}
 				}
 
@@ -650,9 +677,9 @@ bool SampleLowLevelReader::considerUpcomingWindow(SamplePlaybackGuide* guide, Sa
 				int32_t offset = difference >> 1;
 
 				for (int32_t i = 0; i < interpolationBufferSizeLastTime; i++) {
-					interpolationBuffer[0][0][i + offset] = interpolationBuffer[0][0][i];
+					setInterpolationSample(0, i + offset, getInterpolationSample(0, i));
 					if (sample->numChannels == 2) {
-						interpolationBuffer[1][0][i + offset] = interpolationBuffer[1][0][i];
+						setInterpolationSample(1, i + offset, getInterpolationSample(1, i));
 					}
 				}
 
@@ -665,9 +692,9 @@ bool SampleLowLevelReader::considerUpcomingWindow(SamplePlaybackGuide* guide, Sa
 
 				// If still here, fill far end with zeros. Not perfect, but it'll do.
 				for (int32_t i = (interpolationBufferSize - offset); i < interpolationBufferSize; i++) {
-					interpolationBuffer[0][0][i] = 0;
+					setInterpolationSample(0, i, 0);
 					if (sample->numChannels == 2) {
-						interpolationBuffer[1][0][i] = 0;
+						setInterpolationSample(1, i, 0);
 					}
 				}
 
@@ -874,35 +901,23 @@ doZeroes:
 void SampleLowLevelReader::bufferIndividualSampleForInterpolation(uint32_t bitMask, int32_t numChannels,
                                                                   int32_t byteDepth, char* __restrict__ playPosNow) {
 
-	// This works better than using memmoves. Ideally we'd switch this off if not smoothly interpolating - check that that's actually more efficient though
-	for (int32_t i = kInterpolationMaxNumSamples - 1; i >= 1; i--) {
-		interpolationBuffer[0][0][i] = interpolationBuffer[0][0][i - 1];
-		if (numChannels == 2) {
-			interpolationBuffer[1][0][i] = interpolationBuffer[1][0][i - 1];
-		}
-	}
+	advanceInterpolationBuffer();
 
-	interpolationBuffer[0][0][0] = *(int16_t*)(playPosNow + 2);
+	setInterpolationSample(0, 0, *(int16_t*)(playPosNow + 2));
 
 	if (numChannels == 2) {
-		interpolationBuffer[1][0][0] = *(int16_t*)(playPosNow + 2 + byteDepth);
+		setInterpolationSample(1, 0, *(int16_t*)(playPosNow + 2 + byteDepth));
 	}
 }
 
 void SampleLowLevelReader::bufferZeroForInterpolation(int32_t numChannels) {
 
-	// This works better than using memmoves. Ideally we'd switch this off if not smoothly interpolating - check that that's actually more efficient though
-	for (int32_t i = kInterpolationMaxNumSamples - 1; i >= 1; i--) {
-		interpolationBuffer[0][0][i] = interpolationBuffer[0][0][i - 1];
-		if (numChannels == 2) {
-			interpolationBuffer[1][0][i] = interpolationBuffer[1][0][i - 1];
-		}
-	}
+	advanceInterpolationBuffer();
 
-	interpolationBuffer[0][0][0] = 0;
+	setInterpolationSample(0, 0, 0);
 
 	if (numChannels == 2) {
-		interpolationBuffer[1][0][0] = 0;
+		setInterpolationSample(1, 0, 0);
 	}
 
 	currentPlayPos++;
@@ -937,31 +952,21 @@ void SampleLowLevelReader::jumpForwardLinear(int32_t numChannels, int32_t byteDe
 			//numSamplesToJumpForward = 2; // Not necessasry
 		}
 
-		if (numChannels == 2) {
-			if (numSamplesToJumpForward >= 2) {
-				interpolationBuffer[0][0][1] = *(int16_t*)(currentPlayPos + 2);
-				interpolationBuffer[1][0][1] = *(int16_t*)(currentPlayPos + 2 + byteDepth);
-				currentPlayPos += jumpAmount;
-			}
-			else {
-				interpolationBuffer[0][0][1] = interpolationBuffer[0][0][0];
-				interpolationBuffer[1][0][1] = interpolationBuffer[1][0][0];
+		// Only the 2 most recent samples matter to us here, so at most 2 need pushing into the buffer
+		if (numSamplesToJumpForward >= 2) {
+			advanceInterpolationBuffer();
+			setInterpolationSample(0, 0, *(int16_t*)(currentPlayPos + 2));
+			if (numChannels == 2) {
+				setInterpolationSample(1, 0, *(int16_t*)(currentPlayPos + 2 + byteDepth));
 			}
-			interpolationBuffer[1][0][0] = *(int16_t*)(currentPlayPos + 2 + byteDepth);
+			currentPlayPos += jumpAmount;
 		}
 
-		else {
-			if (numSamplesToJumpForward >= 2) {
-				interpolationBuffer[0][0][1] = *(int16_t*)(currentPlayPos + 2);
-				currentPlayPos += jumpAmount;
-			}
-			else {
-				interpolationBuffer[0][0][1] = interpolationBuffer[0][0][0];
-			}
+		advanceInterpolationBuffer();
+		setInterpolationSample(0, 0, *(int16_t*)(currentPlayPos + 2));
+		if (numChannels == 2) {
+			setInterpolationSample(1, 0, *(int16_t*)(currentPlayPos + 2 + byteDepth));
 		}
-
-		// Putting these down here did speed things up!
-		interpolationBuffer[0][0][0] = *(int16_t*)(currentPlayPos + 2);
 		currentPlayPos += jumpAmount;
 	}
 }
@@ -971,6 +976,10 @@ void SampleLowLevelReader::jumpForwardLinear(int32_t numChannels, int32_t byteDe
 	((24 + kInterpolationMaxNumSamplesMagnitude) - 16 - numBitsInTableSize                                             \
 	 + 1) // that's (numBitsInInput - 16 - numBitsInTableSize); = 4 for now
 
+// Our interpolation buffer isn't the plain array of vectors these expect, so tell them how to get at it
+#define INTERPOLATION_BUFFER_VECTOR(c, i) vld1_s16(&interpolationBuffer[c][interpolationBufferPos + ((i) << 2)])
+#define INTERPOLATION_BUFFER_SAMPLE(c, i) getInterpolationSample(c, i)
+
 void SampleLowLevelReader::interpolate(int32_t* __restrict__ sampleRead, int32_t numChannelsNow, int32_t whichKernel) {
 #include "dsp/interpolation/interpolate.h"
 }
@@ -980,6 +989,9 @@ void SampleLowLevelReader::interpolateLinear(int32_t* __restrict__ sampleRead, i
 #include "dsp/interpolation/interpolate_linear.h"
 }
 
+#undef INTERPOLATION_BUFFER_VECTOR
+#undef INTERPOLATION_BUFFER_SAMPLE
+
 // This stuff is in its own function here rather than in Voice because for some reason it's faster
 void SampleLowLevelReader::readSamplesResampled(int32_t** __restrict__ oscBufferPos, int32_t numSamplesTotal,
                                                 Sample* sample, int32_t jumpAmount, int32_t numChannels,
@@ -1026,46 +1038,31 @@ void SampleLowLevelReader::readSamplesResampled(int32_t** __restrict__ oscBuffer
 						numSamplesToJumpForward = kInterpolationMaxNumSamples;
 					}
 
-					int16_t sourceL = *(int16_t*)currentPlayPosNow;
-
-					for (int32_t i = kInterpolationMaxNumSamples - 1; i >= numSamplesToJumpForward; i--) {
-						interpolationBuffer[0][0][i] = interpolationBuffer[0][0][i - numSamplesToJumpForward];
-					}
-
+					// Push the new source samples into the ring buffer, oldest first - no shuffling needed
+					int32_t bufferPos = interpolationBufferPos;
 					if (numChannels == 2) {
-						for (int32_t i = kInterpolationMaxNumSamples - 1; i >= numSamplesToJumpForward; i--) {
-							interpolationBuffer[1][0][i] = interpolationBuffer[1][0][i - numSamplesToJumpForward];
-						}
-
-						numSamplesToJumpForward--;
-
-						while (true) {
-							interpolationBuffer[0][0][numSamplesToJumpForward] = sourceL;
-							interpolationBuffer[1][0][numSamplesToJumpForward] =
-							    *(int16_t*)(currentPlayPosNow + byteDepth);
+						do {
+							bufferPos = (bufferPos - 1) & (kInterpolationMaxNumSamples - 1);
+							int16_t sourceL = *(int16_t*)currentPlayPosNow;
+							int16_t sourceR = *(int16_t*)(currentPlayPosNow + byteDepth);
+							interpolationBuffer[0][bufferPos] = sourceL;
+							interpolationBuffer[0][bufferPos + kInterpolationMaxNumSamples] = sourceL;
+							interpolationBuffer[1][bufferPos] = sourceR;
+							interpolationBuffer[1][bufferPos + kInterpolationMaxNumSamples] = sourceR;
 							currentPlayPosNow += jumpAmount;
-							if (!numSamplesToJumpForward) {
-								goto skipFirstSmooth;
-							}
-							numSamplesToJumpForward--;
-							sourceL = *(int16_t*)currentPlayPosNow;
-						}
+						} while (--numSamplesToJumpForward);
 					}
 
 					else {
-
-						numSamplesToJumpForward--;
-
-						while (true) {
+						do {
+							bufferPos = (bufferPos - 1) & (kInterpolationMaxNumSamples - 1);
+							int16_t sourceL = *(int16_t*)currentPlayPosNow;
+							interpolationBuffer[0][bufferPos] = sourceL;
+							interpolationBuffer[0][bufferPos + kInterpolationMaxNumSamples] = sourceL;
 							currentPlayPosNow += jumpAmount;
-							interpolationBuffer[0][0][numSamplesToJumpForward] = sourceL;
-							if (!numSamplesToJumpForward) {
-								goto skipFirstSmooth;
-							}
-							sourceL = *(int16_t*)currentPlayPosNow;
-							numSamplesToJumpForward--;
-						}
+						} while (--numSamplesToJumpForward);
 					}
+					interpolationBufferPos = bufferPos;
 				}
 			}
 			else {
@@ -1281,6 +1278,7 @@ void SampleLowLevelReader::cloneFrom(SampleLowLevelReader* other, bool stealReas
 	}
 
 	memcpy(interpolationBuffer, other->interpolationBuffer, sizeof(interpolationBuffer));
+	interpolationBufferPos = other->interpolationBufferPos;
 
 	oscPos = other->oscPos;
 	currentPlayPos = other->currentPlayPos;
@@ -1288,4 +1286,5 @@ void SampleLowLevelReader::cloneFrom(SampleLowLevelReader* other, bool stealReas
 	clusterStartLocation = other->clusterStartLocation;
 	reassessmentAction = other->reassessmentAction;
 	interpolationBufferSizeLastTime = other->interpolationBufferSizeLastTime;
+	phaseIncrementLastTime = other->phaseIncrementLastTime;
 }
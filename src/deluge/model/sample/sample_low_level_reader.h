@@ -48,6 +48,7 @@ public:
 	void jumpBackSamples(Sample* sample, int32_t numToJumpBack, int32_t playDirection);
 	void setupForPlayPosMovedIntoNewCluster(SamplePlaybackGuide* guide, Sample* sample, int32_t bytePosWithinNewCluster,
 	                                        int32_t byteDepth);
+	void updateDeadlinesForUpcomingClusters(SamplePlaybackGuide* guide, Sample* sample);
 	bool setupClusersForInitialPlay(SamplePlaybackGuide* guide, Sample* sample, int32_t byteOvershoot = 0,
 	                                bool justLooped = false, int32_t priorityRating = 1);
 	bool moveOnToNextCluster(SamplePlaybackGuide* guide, Sample* sample, int32_t priorityRating = 1);
@@ -97,8 +98,29 @@ public:
 	char* clusterStartLocation; // You're allowed to read from this location, but not move any further "back" past it
 	uint8_t reassessmentAction;
 	int8_t interpolationBufferSizeLastTime; // 0 if was previously switched off
-
-	int16x4_t interpolationBuffer[2][kInterpolationMaxNumSamples >> 2];
+	int32_t phaseIncrementLastTime;          // Only used to estimate when upcoming Clusters will be needed
+
+	// Mirrored ring buffer - the history for channel c is interpolationBuffer[c][interpolationBufferPos + i], with
+	// i == 0 the most recent source sample. Everything's written twice, kInterpolationMaxNumSamples apart, so that run
+	// of samples is always contiguous for the kernel, and advancing costs one write per new sample rather than a
+	// shuffle of the whole buffer.
+	int16_t interpolationBuffer[2][kInterpolationMaxNumSamples * 2];
+	int32_t interpolationBufferPos;
+
+	inline int16_t getInterpolationSample(int32_t c, int32_t i) {
+		return interpolationBuffer[c][interpolationBufferPos + i];
+	}
+
+	inline void setInterpolationSample(int32_t c, int32_t i, int16_t value) {
+		int32_t pos = (interpolationBufferPos + i) & (kInterpolationMaxNumSamples - 1);
+		interpolationBuffer[c][pos] = value;
+		interpolationBuffer[c][pos + kInterpolationMaxNumSamples] = value;
+	}
+
+	// Makes room for one new most-recent sample, at i == 0. The oldest one falls off the end
+	inline void advanceInterpolationBuffer() {
+		interpolationBufferPos = (interpolationBufferPos - 1) & (kInterpolationMaxNumSamples - 1);
+	}
 
 	Cluster* clusters[kNumClustersLoadedAhead];
 
@@ -0,0 +1,292 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "model/sample/sample_peak_pyramid.h"
+#include "definitions_cxx.hpp"
+#include "memory/general_memory_allocator.h"
+#include "model/sample/sample.h"
+#include "model/sample/sample_cluster.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/cluster/cluster.h"
+#include <algorithm>
+#include <string.h>
+
+extern uint8_t currentlyAccessingCard;
+
+// Pyramids that fillRoutine() is working through, first one first. If there's no room, a pyramid just doesn't get
+// filled in the background until it's asked for again
+constexpr int32_t kMaxNumPyramidsToFill = 4;
+SamplePeakPyramid* pyramidsToFill[kMaxNumPyramidsToFill];
+int32_t numPyramidsToFill = 0;
+
+// The waveform's waiting on these, so do a few Clusters per call, letting the audio run in between
+constexpr int32_t kNumClustersToFillPerCall = 8;
+
+// If a Cluster won't load this many times in a row, give up, so any other pyramids don't get stuck behind this one
+constexpr int32_t kMaxNumFillFailures = 4;
+
+SamplePeakPyramid::SamplePeakPyramid() {
+	levels[0] = NULL;
+	complete = false;
+	sample = NULL;
+	waitingToFill = false;
+}
+
+SamplePeakPyramid::~SamplePeakPyramid() {
+	stopFilling();
+	if (levels[0]) {
+		GeneralMemoryAllocator::get().dealloc(levels[0]);
+	}
+}
+
+// Returns error
+int32_t SamplePeakPyramid::setup(Sample* newSample) {
+	sample = newSample;
+
+	uint32_t totalLength = 0;
+	for (int32_t l = 0; l < kNumLevels; l++) {
+		levelLengths[l] = ((std::max<uint64_t>(sample->lengthInSamples, 1) - 1) >> kLevelMagnitudes[l]) + 1;
+		totalLength += levelLengths[l];
+	}
+
+	// All levels go in one allocation
+	levels[0] = (Peak*)GeneralMemoryAllocator::get().alloc(totalLength * sizeof(Peak));
+	if (!levels[0]) {
+		return ERROR_INSUFFICIENT_RAM;
+	}
+	for (int32_t l = 1; l < kNumLevels; l++) {
+		levels[l] = levels[l - 1] + levelLengths[l - 1];
+	}
+
+	// Nothing found yet
+	for (uint32_t i = 0; i < totalLength; i++) {
+		levels[0][i].min = 32767;
+		levels[0][i].max = -32768;
+	}
+
+	return NO_ERROR;
+}
+
+void SamplePeakPyramid::addCluster(Sample* sample, int32_t clusterIndex, Cluster* cluster) {
+	SampleCluster* sampleCluster = sample->clusters.getElement(clusterIndex);
+	if (sampleCluster->peaksInPyramid) {
+		return;
+	}
+
+	int32_t bytesPerSample = sample->numChannels * sample->byteDepth;
+
+	// Work out which samples lie entirely within this Cluster. The odd one that overlaps the boundary gets missed,
+	// but that's not going to make any visible difference
+	int64_t clusterStartByte = (int64_t)clusterIndex << audioFileManager.clusterSizeMagnitude;
+	int64_t startByteRelativeToAudio = clusterStartByte - sample->audioDataStartPosBytes;
+	int64_t startSample =
+	    (startByteRelativeToAudio <= 0) ? 0 : (startByteRelativeToAudio + bytesPerSample - 1) / bytesPerSample;
+	int64_t endSample = (startByteRelativeToAudio + audioFileManager.clusterSize) / bytesPerSample;
+	endSample = std::min<int64_t>(endSample, sample->lengthInSamples);
+
+	if (endSample > startSample) {
+
+		// Misalign, to align with non-32-bit data
+		int32_t bytePos = startSample * bytesPerSample - startByteRelativeToAudio + sample->byteDepth - 4;
+
+		// Fill in the finest level, reading both channels if there are two
+		int64_t thisSample = startSample;
+		do {
+			int64_t blockEndSample = std::min<int64_t>(
+			    ((thisSample >> kLevelMagnitudes[0]) + 1) << kLevelMagnitudes[0], endSample);
+			int32_t numValuesThisBlock = (blockEndSample - thisSample) * sample->numChannels;
+
+			int32_t minThisBlock = 32767;
+			int32_t maxThisBlock = -32768;
+			for (int32_t i = 0; i < numValuesThisBlock; i++) {
+				int32_t value = *(int32_t*)&cluster->data[bytePos] >> 16;
+				minThisBlock = std::min(minThisBlock, value);
+				maxThisBlock = std::max(maxThisBlock, value);
+				bytePos += sample->byteDepth;
+			}
+
+			Peak* peak = &levels[0][thisSample >> kLevelMagnitudes[0]];
+			peak->min = std::min<int32_t>(peak->min, minThisBlock);
+			peak->max = std::max<int32_t>(peak->max, maxThisBlock);
+
+			thisSample = blockEndSample;
+		} while (thisSample < endSample);
+
+		// And update the coarser levels from the one below
+		for (int32_t l = 1; l < kNumLevels; l++) {
+			uint32_t startPeak = startSample >> kLevelMagnitudes[l];
+			uint32_t endPeak = ((endSample - 1) >> kLevelMagnitudes[l]) + 1;
+			for (uint32_t p = startPeak; p < endPeak; p++) {
+				uint32_t startChild = p << kMagnitudeBetweenLevels;
+				uint32_t endChild = std::min(startChild + (1 << kMagnitudeBetweenLevels), levelLengths[l - 1]);
+				int32_t minHere = 32767;
+				int32_t maxHere = -32768;
+				for (uint32_t c = startChild; c < endChild; c++) {
+					minHere = std::min<int32_t>(minHere, levels[l - 1][c].min);
+					maxHere = std::max<int32_t>(maxHere, levels[l - 1][c].max);
+				}
+				levels[l][p].min = minHere;
+				levels[l][p].max = maxHere;
+			}
+		}
+	}
+
+	sampleCluster->peaksInPyramid = true;
+}
+
+// Returns false if we don't have all the data for that stretch yet, in which case min and max weren't touched.
+// endSample is exclusive. Values are full-scale 32-bit, like the WaveformRenderer deals in
+bool SamplePeakPyramid::getPeaks(Sample* sample, int64_t startSample, int64_t endSample, int32_t* min, int32_t* max) {
+	if (endSample - startSample < kMinSamplesPerCol) {
+		return false;
+	}
+
+	// Which peaks of the finest level we'll look at. Ones only partly in the stretch count if they're at least half in
+	// it, so the edges are never more than half a peak out
+	int32_t halfPeak = 1 << (kLevelMagnitudes[0] - 1);
+	uint32_t startPeak = (startSample + halfPeak) >> kLevelMagnitudes[0];
+	uint32_t endPeak = std::min<uint32_t>((endSample + halfPeak) >> kLevelMagnitudes[0], levelLengths[0]);
+	if (startPeak >= endPeak) {
+		return false;
+	}
+
+	// Check every Cluster those peaks touch has been added
+	if (!complete) {
+		int32_t bytesPerSample = sample->numChannels * sample->byteDepth;
+		int64_t peaksStartSample = (int64_t)startPeak << kLevelMagnitudes[0];
+		int64_t peaksEndSample = std::min<int64_t>((int64_t)endPeak << kLevelMagnitudes[0], sample->lengthInSamples);
+		int32_t startCluster = (peaksStartSample * bytesPerSample + sample->audioDataStartPosBytes)
+		                       >> audioFileManager.clusterSizeMagnitude;
+		int32_t endCluster = ((peaksEndSample * bytesPerSample + sample->audioDataStartPosBytes - 1)
+		                      >> audioFileManager.clusterSizeMagnitude)
+		                     + 1;
+		endCluster = std::min(endCluster, sample->clusters.getNumElements());
+		for (int32_t c = startCluster; c < endCluster; c++) {
+			if (!sample->clusters.getElement(c)->peaksInPyramid) {
+				return false;
+			}
+		}
+	}
+
+	// Work up through the levels. At each one, take the peaks at the edges which don't make up a whole peak of the
+	// next level, then carry on with what's left in between. Only the coarsest level takes everything that's left
+	int32_t minHere = 32767;
+	int32_t maxHere = -32768;
+	int32_t l = 0;
+	while (startPeak < endPeak) {
+		bool isCoarsest = (l == kNumLevels - 1);
+		uint32_t alignment = (1 << kMagnitudeBetweenLevels) - 1;
+
+		while (startPeak < endPeak && (isCoarsest || (startPeak & alignment))) {
+			minHere = std::min<int32_t>(minHere, levels[l][startPeak].min);
+			maxHere = std::max<int32_t>(maxHere, levels[l][startPeak].max);
+			startPeak++;
+		}
+		while (startPeak < endPeak && (endPeak & alignment)) {
+			endPeak--;
+			minHere = std::min<int32_t>(minHere, levels[l][endPeak].min);
+			maxHere = std::max<int32_t>(maxHere, levels[l][endPeak].max);
+		}
+
+		startPeak >>= kMagnitudeBetweenLevels;
+		endPeak >>= kMagnitudeBetweenLevels;
+		l++;
+	}
+
+	if (minHere > maxHere) {
+		return false; // Shouldn't happen
+	}
+
+	*min = minHere << 16;
+	*max = maxHere << 16;
+	return true;
+}
+
+// Call when the WaveformRenderer's started using this pyramid, so it gets every Cluster it doesn't have yet
+void SamplePeakPyramid::fillWanted() {
+	if (complete || waitingToFill || numPyramidsToFill == kMaxNumPyramidsToFill) {
+		return;
+	}
+
+	nextClusterToFill = sample->getFirstClusterIndexWithAudioData();
+	numFillFailures = 0;
+	waitingToFill = true;
+	pyramidsToFill[numPyramidsToFill++] = this;
+}
+
+void SamplePeakPyramid::stopFilling() {
+	if (!waitingToFill) {
+		return;
+	}
+
+	for (int32_t i = 0; i < numPyramidsToFill; i++) {
+		if (pyramidsToFill[i] == this) {
+			numPyramidsToFill--;
+			memmove(&pyramidsToFill[i], &pyramidsToFill[i + 1], (numPyramidsToFill - i) * sizeof(SamplePeakPyramid*));
+			break;
+		}
+	}
+	waitingToFill = false;
+}
+
+// Returns whether there's any more to do
+bool SamplePeakPyramid::fillSomeClusters() {
+	for (int32_t i = 0; i < kNumClustersToFillPerCall; i++) {
+		// Skip any the WaveformRenderer already did
+		int32_t endCluster = sample->getFirstClusterIndexWithNoAudioData();
+		while (nextClusterToFill < endCluster && sample->clusters.getElement(nextClusterToFill)->peaksInPyramid) {
+			nextClusterToFill++;
+		}
+		if (nextClusterToFill >= endCluster) {
+			complete = true;
+			return false;
+		}
+
+		Cluster* cluster = sample->clusters.getElement(nextClusterToFill)
+		                       ->getCluster(sample, nextClusterToFill, CLUSTER_LOAD_IMMEDIATELY);
+		if (!cluster) {
+			// We'll just try again next time
+			return (++numFillFailures < kMaxNumFillFailures);
+		}
+		numFillFailures = 0;
+
+		addCluster(sample, nextClusterToFill, cluster);
+		audioFileManager.removeReasonFromCluster(cluster, "E458");
+		nextClusterToFill++;
+
+		AudioEngine::routineWithClusterLoading(); // -----------------------------------
+	}
+	return true;
+}
+
+void SamplePeakPyramid::fillRoutine() {
+	if (!numPyramidsToFill || currentlyAccessingCard || audioFileManager.cardEjected || audioFileManager.cardDisabled) {
+		return;
+	}
+
+	SamplePeakPyramid* pyramid = pyramidsToFill[0];
+	Sample* sample = pyramid->sample;
+
+	// Make sure the Sample - and so the pyramid - doesn't get stolen while we're accessing the card
+	sample->addReason();
+	bool moreToDo = !sample->unloadable && pyramid->fillSomeClusters();
+	if (!moreToDo) {
+		pyramid->stopFilling();
+	}
+	sample->removeReason("E460");
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+class Sample;
+class Cluster;
+
+// Min and max values of a Sample's audio at a few resolutions - one pair for each 256, 4096 and 65536 samples - so the
+// waveform can be drawn at any zoom level by looking at a handful of these per column, rather than reading through the
+// audio data again every time the view scrolls or zooms.
+//
+// It gets filled in a Cluster at a time - by the WaveformRenderer whenever it has a Cluster loaded anyway, and, once
+// fillWanted() has been called, by fillRoutine() in the background, going through the whole Sample. Once all the
+// Clusters a column covers have been done, that column never needs the audio data again.
+class SamplePeakPyramid {
+public:
+	SamplePeakPyramid();
+	~SamplePeakPyramid();
+	int32_t setup(Sample* newSample);
+	void addCluster(Sample* sample, int32_t clusterIndex, Cluster* cluster);
+	bool getPeaks(Sample* sample, int64_t startSample, int64_t endSample, int32_t* min, int32_t* max);
+	void fillWanted();
+
+	// Call regularly from the main loop, where the card may be accessed
+	static void fillRoutine();
+
+	static constexpr int32_t kNumLevels = 3;
+	static constexpr int32_t kLevelMagnitudes[kNumLevels] = {8, 12, 16};
+	static constexpr int32_t kMagnitudeBetweenLevels = 4;
+
+	// Columns narrower than this just get worked out from the audio data
+	static constexpr int32_t kMinSamplesPerCol = 1 << kLevelMagnitudes[0];
+
+	bool complete; // Once every Cluster's been added
+
+private:
+	bool fillSomeClusters();
+	void stopFilling();
+
+	struct Peak {
+		int16_t min;
+		int16_t max;
+	};
+
+	Peak* levels[kNumLevels];
+	uint32_t levelLengths[kNumLevels];
+
+	Sample* sample;
+	int32_t nextClusterToFill;
+	uint8_t numFillFailures;
+	bool waitingToFill;
+};
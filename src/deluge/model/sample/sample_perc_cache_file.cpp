@@ -0,0 +1,348 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "model/sample/sample_perc_cache_file.h"
+#include "definitions_cxx.hpp"
+#include "io/debug/print.h"
+#include "model/sample/sample.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/cluster/cluster.h"
+#include "util/d_string.h"
+#include <string.h>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+extern uint8_t currentlyAccessingCard;
+
+namespace SamplePercCacheFile {
+
+constexpr uint32_t kFileMagic = 0x43525044; // "DPRC"
+constexpr uint8_t kFileVersion = 1;
+
+struct FileHeader {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t reductionMagnitude; // kPercBufferReductionMagnitude when it was written
+	uint8_t reversed;
+	uint8_t reserved;
+
+	// So we can tell if the audio file has been changed since
+	uint32_t audioFileSize;
+	uint32_t audioFileDateTime;
+	uint32_t lengthInSamples;
+
+	uint32_t numBytes; // Of perc cache data, which follows
+};
+
+enum class JobType : uint8_t {
+	LOAD,
+	SAVE,
+};
+
+struct Job {
+	Sample* sample;
+	uint8_t reversed;
+	JobType type;
+};
+
+constexpr int32_t kMaxNumJobs = 8;
+
+Job jobs[kMaxNumJobs];
+int32_t numJobs = 0;
+
+FIL file; // Our own, so we don't interfere with anything else that's got a file open
+
+void addJob(Sample* sample, int32_t reversed, JobType type) {
+	for (int32_t j = 0; j < numJobs; j++) {
+		if (jobs[j].sample == sample && jobs[j].reversed == reversed) {
+			jobs[j].type = type;
+			return;
+		}
+	}
+
+	// If there's no room, just forget it. It'll get asked for again if it's still needed
+	if (numJobs == kMaxNumJobs) {
+		return;
+	}
+
+	jobs[numJobs].sample = sample;
+	jobs[numJobs].reversed = reversed;
+	jobs[numJobs].type = type;
+	numJobs++;
+}
+
+void percCacheWanted(Sample* sample, int32_t reversed) {
+	addJob(sample, reversed, JobType::LOAD);
+}
+
+void percCacheCompleted(Sample* sample, int32_t reversed) {
+	addJob(sample, reversed, JobType::SAVE);
+}
+
+void sampleBeingDeleted(Sample* sample) {
+	for (int32_t j = 0; j < numJobs; j++) {
+		if (jobs[j].sample == sample) {
+			numJobs--;
+			memmove(&jobs[j], &jobs[j + 1], (numJobs - j) * sizeof(Job));
+			j--;
+		}
+	}
+}
+
+// Returns error
+int32_t getPaths(Sample* sample, int32_t reversed, String* audioFilePath, String* percFilePath) {
+	// If it got loaded from the song's alternate folder, that's where it really is
+	audioFilePath->set(sample->loadedFromAlternatePath.isEmpty() ? &sample->filePath
+	                                                              : &sample->loadedFromAlternatePath);
+	percFilePath->set(audioFilePath);
+	return percFilePath->concatenate(reversed ? ".rev.perc" : ".perc");
+}
+
+// Fills in the bits of the header that identify the audio file it's for. Returns error
+int32_t getHeaderForAudioFile(Sample* sample, int32_t reversed, String* audioFilePath, FileHeader* header) {
+	FILINFO fileInfo;
+	FRESULT result = f_stat(audioFilePath->get(), &fileInfo);
+	if (result != FR_OK) {
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	header->magic = kFileMagic;
+	header->version = kFileVersion;
+	header->reductionMagnitude = kPercBufferReductionMagnitude;
+	header->reversed = reversed;
+	header->reserved = 0;
+	header->audioFileSize = fileInfo.fsize;
+	header->audioFileDateTime = ((uint32_t)fileInfo.fdate << 16) | fileInfo.ftime;
+	header->lengthInSamples = sample->lengthInSamples;
+	header->numBytes = sample->getPercCacheSize();
+	return NO_ERROR;
+}
+
+// Returns error
+int32_t load(Sample* sample, int32_t reversed) {
+	String audioFilePath;
+	String percFilePath;
+	int32_t error = getPaths(sample, reversed, &audioFilePath, &percFilePath);
+	if (error) {
+		return error;
+	}
+
+	FileHeader headerWanted;
+	error = getHeaderForAudioFile(sample, reversed, &audioFilePath, &headerWanted);
+	if (error) {
+		return error;
+	}
+
+	FRESULT result = f_open(&file, percFilePath.get(), FA_READ);
+	if (result != FR_OK) {
+		sample->percCacheFileStatus[reversed] = PercCacheFileStatus::NOT_ON_CARD;
+		return NO_ERROR;
+	}
+
+	FileHeader header;
+	UINT numBytesRead;
+	result = f_read(&file, &header, sizeof(header), &numBytesRead);
+	if (result != FR_OK || numBytesRead != sizeof(header) || memcmp(&header, &headerWanted, sizeof(header))) {
+		// Probably just out of date. We'll overwrite it next time the perc cache gets completed
+		f_close(&file);
+		sample->percCacheFileStatus[reversed] = PercCacheFileStatus::NOT_ON_CARD;
+		return NO_ERROR;
+	}
+
+	error = sample->preparePercCacheStorage(reversed);
+	if (error) {
+		f_close(&file);
+		return error;
+	}
+
+	int32_t numBytes = header.numBytes;
+
+	// Short Samples - just read it straight into the memory. If fillPercCache() is also filling bits of it in while
+	// we're reading, that's fine - it'll come up with exactly the same values
+	if (!sample->isPercCacheDoneWithClusters()) {
+		result = f_read(&file, sample->percCacheMemory[reversed], numBytes, &numBytesRead);
+		f_close(&file);
+		if (result != FR_OK || numBytesRead != (UINT)numBytes) {
+			return ERROR_SD_CARD;
+		}
+	}
+
+	// Or longer ones - into Clusters, which we keep a reason on each of till we're done, so none get stolen
+	else {
+		int32_t numClustersDone = 0;
+		for (; numClustersDone < sample->numPercCacheClusters; numClustersDone++) {
+			int32_t c = numClustersDone;
+			Cluster* cluster = sample->percCacheClusters[reversed][c];
+			if (cluster) {
+				audioFileManager.addReasonToCluster(cluster);
+			}
+			else {
+				cluster = audioFileManager.allocateCluster(
+				    reversed ? ClusterType::PERC_CACHE_REVERSED : ClusterType::PERC_CACHE_FORWARDS, true, sample);
+				if (!cluster) {
+					error = ERROR_INSUFFICIENT_RAM;
+					break;
+				}
+				cluster->sample = sample;
+				cluster->clusterIndex = c;
+				sample->percCacheClusters[reversed][c] = cluster;
+			}
+
+			int32_t numBytesThisCluster = std::min<int32_t>(numBytes - (c << audioFileManager.clusterSizeMagnitude),
+			                                                audioFileManager.clusterSize);
+			result = f_read(&file, cluster->data, numBytesThisCluster, &numBytesRead);
+			if (result != FR_OK || numBytesRead != (UINT)numBytesThisCluster) {
+				numClustersDone++; // It's got a reason too, which needs removing
+				error = ERROR_SD_CARD;
+				break;
+			}
+		}
+		f_close(&file);
+
+		if (!error) {
+			error = sample->setPercCacheComplete(reversed);
+		}
+
+		for (int32_t c = 0; c < numClustersDone; c++) {
+			audioFileManager.removeReasonFromCluster(sample->percCacheClusters[reversed][c], "E453");
+		}
+
+		return error;
+	}
+
+	return sample->setPercCacheComplete(reversed);
+}
+
+// Returns error
+int32_t save(Sample* sample, int32_t reversed) {
+	// Might have been stolen from since it got completed
+	if (!sample->isPercCacheComplete(reversed)) {
+		return NO_ERROR;
+	}
+
+	String audioFilePath;
+	String percFilePath;
+	int32_t error = getPaths(sample, reversed, &audioFilePath, &percFilePath);
+	if (error) {
+		return error;
+	}
+
+	FileHeader header;
+	error = getHeaderForAudioFile(sample, reversed, &audioFilePath, &header);
+	if (error) {
+		return error;
+	}
+
+	bool doneWithClusters = sample->isPercCacheDoneWithClusters();
+
+	// Make sure none of it gets stolen while we're writing it
+	if (doneWithClusters) {
+		for (int32_t c = 0; c < sample->numPercCacheClusters; c++) {
+			audioFileManager.addReasonToCluster(sample->percCacheClusters[reversed][c]);
+		}
+	}
+
+	FRESULT result = f_open(&file, percFilePath.get(), FA_CREATE_ALWAYS | FA_WRITE);
+	if (result == FR_OK) {
+		UINT numBytesWritten;
+		result = f_write(&file, &header, sizeof(header), &numBytesWritten);
+
+		if (result == FR_OK) {
+			if (!doneWithClusters) {
+				result = f_write(&file, sample->percCacheMemory[reversed], header.numBytes, &numBytesWritten);
+			}
+			else {
+				for (int32_t c = 0; c < sample->numPercCacheClusters && result == FR_OK; c++) {
+					int32_t numBytesThisCluster =
+					    std::min<int32_t>(header.numBytes - (c << audioFileManager.clusterSizeMagnitude),
+					                      audioFileManager.clusterSize);
+					result = f_write(&file, sample->percCacheClusters[reversed][c]->data, numBytesThisCluster,
+					                 &numBytesWritten);
+				}
+			}
+		}
+
+		FRESULT closeResult = f_close(&file);
+		if (result == FR_OK) {
+			result = closeResult;
+		}
+
+		// Don't leave a half-written one lying around
+		if (result != FR_OK) {
+			f_unlink(percFilePath.get());
+		}
+	}
+
+	if (doneWithClusters) {
+		for (int32_t c = 0; c < sample->numPercCacheClusters; c++) {
+			audioFileManager.removeReasonFromCluster(sample->percCacheClusters[reversed][c], "E454");
+		}
+	}
+
+	if (result != FR_OK) {
+		return ERROR_SD_CARD;
+	}
+
+	sample->percCacheFileStatus[reversed] = PercCacheFileStatus::ON_CARD;
+	return NO_ERROR;
+}
+
+void routine() {
+	if (!numJobs || currentlyAccessingCard || audioFileManager.cardEjected || audioFileManager.cardDisabled) {
+		return;
+	}
+
+	// Just do one per call - each one is a few card accesses
+	Job job = jobs[0];
+	numJobs--;
+	memmove(&jobs[0], &jobs[1], numJobs * sizeof(Job));
+
+	Sample* sample = job.sample;
+
+	// Recordings that are still happening (or that haven't been given their proper name yet) can wait till next time
+	if (sample->unloadable || !sample->tempFilePathForRecording.isEmpty()) {
+		return;
+	}
+
+	// Make sure the Sample doesn't get stolen while we're accessing the card
+	sample->addReason();
+
+	int32_t error;
+	if (job.type == JobType::LOAD) {
+		if (sample->percCacheFileStatus[job.reversed] == PercCacheFileStatus::NOT_ON_CARD
+		    || sample->isPercCacheComplete(job.reversed)) {
+			error = NO_ERROR;
+		}
+		else {
+			error = load(sample, job.reversed);
+		}
+	}
+	else {
+		error = save(sample, job.reversed);
+	}
+
+	if (error) {
+		Debug::print("perc cache file error: ");
+		Debug::println(error);
+	}
+
+	sample->removeReason("E455");
+}
+
+} // namespace SamplePercCacheFile
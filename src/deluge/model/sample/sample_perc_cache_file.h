@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+class Sample;
+
+// The perc cache (the "percussiveness" data the TimeStretcher uses to decide where to end its hops) takes a fair bit
+// of CPU to work out, and it only lives in stealable Clusters. So once a Sample's perc cache has been worked out for
+// the whole of it, in one play-direction, we write it to a file next to the audio file - e.g. "SAMPLES/LOOP.WAV.perc"
+// (or ".rev.perc" for reversed). Then next time it's needed and isn't in RAM, it gets read back from there rather than
+// worked out again.
+//
+// The file records the size and modified-date of the audio file it was made from, so if that's changed, it's ignored
+// and will be overwritten next time.
+//
+// None of the card access happens in the audio routine - that just asks for it to be done, and routine() does it.
+namespace SamplePercCacheFile {
+
+// Called by Sample::fillPercCache() when it's about to have to start working out perc cache for a new zone
+void percCacheWanted(Sample* sample, int32_t reversed);
+
+// Called by Sample::fillPercCache() when one play-direction's perc cache has just become complete
+void percCacheCompleted(Sample* sample, int32_t reversed);
+
+// So we don't try and do anything with a Sample that no longer exists
+void sampleBeingDeleted(Sample* sample);
+
+// Call regularly from the main loop, where the card may be accessed
+void routine();
+
+} // namespace SamplePercCacheFile
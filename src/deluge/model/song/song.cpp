@@ -32,6 +32,7 @@
 #include "hid/led/pad_leds.h"
 #include "hid/matrix/matrix_driver.h"
 #include "io/debug/print.h"
+#include "io/debug/render_profiler.h"
 #include "io/midi/midi_device.h"
 #include "io/midi/midi_device_manager.h"
 #include "io/midi/midi_engine.h"
@@ -70,9 +71,12 @@
 #include <string.h>
 
 extern "C" {
+#include "RZA1/mtu/mtu.h"
 #include "RZA1/uart/sio_char.h"
 }
 
+extern uint8_t currentlyAccessingCard;
+
 using namespace deluge;
 
 Song::Song() : backedUpParamManagers(sizeof(BackedUpParamManager)) {
@@ -1975,6 +1979,103 @@ readClip:
 }
 
 // Needs to be in a separate function than the above because the main song XML file needs to be closed first before this is called, because this will open other (sample) files
+// For comparing how long songs take to parse between firmware versions. Reads every song in the SONGS folder - just
+// the XML, not any audio - and prints how long readFromFile() took for each, along with how long it takes just to go
+// through the same file a char at a time with readCharXML(), as a reference that doesn't change between versions.
+// Times come from the slow timer, so anything over about 1.9 seconds wraps around.
+void Song::runReadBenchmark() {
+	if (currentlyAccessingCard) {
+		return;
+	}
+
+	DIR dir;
+	FRESULT result = f_opendir(&dir, "SONGS");
+	if (result != FR_OK) {
+		Debug::println("Song read benchmark: no SONGS folder");
+		return;
+	}
+
+	int32_t numSongs = 0;
+	uint32_t totalReadUS = 0;
+	uint32_t totalCharsUS = 0;
+
+	while (true) {
+		FILINFO fileInfo;
+		FilePointer filePointer;
+		result = f_readdir_get_filepointer(&dir, &fileInfo, &filePointer);
+		if (result != FR_OK || !fileInfo.fname[0]) {
+			break;
+		}
+		if ((fileInfo.fattrib & AM_DIR) || fileInfo.fname[0] == '.') {
+			continue;
+		}
+		char const* dot = strrchr(fileInfo.fname, '.');
+		if (!dot || strcasecmp(dot, ".XML")) {
+			continue;
+		}
+
+		// The char-at-a-time reference first
+		int32_t error = storageManager.openXMLFile(&filePointer, "song");
+		if (error) {
+			continue;
+		}
+		uint16_t startTime = *TCNT[TIMER_SYSTEM_SLOW];
+		char thisChar;
+		while (storageManager.readCharXML(&thisChar)) {}
+		uint16_t endTime = *TCNT[TIMER_SYSTEM_SLOW];
+		storageManager.closeFile();
+		uint32_t charsUS = (uint16_t)(endTime - startTime) * 1000 / msToSlowTimerCount(1);
+
+		// And then reading it properly, into a Song that just gets thrown away again
+		void* songMemory = GeneralMemoryAllocator::get().alloc(sizeof(Song), NULL, false, true);
+		if (!songMemory) {
+			break;
+		}
+		Song* song = new (songMemory) Song();
+		error = song->paramManager.setupUnpatched();
+		if (!error) {
+			GlobalEffectable::initParams(&song->paramManager);
+			error = storageManager.openXMLFile(&filePointer, "song");
+			if (!error) {
+				startTime = *TCNT[TIMER_SYSTEM_SLOW];
+				error = song->readFromFile();
+				endTime = *TCNT[TIMER_SYSTEM_SLOW];
+				storageManager.closeFile();
+			}
+		}
+		void* toDealloc = dynamic_cast<void*>(song);
+		song->~Song();
+		GeneralMemoryAllocator::get().dealloc(toDealloc);
+
+		Debug::print(fileInfo.fname);
+		if (error) {
+			Debug::print(": error ");
+			Debug::println(error);
+			continue;
+		}
+		uint32_t readUS = (uint16_t)(endTime - startTime) * 1000 / msToSlowTimerCount(1);
+		Debug::print(": bytes: ");
+		Debug::print((int32_t)fileInfo.fsize);
+		Debug::print(", readFromFile() uS: ");
+		Debug::print(readUS);
+		Debug::print(", char at a time uS: ");
+		Debug::println(charsUS);
+
+		numSongs++;
+		totalReadUS += readUS;
+		totalCharsUS += charsUS;
+	}
+
+	f_closedir(&dir);
+
+	Debug::print("Song read benchmark, songs: ");
+	Debug::print(numSongs);
+	Debug::print(", total readFromFile() uS: ");
+	Debug::print(totalReadUS);
+	Debug::print(", total char at a time uS: ");
+	Debug::println(totalCharsUS);
+}
+
 void Song::loadAllSamples(bool mayActuallyReadFiles) {
 
 	for (Output* thisOutput = firstOutput; thisOutput; thisOutput = thisOutput->next) {
@@ -2094,7 +2195,8 @@ void Song::renderAudio(StereoSample* outputBuffer, int32_t numSamples, int32_t*
 	char modelStackMemory[MODEL_STACK_MAX_SIZE];
 	ModelStack* modelStack = setupModelStackWithSong(modelStackMemory, this);
 
-	for (Output* output = firstOutput; output; output = output->next) {
+	int32_t outputIndex = 0;
+	for (Output* output = firstOutput; output; output = output->next, outputIndex++) {
 		if (!output->inValidState) {
 			continue;
 		}
@@ -2102,8 +2204,10 @@ void Song::renderAudio(StereoSample* outputBuffer, int32_t numSamples, int32_t*
 		bool isClipActiveNow = (output->activeClip && isClipActive(output->activeClip->getClipBeingRecordedFrom()));
 
 		//AudioEngine::logAction("outp->render");
+		uint16_t outputStartTime = RenderProfiler::getTime();
 		output->renderOutput(modelStack, outputBuffer, outputBuffer + numSamples, numSamples, reverbBuffer,
 		                     volumePostFX >> 1, sideChainHitPending, !isClipActiveNow, isClipActiveNow);
+		RenderProfiler::stopOutput(outputIndex, outputStartTime);
 		//AudioEngine::logAction("/outp->render");
 	}
 
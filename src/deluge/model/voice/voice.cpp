@@ -167,6 +167,10 @@ bool Voice::noteOn(ModelStackWithVoice* modelStack, int32_t newNoteCodeBeforeArp
 		sourceValues[util::to_underlying(PatchSource::X) + m] = combineExpressionValues(sound, m);
 	}
 
+	// Start a fresh control block, so the new note gets patched right away
+	samplesLeftInControlBlock = 0;
+	sourcesChangedSinceLastPatching = 0; // performInitialPatching() will have done everything
+
 	if (resetEnvelopes) {
 		memset(sourceAmplitudesLastTime, 0, sizeof(sourceAmplitudesLastTime));
 		memset(modulatorAmplitudeLastTime, 0, sizeof(modulatorAmplitudeLastTime));
@@ -671,13 +675,55 @@ bool Voice::sampleZoneChanged(ModelStackWithVoice* modelStack, int32_t s, Marker
 	return true;
 }
 
+// Where a ramp from lastTime to target, over the rest of the control block, will have got to after numSamples
+static inline int32_t getRampPosition(int32_t lastTime, int32_t target, int32_t numSamples, int32_t samplesLeft) {
+	if (numSamples == samplesLeft) {
+		return target;
+	}
+	return lastTime + (int32_t)(target - lastTime) / samplesLeft * numSamples;
+}
+
 // Before calling this, you must set the filterSetConfig's doLPF and doHPF to default values
 
-// Returns false if became inactive and needs unassigning
+// Returns false if became inactive and needs unassigning.
+// Modulation (envelopes, LFO, MPE smoothing, patching, filter setup) only gets worked out every
+// kVoiceControlBlockSize samples, however big or small the render windows are, with amplitudes ramping between those
+// points. So a window gets split wherever it crosses a control block boundary, and a tiny window which doesn't cross
+// one skips all that and just carries on the ramps from last time
 bool Voice::render(ModelStackWithVoice* modelStack, int32_t* soundBuffer, int32_t numSamples,
                    bool soundRenderingInStereo, bool applyingPanAtVoiceLevel, uint32_t sourcesChanged, bool doLPF,
                    bool doHPF, int32_t externalPitchAdjust) {
 
+	// Hang onto these until the next control block, which is the next time patching happens
+	sourcesChangedSinceLastPatching |= sourcesChanged;
+
+	do {
+		bool startingControlBlock = !samplesLeftInControlBlock;
+		if (startingControlBlock) {
+			samplesLeftInControlBlock = kVoiceControlBlockSize;
+		}
+		int32_t numSamplesThisTime = std::min(numSamples, samplesLeftInControlBlock);
+
+		bool stillGoing =
+		    renderPartOfControlBlock(modelStack, soundBuffer, numSamplesThisTime, soundRenderingInStereo,
+		                             applyingPanAtVoiceLevel, startingControlBlock, doLPF, doHPF, externalPitchAdjust);
+		samplesLeftInControlBlock -= numSamplesThisTime;
+		if (!stillGoing) {
+			return false;
+		}
+
+		soundBuffer += numSamplesThisTime << soundRenderingInStereo;
+		numSamples -= numSamplesThisTime;
+	} while (numSamples);
+
+	return true;
+}
+
+// samplesLeftInControlBlock includes the numSamples we're rendering now
+bool Voice::renderPartOfControlBlock(ModelStackWithVoice* modelStack, int32_t* soundBuffer, int32_t numSamples,
+                                     bool soundRenderingInStereo, bool applyingPanAtVoiceLevel,
+                                     bool startingControlBlock, bool doLPF, bool doHPF, int32_t externalPitchAdjust) {
+
 	GeneralMemoryAllocator::get().checkStack("Voice::render");
 
 	ParamManagerForTimeline* paramManager = (ParamManagerForTimeline*)modelStack->paramManager;
@@ -690,76 +736,81 @@ bool Voice::render(ModelStackWithVoice* modelStack, int32_t* soundBuffer, int32_
 		noteOff(modelStack);
 	}
 
-	// Do envelopes - if they're patched to something (always do the first one though)
-	for (int32_t e = 0; e < kNumEnvelopes; e++) {
-		if (e == 0
-		    || (paramManager->getPatchCableSet()->sourcesPatchedToAnything[GLOBALITY_LOCAL]
-		        & (1 << (util::to_underlying(PatchSource::ENVELOPE_0) + e)))) {
-			int32_t old = sourceValues[util::to_underlying(PatchSource::ENVELOPE_0) + e];
-			int32_t release = paramFinalValues[Param::Local::ENV_0_RELEASE + e];
-			if (e == 0 && overrideAmplitudeEnvelopeReleaseRate) {
-				release = overrideAmplitudeEnvelopeReleaseRate;
-			}
-			sourceValues[util::to_underlying(PatchSource::ENVELOPE_0) + e] =
-			    envelopes[e].render(numSamples, paramFinalValues[Param::Local::ENV_0_ATTACK + e],
-			                        paramFinalValues[Param::Local::ENV_0_DECAY + e],
-			                        paramFinalValues[Param::Local::ENV_0_SUSTAIN + e], release, decayTableSmall8);
-			uint32_t anyChange = (old != sourceValues[util::to_underlying(PatchSource::ENVELOPE_0) + e]);
-			sourcesChanged |= anyChange << (util::to_underlying(PatchSource::ENVELOPE_0) + e);
-		}
-	}
-
-	bool unassignVoiceAfter =
-	    (envelopes[0].state
-	     == EnvelopeStage::
-	         OFF); //(envelopes[0].state >= EnvelopeStage::DECAY && localSourceValues[PatchSource::ENVELOPE_0 - Local::FIRST_SOURCE] == -2147483648);
-	// Local LFO
-	if (paramManager->getPatchCableSet()->sourcesPatchedToAnything[GLOBALITY_LOCAL]
-	    & (1 << util::to_underlying(PatchSource::LFO_LOCAL))) {
-		int32_t old = sourceValues[util::to_underlying(PatchSource::LFO_LOCAL)];
-		sourceValues[util::to_underlying(PatchSource::LFO_LOCAL)] =
-		    lfo.render(numSamples, sound->lfoLocalWaveType, paramFinalValues[Param::Local::LFO_LOCAL_FREQ]);
-		uint32_t anyChange = (old != sourceValues[util::to_underlying(PatchSource::LFO_LOCAL)]);
-		sourcesChanged |= anyChange << util::to_underlying(PatchSource::LFO_LOCAL);
-	}
-
-	// MPE params
-
+	// Expression changes can come from the Sound on any render, so make sure they don't get missed
 	whichExpressionSourcesCurrentlySmoothing |= sound->whichExpressionSourcesChangedAtSynthLevel;
 
-	if (whichExpressionSourcesCurrentlySmoothing) {
-		whichExpressionSourcesFinalValueChanged |= whichExpressionSourcesCurrentlySmoothing;
+	if (startingControlBlock) {
+		uint32_t sourcesChanged = sourcesChangedSinceLastPatching;
+		sourcesChangedSinceLastPatching = 0;
 
-		for (int32_t i = 0; i < kNumExpressionDimensions; i++) {
-			if ((whichExpressionSourcesCurrentlySmoothing >> i) & 1) {
+		// Do envelopes - if they're patched to something (always do the first one though)
+		for (int32_t e = 0; e < kNumEnvelopes; e++) {
+			if (e == 0
+			    || (paramManager->getPatchCableSet()->sourcesPatchedToAnything[GLOBALITY_LOCAL]
+			        & (1 << (util::to_underlying(PatchSource::ENVELOPE_0) + e)))) {
+				int32_t old = sourceValues[util::to_underlying(PatchSource::ENVELOPE_0) + e];
+				int32_t release = paramFinalValues[Param::Local::ENV_0_RELEASE + e];
+				if (e == 0 && overrideAmplitudeEnvelopeReleaseRate) {
+					release = overrideAmplitudeEnvelopeReleaseRate;
+				}
+				sourceValues[util::to_underlying(PatchSource::ENVELOPE_0) + e] =
+				    envelopes[e].render(kVoiceControlBlockSize, paramFinalValues[Param::Local::ENV_0_ATTACK + e],
+				                        paramFinalValues[Param::Local::ENV_0_DECAY + e],
+				                        paramFinalValues[Param::Local::ENV_0_SUSTAIN + e], release, decayTableSmall8);
+				uint32_t anyChange = (old != sourceValues[util::to_underlying(PatchSource::ENVELOPE_0) + e]);
+				sourcesChanged |= anyChange << (util::to_underlying(PatchSource::ENVELOPE_0) + e);
+			}
+		}
 
-				int32_t targetValue = combineExpressionValues(sound, i);
+		// Local LFO
+		if (paramManager->getPatchCableSet()->sourcesPatchedToAnything[GLOBALITY_LOCAL]
+		    & (1 << util::to_underlying(PatchSource::LFO_LOCAL))) {
+			int32_t old = sourceValues[util::to_underlying(PatchSource::LFO_LOCAL)];
+			sourceValues[util::to_underlying(PatchSource::LFO_LOCAL)] = lfo.render(
+			    kVoiceControlBlockSize, sound->lfoLocalWaveType, paramFinalValues[Param::Local::LFO_LOCAL_FREQ]);
+			uint32_t anyChange = (old != sourceValues[util::to_underlying(PatchSource::LFO_LOCAL)]);
+			sourcesChanged |= anyChange << util::to_underlying(PatchSource::LFO_LOCAL);
+		}
 
-				int32_t diff = (targetValue >> 8) - (sourceValues[i + util::to_underlying(PatchSource::X)] >> 8);
+		// MPE params
 
-				if (diff == 0) {
-					whichExpressionSourcesCurrentlySmoothing &= ~(1 << i);
-				}
-				else {
-					int32_t amountToAdd = diff * numSamples;
-					sourceValues[i + util::to_underlying(PatchSource::X)] += amountToAdd;
+		if (whichExpressionSourcesCurrentlySmoothing) {
+			whichExpressionSourcesFinalValueChanged |= whichExpressionSourcesCurrentlySmoothing;
+
+			for (int32_t i = 0; i < kNumExpressionDimensions; i++) {
+				if ((whichExpressionSourcesCurrentlySmoothing >> i) & 1) {
+
+					int32_t targetValue = combineExpressionValues(sound, i);
+
+					int32_t diff = (targetValue >> 8) - (sourceValues[i + util::to_underlying(PatchSource::X)] >> 8);
+
+					if (diff == 0) {
+						whichExpressionSourcesCurrentlySmoothing &= ~(1 << i);
+					}
+					else {
+						int32_t amountToAdd = diff * kVoiceControlBlockSize;
+						sourceValues[i + util::to_underlying(PatchSource::X)] += amountToAdd;
+					}
 				}
 			}
 		}
-	}
 
-	sourcesChanged |= whichExpressionSourcesFinalValueChanged << util::to_underlying(PatchSource::X);
+		sourcesChanged |= whichExpressionSourcesFinalValueChanged << util::to_underlying(PatchSource::X);
 
-	whichExpressionSourcesFinalValueChanged = 0;
+		whichExpressionSourcesFinalValueChanged = 0;
 
-	// Patch all the sources to their parameters
-	if (sourcesChanged) {
-		for (int32_t s = 0; s < util::to_underlying(kFirstLocalSource); s++) {
-			sourceValues[s] = sound->globalSourceValues[s];
+		// Patch all the sources to their parameters
+		if (sourcesChanged) {
+			for (int32_t s = 0; s < util::to_underlying(kFirstLocalSource); s++) {
+				sourceValues[s] = sound->globalSourceValues[s];
+			}
+			patcher.performPatching(sourcesChanged, sound, paramManager);
 		}
-		patcher.performPatching(sourcesChanged, sound, paramManager);
 	}
 
+	// Only unassign once the amplitude has finished ramping down, at the end of the control block
+	bool unassignVoiceAfter = (envelopes[0].state == EnvelopeStage::OFF && numSamples == samplesLeftInControlBlock);
+
 	// Sort out pitch
 	int32_t overallPitchAdjust = paramFinalValues[Param::Local::PITCH_ADJUST];
 
@@ -798,18 +849,21 @@ bool Voice::render(ModelStackWithVoice* modelStack, int32_t* soundBuffer, int32_
 		overallPitchAdjust = a << 8;
 
 		// Move envelope on. Using the "release rate" lookup table gives by far the best range of speed values
-		int32_t envelopeSpeed =
-		    lookupReleaseRate(cableToExpParamShortcut(
-		        paramManager->getUnpatchedParamSet()->getValue(Param::Unpatched::Sound::PORTAMENTO)))
-		    >> 13;
-		portaEnvelopePos += envelopeSpeed * numSamples;
+		if (startingControlBlock) {
+			int32_t envelopeSpeed =
+			    lookupReleaseRate(cableToExpParamShortcut(
+			        paramManager->getUnpatchedParamSet()->getValue(Param::Unpatched::Sound::PORTAMENTO)))
+			    >> 13;
+			portaEnvelopePos += envelopeSpeed * kVoiceControlBlockSize;
+		}
 	}
 
 	// Decide whether to do an auto-release for sample. Despite this being envelope-related, meaning we'd ideally prefer to do it before patching,
 	// we can only do it after because we need to know pitch
 
 	// If not already releasing and some release is set, and no noise-source...
-	if (sound->getSynthMode() != SynthMode::FM && envelopes[0].state < EnvelopeStage::RELEASE && hasReleaseStage()
+	if (startingControlBlock && sound->getSynthMode() != SynthMode::FM && envelopes[0].state < EnvelopeStage::RELEASE
+	    && hasReleaseStage()
 	    && !paramManager->getPatchedParamSet()->params[Param::Local::NOISE_VOLUME].containsSomething(-2147483648)) {
 
 		uint32_t whichSourcesNeedAttention = 0;
@@ -932,12 +986,15 @@ skipAutoRelease : {}
 
 	// Prepare the filters
 	// Checking if filters should run now happens within the filterset
-	filterGain = filterSet.setConfig(
-	    paramFinalValues[Param::Local::LPF_FREQ], paramFinalValues[Param::Local::LPF_RESONANCE], doLPF, sound->lpfMode,
-	    paramFinalValues[Param::Local::LPF_MORPH], paramFinalValues[Param::Local::HPF_FREQ],
-	    (paramFinalValues[Param::Local::HPF_RESONANCE]), // >> storageManager.devVarA) << storageManager.devVarA,
-	    doHPF, sound->hpfMode, paramFinalValues[Param::Local::HPF_MORPH], sound->volumeNeutralValueForUnison << 1,
-	    sound->filterRoute); // Level adjustment for unison now happens *before* the filter!
+	if (startingControlBlock) {
+		filterGainThisControlBlock = filterSet.setConfig(
+		    paramFinalValues[Param::Local::LPF_FREQ], paramFinalValues[Param::Local::LPF_RESONANCE], doLPF,
+		    sound->lpfMode, paramFinalValues[Param::Local::LPF_MORPH], paramFinalValues[Param::Local::HPF_FREQ],
+		    (paramFinalValues[Param::Local::HPF_RESONANCE]), // >> storageManager.devVarA) << storageManager.devVarA,
+		    doHPF, sound->hpfMode, paramFinalValues[Param::Local::HPF_MORPH], sound->volumeNeutralValueForUnison << 1,
+		    sound->filterRoute); // Level adjustment for unison now happens *before* the filter!
+	}
+	filterGain = filterGainThisControlBlock;
 
 	SynthMode synthMode = sound->getSynthMode();
 
@@ -998,7 +1055,8 @@ skipAutoRelease : {}
 		}
 
 		for (int32_t s = 0; s < kNumSources; s++) {
-			sourceAmplitudeIncrements[s] = (int32_t)(sourceAmplitudes[s] - sourceAmplitudesLastTime[s]) / numSamples;
+			sourceAmplitudeIncrements[s] =
+			    (int32_t)(sourceAmplitudes[s] - sourceAmplitudesLastTime[s]) / samplesLeftInControlBlock;
 		}
 
 		filterGainLastTime = filterGain;
@@ -1012,7 +1070,7 @@ skipAutoRelease : {}
 				if (modulatorsActive[m]) {
 					modulatorAmplitudeIncrements[m] = (int32_t)(paramFinalValues[Param::Local::MODULATOR_0_VOLUME + m]
 					                                            - modulatorAmplitudeLastTime[m])
-					                                  / numSamples;
+					                                  / samplesLeftInControlBlock;
 				}
 			}
 		}
@@ -1024,12 +1082,13 @@ skipAutoRelease : {}
 		if (!doneFirstRender && paramFinalValues[Param::Local::ENV_0_ATTACK] > 245632) {
 			overallOscAmplitudeLastTime = overallOscAmplitude;
 		}
-		overallOscillatorAmplitudeIncrement = (int32_t)(overallOscAmplitude - overallOscAmplitudeLastTime) / numSamples;
+		overallOscillatorAmplitudeIncrement =
+		    (int32_t)(overallOscAmplitude - overallOscAmplitudeLastTime) / samplesLeftInControlBlock;
 
 		for (int32_t s = 0; s < kNumSources; s++) {
 			sourceWaveIndexIncrements[s] =
 			    (int32_t)(paramFinalValues[Param::Local::OSC_A_WAVE_INDEX + s] - sourceWaveIndexesLastTime[s])
-			    / numSamples;
+			    / samplesLeftInControlBlock;
 		}
 	}
 
@@ -1062,7 +1121,10 @@ skipAutoRelease : {}
 	    || (paramFinalValues[Param::Local::NOISE_VOLUME] != 0
 	        && synthMode != SynthMode::FM) // Not essential, but makes life easier
 	    || paramManager->getPatchCableSet()->doesParamHaveSomethingPatchedToIt(Param::Local::PAN)
-	    || (paramFinalValues[Param::Local::FOLD] != NEGATIVE_ONE_Q31)) {
+	    || (paramFinalValues[Param::Local::FOLD] != NEGATIVE_ONE_Q31)
+	    // The vectorized oscillators write in 4s, so can spill past the end - which would be into the next bit of the
+	    // window, if it's been split at a control block boundary
+	    || (numSamples & 3)) {
 		renderingDirectlyIntoSoundBuffer = false;
 	}
 
@@ -1657,14 +1719,21 @@ skipUnisonPart : {}
 
 renderingDone:
 
+	// Unless that was the end of the control block, the ramps only got part of the way to their targets
 	for (int32_t s = 0; s < kNumSources; s++) {
-		sourceAmplitudesLastTime[s] = sourceAmplitudes[s];
-		sourceWaveIndexesLastTime[s] = paramFinalValues[Param::Local::OSC_A_WAVE_INDEX + s];
+		sourceAmplitudesLastTime[s] = getRampPosition(sourceAmplitudesLastTime[s], sourceAmplitudes[s], numSamples,
+		                                              samplesLeftInControlBlock);
+		sourceWaveIndexesLastTime[s] =
+		    getRampPosition(sourceWaveIndexesLastTime[s], paramFinalValues[Param::Local::OSC_A_WAVE_INDEX + s],
+		                    numSamples, samplesLeftInControlBlock);
 	}
 	for (int32_t m = 0; m < kNumModulators; m++) {
-		modulatorAmplitudeLastTime[m] = paramFinalValues[Param::Local::MODULATOR_0_VOLUME + m];
+		modulatorAmplitudeLastTime[m] =
+		    getRampPosition(modulatorAmplitudeLastTime[m], paramFinalValues[Param::Local::MODULATOR_0_VOLUME + m],
+		                    numSamples, samplesLeftInControlBlock);
 	}
-	overallOscAmplitudeLastTime = overallOscAmplitude;
+	overallOscAmplitudeLastTime =
+	    getRampPosition(overallOscAmplitudeLastTime, overallOscAmplitude, numSamples, samplesLeftInControlBlock);
 
 	return !unassignVoiceAfter;
 }
@@ -2006,9 +2075,21 @@ void Voice::renderBasicSource(Sound* sound, ParamManagerForTimeline* paramManage
 
 	GeneralMemoryAllocator::get().checkStack("Voice::renderBasicSource");
 
+	// Simple oscillators can often have their unison parts all rendered side by side, which saves a lot
+	uint32_t unisonPartsRenderedTogether = 0;
+	if (sound->numUnison > 1 && !doOscSync && !getPhaseIncrements) {
+		unisonPartsRenderedTogether =
+		    renderUnisonPartsTogether(sound, s, oscBuffer, numSamples, stereoBuffer, sourceAmplitude,
+		                              amplitudeIncrement, overallPitchAdjust);
+	}
+
 	// For each unison part
 	for (int32_t u = 0; u < sound->numUnison; u++) {
 
+		if (unisonPartsRenderedTogether & (1 << u)) {
+			continue;
+		}
+
 		VoiceUnisonPartSource* voiceUnisonPartSource = &unisonParts[u].sources[s];
 
 		// Samples may become inactive
@@ -2729,6 +2810,147 @@ const int16_t* analogSawTables[] = {
     mysterySynthBSaw_53,   mysterySynthBSaw_39,   mysterySynthBSaw_27,  mysterySynthBSaw_19,  mysterySynthBSaw_13,
     mysterySynthBSaw_9,    mysterySynthBSaw_7,    mysterySynthBSaw_5,   mysterySynthBSaw_3,   mysterySynthBSaw_1};
 
+// For the plain table-based waves (and the crude saw) with no pulse width or sync, renders whichever of a source's
+// unison parts are close enough in pitch to share a table, up to 4 at a time in vector lanes. Returns a bitmask of the
+// parts it did - anything else, like a part on its own, is left for the regular per-part rendering.
+uint32_t Voice::renderUnisonPartsTogether(Sound* sound, int32_t s, int32_t* oscBuffer, int32_t numSamples,
+                                          bool stereoBuffer, int32_t amplitude, int32_t amplitudeIncrement,
+                                          int32_t overallPitchAdjust) {
+
+	OscType type = sound->sources[s].oscType;
+	if ((type != OscType::SINE && type != OscType::SAW && type != OscType::SQUARE && type != OscType::ANALOG_SAW_2
+	     && type != OscType::ANALOG_SQUARE)
+	    || paramFinalValues[Param::Local::OSC_A_PHASE_WIDTH + s]) {
+		return 0;
+	}
+
+	const int16_t* tables[kMaxNumVoicesUnison];
+	int32_t tableSizeMagnitudes[kMaxNumVoicesUnison];
+	uint32_t phaseIncrements[kMaxNumVoicesUnison];
+	uint32_t candidates = 0;
+
+	for (int32_t u = 0; u < sound->numUnison; u++) {
+		VoiceUnisonPartSource* voiceUnisonPartSource = &unisonParts[u].sources[s];
+		if (!voiceUnisonPartSource->active) {
+			continue;
+		}
+
+		// If the pitch is too high, the regular rendering will skip this part anyway
+		uint32_t phaseIncrement = voiceUnisonPartSource->phaseIncrementStoredValue;
+		if (!adjustPitch(&phaseIncrement, overallPitchAdjust)
+		    || !adjustPitch(&phaseIncrement, paramFinalValues[Param::Local::OSC_A_PITCH_ADJUST + s])) {
+			continue;
+		}
+
+		// Same table choices as renderOsc()
+		if (type == OscType::SINE) {
+			tables[u] = sineWaveSmall;
+			tableSizeMagnitudes[u] = 8;
+		}
+		else {
+			int32_t tableNumber;
+			getTableNumber(phaseIncrement, tableNumber, tableSizeMagnitudes[u]);
+			bool crude = (tableNumber < AudioEngine::cpuDireness + 6);
+
+			if (type == OscType::SAW) {
+				tables[u] = crude ? NULL : sawTables[tableNumber];
+			}
+			else if (type == OscType::ANALOG_SAW_2) {
+				tables[u] = (crude && tableNumber >= 8) ? NULL : analogSawTables[tableNumber];
+			}
+			else if (type == OscType::SQUARE) {
+				if (crude) {
+					continue;
+				}
+				tables[u] = squareTables[tableNumber];
+			}
+			else {
+				tables[u] = analogSquareTables[tableNumber];
+			}
+
+			if (!tables[u]) {
+				tableSizeMagnitudes[u] = 0;
+			}
+		}
+
+		phaseIncrements[u] = phaseIncrement;
+		candidates |= (1 << u);
+	}
+
+	bool stereoUnison = sound->unisonStereoSpread && stereoBuffer;
+	uint32_t unisonPartsRendered = 0;
+
+	while (candidates) {
+		int32_t first = __builtin_ctz(candidates);
+
+		uint32_t group = 0;
+		uint32_t phases[4] = {0, 0, 0, 0};
+		uint32_t groupPhaseIncrements[4] = {0, 0, 0, 0};
+		int32_t laneAmplitudesL[4] = {0, 0, 0, 0};
+		int32_t laneAmplitudesR[4] = {0, 0, 0, 0};
+		int32_t numLanes = 0;
+
+		for (int32_t u = first; u < sound->numUnison && numLanes < 4; u++) {
+			if (!(candidates & (1 << u)) || tables[u] != tables[first]
+			    || tableSizeMagnitudes[u] != tableSizeMagnitudes[first]) {
+				continue;
+			}
+
+			group |= (1 << u);
+			phases[numLanes] = unisonParts[u].sources[s].oscPos;
+			groupPhaseIncrements[numLanes] = phaseIncrements[u];
+
+			if (stereoBuffer) {
+				int32_t amplitudeL, amplitudeR;
+				shouldDoPanning((stereoUnison ? sound->unisonPan[u] : 0), &amplitudeL, &amplitudeR);
+				laneAmplitudesL[numLanes] = std::min(amplitudeL, (int32_t)1073741823) << 1;
+				laneAmplitudesR[numLanes] = std::min(amplitudeR, (int32_t)1073741823) << 1;
+			}
+			else {
+				laneAmplitudesL[numLanes] = 2147483647;
+			}
+			numLanes++;
+		}
+		candidates &= ~group;
+
+		// Not worth it for just one
+		if (numLanes < 2) {
+			continue;
+		}
+
+		for (int32_t u = 0; u < sound->numUnison; u++) {
+			if (group & (1 << u)) {
+				unisonParts[u].sources[s].oscPos += phaseIncrements[u] * numSamples;
+			}
+		}
+
+		// Sine and crude saw come out twice as big for the same amplitude - see renderOsc()
+		int32_t amplitudeHere = amplitude;
+		int32_t amplitudeIncrementHere = amplitudeIncrement;
+		if (type == OscType::SINE || !tables[first]) {
+			amplitudeHere >>= 1;
+			amplitudeIncrementHere >>= 1;
+		}
+
+		int32x4_t laneAmplitudesRVector = vld1q_s32(laneAmplitudesR);
+		int32x4_t const* laneAmplitudesRPointer = stereoBuffer ? &laneAmplitudesRVector : NULL;
+
+		if (!tables[first]) {
+			renderUnisonWave<true>(NULL, 0, amplitudeHere, amplitudeIncrementHere, oscBuffer, numSamples, phases,
+			                       groupPhaseIncrements, vld1q_s32(laneAmplitudesL), laneAmplitudesRPointer);
+		}
+		else {
+			renderUnisonWave<false>(tables[first], tableSizeMagnitudes[first], amplitudeHere, amplitudeIncrementHere,
+			                        oscBuffer, numSamples, phases, groupPhaseIncrements, vld1q_s32(laneAmplitudesL),
+			                        laneAmplitudesRPointer);
+		}
+
+		unisonPartsRendered |= group;
+	}
+
+	return unisonPartsRendered;
+}
+
 __attribute__((optimize("unroll-loops"))) void
 Voice::renderOsc(int32_t s, OscType type, int32_t amplitude, int32_t* bufferStart, int32_t* bufferEnd,
                  int32_t numSamples, uint32_t phaseIncrement, uint32_t pulseWidth, uint32_t* startPhase,
@@ -25,6 +25,9 @@
 #include "modulation/lfo.h"
 #include "modulation/patch/patcher.h"
 
+// How often each Voice's modulation gets worked out, in samples
+constexpr int32_t kVoiceControlBlockSize = 32;
+
 class StereoSample;
 class ModelStackWithVoice;
 using namespace deluge;
@@ -67,6 +70,10 @@ public:
 	uint32_t sourceWaveIndexesLastTime[kNumSources];
 
 	int32_t filterGainLastTime;
+	int32_t filterGainThisControlBlock;
+
+	int32_t samplesLeftInControlBlock;
+	uint32_t sourcesChangedSinceLastPatching;
 
 	bool doneFirstRender;
 	bool previouslyIgnoredNoteOff;
@@ -75,6 +82,9 @@ public:
 
 	uint32_t orderSounded;
 
+	uint32_t costModelKey; // For the VoiceCostModel. Updated each render
+	int32_t estimatedCost; // Ticks the window being planned is predicted to take
+
 	int32_t overrideAmplitudeEnvelopeReleaseRate;
 
 	Voice* nextUnassigned;
@@ -101,6 +111,10 @@ public:
 	void expressionEventSmooth(int32_t newValue, int32_t s);
 
 private:
+	bool renderPartOfControlBlock(ModelStackWithVoice* modelStack, int32_t* soundBuffer, int32_t numSamples,
+	                              bool soundRenderingInStereo, bool applyingPanAtVoiceLevel, bool startingControlBlock,
+	                              bool doLPF, bool doHPF, int32_t externalPitchAdjust);
+
 	//inline int32_t doFM(uint32_t *carrierPhase, uint32_t* lastShiftedPhase, uint32_t carrierPhaseIncrement, uint32_t phaseShift);
 
 	void renderOsc(int32_t s, OscType type, int32_t amplitude, int32_t* thisSample, int32_t* bufferEnd,
@@ -112,6 +126,9 @@ private:
 	                       bool* unisonPartBecameInactive, int32_t overallPitchAdjust, bool doOscSync,
 	                       uint32_t* oscSyncPos, uint32_t* oscSyncPhaseIncrements, int32_t amplitudeIncrement,
 	                       uint32_t* getPhaseIncrements, bool getOutAfterPhaseIncrements, int32_t waveIndexIncrement);
+	uint32_t renderUnisonPartsTogether(Sound* sound, int32_t s, int32_t* oscBuffer, int32_t numSamples,
+	                                   bool stereoBuffer, int32_t amplitude, int32_t amplitudeIncrement,
+	                                   int32_t overallPitchAdjust);
 	bool adjustPitch(uint32_t* phaseIncrement, int32_t adjustment);
 
 	void renderSineWaveWithFeedback(int32_t* thisSample, int32_t numSamples, uint32_t* phase, int32_t amplitude,
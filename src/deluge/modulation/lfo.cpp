@@ -84,3 +84,43 @@ int32_t LFO::render(int32_t numSamples, LFOType waveType, uint32_t phaseIncremen
 void LFO::tick(int32_t numSamples, uint32_t phaseIncrement) {
 	phase += phaseIncrement * numSamples;
 }
+
+void LFO::renderBlock(int32_t* values, int32_t numSamples, LFOType waveType, uint32_t phaseIncrement) {
+	uint32_t thisPhase = phase;
+	switch (waveType) {
+	case LFOType::SAW:
+		for (int32_t i = 0; i < numSamples; i++) {
+			values[i] = thisPhase;
+			thisPhase += phaseIncrement;
+		}
+		break;
+
+	case LFOType::SQUARE:
+		for (int32_t i = 0; i < numSamples; i++) {
+			values[i] = getSquare(thisPhase);
+			thisPhase += phaseIncrement;
+		}
+		break;
+
+	case LFOType::SINE:
+		for (int32_t i = 0; i < numSamples; i++) {
+			values[i] = getSine(thisPhase);
+			thisPhase += phaseIncrement;
+		}
+		break;
+
+	case LFOType::TRIANGLE:
+		for (int32_t i = 0; i < numSamples; i++) {
+			values[i] = getTriangle(thisPhase);
+			thisPhase += phaseIncrement;
+		}
+		break;
+
+	default: // The random ones need to keep track of wrapping, so just do them the normal way
+		for (int32_t i = 0; i < numSamples; i++) {
+			values[i] = render(1, waveType, phaseIncrement);
+		}
+		return;
+	}
+	phase = thisPhase;
+}
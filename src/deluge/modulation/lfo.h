@@ -26,4 +26,7 @@ public:
 	int32_t holdValue;
 	int32_t render(int32_t numSamples, LFOType waveType, uint32_t phaseIncrement);
 	void tick(int32_t numSamples, uint32_t phaseIncrement);
+
+	// Same as calling render(1, ...) numSamples times, but with the wave type only looked at once
+	void renderBlock(int32_t* values, int32_t numSamples, LFOType waveType, uint32_t phaseIncrement);
 };
@@ -17,6 +17,7 @@
 
 #include "processing/engines/audio_engine.h"
 #include "definitions_cxx.hpp"
+#include "dsp/convolution/impulse_response_processor.h"
 #include "dsp/master_compressor/master_compressor.h"
 #include "dsp/reverb/freeverb/revmodel.hpp"
 #include "dsp/timestretch/time_stretcher.h"
@@ -30,9 +31,12 @@
 #include "gui/views/view.h"
 #include "hid/display/display.h"
 #include "io/debug/print.h"
+#include "io/debug/render_profiler.h"
 #include "io/midi/midi_engine.h"
 #include "memory/general_memory_allocator.h"
+#include "memory/slab_allocator.h"
 #include "model/drum/kit.h"
+#include "model/sample/sample_cache_prerenderer.h"
 #include "model/sample/sample_recorder.h"
 #include "model/song/song.h"
 #include "model/voice/voice.h"
@@ -42,6 +46,7 @@
 #include "modulation/patch/patch_cable_set.h"
 #include "processing/audio_output.h"
 #include "processing/engines/cv_engine.h"
+#include "processing/engines/voice_cost_model.h"
 #include "processing/live/live_input_buffer.h"
 #include "processing/metronome/metronome.h"
 #include "processing/sound/sound_drum.h"
@@ -125,6 +130,7 @@ int32_t cpuDireness = 0;
 uint32_t timeDirenessChanged;
 uint32_t timeThereWasLastSomeReverb = 0x8FFFFFFF;
 int32_t numSamplesLastTime;
+int32_t numSamplesThisWindow = SSI_TX_BUFFER_NUM_SAMPLES; // For predicting the cost of Voices started during it
 int32_t smoothedSamples;
 uint32_t nextVoiceState = 1;
 bool renderInStereo = true;
@@ -151,6 +157,7 @@ LiveInputBuffer* liveInputBuffers[3];
 uint16_t lastRoutineTime;
 
 StereoSample renderingBuffer[SSI_TX_BUFFER_NUM_SAMPLES] __attribute__((aligned(CACHE_LINE_SIZE)));
+int32_t reverbBuffer[SSI_TX_BUFFER_NUM_SAMPLES] __attribute__((aligned(CACHE_LINE_SIZE)));
 
 StereoSample* renderingBufferOutputPos = renderingBuffer;
 StereoSample* renderingBufferOutputEnd = renderingBuffer;
@@ -205,6 +212,11 @@ void init() {
 		staticVoices[i].nextUnassigned = (i == kNumVoicesStatic - 1) ? NULL : &staticVoices[i + 1];
 	}
 
+	// Any more of these than the static ones above come from slabs
+	SlabAllocator::get().addSizeClass(sizeof(Voice));
+	SlabAllocator::get().addSizeClass(sizeof(VoiceSample));
+	SlabAllocator::get().addSizeClass(sizeof(TimeStretcher));
+
 	i2sTXBufferPos = (uint32_t)getTxBufferStart();
 
 	i2sRXBufferPos = (uint32_t)getRxBufferStart()
@@ -303,6 +315,66 @@ Voice* cullVoice(bool saveVoice, bool justDoFastRelease) {
 	return bestVoice;
 }
 
+// Works out from the VoiceCostModel what a render of numSamples will cost, and if that won't fit in real time,
+// fast-releases Voices until it will. That's a lot less audible than letting the render fall behind and then having to
+// hard cull. Victims are picked mostly the same way as cullVoice() does, except that within each class of priority
+// (manual priority, how many voices the Sound has, and envelope stage), the Voices which free up the most get picked
+// first. extraCost is for a Voice about to be started.
+static void cullVoicesToFitPredictedCost(int32_t numSamples, int32_t extraCost = 0) {
+	int32_t budget = VoiceCostModel::getBudget(numSamples);
+	int32_t predictedCost = VoiceCostModel::predictNonVoiceCost(numSamples) + extraCost;
+
+	int32_t numVoices = activeVoices.getNumElements();
+	for (int32_t v = 0; v < numVoices; v++) {
+		Voice* thisVoice = activeVoices.getVoice(v);
+		// Ones already fast-releasing will be gone in a moment, so don't count them
+		if (thisVoice->envelopes[0].state < EnvelopeStage::FAST_RELEASE) {
+			thisVoice->estimatedCost = VoiceCostModel::predictVoiceCost(thisVoice->costModelKey, numSamples);
+			predictedCost += thisVoice->estimatedCost;
+		}
+	}
+
+	// Don't sweep away too much at once on a measurement blip. If this isn't enough, the next window will do more
+	for (int32_t numReleased = 0; predictedCost > budget && numReleased < 4; numReleased++) {
+		uint32_t bestRating = 0;
+		Voice* bestVoice = NULL;
+
+		for (int32_t v = 0; v < numVoices; v++) {
+			Voice* thisVoice = activeVoices.getVoice(v);
+			if (thisVoice->envelopes[0].state >= EnvelopeStage::FAST_RELEASE) {
+				continue;
+			}
+
+			uint32_t priorityRating = thisVoice->getPriorityRating();
+			// As a proportion of the whole budget, out of 4096
+			uint32_t cost = std::clamp<int32_t>(((int64_t)thisVoice->estimatedCost << 12) / (budget + 1), 0, 4095);
+			uint32_t ratingThisVoice = (priorityRating & 0xFF000000) | (cost << 12) | ((priorityRating >> 12) & 4095);
+
+			if (ratingThisVoice > bestRating) {
+				bestRating = ratingThisVoice;
+				bestVoice = thisVoice;
+			}
+		}
+
+		if (!bestVoice) {
+			break;
+		}
+
+		predictedCost -= bestVoice->estimatedCost;
+
+		bool stillGoing = bestVoice->doFastRelease(65536);
+		if (!stillGoing) {
+			unassignVoice(bestVoice, bestVoice->assignedToSound);
+			numVoices--;
+		}
+
+#if ALPHA_OR_BETA_VERSION
+		Debug::print("predictively culled 1 voice. voices left: ");
+		Debug::println(getNumVoices());
+#endif
+	}
+}
+
 int32_t getNumVoices() {
 	return activeVoices.getNumElements();
 }
@@ -333,189 +405,9 @@ int32_t numAudioLogItems = 0;
 
 extern uint16_t g_usb_usbmode;
 
-void routine() {
-	logAction("AudioDriver::routine");
-
-	if (audioRoutineLocked) {
-		logAction("AudioDriver::routine locked");
-		return; // Prevents this from being called again from inside any e.g. memory allocation routines that get called from within this!
-	}
-
-	// See if some more outputting is left over from last time to do
-	bool finishedOutputting = doSomeOutputting();
-	if (!finishedOutputting) {
-		logAction("AudioDriver::still outputting");
-		//Debug::println("still waiting");
-		return;
-	}
-
-	audioRoutineLocked = true;
-	routineBeenCalled = true;
-
-	playbackHandler.routine();
-
-	// At this point, there may be MIDI, including clocks, waiting to be sent.
-
-	GeneralMemoryAllocator::get().checkStack("AudioDriver::routine");
-
-	saddr = (uint32_t)(getTxBufferCurrentPlace());
-	uint32_t saddrPosAtStart = saddr >> (2 + NUM_MONO_OUTPUT_CHANNELS_MAGNITUDE);
-	int32_t numSamples = ((uint32_t)(saddr - i2sTXBufferPos) >> (2 + NUM_MONO_OUTPUT_CHANNELS_MAGNITUDE))
-	                     & (SSI_TX_BUFFER_NUM_SAMPLES - 1);
-	if (!numSamples) {
-		audioRoutineLocked = false;
-		return;
-	}
-
-#if AUTOMATED_TESTER_ENABLED
-	AutomatedTester::possiblyDoSomething();
-#endif
-
-	// Flush everything out of the MIDI buffer now. At this stage, it would only really have live user-triggered output and MIDI THRU in it.
-	// We want any messages like "start" to go out before we send any clocks below, and also want to give them a head-start being sent and out of the way so the clock messages can
-	// be sent on-time
-	bool anythingInMidiOutputBufferNow = midiEngine.anythingInOutputBuffer();
-	bool anythingInGateOutputBufferNow =
-	    cvEngine.gateOutputPending || cvEngine.clockOutputPending; // Not asapGateOutputPending (RUN)
-	if (anythingInMidiOutputBufferNow || anythingInGateOutputBufferNow) {
-
-		// We're only allowed to do this if the timer ISR isn't pending (i.e. we haven't enabled to timer to trigger it) - otherwise this will all get called soon anyway.
-		// I thiiiink this is 100% immune to any synchronization problems?
-		if (!isTimerEnabled(TIMER_MIDI_GATE_OUTPUT)) {
-			if (anythingInGateOutputBufferNow) {
-				cvEngine.updateGateOutputs();
-			}
-			if (anythingInMidiOutputBufferNow) {
-				midiEngine.flushMIDI();
-			}
-		}
-	}
-
-#ifdef REPORT_CPU_USAGE
-	if (numSamples < (NUM_SAMPLES_FOR_CPU_USAGE_REPORT)) {
-		audioRoutineLocked = false;
-		return;
-	}
-	numSamples = NUM_SAMPLES_FOR_CPU_USAGE_REPORT;
-	int32_t unadjustedNumSamplesBeforeLappingPlayHead = numSamples;
-#else
-
-	if (smoothedSamples < numSamples) {
-		smoothedSamples = (numSamplesLastTime + numSamples) >> 1;
-	}
-	else {
-		smoothedSamples = numSamples;
-	}
-	if (!bypassCulling) {
-		numSamplesLastTime = numSamples;
-	}
-
-	// Consider direness and culling - before increasing the number of samples
-	int32_t numSamplesLimit = 40; //storageManager.devVarC;
-	int32_t direnessThreshold = numSamplesLimit - 17;
-
-	if (smoothedSamples >= direnessThreshold) { // 20
-
-		int32_t newDireness = smoothedSamples - (direnessThreshold - 1);
-		if (newDireness > 14) {
-			newDireness = 14;
-		}
-
-		if (newDireness >= cpuDireness) {
-			cpuDireness = newDireness;
-			timeDirenessChanged = audioSampleTimer;
-		}
-
-		if (!bypassCulling) {
-			int32_t numSamplesOverLimit = smoothedSamples - numSamplesLimit;
-
-			// If it's real dire, do a proper immediate cull
-			if (numSamplesOverLimit >= 10) {
-
-				int32_t numToCull = (numSamplesOverLimit >> 3) + 1;
-
-				for (int32_t i = 0; i < numToCull; i++) {
-					cullVoice();
-				}
-
-#if ALPHA_OR_BETA_VERSION
-#if DO_AUDIO_LOG
-				definitelyLog = true;
-#endif
-				Debug::print("culled ");
-				Debug::print(numToCull);
-				Debug::print(" voices. numSamples: ");
-				Debug::print(numSamples);
-
-				Debug::print(". voices left: ");
-				Debug::println(getNumVoices());
-				logAction("hard cull");
-#endif
-			}
-
-			// Or if it's just a little bit dire, do a soft cull with fade-out
-			else if (numSamplesOverLimit >= -6) {
-#if DO_AUDIO_LOG
-				definitelyLog = true;
-#endif
-				cullVoice(false, true);
-				logAction("soft cull");
-			}
-		}
-		else {
-
-			int32_t numSamplesOverLimit = smoothedSamples - numSamplesLimit;
-			if (numSamplesOverLimit >= 0) {
-#if DO_AUDIO_LOG
-				definitelyLog = true;
-#endif
-				Debug::print("Won't cull, but numSamples is ");
-				Debug::println(numSamples);
-				logAction("skipped cull");
-			}
-		}
-	}
-
-	else if (smoothedSamples < direnessThreshold - 10) {
-
-		if ((int32_t)(audioSampleTimer - timeDirenessChanged) >= (kSampleRate >> 3)) { // Only if it's been long enough
-			timeDirenessChanged = audioSampleTimer;
-			cpuDireness--;
-			if (cpuDireness < 0) {
-				cpuDireness = 0;
-			}
-			else {
-				//Debug::print("direness: ");
-				//Debug::println(cpuDireness);
-			}
-		}
-	}
-	bypassCulling = false;
-
-	// Double the number of samples we're going to do - within some constraints
-	int32_t sampleThreshold = 6; // If too low, it'll lead to bigger audio windows and stuff
-	constexpr int32_t maxAdjustedNumSamples = 0.66 * SSI_TX_BUFFER_NUM_SAMPLES;
-
-	int32_t unadjustedNumSamplesBeforeLappingPlayHead = numSamples;
-
-	if (numSamples < maxAdjustedNumSamples) {
-		int32_t samplesOverThreshold = numSamples - sampleThreshold;
-		if (samplesOverThreshold > 0) {
-			samplesOverThreshold = samplesOverThreshold << 1;
-			numSamples = sampleThreshold + samplesOverThreshold;
-			numSamples = std::min(numSamples, maxAdjustedNumSamples);
-		}
-	}
-
-	// Want to round to be doing a multiple of 4 samples, so the NEON functions can be utilized most efficiently.
-	// Note - this can take numSamples up as high as SSI_TX_BUFFER_NUM_SAMPLES (currently 128).
-	if (numSamples >= 3) {
-		numSamples = (numSamples + 2) & ~3;
-	}
-
-#endif
-
-	int32_t timeWithinWindowAtWhichMIDIOrGateOccurs = -1; // -1 means none
+// Actions any sequencer ticks due at the very start of this window, and shortens the window so that it ends exactly
+// where the next one is due. Also does any trigger or MIDI clock out ticks falling within it.
+static int32_t doTicksForWindow(int32_t numSamples, int32_t* timeWithinWindowAtWhichMIDIOrGateOccurs) {
 
 	// If a timer-tick is due during or directly after this window of audio samples...
 	if (playbackHandler.isEitherClockActive()) {
@@ -553,7 +445,7 @@ startAgain:
 			if (midiEngine.anythingInOutputBuffer() || cvEngine.clockOutputPending
 			    || cvEngine.gateOutputPending) { // Not asapGateOutputPending. That probably actually couldn't have been
 				                                 // generated by a actionSwungTick() anyway I think?
-				timeWithinWindowAtWhichMIDIOrGateOccurs = 0;
+				*timeWithinWindowAtWhichMIDIOrGateOccurs = 0;
 			}
 
 			goto startAgain;
@@ -572,8 +464,8 @@ startAgain:
 				playbackHandler.doTriggerClockOutTick();
 				playbackHandler.scheduleTriggerClockOutTick(); // Schedules another one
 
-				if (timeWithinWindowAtWhichMIDIOrGateOccurs == -1) {
-					timeWithinWindowAtWhichMIDIOrGateOccurs = timeTilTriggerClockOutTick;
+				if (*timeWithinWindowAtWhichMIDIOrGateOccurs == -1) {
+					*timeWithinWindowAtWhichMIDIOrGateOccurs = timeTilTriggerClockOutTick;
 				}
 			}
 		}
@@ -584,18 +476,24 @@ startAgain:
 				playbackHandler.doMIDIClockOutTick();
 				playbackHandler.scheduleMIDIClockOutTick(); // Schedules another one
 
-				if (timeWithinWindowAtWhichMIDIOrGateOccurs == -1) {
-					timeWithinWindowAtWhichMIDIOrGateOccurs = timeTilMIDIClockOutTick;
+				if (*timeWithinWindowAtWhichMIDIOrGateOccurs == -1) {
+					*timeWithinWindowAtWhichMIDIOrGateOccurs = timeTilMIDIClockOutTick;
 				}
 			}
 		}
 	}
 
-	memset(&renderingBuffer, 0, numSamples * sizeof(StereoSample));
+	return numSamples;
+}
 
-	static int32_t reverbBuffer[SSI_TX_BUFFER_NUM_SAMPLES] __attribute__((aligned(CACHE_LINE_SIZE)));
+// Renders one window of audio for the whole song - voices, reverb, song-level effects, master compressor and metronome -
+// into renderingBuffer. Doesn't output it anywhere; that's up to the caller.
+static void renderWindow(int32_t numSamples) {
+	memset(&renderingBuffer, 0, numSamples * sizeof(StereoSample));
 	memset(&reverbBuffer, 0, numSamples * sizeof(int32_t));
 
+	uint16_t windowStartTime = RenderProfiler::getTime();
+
 #ifdef REPORT_CPU_USAGE
 	uint16_t startTime = MTU2.TCNT_0;
 #endif
@@ -672,34 +570,24 @@ startAgain:
 			reverbAmplitudeL = reverbAmplitudeR = reverbOutputVolume;
 		}
 
-		// HPF on reverb send, cos if it has DC offset, the reverb magnifies that, and the sound farts out
+		// HPF on reverb send, cos if it has DC offset, the reverb magnifies that, and the sound farts out.
+		// Also halves it, ready for the reverb
 		{
 			int32_t* reverbSample = reverbBuffer;
 			int32_t* reverbBufferEnd = &reverbBuffer[numSamples];
 			do {
 				int32_t distanceToGoL = *reverbSample - reverbSendPostLPF;
 				reverbSendPostLPF += distanceToGoL >> 11;
-				*reverbSample -= reverbSendPostLPF;
+				*reverbSample = (*reverbSample - reverbSendPostLPF) >> 1;
 
 				reverbSample++;
 			} while (reverbSample != reverbBufferEnd);
 		}
 
 		// Mix reverb into main render
-		int32_t* reverbSample = reverbBuffer;
-		StereoSample* outputSample = renderingBuffer;
-
-		StereoSample* outputBufferEnd = renderingBuffer + numSamples;
-
-		do {
-			int32_t reverbOutL;
-			int32_t reverbOutR;
-			reverb.process(*(reverbSample++) >> 1, &reverbOutL, &reverbOutR);
-
-			outputSample->l += multiply_32x32_rshift32_rounded(reverbOutL, reverbAmplitudeL);
-			outputSample->r += multiply_32x32_rshift32_rounded(reverbOutR, reverbAmplitudeR);
-
-		} while (++outputSample != outputBufferEnd);
+		uint16_t reverbStartTime = RenderProfiler::getTime();
+		reverb.processBlock(reverbBuffer, renderingBuffer, numSamples, reverbAmplitudeL, reverbAmplitudeR);
+		RenderProfiler::stop(RenderProfiler::SECTION_REVERB, reverbStartTime);
 	}
 
 	// Previewing sample
@@ -745,12 +633,215 @@ startAgain:
 		}
 	}
 
+	uint16_t compressorStartTime = RenderProfiler::getTime();
 	mastercompressor.render(renderingBuffer, numSamples, masterVolumeAdjustmentL, masterVolumeAdjustmentR);
+	RenderProfiler::stop(RenderProfiler::SECTION_MASTER_COMPRESSOR, compressorStartTime);
 	masterVolumeAdjustmentL <<= 2;
 	masterVolumeAdjustmentR <<= 2;
 
 	metronome.render(renderingBuffer, numSamples);
 
+	uint16_t windowTicks = RenderProfiler::getTime() - windowStartTime;
+	RenderProfiler::windowRendered(numSamples, windowTicks);
+	VoiceCostModel::recordWindowRender(windowTicks, numSamples);
+}
+
+void routine() {
+	logAction("AudioDriver::routine");
+
+	if (audioRoutineLocked) {
+		logAction("AudioDriver::routine locked");
+		return; // Prevents this from being called again from inside any e.g. memory allocation routines that get called from within this!
+	}
+
+	// See if some more outputting is left over from last time to do
+	bool finishedOutputting = doSomeOutputting();
+	if (!finishedOutputting) {
+		logAction("AudioDriver::still outputting");
+		//Debug::println("still waiting");
+		return;
+	}
+
+	audioRoutineLocked = true;
+	routineBeenCalled = true;
+
+	playbackHandler.routine();
+
+	// At this point, there may be MIDI, including clocks, waiting to be sent.
+
+	GeneralMemoryAllocator::get().checkStack("AudioDriver::routine");
+
+	saddr = (uint32_t)(getTxBufferCurrentPlace());
+	uint32_t saddrPosAtStart = saddr >> (2 + NUM_MONO_OUTPUT_CHANNELS_MAGNITUDE);
+	int32_t numSamples = ((uint32_t)(saddr - i2sTXBufferPos) >> (2 + NUM_MONO_OUTPUT_CHANNELS_MAGNITUDE))
+	                     & (SSI_TX_BUFFER_NUM_SAMPLES - 1);
+	if (!numSamples) {
+		audioRoutineLocked = false;
+		return;
+	}
+
+#if AUTOMATED_TESTER_ENABLED
+	AutomatedTester::possiblyDoSomething();
+#endif
+
+	// Flush everything out of the MIDI buffer now. At this stage, it would only really have live user-triggered output and MIDI THRU in it.
+	// We want any messages like "start" to go out before we send any clocks below, and also want to give them a head-start being sent and out of the way so the clock messages can
+	// be sent on-time
+	bool anythingInMidiOutputBufferNow = midiEngine.anythingInOutputBuffer();
+	bool anythingInGateOutputBufferNow =
+	    cvEngine.gateOutputPending || cvEngine.clockOutputPending; // Not asapGateOutputPending (RUN)
+	if (anythingInMidiOutputBufferNow || anythingInGateOutputBufferNow) {
+
+		// We're only allowed to do this if the timer ISR isn't pending (i.e. we haven't enabled to timer to trigger it) - otherwise this will all get called soon anyway.
+		// I thiiiink this is 100% immune to any synchronization problems?
+		if (!isTimerEnabled(TIMER_MIDI_GATE_OUTPUT)) {
+			if (anythingInGateOutputBufferNow) {
+				cvEngine.updateGateOutputs();
+			}
+			if (anythingInMidiOutputBufferNow) {
+				midiEngine.flushMIDI();
+			}
+		}
+	}
+
+#ifdef REPORT_CPU_USAGE
+	if (numSamples < (NUM_SAMPLES_FOR_CPU_USAGE_REPORT)) {
+		audioRoutineLocked = false;
+		return;
+	}
+	numSamples = NUM_SAMPLES_FOR_CPU_USAGE_REPORT;
+	int32_t unadjustedNumSamplesBeforeLappingPlayHead = numSamples;
+#else
+
+	if (smoothedSamples < numSamples) {
+		smoothedSamples = (numSamplesLastTime + numSamples) >> 1;
+	}
+	else {
+		smoothedSamples = numSamples;
+	}
+	if (!bypassCulling) {
+		numSamplesLastTime = numSamples;
+	}
+
+	// Consider direness and culling - before increasing the number of samples
+	int32_t numSamplesLimit = 40; //storageManager.devVarC;
+	int32_t direnessThreshold = numSamplesLimit - 17;
+
+	if (smoothedSamples >= direnessThreshold) { // 20
+
+		int32_t newDireness = smoothedSamples - (direnessThreshold - 1);
+		if (newDireness > 14) {
+			newDireness = 14;
+		}
+
+		if (newDireness >= cpuDireness) {
+			cpuDireness = newDireness;
+			timeDirenessChanged = audioSampleTimer;
+		}
+
+		if (!bypassCulling) {
+			int32_t numSamplesOverLimit = smoothedSamples - numSamplesLimit;
+
+			// If it's real dire, do a proper immediate cull
+			if (numSamplesOverLimit >= 10) {
+
+				int32_t numToCull = (numSamplesOverLimit >> 3) + 1;
+
+				for (int32_t i = 0; i < numToCull; i++) {
+					cullVoice();
+				}
+
+#if ALPHA_OR_BETA_VERSION
+#if DO_AUDIO_LOG
+				definitelyLog = true;
+#endif
+				Debug::print("culled ");
+				Debug::print(numToCull);
+				Debug::print(" voices. numSamples: ");
+				Debug::print(numSamples);
+
+				Debug::print(". voices left: ");
+				Debug::println(getNumVoices());
+				logAction("hard cull");
+#endif
+			}
+
+			// Or if it's just a little bit dire, do a soft cull with fade-out
+			else if (numSamplesOverLimit >= -6) {
+#if DO_AUDIO_LOG
+				definitelyLog = true;
+#endif
+				cullVoice(false, true);
+				logAction("soft cull");
+			}
+		}
+		else {
+
+			int32_t numSamplesOverLimit = smoothedSamples - numSamplesLimit;
+			if (numSamplesOverLimit >= 0) {
+#if DO_AUDIO_LOG
+				definitelyLog = true;
+#endif
+				Debug::print("Won't cull, but numSamples is ");
+				Debug::println(numSamples);
+				logAction("skipped cull");
+			}
+		}
+	}
+
+	else if (smoothedSamples < direnessThreshold - 10) {
+
+		if ((int32_t)(audioSampleTimer - timeDirenessChanged) >= (kSampleRate >> 3)) { // Only if it's been long enough
+			timeDirenessChanged = audioSampleTimer;
+			cpuDireness--;
+			if (cpuDireness < 0) {
+				cpuDireness = 0;
+			}
+			else {
+				//Debug::print("direness: ");
+				//Debug::println(cpuDireness);
+			}
+		}
+	}
+	bool doPredictiveCull = !bypassCulling;
+	bypassCulling = false;
+
+	// Double the number of samples we're going to do - within some constraints
+	int32_t sampleThreshold = 6; // If too low, it'll lead to bigger audio windows and stuff
+	constexpr int32_t maxAdjustedNumSamples = 0.66 * SSI_TX_BUFFER_NUM_SAMPLES;
+
+	int32_t unadjustedNumSamplesBeforeLappingPlayHead = numSamples;
+
+	if (numSamples < maxAdjustedNumSamples) {
+		int32_t samplesOverThreshold = numSamples - sampleThreshold;
+		if (samplesOverThreshold > 0) {
+			samplesOverThreshold = samplesOverThreshold << 1;
+			numSamples = sampleThreshold + samplesOverThreshold;
+			numSamples = std::min(numSamples, maxAdjustedNumSamples);
+		}
+	}
+
+	// Want to round to be doing a multiple of 4 samples, so the NEON functions can be utilized most efficiently.
+	// Note - this can take numSamples up as high as SSI_TX_BUFFER_NUM_SAMPLES (currently 128).
+	if (numSamples >= 3) {
+		numSamples = (numSamples + 2) & ~3;
+	}
+
+	// Now that we know how big the window is, we can predict what it'll cost
+	if (doPredictiveCull) {
+		cullVoicesToFitPredictedCost(numSamples);
+	}
+
+#endif
+
+	numSamplesThisWindow = numSamples;
+
+	int32_t timeWithinWindowAtWhichMIDIOrGateOccurs = -1; // -1 means none
+
+	numSamples = doTicksForWindow(numSamples, &timeWithinWindowAtWhichMIDIOrGateOccurs);
+
+	renderWindow(numSamples);
+
 	// Monitoring setup
 	doMonitoring = false;
 	if (audioRecorder.recordingSource == AudioInputChannel::STEREO
@@ -878,6 +969,161 @@ startAgain:
 	audioRoutineLocked = false;
 }
 
+// Renders the current song as fast as the CPU allows, rather than at the pace the DMA consumes the output buffer,
+// timing each window and printing min / average / max render times per second of audio, and overall. Optionally
+// writes the result to a WAV file in the resample folder, so renders can be compared between firmware builds.
+// Blocks everything else until done, and doesn't output any audio while running.
+void renderOfflineBenchmark(int32_t numSeconds, int32_t windowSize, bool writeToFile) {
+	if (audioRoutineLocked) {
+		return;
+	}
+
+	windowSize = std::clamp<int32_t>(windowSize & ~3, 4, SSI_TX_BUFFER_NUM_SAMPLES);
+	uint32_t numSamplesToRender = numSeconds * kSampleRate;
+
+	SampleRecorder* recorder = NULL;
+	if (writeToFile) {
+		recorder = getNewRecorder(2, AudioRecordingFolder::RESAMPLE, AudioInputChannel::OUTPUT);
+		if (!recorder) {
+			Debug::println("offline render: couldn't create recorder");
+			return;
+		}
+	}
+
+	audioRoutineLocked = true;
+
+	// Silence the output, or the DMA will just keep looping whatever was last in its buffer
+	memset(getTxBufferStart(), 0, (uint32_t)getTxBufferEnd() - (uint32_t)getTxBufferStart());
+
+	uint32_t totalTimeUS = 0;
+	uint32_t minTimeUS = 0xFFFFFFFF;
+	uint32_t maxTimeUS = 0;
+	int32_t numWindows = 0;
+
+	uint32_t secondTimeUS = 0;
+	uint32_t secondMaxTimeUS = 0;
+	int32_t secondNumWindows = 0;
+	uint32_t samplesRenderedThisSecond = 0;
+	int32_t secondNum = 0;
+
+	uint32_t numSamplesRendered = 0;
+	while (numSamplesRendered < numSamplesToRender) {
+
+		// Let the card catch up. This isn't part of what we're measuring
+		audioFileManager.loadAnyEnqueuedClusters(128, false);
+
+		int32_t timeWithinWindowAtWhichMIDIOrGateOccurs = -1;
+		int32_t numSamples = std::min<uint32_t>(windowSize, numSamplesToRender - numSamplesRendered);
+		numSamples = doTicksForWindow(numSamples, &timeWithinWindowAtWhichMIDIOrGateOccurs);
+
+		uint16_t startTime = *TCNT[TIMER_SYSTEM_FAST];
+		renderWindow(numSamples);
+		uint16_t endTime = *TCNT[TIMER_SYSTEM_FAST];
+
+		uint32_t timeUS = fastTimerCountToUS((uint16_t)(endTime - startTime));
+		totalTimeUS += timeUS;
+		minTimeUS = std::min(minTimeUS, timeUS);
+		maxTimeUS = std::max(maxTimeUS, timeUS);
+		numWindows++;
+
+		secondTimeUS += timeUS;
+		secondMaxTimeUS = std::max(secondMaxTimeUS, timeUS);
+		secondNumWindows++;
+
+		if (recorder && recorder->status < RECORDER_STATUS_FINISHED_CAPTURING_BUT_STILL_WRITING) {
+			// Same gain staging as doSomeOutputting(), minus the dither
+			for (int32_t i = 0; i < numSamples; i++) {
+				renderingBuffer[i].l = lshiftAndSaturate<AUDIO_OUTPUT_GAIN_DOUBLINGS>(
+				    multiply_32x32_rshift32(renderingBuffer[i].l, masterVolumeAdjustmentL));
+				renderingBuffer[i].r = lshiftAndSaturate<AUDIO_OUTPUT_GAIN_DOUBLINGS>(
+				    multiply_32x32_rshift32(renderingBuffer[i].r, masterVolumeAdjustmentR));
+			}
+			recorder->feedAudio((int32_t*)renderingBuffer, numSamples);
+			recorder->cardRoutine();
+		}
+
+		sideChainHitPending = 0;
+		audioSampleTimer += numSamples;
+		numSamplesRendered += numSamples;
+
+		samplesRenderedThisSecond += numSamples;
+		if (samplesRenderedThisSecond >= kSampleRate || numSamplesRendered == numSamplesToRender) {
+			Debug::print("offline render, second ");
+			Debug::print(secondNum);
+			Debug::print(": avg uS per window: ");
+			Debug::print(secondTimeUS / secondNumWindows);
+			Debug::print(", max: ");
+			Debug::print(secondMaxTimeUS);
+			Debug::print(", voices: ");
+			Debug::println(getNumVoices());
+
+			secondNum++;
+			secondTimeUS = 0;
+			secondMaxTimeUS = 0;
+			secondNumWindows = 0;
+			samplesRenderedThisSecond = 0;
+		}
+	}
+
+	Debug::print("offline render done. windows: ");
+	Debug::print(numWindows);
+	Debug::print(", uS per window min / avg / max: ");
+	Debug::print(minTimeUS);
+	Debug::print(" / ");
+	Debug::print(totalTimeUS / numWindows);
+	Debug::print(" / ");
+	Debug::println(maxTimeUS);
+
+	// Percentage of real time it took to render. Over 100 means we couldn't have kept up on the device.
+	uint64_t audioDurationUS = (uint64_t)numSamplesRendered * 1000000 / kSampleRate;
+	Debug::print("% of real time: ");
+	Debug::println((uint64_t)totalTimeUS * 100 / audioDurationUS);
+
+	if (recorder) {
+		if (recorder->status < RECORDER_STATUS_FINISHED_CAPTURING_BUT_STILL_WRITING) {
+			recorder->endSyncedRecording(0);
+		}
+		// Nothing else is holding onto it, so let the normal card routine finish writing the file and then delete it
+		recorder->pointerHeldElsewhere = false;
+		recorder->autoDeleteWhenDone = true;
+	}
+
+	resumeOutputAfterBenchmark();
+}
+
+// After blocking the audio routine for a while, start outputting afresh from where the DMA is now, keeping the same
+// input-to-output offset as init() sets up
+void resumeOutputAfterBenchmark() {
+	saddr = (uint32_t)getTxBufferCurrentPlace();
+	i2sTXBufferPos = saddr;
+	i2sRXBufferPos = (uint32_t)getRxBufferCurrentPlace()
+	                 - ((SSI_TX_BUFFER_NUM_SAMPLES + 16) << (2 + NUM_MONO_INPUT_CHANNELS_MAGNITUDE));
+	if (i2sRXBufferPos < (uint32_t)getRxBufferStart()) {
+		i2sRXBufferPos += (SSI_RX_BUFFER_NUM_SAMPLES << (2 + NUM_MONO_INPUT_CHANNELS_MAGNITUDE));
+	}
+	renderingBufferOutputPos = renderingBufferOutputEnd;
+	bypassCulling = true;
+
+	audioRoutineLocked = false;
+}
+
+// Times individual DSP components, and checks the accuracy of the ones that approximate something, printing the
+// results. Like renderOfflineBenchmark(), blocks everything else and outputs silence until done.
+void runComponentBenchmarks() {
+	if (audioRoutineLocked) {
+		return;
+	}
+
+	audioRoutineLocked = true;
+	memset(getTxBufferStart(), 0, (uint32_t)getTxBufferEnd() - (uint32_t)getTxBufferStart());
+
+	ImpulseResponseProcessor::runBenchmark();
+	TimeStretcher::runHopSearchBenchmark();
+	Song::runReadBenchmark();
+
+	resumeOutputAfterBenchmark();
+}
+
 int32_t getNumSamplesLeftToOutputFromPreviousRender() {
 	return ((uint32_t)renderingBufferOutputEnd - (uint32_t)renderingBufferOutputPos) >> 3;
 }
@@ -1188,6 +1434,16 @@ void getMasterCompressorParamsFromSong(Song* song) {
 
 Voice* solicitVoice(Sound* forSound) {
 
+	// Go by what its Sound's other Voices cost, using the key from its last render - and if we can see that's going to
+	// put us over, make room now. If the Sound hasn't rendered yet, guess that its filters will be on if it has them
+	uint32_t costModelKey = forSound->lastCostModelKey;
+	if (!costModelKey) {
+		bool hasFilters = forSound->hasFilters();
+		costModelKey = VoiceCostModel::getConfigurationKey(forSound, hasFilters, hasFilters);
+	}
+	int32_t estimatedCost = VoiceCostModel::predictVoiceCost(costModelKey, numSamplesThisWindow);
+	cullVoicesToFitPredictedCost(numSamplesThisWindow, estimatedCost);
+
 	Voice* newVoice;
 
 	if (numSamplesLastTime >= 100 && activeVoices.getNumElements()) {
@@ -1206,7 +1462,7 @@ doCull:
 	}
 
 	else {
-		void* memory = GeneralMemoryAllocator::get().alloc(sizeof(Voice), NULL, false, true);
+		void* memory = SlabAllocator::get().alloc(sizeof(Voice));
 		if (!memory) {
 			if (activeVoices.getNumElements()) {
 				goto doCull;
@@ -1221,6 +1477,9 @@ doCull:
 
 	newVoice->assignedToSound = forSound;
 
+	newVoice->costModelKey = costModelKey;
+	newVoice->estimatedCost = estimatedCost;
+
 	uint32_t keyWords[2];
 	keyWords[0] = (uint32_t)forSound;
 	keyWords[1] = (uint32_t)newVoice;
@@ -1256,12 +1515,12 @@ void unassignVoice(Voice* voice, Sound* sound, ModelStackWithSoundFlags* modelSt
 }
 
 void disposeOfVoice(Voice* voice) {
-	if (voice >= staticVoices && voice < &staticVoices[kNumTimeStretchersStatic]) {
+	if (voice >= staticVoices && voice < &staticVoices[kNumVoicesStatic]) {
 		voice->nextUnassigned = firstUnassignedVoice;
 		firstUnassignedVoice = voice;
 	}
 	else {
-		GeneralMemoryAllocator::get().dealloc(voice);
+		SlabAllocator::get().dealloc(voice);
 	}
 }
 
@@ -1272,7 +1531,7 @@ VoiceSample* solicitVoiceSample() {
 		return toReturn;
 	}
 	else {
-		void* memory = GeneralMemoryAllocator::get().alloc(sizeof(VoiceSample), NULL, false, true);
+		void* memory = SlabAllocator::get().alloc(sizeof(VoiceSample));
 		if (!memory) {
 			return NULL;
 		}
@@ -1287,7 +1546,7 @@ void voiceSampleUnassigned(VoiceSample* voiceSample) {
 		firstUnassignedVoiceSample = voiceSample;
 	}
 	else {
-		GeneralMemoryAllocator::get().dealloc(voiceSample);
+		SlabAllocator::get().dealloc(voiceSample);
 	}
 }
 
@@ -1300,7 +1559,7 @@ TimeStretcher* solicitTimeStretcher() {
 	}
 
 	else {
-		void* memory = GeneralMemoryAllocator::get().alloc(sizeof(TimeStretcher), NULL, false, true);
+		void* memory = SlabAllocator::get().alloc(sizeof(TimeStretcher));
 		if (!memory) {
 			return NULL;
 		}
@@ -1316,7 +1575,7 @@ void timeStretcherUnassigned(TimeStretcher* timeStretcher) {
 		firstUnassignedTimeStretcher = timeStretcher;
 	}
 	else {
-		GeneralMemoryAllocator::get().dealloc(timeStretcher);
+		SlabAllocator::get().dealloc(timeStretcher);
 	}
 }
 
@@ -1408,6 +1667,9 @@ void slowRoutine() {
 		}
 	}
 
+	// Any analog delays which have started up with a user IR and need somewhere to keep their convolution state
+	ImpulseResponseProcessor::allocateWantedConvolutionStates();
+
 	// Discard any LiveInputBuffers which aren't in use
 	for (int32_t i = 0; i < 3; i++) {
 		if (liveInputBuffers[i]) {
@@ -1423,6 +1685,9 @@ void slowRoutine() {
 
 	// Go through all SampleRecorders, getting them to write etc
 	doRecorderCardRoutines();
+
+	// And with any CPU to spare, get SampleCaches filled in before the Voices that'll want them start
+	SampleCachePrerenderer::routine();
 }
 
 SampleRecorder* getNewRecorder(int32_t numChannels, AudioRecordingFolder folderID, AudioInputChannel mode,
@@ -171,6 +171,11 @@ Voice* cullVoice(bool saveVoice = false, bool justDoFastRelease = false);
 bool doSomeOutputting();
 void updateReverbParams();
 
+void renderOfflineBenchmark(int32_t numSeconds, int32_t windowSize = SSI_TX_BUFFER_NUM_SAMPLES,
+                            bool writeToFile = false);
+void resumeOutputAfterBenchmark();
+void runComponentBenchmarks();
+
 extern bool headphonesPluggedIn;
 extern bool micPluggedIn;
 extern bool lineInPluggedIn;
@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "processing/engines/voice_cost_model.h"
+#include "definitions_cxx.hpp"
+#include "processing/sound/sound.h"
+#include "util/cfunctions.h"
+
+namespace VoiceCostModel {
+
+// Direct-mapped by key hash. A configuration that gets evicted just gets re-learned from the overall average
+constexpr int32_t kNumEntries = 64;
+
+// How fast estimates follow new measurements
+constexpr float kSmoothing = 1.0f / 8;
+
+// Below this variance in window size, in samples squared, there's not enough spread to tell the fixed cost apart from
+// the per-sample one, so it's all treated as per-sample. That's still right for the window size being seen
+constexpr float kMinSamplesVariance = 16;
+
+// Fraction of real time, out of 256, that we'll plan on rendering taking
+constexpr int32_t kBudgetProportion = 218; // About 85%
+
+// Moving averages of window size and ticks, and the squared and cross terms, which is all a least-squares line fit of
+// ticks against window size needs
+struct Fit {
+	float samples;
+	float ticks;
+	float samplesSquared;
+	float samplesTimesTicks;
+
+	void record(int32_t numSamples, int32_t numTicks) {
+		float n = numSamples;
+		float t = numTicks;
+		if (!samples) {
+			samples = n;
+			ticks = t;
+			samplesSquared = n * n;
+			samplesTimesTicks = n * t;
+			return;
+		}
+		samples += (n - samples) * kSmoothing;
+		ticks += (t - ticks) * kSmoothing;
+		samplesSquared += (n * n - samplesSquared) * kSmoothing;
+		samplesTimesTicks += (n * t - samplesTimesTicks) * kSmoothing;
+	}
+
+	int32_t predict(int32_t numSamples) {
+		if (!samples) {
+			return 0;
+		}
+		float perSample = ticks / samples;
+		float fixed = 0;
+		float variance = samplesSquared - samples * samples;
+		if (variance >= kMinSamplesVariance) {
+			float slope = (samplesTimesTicks - samples * ticks) / variance;
+			float intercept = ticks - slope * samples;
+			// Noise can give a nonsense line. Only trust it if both parts come out positive
+			if (slope > 0 && intercept > 0) {
+				perSample = slope;
+				fixed = intercept;
+			}
+		}
+		return (int32_t)(fixed + perSample * numSamples);
+	}
+};
+
+struct Entry {
+	uint32_t key;
+	Fit fit;
+};
+
+Entry entries[kNumEntries];
+
+// Used for configurations we haven't measured yet
+Fit averageVoiceFit;
+
+Fit nonVoiceFit;
+
+// Sum of voice renders since the last window ended, so that can be taken out of the window's total
+uint32_t voiceTicksThisWindow = 0;
+
+int32_t budgetPerSample = 0; // 16.16 fixed point
+
+uint32_t getConfigurationKey(Sound* sound, bool doLPF, bool doHPF) {
+	uint32_t key = 1; // So that 0 never comes out as a valid key
+	key = (key << 2) | util::to_underlying(sound->synthMode);
+	key = (key << 3) | (sound->numUnison - 1);
+	key = (key << 1) | doLPF;
+	key = (key << 1) | doHPF;
+	if (doLPF) {
+		key = (key << 3) | util::to_underlying(sound->lpfMode);
+	}
+
+	for (int32_t s = 0; s < kNumSources; s++) {
+		Source* source = &sound->sources[s];
+		key = (key << 4) | util::to_underlying(source->oscType);
+
+		if (source->oscType == OscType::SAMPLE) {
+			key = (key << 1) | (source->sampleControls.interpolationMode == InterpolationMode::SMOOTH);
+		}
+	}
+
+	return key;
+}
+
+static inline Entry* getEntry(uint32_t key) {
+	return &entries[(key ^ (key >> 6) ^ (key >> 12) ^ (key >> 18)) & (kNumEntries - 1)];
+}
+
+void recordVoiceRender(uint32_t key, uint16_t ticks, int32_t numSamples) {
+	voiceTicksThisWindow += ticks;
+
+	averageVoiceFit.record(numSamples, ticks);
+
+	Entry* entry = getEntry(key);
+	if (entry->key != key) {
+		entry->key = key;
+		entry->fit.samples = 0; // Start over from this measurement
+	}
+	entry->fit.record(numSamples, ticks);
+}
+
+int32_t predictVoiceCost(uint32_t key, int32_t numSamples) {
+	Entry* entry = getEntry(key);
+	if (entry->key == key && entry->fit.samples) {
+		return entry->fit.predict(numSamples);
+	}
+	if (averageVoiceFit.samples) {
+		return averageVoiceFit.predict(numSamples);
+	}
+	// Nothing measured at all yet. Go with something pessimistic-ish, about 1/60 of real time
+	return getBudget(numSamples) >> 6;
+}
+
+void recordWindowRender(uint16_t ticks, int32_t numSamples) {
+	uint32_t nonVoiceTicks = (ticks > voiceTicksThisWindow) ? (ticks - voiceTicksThisWindow) : 0;
+	voiceTicksThisWindow = 0;
+
+	nonVoiceFit.record(numSamples, nonVoiceTicks);
+}
+
+int32_t predictNonVoiceCost(int32_t numSamples) {
+	return nonVoiceFit.predict(numSamples);
+}
+
+int32_t getBudget(int32_t numSamples) {
+	if (!budgetPerSample) {
+		// Ticks per second, times 65536, over samples per second, scaled down to our proportion
+		uint64_t ticksPerSecond = usToFastTimerCount(1000000);
+		budgetPerSample = ((ticksPerSecond << 16) / kSampleRate * kBudgetProportion) >> 8;
+	}
+	return ((int64_t)budgetPerSample * numSamples) >> 16;
+}
+
+} // namespace VoiceCostModel
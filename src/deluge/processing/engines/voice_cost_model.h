@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+class Sound;
+
+// Keeps a running measurement of what Voices cost to render, per configuration - that is, the things which make the
+// biggest difference: oscillator types, synth mode, unison, sinc vs linear interpolation and filters. Each render call
+// has a fixed overhead as well as its per-sample work, and windows vary from a few samples to 128, so costs are fitted
+// as a fixed part plus a per-sample part and predicted for the actual window size, in fast-timer ticks.
+namespace VoiceCostModel {
+
+// Only uses things known before a Voice starts, so a Voice about to be started gets the same key as its Sound's Voices
+// that are already going. Time-stretching is decided per Voice once it's playing, so it just gets averaged in
+uint32_t getConfigurationKey(Sound* sound, bool doLPF, bool doHPF);
+
+void recordVoiceRender(uint32_t key, uint16_t ticks, int32_t numSamples);
+int32_t predictVoiceCost(uint32_t key, int32_t numSamples);
+
+// Everything other than the Voices - reverb, delays, mod FX, song-level stuff and so on
+void recordWindowRender(uint16_t ticks, int32_t numSamples);
+int32_t predictNonVoiceCost(int32_t numSamples);
+
+// What we can afford for a window, leaving a bit in reserve for SD card access, UI and so on
+int32_t getBudget(int32_t numSamples);
+
+} // namespace VoiceCostModel
@@ -151,3 +151,73 @@ setupForApplyingAmplitudeWithVectors(int32x4_t& amplitudeVector, int32x4_t& ampl
 			outputBufferPos += 4;                                                                                      \
 		} while (outputBufferPos < bufferEnd);                                                                         \
 	};
+
+/// Adds up the lanes of each of 4 vectors, giving the 4 totals in one vector
+[[gnu::always_inline]] static inline int32x4_t //<
+sumLanesOfEach(int32x4_t a, int32x4_t b, int32x4_t c, int32x4_t d) {
+	int32x2_t sumsAB =
+	    vpadd_s32(vpadd_s32(vget_low_s32(a), vget_high_s32(a)), vpadd_s32(vget_low_s32(b), vget_high_s32(b)));
+	int32x2_t sumsCD =
+	    vpadd_s32(vpadd_s32(vget_low_s32(c), vget_high_s32(c)), vpadd_s32(vget_low_s32(d), vget_high_s32(d)));
+	return vcombine_s32(sumsAB, sumsCD);
+}
+
+/* Renders up to 4 unison parts of the same oscillator together, one per vector lane, and adds their sum into
+   outputBuffer. A NULL table means the crude, non-anti-aliased saw, whose value is just the phase.
+   Each lane gets its own amplitude (Q31) on top of the overall one - so unused lanes just need a 0 there. If
+   laneAmplitudesR is given, outputBuffer is stereo, and the two sets of lane amplitudes do the panning.
+   Like renderWave(), this goes 4 samples at a time so can write a little past numSamples, and it leaves the caller
+   to store the new phases. */
+template <bool crudeSaw>
+__attribute__((optimize("unroll-loops"))) static void //<
+renderUnisonWave(const int16_t* table, int32_t tableSizeMagnitude, int32_t amplitude, int32_t amplitudeIncrement,
+                 int32_t* __restrict__ outputBuffer, int32_t numSamples, uint32_t* phases,
+                 uint32_t const* phaseIncrements, int32x4_t laneAmplitudesL, int32x4_t const* laneAmplitudesR) {
+
+	int32_t* __restrict__ outputBufferPos = outputBuffer;
+	int32_t const* const bufferEnd = outputBuffer + (numSamples << (laneAmplitudesR != NULL));
+
+	int32x4_t amplitudeVector = vdupq_n_s32(amplitude);
+	int32x4_t amplitudeIncrementVector = vdupq_n_s32(amplitudeIncrement);
+
+	uint32x4_t phaseVector = vld1q_u32(phases);
+	uint32x4_t phaseIncrementVector = vld1q_u32(phaseIncrements);
+
+	do {
+		int32x4_t valuesL[4];
+		int32x4_t valuesR[4];
+
+		for (int32_t i = 0; i < 4; i++) {
+			int32x4_t valueVector;
+			if (crudeSaw) {
+				phaseVector = vaddq_u32(phaseVector, phaseIncrementVector);
+				valueVector = vreinterpretq_s32_u32(phaseVector);
+			}
+			else {
+				waveRenderingFunctionUnison(valueVector, phases, phaseIncrements, table, tableSizeMagnitude);
+			}
+
+			amplitudeVector = vaddq_s32(amplitudeVector, amplitudeIncrementVector);
+			valuesL[i] = vqdmulhq_s32(valueVector, vqdmulhq_s32(amplitudeVector, laneAmplitudesL));
+			if (laneAmplitudesR) {
+				valuesR[i] = vqdmulhq_s32(valueVector, vqdmulhq_s32(amplitudeVector, *laneAmplitudesR));
+			}
+		}
+
+		int32x4_t sumsL = sumLanesOfEach(valuesL[0], valuesL[1], valuesL[2], valuesL[3]);
+
+		if (laneAmplitudesR) {
+			int32x4_t sumsR = sumLanesOfEach(valuesR[0], valuesR[1], valuesR[2], valuesR[3]);
+			int32x4x2_t existingDataInBuffer = vld2q_s32(outputBufferPos);
+			existingDataInBuffer.val[0] = vaddq_s32(existingDataInBuffer.val[0], sumsL);
+			existingDataInBuffer.val[1] = vaddq_s32(existingDataInBuffer.val[1], sumsR);
+			vst2q_s32(outputBufferPos, existingDataInBuffer);
+			outputBufferPos += 8;
+		}
+		else {
+			int32x4_t existingDataInBuffer = vld1q_s32(outputBufferPos);
+			vst1q_s32(outputBufferPos, vaddq_s32(existingDataInBuffer, sumsL));
+			outputBufferPos += 4;
+		}
+	} while (outputBufferPos < bufferEnd);
+}
@@ -26,6 +26,7 @@
 #include "hid/led/indicator_leds.h"
 #include "hid/matrix/matrix_driver.h"
 #include "io/debug/print.h"
+#include "io/debug/render_profiler.h"
 #include "memory/general_memory_allocator.h"
 #include "model/action/action.h"
 #include "model/action/action_logger.h"
@@ -45,6 +46,7 @@
 #include "modulation/patch/patcher.h"
 #include "playback/playback_handler.h"
 #include "processing/engines/audio_engine.h"
+#include "processing/engines/voice_cost_model.h"
 #include "processing/sound/sound_instrument.h"
 #include "storage/audio/audio_file_manager.h"
 #include "storage/flash_storage.h"
@@ -113,6 +115,7 @@ Sound::Sound() : patcher(&patchableInfoForSound) {
 	lpfMode = FilterMode::TRANSISTOR_24DB; // Good for samples, I think
 
 	postReverbVolumeLastTime = -1; // Special state to make it grab the actual value the first time it's rendered
+	lastCostModelKey = 0;
 
 	// LFO
 	lfoGlobalWaveType = LFOType::TRIANGLE;
@@ -2155,6 +2158,9 @@ void Sound::render(ModelStackWithThreeMainThings* modelStack, StereoSample* outp
 		bool doneFirstVoice = false;
 		*/
 
+		uint32_t costModelKey = VoiceCostModel::getConfigurationKey(this, doLPF, doHPF);
+		lastCostModelKey = costModelKey;
+
 		int32_t ends[2];
 		AudioEngine::activeVoices.getRangeForSound(this, ends);
 		for (int32_t v = ends[0]; v < ends[1]; v++) {
@@ -2171,8 +2177,14 @@ void Sound::render(ModelStackWithThreeMainThings* modelStack, StereoSample* outp
 
 			ModelStackWithVoice* modelStackWithVoice = modelStackWithSoundFlags->addVoice(thisVoice);
 
+			uint16_t voiceStartTime = RenderProfiler::getTime();
 			bool stillGoing = thisVoice->render(modelStackWithVoice, soundBuffer, numSamples, renderingInStereo,
 			                                    applyingPanAtVoiceLevel, sourcesChanged, doLPF, doHPF, pitchAdjust);
+			uint16_t voiceTicks = RenderProfiler::getTime() - voiceStartTime;
+			RenderProfiler::record(RenderProfiler::SECTION_VOICES, voiceTicks);
+
+			thisVoice->costModelKey = costModelKey;
+			VoiceCostModel::recordVoiceRender(costModelKey, voiceTicks, numSamples);
 			if (!stillGoing) {
 				AudioEngine::activeVoices.checkVoiceExists(thisVoice, this, "E201");
 				AudioEngine::unassignVoice(thisVoice, this, modelStackWithSoundFlags);
@@ -128,6 +128,7 @@ public:
 	uint32_t modulatorRetriggerPhase[kNumModulators];
 
 	int32_t postReverbVolumeLastTime;
+	uint32_t lastCostModelKey; // From the VoiceCostModel, for Voices about to start. 0 until first rendered
 
 	uint32_t numSamplesSkippedRenderingForGlobalLFO;
 	uint32_t timeStartedSkippingRenderingModFX;
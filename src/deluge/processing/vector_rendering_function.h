@@ -58,6 +58,33 @@ waveRenderingFunctionGeneral(int32x4_t& valueVector, uint32_t& phaseTemp, int32_
 	valueVector = vqdmlal_s16(value1Big, difference, vreinterpret_s16_u16(strength2));
 }
 
+/// Like waveRenderingFunctionGeneral, but each lane is a different oscillator - e.g. a unison part - reading the same
+/// table, rather than 4 consecutive samples of one oscillator. Renders the next sample of each.
+[[gnu::always_inline]] static inline void //<
+waveRenderingFunctionUnison(int32x4_t& valueVector, uint32_t* phases, uint32_t const* phaseIncrements,
+                            const int16_t* table, int32_t tableSizeMagnitude) {
+	uint32x4_t readValue;
+	uint16x4_t strength2;
+
+	waveRenderingFunctionGeneralForLoop<0>(readValue, strength2, phases[0], phaseIncrements[0], table,
+	                                       tableSizeMagnitude);
+	waveRenderingFunctionGeneralForLoop<1>(readValue, strength2, phases[1], phaseIncrements[1], table,
+	                                       tableSizeMagnitude);
+	waveRenderingFunctionGeneralForLoop<2>(readValue, strength2, phases[2], phaseIncrements[2], table,
+	                                       tableSizeMagnitude);
+	waveRenderingFunctionGeneralForLoop<3>(readValue, strength2, phases[3], phaseIncrements[3], table,
+	                                       tableSizeMagnitude);
+
+	strength2 = vshr_n_u16(strength2, 1);
+	int16x4_t value1 = vreinterpret_s16_u16(vmovn_u32(readValue));
+	int16x4_t value2 = vreinterpret_s16_u16(vshrn_n_u32(readValue, 16));
+	int32x4_t value1Big = vshll_n_s16(value1, 16);
+
+	int16x4_t difference = vsub_s16(value2, value1);
+
+	valueVector = vqdmlal_s16(value1Big, difference, vreinterpret_s16_u16(strength2));
+}
+
 template <int i>
 [[gnu::always_inline]] static inline void //<
 waveRenderingFunctionPulseForLoopFragment(int16x4_t& rshifted, uint32x4_t& readValue, const uint32_t phase,
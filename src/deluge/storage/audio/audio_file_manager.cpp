@@ -21,11 +21,15 @@
 #include "gui/l10n/l10n.h"
 #include "hid/display/display.h"
 #include "io/debug/print.h"
+#include "io/debug/render_profiler.h"
 #include "io/midi/midi_device_manager.h"
 #include "memory/general_memory_allocator.h"
 #include "model/action/action_logger.h"
 #include "model/sample/sample.h"
+#include "model/sample/sample_analysis.h"
+#include "model/sample/sample_peak_pyramid.h"
 #include "model/sample/sample_cache.h"
+#include "model/sample/sample_perc_cache_file.h"
 #include "model/sample/sample_reader.h"
 #include "model/sample/sample_recorder.h"
 #include "playback/playback_handler.h"
@@ -1241,6 +1245,17 @@ void AudioFileManager::slowRoutine() {
 		}
 	}
 
+	else {
+		// Read or write any perc cache files that the audio routine has asked for
+		SamplePercCacheFile::routine();
+
+		// And a bit more of any background Sample analysis
+		SampleAnalysis::routine();
+
+		// And fill in a bit more of any waveform peak pyramids
+		SamplePeakPyramid::fillRoutine();
+	}
+
 	// NOTE: (Kate) There was dead code here referencing things that no longer
 	// exist (NUM_LOADED_SAMPLE_CHUNK_ALLOCATION_QUEUES, availableClusterQueues)
 	// It has been removed.
@@ -1312,10 +1327,16 @@ performActionsAndGetOut:
 			display->freezeWithError("E235"); // Cos Chris F got an E205
 		}
 
+		uint16_t loadStartTime = RenderProfiler::getTime();
+		uint32_t totalWindowTicksAtLoadStart = RenderProfiler::totalWindowTicks;
+
 		allowSomeUserActionsEvenWhenInCardRoutine = true; // Sorry!!
 		bool success = loadCluster(cluster);
 		allowSomeUserActionsEvenWhenInCardRoutine = false;
 
+		RenderProfiler::stopExcludingRendering(RenderProfiler::SECTION_CLUSTER_LOADING, loadStartTime,
+		                                       totalWindowTicksAtLoadStart);
+
 		// If that didn't work, presumably because the SD card got ejected...
 		if (!success) {
 			Debug::println("load Cluster fail");
@@ -1412,10 +1433,7 @@ void AudioFileManager::removeReasonFromCluster(Cluster* cluster, char const* err
 }
 
 bool AudioFileManager::loadingQueueHasAnyLowestPriorityElements() {
-	int32_t numElements = loadingQueue.getNumElements();
-	return (numElements
-	        && ((PriorityQueueElement*)audioFileManager.loadingQueue.getElementAddress(numElements - 1))->priorityRating
-	               == 0xFFFFFFFF);
+	return loadingQueue.hasAnyLowestPriorityElements();
 }
 
 // Caller must also set alternateAudioFileLoadPath.
@@ -34,6 +34,7 @@ Cluster::Cluster() {
 	loaded = false;
 	numReasonsHeldBySampleRecorder = 0;
 	numReasonsToBeLoaded = 0;
+	loadingQueueIndex = -1;
 	// type is not set here, set it yourself (can't remember exact reason...)
 }
 
@@ -45,6 +45,7 @@ public:
 	SampleCache* sampleCache;
 	char firstThreeBytesPreDataConversion[3];
 	bool loaded;
+	int32_t loadingQueueIndex; // Position in AudioFileManager::loadingQueue, or -1 if not in it
 
 	char dummy[CACHE_LINE_SIZE];
 
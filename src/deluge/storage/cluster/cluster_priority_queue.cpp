@@ -18,55 +18,153 @@
 #include "storage/cluster/cluster_priority_queue.h"
 #include "definitions_cxx.hpp"
 #include "io/debug/print.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/cluster/cluster.h"
 
-class Cluster;
+ClusterPriorityQueue::ClusterPriorityQueue() : ResizeableArray(sizeof(PriorityQueueElement), 32, 31) {
+	numLowestPriorityElements = 0;
+}
+
+bool ClusterPriorityQueue::comesBefore(PriorityQueueElement* a, PriorityQueueElement* b) {
+	bool aIsLowest = (a->priorityRating == 0xFFFFFFFF);
+	bool bIsLowest = (b->priorityRating == 0xFFFFFFFF);
+	if (aIsLowest != bIsLowest) {
+		return bIsLowest;
+	}
+
+	// Deadlines wrap around along with audioSampleTimer
+	int32_t deadlineDifference = (int32_t)(a->deadline - b->deadline);
+	if (deadlineDifference) {
+		return (deadlineDifference < 0);
+	}
+
+	return (a->priorityRating < b->priorityRating);
+}
+
+void ClusterPriorityQueue::placeElement(PriorityQueueElement* element, int32_t i) {
+	*getElement(i) = *element;
+	element->cluster->loadingQueueIndex = i;
+}
 
-ClusterPriorityQueue::ClusterPriorityQueue()
-    : OrderedResizeableArrayWith32bitKey(sizeof(PriorityQueueElement), 32, 31) {
+void ClusterPriorityQueue::siftUp(int32_t i) {
+	PriorityQueueElement moving = *getElement(i);
+	while (i > 0) {
+		int32_t parent = (i - 1) >> 1;
+		PriorityQueueElement* parentElement = getElement(parent);
+		if (!comesBefore(&moving, parentElement)) {
+			break;
+		}
+		placeElement(parentElement, i);
+		i = parent;
+	}
+	placeElement(&moving, i);
+}
+
+void ClusterPriorityQueue::siftDown(int32_t i) {
+	PriorityQueueElement moving = *getElement(i);
+	while (true) {
+		int32_t child = (i << 1) + 1;
+		if (child >= numElements) {
+			break;
+		}
+		if (child + 1 < numElements && comesBefore(getElement(child + 1), getElement(child))) {
+			child++;
+		}
+		PriorityQueueElement* childElement = getElement(child);
+		if (!comesBefore(childElement, &moving)) {
+			break;
+		}
+		placeElement(childElement, i);
+		i = child;
+	}
+	placeElement(&moving, i);
 }
 
 // Returns error
 int32_t ClusterPriorityQueue::add(Cluster* cluster, uint32_t priorityRating) {
-	int32_t i = insertAtKey((int32_t)cluster);
-	if (i == -1) {
-		return ERROR_INSUFFICIENT_RAM;
+	int32_t i = numElements;
+	int32_t error = insertAtIndex(i);
+	if (error) {
+		return error;
 	}
 
-	PriorityQueueElement* element = (PriorityQueueElement*)getElementAddress(i);
+	// Until told otherwise, assume it's needed right away
+	PriorityQueueElement* element = getElement(i);
 	element->priorityRating = priorityRating;
+	element->deadline = AudioEngine::audioSampleTimer;
 	element->cluster = cluster;
+	element->deadlineKnown = false;
+
+	if (priorityRating == 0xFFFFFFFF) {
+		numLowestPriorityElements++;
+	}
+
+	siftUp(i);
 	return NO_ERROR;
 }
 
+void ClusterPriorityQueue::removeAtIndex(int32_t i) {
+	PriorityQueueElement* element = getElement(i);
+	if (element->priorityRating == 0xFFFFFFFF) {
+		numLowestPriorityElements--;
+	}
+	element->cluster->loadingQueueIndex = -1;
+
+	int32_t lastIndex = numElements - 1;
+	if (i != lastIndex) {
+		PriorityQueueElement last = *getElement(lastIndex);
+		placeElement(&last, i);
+	}
+	deleteAtIndex(lastIndex);
+
+	// The element moved into the gap might belong either further up or further down
+	if (i < numElements) {
+		Cluster* moved = getElement(i)->cluster;
+		siftUp(i);
+		siftDown(moved->loadingQueueIndex);
+	}
+}
+
 Cluster* ClusterPriorityQueue::grabHead() {
 	if (!numElements) {
 		return NULL;
 	}
-	Cluster* toReturn = ((PriorityQueueElement*)getElementAddress(0))->cluster;
-	deleteAtIndex(0);
+	Cluster* toReturn = getElement(0)->cluster;
+	removeAtIndex(0);
 	return toReturn;
 }
 
 // Returns whether it was present
 bool ClusterPriorityQueue::removeIfPresent(Cluster* cluster) {
-	for (int32_t i = 0; i < numElements; i++) {
-		PriorityQueueElement* element = (PriorityQueueElement*)getElementAddress(i);
-		if (element->cluster == cluster) {
-			deleteAtIndex(i);
-			return true;
-		}
+	if (!checkPresent(cluster)) {
+		return false;
 	}
-
-	return false;
+	removeAtIndex(cluster->loadingQueueIndex);
+	return true;
 }
 
 bool ClusterPriorityQueue::checkPresent(Cluster* cluster) {
-	for (int32_t i = 0; i < numElements; i++) {
-		PriorityQueueElement* element = (PriorityQueueElement*)getElementAddress(i);
-		if (element->cluster == cluster) {
-			return true;
-		}
+	int32_t i = cluster->loadingQueueIndex;
+	return (i >= 0 && i < numElements && getElement(i)->cluster == cluster);
+}
+
+// The first deadline given replaces the "right away" one assumed when the Cluster was enqueued. After that, if more
+// than one thing is waiting on the same Cluster, whichever needs it soonest wins, so it only ever moves earlier.
+void ClusterPriorityQueue::updateDeadline(Cluster* cluster, uint32_t newDeadline) {
+	if (!checkPresent(cluster)) {
+		return;
 	}
+	int32_t i = cluster->loadingQueueIndex;
+	PriorityQueueElement* element = getElement(i);
 
-	return false;
+	if (!element->deadlineKnown) {
+		element->deadlineKnown = true;
+		element->deadline = newDeadline;
+		siftUp(i);
+		siftDown(cluster->loadingQueueIndex);
+	}
+	else if ((int32_t)(newDeadline - element->deadline) < 0) {
+		element->deadline = newDeadline;
+		siftUp(i);
+	}
 }
@@ -17,16 +17,22 @@
 
 #pragma once
 
-#include "util/container/array/ordered_resizeable_array.h"
+#include "util/container/array/resizeable_array.h"
 
 class Cluster;
 
 struct PriorityQueueElement {
 	uint32_t priorityRating;
+	uint32_t deadline; // In audioSampleTimer samples
 	Cluster* cluster;
+	bool deadlineKnown;
 };
 
-class ClusterPriorityQueue final : public OrderedResizeableArrayWith32bitKey {
+// A binary min-heap of Clusters waiting to be loaded. Clusters needed soonest (earliest deadline) come first,
+// with the priorityRating breaking ties, except that anything enqueued with the lowest rating (0xFFFFFFFF) - i.e.
+// loading in the background rather than for playback - always comes after everything else.
+// Each Cluster remembers its own index in the heap, so removing it or moving its deadline doesn't need a search.
+class ClusterPriorityQueue final : public ResizeableArray {
 public:
 	ClusterPriorityQueue();
 
@@ -34,4 +40,16 @@ public:
 	Cluster* grabHead();
 	bool removeIfPresent(Cluster* cluster);
 	bool checkPresent(Cluster* cluster);
+	void updateDeadline(Cluster* cluster, uint32_t newDeadline);
+	bool hasAnyLowestPriorityElements() { return numLowestPriorityElements != 0; }
+
+private:
+	inline PriorityQueueElement* getElement(int32_t i) { return (PriorityQueueElement*)getElementAddress(i); }
+	bool comesBefore(PriorityQueueElement* a, PriorityQueueElement* b);
+	void placeElement(PriorityQueueElement* element, int32_t i);
+	void siftUp(int32_t i);
+	void siftDown(int32_t i);
+	void removeAtIndex(int32_t i);
+
+	int32_t numLowestPriorityElements;
 };
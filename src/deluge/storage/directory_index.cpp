@@ -0,0 +1,441 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "storage/directory_index.h"
+#include "definitions_cxx.hpp"
+#include "io/debug/print.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/file_item.h"
+#include "storage/storage_manager.h"
+#include "util/container/array/c_string_array.h"
+#include "util/d_string.h"
+#include "util/functions.h"
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+extern "C" {
+FRESULT f_readdir_get_filepointer(DIR* dp, FILINFO* fno, FilePointer* filePointer);
+FRESULT f_dir_hash(DIR* dp, DWORD* hash, UINT maxEntries, UINT* numEntriesDone);
+extern DWORD DirChangeCount;
+}
+
+namespace DirectoryIndex {
+
+constexpr char const* kFileName = "DIRINDEX.IDX";
+constexpr uint32_t kFileMagic = 0x58444444; // "DDDX"
+constexpr uint8_t kFileVersion = 3;
+
+constexpr int32_t kNumEntriesToHashPerGo = 64;
+constexpr int32_t kNumCheckedFoldersToRemember = 8;
+
+struct FileHeader {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t interpretNoteNames;
+	uint16_t reserved;
+	uint32_t dirHash;
+	uint32_t numEntries;
+	// Followed by a uint32_t offset, from the start of the file, for each entry. Then the entries themselves
+};
+
+struct EntryHeader {
+	uint32_t sclust;
+	uint32_t objsize;
+	uint32_t modified;
+	uint8_t isFolder;
+	uint8_t nameLength;
+	// Followed by the name, without a null terminator
+};
+
+int32_t numEntries = 0;
+
+FIL file; // Our own, so we don't interfere with anything else that's got a file open
+bool fileOpen = false;
+
+// Folders whose index has been found to match them, and what DirChangeCount was at the time. If it's still the same,
+// nothing in any folder has changed since, so there's no need to hash the folder again
+struct CheckedFolder {
+	WORD fsID;
+	DWORD sclust;
+	DWORD dirChangeCount;
+	bool interpretNoteNames;
+};
+
+CheckedFolder checkedFolders[kNumCheckedFoldersToRemember];
+int32_t numCheckedFolders = 0;
+int32_t nextCheckedFolderToReplace = 0;
+
+CheckedFolder* findCheckedFolder(DIR* dir) {
+	for (int32_t i = 0; i < numCheckedFolders; i++) {
+		if (checkedFolders[i].fsID == dir->obj.id && checkedFolders[i].sclust == dir->obj.sclust) {
+			return &checkedFolders[i];
+		}
+	}
+	return NULL;
+}
+
+void rememberCheckedFolder(DIR* dir, bool interpretNoteNames) {
+	CheckedFolder* checkedFolder = findCheckedFolder(dir);
+	if (!checkedFolder) {
+		if (numCheckedFolders < kNumCheckedFoldersToRemember) {
+			checkedFolder = &checkedFolders[numCheckedFolders++];
+		}
+		else {
+			checkedFolder = &checkedFolders[nextCheckedFolderToReplace];
+			nextCheckedFolderToReplace = (nextCheckedFolderToReplace + 1) % kNumCheckedFoldersToRemember;
+		}
+	}
+	checkedFolder->fsID = dir->obj.id;
+	checkedFolder->sclust = dir->obj.sclust;
+	checkedFolder->dirChangeCount = DirChangeCount;
+	checkedFolder->interpretNoteNames = interpretNoteNames;
+}
+
+// Returns error
+int32_t hashDir(DIR* dir, uint32_t* hash) {
+	FRESULT result = f_readdir(dir, NULL); // Rewind
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	DWORD hashNow = 2166136261;
+	while (true) {
+		UINT numEntriesDone;
+		result = f_dir_hash(dir, &hashNow, kNumEntriesToHashPerGo, &numEntriesDone);
+		if (result != FR_OK) {
+			return fresultToDelugeErrorCode(result);
+		}
+		if (numEntriesDone < kNumEntriesToHashPerGo) {
+			break;
+		}
+		audioFileManager.loadAnyEnqueuedClusters();
+	}
+
+	*hash = hashNow;
+	return NO_ERROR;
+}
+
+// The files we keep alongside the user's own ones. They're left out of the index, and the hash doesn't see them either,
+// so previewing samples and the like doesn't mean it needs making again
+bool isIndexOrCacheFile(char const* name) {
+	static char const* const extensions[] = {".IDX", ".TMP", ".perc", ".wtcache", ".anl"};
+
+	int32_t nameLength = strlen(name);
+	for (char const* extension : extensions) {
+		int32_t extensionLength = strlen(extension);
+		if (nameLength > extensionLength && !strcasecmp(&name[nameLength - extensionLength], extension)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void emptyItems(CStringArray* items) {
+	for (int32_t i = 0; i < items->getNumElements();) {
+		FileItem* item = (FileItem*)items->getElementAddress(i);
+		item->~FileItem();
+
+		i++;
+		if (!(i & 63)) {
+			AudioEngine::routineWithClusterLoading();
+		}
+	}
+	items->empty();
+}
+
+// Reads the whole folder in, sorts it, and writes it out to the index file, which must already be open for writing.
+// Returns error
+int32_t build(DIR* dir, CStringArray* items) {
+	FRESULT result = f_readdir(dir, NULL); // Rewind
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	int32_t error = NO_ERROR;
+
+	while (true) {
+		audioFileManager.loadAnyEnqueuedClusters();
+
+		FilePointer thisFilePointer;
+		result = f_readdir_get_filepointer(dir, &staticFNO, &thisFilePointer);
+		if (result != FR_OK) {
+			return fresultToDelugeErrorCode(result);
+		}
+		if (staticFNO.fname[0] == 0) {
+			break; // End of dir
+		}
+		if (staticFNO.fname[0] == '.') {
+			continue;
+		}
+		if (isIndexOrCacheFile(staticFNO.fname)) {
+			continue;
+		}
+
+		int32_t newIndex = items->getNumElements();
+		error = items->insertAtIndex(newIndex);
+		if (error) {
+			return error;
+		}
+		FileItem* thisItem = new (items->getElementAddress(newIndex)) FileItem();
+		error = thisItem->filename.set(staticFNO.fname);
+		if (error) {
+			return error;
+		}
+		thisItem->displayName = thisItem->filename.get();
+		thisItem->isFolder = staticFNO.fattrib & AM_DIR;
+		thisItem->filePointer = thisFilePointer;
+	}
+
+	items->sortForStrings();
+
+	// Only now that the index file's own directory entry exists can we get the hash that'll match next time
+	FileHeader header;
+	header.magic = kFileMagic;
+	header.version = kFileVersion;
+	header.interpretNoteNames = shouldInterpretNoteNames;
+	header.reserved = 0;
+	header.numEntries = items->getNumElements();
+	error = hashDir(dir, &header.dirHash);
+	if (error) {
+		return error;
+	}
+
+	UINT numBytesWritten;
+	result = f_write(&file, &header, sizeof(header), &numBytesWritten);
+
+	// Offsets, a bunch at a time
+	uint32_t offset = sizeof(FileHeader) + header.numEntries * sizeof(uint32_t);
+	uint32_t offsetsBuffer[64];
+	int32_t numOffsetsInBuffer = 0;
+	for (int32_t i = 0; i < items->getNumElements() && result == FR_OK; i++) {
+		FileItem* item = (FileItem*)items->getElementAddress(i);
+		offsetsBuffer[numOffsetsInBuffer++] = offset;
+		offset += sizeof(EntryHeader) + std::min<int32_t>(item->filename.getLength(), kMaxNameLength);
+
+		if (numOffsetsInBuffer == 64 || i == items->getNumElements() - 1) {
+			result = f_write(&file, offsetsBuffer, numOffsetsInBuffer * sizeof(uint32_t), &numBytesWritten);
+			numOffsetsInBuffer = 0;
+		}
+	}
+
+	// And the entries
+	for (int32_t i = 0; i < items->getNumElements() && result == FR_OK; i++) {
+		FileItem* item = (FileItem*)items->getElementAddress(i);
+		EntryHeader entryHeader;
+		entryHeader.sclust = item->filePointer.sclust;
+		entryHeader.objsize = item->filePointer.objsize;
+		entryHeader.modified = item->filePointer.modified;
+		entryHeader.isFolder = item->isFolder;
+		entryHeader.nameLength = std::min<int32_t>(item->filename.getLength(), kMaxNameLength);
+		result = f_write(&file, &entryHeader, sizeof(entryHeader), &numBytesWritten);
+		if (result == FR_OK) {
+			result = f_write(&file, item->filename.get(), entryHeader.nameLength, &numBytesWritten);
+		}
+
+		if (!(i & 63)) {
+			audioFileManager.loadAnyEnqueuedClusters();
+		}
+	}
+
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	return NO_ERROR;
+}
+
+// Returns error
+int32_t open(char const* dirPath, DIR* dir, bool interpretNoteNames) {
+	close();
+
+	shouldInterpretNoteNames = interpretNoteNames;
+	octaveStartsFromA = false;
+
+	String filePath;
+	int32_t error = filePath.set(dirPath);
+	if (error) {
+		return error;
+	}
+	error = filePath.concatenate("/");
+	if (error) {
+		return error;
+	}
+	error = filePath.concatenate(kFileName);
+	if (error) {
+		return error;
+	}
+
+	// If we've checked this folder since anything last changed, the index we made or checked then is still good
+	FRESULT result;
+	CheckedFolder* checkedFolder = findCheckedFolder(dir);
+	if (checkedFolder && checkedFolder->dirChangeCount == DirChangeCount
+	    && checkedFolder->interpretNoteNames == interpretNoteNames) {
+		goto openForReading;
+	}
+
+	// See if there's one already, which is up to date
+	result = f_open(&file, filePath.get(), FA_READ);
+	if (result == FR_OK) {
+		FileHeader header;
+		UINT numBytesRead;
+		result = f_read(&file, &header, sizeof(header), &numBytesRead);
+		f_close(&file);
+
+		if (result == FR_OK && numBytesRead == sizeof(header) && header.magic == kFileMagic
+		    && header.version == kFileVersion && header.interpretNoteNames == interpretNoteNames) {
+			uint32_t dirHash;
+			error = hashDir(dir, &dirHash);
+			if (error) {
+				return error;
+			}
+			if (dirHash == header.dirHash) {
+				rememberCheckedFolder(dir, interpretNoteNames);
+				goto openForReading;
+			}
+		}
+	}
+
+	// Otherwise, make it again. Opening the file first means we find out straight away if the card's write-protected
+	{
+		result = f_open(&file, filePath.get(), FA_CREATE_ALWAYS | FA_WRITE);
+		if (result != FR_OK) {
+			return fresultToDelugeErrorCode(result);
+		}
+
+		Debug::print("making directory index for ");
+		Debug::println(dirPath);
+
+		CStringArray items{sizeof(FileItem)};
+		error = build(dir, &items);
+		emptyItems(&items);
+
+		result = f_close(&file);
+		if (!error && result != FR_OK) {
+			error = fresultToDelugeErrorCode(result);
+		}
+
+		// Don't leave a half-written one lying around
+		if (error) {
+			f_unlink(filePath.get());
+			return error;
+		}
+
+		rememberCheckedFolder(dir, interpretNoteNames);
+	}
+
+openForReading:
+	result = f_open(&file, filePath.get(), FA_READ);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	FileHeader header;
+	UINT numBytesRead;
+	result = f_read(&file, &header, sizeof(header), &numBytesRead);
+	if (result != FR_OK || numBytesRead != sizeof(header)) {
+		f_close(&file);
+		return ERROR_SD_CARD;
+	}
+
+	numEntries = header.numEntries;
+	fileOpen = true;
+	return NO_ERROR;
+}
+
+void close() {
+	if (fileOpen) {
+		f_close(&file);
+		fileOpen = false;
+	}
+	numEntries = 0;
+}
+
+// Returns error
+int32_t readEntry(int32_t i, Entry* entry) {
+	uint32_t offset;
+	UINT numBytesRead;
+	FRESULT result = f_lseek(&file, sizeof(FileHeader) + i * sizeof(uint32_t));
+	if (result == FR_OK) {
+		result = f_read(&file, &offset, sizeof(offset), &numBytesRead);
+	}
+	if (result != FR_OK || numBytesRead != sizeof(offset)) {
+		return ERROR_SD_CARD;
+	}
+
+	EntryHeader entryHeader;
+	result = f_lseek(&file, offset);
+	if (result == FR_OK) {
+		result = f_read(&file, &entryHeader, sizeof(entryHeader), &numBytesRead);
+	}
+	if (result != FR_OK || numBytesRead != sizeof(entryHeader)) {
+		return ERROR_SD_CARD;
+	}
+
+	result = f_read(&file, entry->name, entryHeader.nameLength, &numBytesRead);
+	if (result != FR_OK || numBytesRead != entryHeader.nameLength) {
+		return ERROR_SD_CARD;
+	}
+
+	entry->name[entryHeader.nameLength] = 0;
+	entry->isFolder = entryHeader.isFolder;
+	entry->filePointer.sclust = entryHeader.sclust;
+	entry->filePointer.objsize = entryHeader.objsize;
+	entry->filePointer.modified = entryHeader.modified;
+	return NO_ERROR;
+}
+
+// Same as CStringArray::search(). Returns error
+int32_t search(char const* name, int32_t* index, bool* foundExact) {
+	int32_t rangeBegin = 0;
+	int32_t rangeEnd = numEntries;
+
+	if (foundExact) {
+		*foundExact = false;
+	}
+
+	while (rangeBegin != rangeEnd) {
+		int32_t proposedIndex = rangeBegin + ((rangeEnd - rangeBegin) >> 1);
+
+		Entry entry;
+		int32_t error = readEntry(proposedIndex, &entry);
+		if (error) {
+			return error;
+		}
+
+		int32_t result = strcmpspecial(entry.name, name);
+		if (!result) {
+			if (foundExact) {
+				*foundExact = true;
+			}
+			rangeBegin = proposedIndex;
+			break;
+		}
+		else if (result < 0) {
+			rangeBegin = proposedIndex + 1;
+		}
+		else {
+			rangeEnd = proposedIndex;
+		}
+	}
+
+	*index = rangeBegin;
+	return NO_ERROR;
+}
+
+} // namespace DirectoryIndex
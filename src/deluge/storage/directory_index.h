@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+// A sorted list of everything in a folder, kept in a file in that folder (DIRINDEX.IDX), so the Browser can look at
+// just the few entries around where the user is, rather than reading the whole folder and sorting it each time.
+//
+// It records a hash of the folder's raw directory entries, so if anything's been added, removed or renamed - by us or
+// by a computer - it gets noticed and the index gets made again. Checking that hash still means going through the
+// directory's sectors, but none of the name-assembling, allocating or sorting that reading it properly involves. And
+// it only has to be done once after each change to the card: FatFs counts changes to directory entries, so a folder
+// that's been checked since the last one is known to still match. Index and cache files (.IDX, .perc, .wtcache,
+// .anl) don't count as changes, and aren't hashed or listed.
+namespace DirectoryIndex {
+
+constexpr int32_t kMaxNameLength = 255;
+
+struct Entry {
+	FilePointer filePointer;
+	bool isFolder;
+	char name[kMaxNameLength + 1];
+};
+
+// dir must be the already-opened folder. The sort order depends on interpretNoteNames, like CStringArray's.
+// Returns error, in which case the caller should just read the folder itself
+int32_t open(char const* dirPath, DIR* dir, bool interpretNoteNames);
+void close();
+
+// Index of the first entry that sorts at or after name. Returns error
+int32_t search(char const* name, int32_t* index, bool* foundExact = NULL);
+
+int32_t readEntry(int32_t i, Entry* entry);
+
+extern int32_t numEntries;
+
+} // namespace DirectoryIndex
@@ -0,0 +1,444 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "storage/song_index.h"
+#include "hid/led/pad_leds.h"
+#include "io/debug/print.h"
+#include "model/song/song.h"
+#include "playback/playback_handler.h"
+#include "storage/storage_manager.h"
+#include "util/container/array/resizeable_array.h"
+#include "util/d_string.h"
+#include "util/functions.h"
+#include <algorithm>
+#include <cctype>
+#include <string.h>
+
+namespace SongIndex {
+
+constexpr char const* kFileName = "SONGINFO.IDX";
+constexpr char const* kTempFileName = "SONGINFO.TMP";
+constexpr uint32_t kFileMagic = 0x49475344; // "DSGI"
+constexpr uint8_t kFileVersion = 2;
+
+struct FileHeader {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t reserved[3];
+	// Followed by the records, one after another
+};
+
+struct RecordHeader {
+	uint16_t recordSize; // Including this header
+	uint8_t nameLength;
+	uint8_t reserved;
+	uint32_t sclust;
+	uint32_t objsize;
+	uint32_t modified;
+	// Followed by the name, without a null terminator, then the Info
+};
+
+FIL file;     // Our own, so we don't interfere with anything else that's got a file open
+FIL tempFile; // For when rewriting it
+
+// Where each record is in the file, read in once per folder, so looking a song up is just one seek and read rather
+// than going through the whole file. The record itself still gets checked when it's read, in case anything's changed
+struct Entry {
+	uint32_t sclust;
+	uint32_t objsize;
+	uint32_t modified;
+	uint32_t nameHash;
+	uint32_t recordPos;
+	uint16_t recordSize;
+};
+
+ResizeableArray entries(sizeof(Entry));
+String entriesDirPath; // Which folder the entries are for. Empty if none
+FilePointer entriesFilePointer; // The index file's, so it can be opened again without looking it up in the folder
+uint16_t entriesFileSystemID;   // In case the card gets swapped
+
+// Returns error
+int32_t getFilePath(char const* dirPath, char const* fileName, String* filePath) {
+	int32_t error = filePath->set(dirPath);
+	if (error) {
+		return error;
+	}
+	error = filePath->concatenate("/");
+	if (error) {
+		return error;
+	}
+	return filePath->concatenate(fileName);
+}
+
+bool checkFileHeader(FIL* fileHere) {
+	FileHeader header;
+	UINT numBytesRead;
+	FRESULT result = f_read(fileHere, &header, sizeof(header), &numBytesRead);
+	return (result == FR_OK && numBytesRead == sizeof(header) && header.magic == kFileMagic
+	        && header.version == kFileVersion);
+}
+
+FRESULT writeFileHeader(FIL* fileHere) {
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kFileMagic;
+	header.version = kFileVersion;
+	UINT numBytesWritten;
+	return f_write(fileHere, &header, sizeof(header), &numBytesWritten);
+}
+
+FRESULT writeRecord(FIL* fileHere, char const* fileName, FilePointer const* filePointer, Info const* info) {
+	RecordHeader recordHeader;
+	recordHeader.nameLength = std::min<int32_t>(strlen(fileName), 255);
+	recordHeader.reserved = 0;
+	recordHeader.sclust = filePointer->sclust;
+	recordHeader.objsize = filePointer->objsize;
+	recordHeader.modified = filePointer->modified;
+	recordHeader.recordSize = sizeof(RecordHeader) + recordHeader.nameLength + sizeof(Info);
+
+	UINT numBytesWritten;
+	FRESULT result = f_write(fileHere, &recordHeader, sizeof(recordHeader), &numBytesWritten);
+	if (result == FR_OK) {
+		result = f_write(fileHere, fileName, recordHeader.nameLength, &numBytesWritten);
+	}
+	if (result == FR_OK) {
+		result = f_write(fileHere, info, sizeof(Info), &numBytesWritten);
+	}
+	return result;
+}
+
+// Reads the next record's header and name. Returns false if there are no more, or they can't be read
+bool readRecordHeader(FIL* fileHere, RecordHeader* recordHeader, char* name) {
+	UINT numBytesRead;
+	FRESULT result = f_read(fileHere, recordHeader, sizeof(RecordHeader), &numBytesRead);
+	if (result != FR_OK || numBytesRead != sizeof(RecordHeader)) {
+		return false;
+	}
+	if (recordHeader->recordSize < sizeof(RecordHeader) + recordHeader->nameLength) {
+		return false; // Corrupt
+	}
+	result = f_read(fileHere, name, recordHeader->nameLength, &numBytesRead);
+	if (result != FR_OK || numBytesRead != recordHeader->nameLength) {
+		return false;
+	}
+	name[recordHeader->nameLength] = 0;
+	return true;
+}
+
+uint32_t hashName(char const* name) {
+	uint32_t hash = 2166136261;
+	for (; *name; name++) {
+		hash = (hash ^ (uint8_t)tolower(*name)) * 16777619;
+	}
+	return hash;
+}
+
+void close() {
+	entries.empty();
+	entriesDirPath.clear();
+}
+
+// Opens the index file for the folder the entries are for, reading them in first if they're for some other folder.
+// Returns whether it's open, in which case there might still be no entries
+bool openForReading(char const* dirPath) {
+	if (!strcmp(entriesDirPath.get(), dirPath) && entriesFileSystemID == fileSystemStuff.fileSystem.id) {
+		if (!entriesFilePointer.sclust) {
+			return false; // We already know there's no file, or nothing in it
+		}
+
+		// Same as StorageManager::openFilePointer(), to save looking it up in the folder again
+		file.obj.sclust = entriesFilePointer.sclust;
+		file.obj.objsize = entriesFilePointer.objsize;
+		file.obj.fs = &fileSystemStuff.fileSystem;
+		file.obj.id = fileSystemStuff.fileSystem.id;
+		file.flag = FA_READ;
+		file.err = 0;
+		file.sect = 0;
+		file.fptr = 0;
+		return true;
+	}
+
+	close();
+	if (entriesDirPath.set(dirPath)) {
+		return false;
+	}
+	entriesFileSystemID = fileSystemStuff.fileSystem.id;
+	entriesFilePointer.sclust = 0;
+
+	String indexFilePath;
+	if (getFilePath(dirPath, kFileName, &indexFilePath)) {
+		entriesDirPath.clear();
+		return false;
+	}
+	if (f_open(&file, indexFilePath.get(), FA_READ) != FR_OK) {
+		return false;
+	}
+	entriesFilePointer.sclust = file.obj.sclust;
+	entriesFilePointer.objsize = file.obj.objsize;
+
+	if (checkFileHeader(&file)) {
+		RecordHeader recordHeader;
+		char name[256];
+		while (true) {
+			FSIZE_t recordPos = f_tell(&file);
+			if (!readRecordHeader(&file, &recordHeader, name)) {
+				break;
+			}
+
+			// If we run out of RAM, the songs after this will just get looked at the slow way, from their XML files
+			int32_t i = entries.getNumElements();
+			if (entries.insertAtIndex(i)) {
+				break;
+			}
+			Entry* entry = (Entry*)entries.getElementAddress(i);
+			entry->sclust = recordHeader.sclust;
+			entry->objsize = recordHeader.objsize;
+			entry->modified = recordHeader.modified;
+			entry->nameHash = hashName(name);
+			entry->recordPos = recordPos;
+			entry->recordSize = recordHeader.recordSize;
+
+			if (f_lseek(&file, recordPos + recordHeader.recordSize) != FR_OK) {
+				break;
+			}
+		}
+	}
+	f_lseek(&file, 0);
+	return true;
+}
+
+bool find(char const* dirPath, char const* fileName, FilePointer const* filePointer, Info* info) {
+	if (!openForReading(dirPath)) {
+		return false;
+	}
+
+	bool found = false;
+	uint32_t nameHash = hashName(fileName);
+	for (int32_t i = entries.getNumElements() - 1; i >= 0; i--) { // Newest first
+		Entry* entry = (Entry*)entries.getElementAddress(i);
+		if (entry->sclust != filePointer->sclust || entry->objsize != filePointer->objsize
+		    || entry->modified != filePointer->modified || entry->nameHash != nameHash) {
+			continue;
+		}
+
+		RecordHeader recordHeader;
+		char name[256];
+		if (f_lseek(&file, entry->recordPos) != FR_OK || !readRecordHeader(&file, &recordHeader, name)
+		    || recordHeader.sclust != filePointer->sclust || recordHeader.objsize != filePointer->objsize
+		    || recordHeader.modified != filePointer->modified || strcasecmp(name, fileName)) {
+			break; // File's changed since we read it in
+		}
+
+		if (recordHeader.recordSize == sizeof(RecordHeader) + recordHeader.nameLength + sizeof(Info)) {
+			UINT numBytesRead;
+			FRESULT result = f_read(&file, info, sizeof(Info), &numBytesRead);
+			found = (result == FR_OK && numBytesRead == sizeof(Info));
+		}
+		break;
+	}
+
+	f_close(&file);
+	return found;
+}
+
+void add(char const* dirPath, char const* fileName, FilePointer const* filePointer, Info const* info) {
+	String indexFilePath;
+	if (getFilePath(dirPath, kFileName, &indexFilePath)) {
+		return;
+	}
+
+	// Make sure we know what's in there already
+	if (openForReading(dirPath)) {
+		f_close(&file);
+	}
+
+	FRESULT result = f_open(&file, indexFilePath.get(), FA_OPEN_APPEND | FA_WRITE | FA_READ);
+	if (result != FR_OK) {
+		return;
+	}
+
+	if (!f_size(&file)) {
+		result = writeFileHeader(&file);
+		entries.empty();
+	}
+	else {
+		f_lseek(&file, 0);
+		if (!checkFileHeader(&file)) {
+			// Something else, or an older version. Start it again
+			f_lseek(&file, 0);
+			f_truncate(&file);
+			result = writeFileHeader(&file);
+			entries.empty();
+		}
+	}
+
+	// If there's an out-of-date record for the same file (which will be the same size), write over that, so the file
+	// doesn't keep growing each time a song gets changed on a computer. Otherwise just stick it on the end
+	uint32_t nameHash = hashName(fileName);
+	uint16_t recordSize = sizeof(RecordHeader) + std::min<int32_t>(strlen(fileName), 255) + sizeof(Info);
+	Entry* entry = NULL;
+	for (int32_t i = 0; i < entries.getNumElements(); i++) {
+		Entry* entryHere = (Entry*)entries.getElementAddress(i);
+		if (entryHere->nameHash == nameHash && entryHere->recordSize == recordSize) {
+			RecordHeader recordHeader;
+			char name[256];
+			if (f_lseek(&file, entryHere->recordPos) == FR_OK && readRecordHeader(&file, &recordHeader, name)
+			    && recordHeader.recordSize == recordSize && !strcasecmp(name, fileName)) {
+				entry = entryHere;
+			}
+			break;
+		}
+	}
+
+	FSIZE_t recordPos = entry ? entry->recordPos : f_size(&file);
+	if (result == FR_OK) {
+		result = f_lseek(&file, recordPos);
+	}
+	if (result == FR_OK) {
+		result = writeRecord(&file, fileName, filePointer, info);
+	}
+
+	if (result == FR_OK && !entry) {
+		int32_t i = entries.getNumElements();
+		if (!entries.insertAtIndex(i)) {
+			entry = (Entry*)entries.getElementAddress(i);
+		}
+	}
+	if (result == FR_OK && entry) {
+		entry->sclust = filePointer->sclust;
+		entry->objsize = filePointer->objsize;
+		entry->modified = filePointer->modified;
+		entry->nameHash = nameHash;
+		entry->recordPos = recordPos;
+		entry->recordSize = recordSize;
+	}
+
+	entriesFilePointer.sclust = file.obj.sclust;
+	entriesFilePointer.objsize = file.obj.objsize;
+	FRESULT closeResult = f_close(&file);
+	if (result == FR_OK) {
+		result = closeResult;
+	}
+
+	if (result != FR_OK) {
+		close(); // Don't know what's in the file now, so read it in again next time
+		Debug::println("couldn't add to song index");
+	}
+}
+
+void getInfoForCurrentSong(Info* info) {
+	memcpy(info->preview, PadLEDs::imageStore, sizeof(info->preview)); // Same as Song::writeToFile() saves
+	info->flags = SONG_INFO_HAS_METADATA;
+	info->presetScale = currentSong->getCurrentPresetScale();
+	info->rootNote = currentSong->rootNote;
+	info->tempoBPM = playbackHandler.calculateBPM(currentSong->getTimePerTimerTickFloat());
+}
+
+void songSaved(char const* dirPath, char const* filePath) {
+	// The FilePointer the song browser will have for it
+	FilePointer filePointer;
+	FILINFO fileInfo;
+	FRESULT result = f_stat(filePath, &fileInfo);
+	if (result != FR_OK) {
+		return;
+	}
+	filePointer.modified = (DWORD)fileInfo.fdate << 16 | fileInfo.ftime;
+	result = f_open(&file, filePath, FA_READ);
+	if (result != FR_OK) {
+		return;
+	}
+	filePointer.sclust = file.obj.sclust;
+	filePointer.objsize = file.obj.objsize;
+	f_close(&file);
+
+	char const* fileName = getFileNameFromEndOfPath(filePath);
+
+	Info info;
+	getInfoForCurrentSong(&info);
+
+	String indexFilePath;
+	String tempFilePath;
+	if (getFilePath(dirPath, kFileName, &indexFilePath) || getFilePath(dirPath, kTempFileName, &tempFilePath)) {
+		return;
+	}
+
+	// Write a new file, with all the old records except any for this song, then the new record
+	result = f_open(&tempFile, tempFilePath.get(), FA_CREATE_ALWAYS | FA_WRITE);
+	if (result != FR_OK) {
+		return;
+	}
+	result = writeFileHeader(&tempFile);
+
+	if (result == FR_OK && f_open(&file, indexFilePath.get(), FA_READ) == FR_OK) {
+		if (checkFileHeader(&file)) {
+			RecordHeader recordHeader;
+			char name[256];
+			while (result == FR_OK && readRecordHeader(&file, &recordHeader, name)) {
+				int32_t bytesLeft = recordHeader.recordSize - sizeof(RecordHeader) - recordHeader.nameLength;
+				if (!strcasecmp(name, fileName)) {
+					if (f_lseek(&file, f_tell(&file) + bytesLeft) != FR_OK) {
+						break;
+					}
+					continue;
+				}
+
+				UINT numBytesWritten;
+				result = f_write(&tempFile, &recordHeader, sizeof(RecordHeader), &numBytesWritten);
+				if (result == FR_OK) {
+					result = f_write(&tempFile, name, recordHeader.nameLength, &numBytesWritten);
+				}
+
+				// Copy the rest across a bit at a time
+				while (result == FR_OK && bytesLeft > 0) {
+					uint8_t buffer[128];
+					UINT numBytesRead;
+					result = f_read(&file, buffer, std::min<int32_t>(bytesLeft, sizeof(buffer)), &numBytesRead);
+					if (result == FR_OK && !numBytesRead) {
+						result = FR_INT_ERR; // Record got cut off
+					}
+					if (result == FR_OK) {
+						result = f_write(&tempFile, buffer, numBytesRead, &numBytesWritten);
+						bytesLeft -= numBytesRead;
+					}
+				}
+			}
+		}
+		f_close(&file);
+	}
+
+	if (result == FR_OK) {
+		result = writeRecord(&tempFile, fileName, &filePointer, &info);
+	}
+
+	FRESULT closeResult = f_close(&tempFile);
+	if (result == FR_OK) {
+		result = closeResult;
+	}
+
+	close(); // It'll get read in again if the user goes browsing
+
+	if (result != FR_OK) {
+		f_unlink(tempFilePath.get());
+		Debug::println("couldn't update song index");
+		return;
+	}
+
+	f_unlink(indexFilePath.get()); // Might not exist - that's fine
+	f_rename(tempFilePath.get(), indexFilePath.get());
+}
+
+} // namespace SongIndex
@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "definitions_cxx.hpp"
+#include <cstdint>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+#define SONG_INFO_HAS_METADATA 1 // If not, only the preview is valid
+
+// What the song browser wants to know about each song, kept in a file in the song's folder (SONGINFO.IDX), so it
+// doesn't have to go and parse the song's XML file every time the user scrolls past it.
+//
+// Each song gets a record when it's saved. Songs that haven't been saved since this existed get a preview-only record
+// the first time they're previewed. Records are checked against the song file's first cluster, size and modified
+// date, so one that's out of date just gets ignored. A save by us always rewrites the record anyway. A computer that
+// edits a song in place without changing its size still gives it a new date (we've no clock, so ours are all 0).
+namespace SongIndex {
+
+struct Info {
+	uint8_t preview[kDisplayHeight][kDisplayWidth + kSideBarWidth][3]; // As stored in the song - not greyed out
+	uint8_t flags;
+	uint8_t presetScale; // As Song::getCurrentPresetScale() - 255 if none of them
+	int16_t rootNote;
+	float tempoBPM;
+};
+
+// fileName is as it is in the folder, with extension, and filePointer as the browser got it from the folder, date
+// and all. Returns whether a valid record was found. The first time for each folder, this reads in where everything
+// is in the index file, and keeps that until close()
+bool find(char const* dirPath, char const* fileName, FilePointer const* filePointer, Info* info);
+
+// For when we've had to get the info some other way
+void add(char const* dirPath, char const* fileName, FilePointer const* filePointer, Info const* info);
+
+// Call once currentSong has been saved to filePath, which must be in dirPath. Records everything about it,
+// replacing any older record for that file
+void songSaved(char const* dirPath, char const* filePath);
+
+// Frees what find() read in. Call when leaving the song browser
+void close();
+
+} // namespace SongIndex
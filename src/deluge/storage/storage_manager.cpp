@@ -192,9 +192,67 @@ char stringBuffer[kFilenameBufferSize] __attribute__((aligned(CACHE_LINE_SIZE)))
 #define PAST_EQUALS_SIGN 5
 #define IN_ATTRIBUTE_VALUE 6
 
+#define XML_CHAR_WHITESPACE 1
+#define XML_CHAR_ENDS_TAG_NAME 2
+#define XML_CHAR_ENDS_ATTRIBUTE_NAME 4
+
+struct XMLCharClassTable {
+	constexpr XMLCharClassTable() : classes() {
+		for (char c : {' ', '\r', '\n', '\t'}) {
+			classes[(uint8_t)c] = XML_CHAR_WHITESPACE | XML_CHAR_ENDS_TAG_NAME | XML_CHAR_ENDS_ATTRIBUTE_NAME;
+		}
+		for (char c : {'/', '?', '>'}) {
+			classes[(uint8_t)c] |= XML_CHAR_ENDS_TAG_NAME;
+		}
+		for (char c : {'=', '>'}) {
+			classes[(uint8_t)c] |= XML_CHAR_ENDS_ATTRIBUTE_NAME;
+		}
+	}
+	uint8_t classes[256];
+};
+
+constexpr XMLCharClassTable xmlCharClasses;
+
+// Every char that can end a tag or attribute name is below 0x40, whereas names are mostly letters, so we can rule
+// out 4 chars at a time by checking whether any byte in the word is below that.
+#define WORD_HAS_BYTE_BELOW_0X40(word) (((word)-0x40404040) & ~(word)&0x80808080)
+
+// Returns the position in the read buffer of the first char of the given class(es), or currentReadBufferEndPos (or
+// fileBufferCurrentPos if that's somehow further along) if there isn't one before the buffer ends.
+int32_t StorageManager::findCharOfClassInReadBuffer(uint8_t charClass) {
+	int32_t pos = fileBufferCurrentPos;
+	int32_t endPos = currentReadBufferEndPos;
+
+	while (pos < endPos) {
+		if (!((uint32_t)&fileClusterBuffer[pos] & 3) && pos + 4 <= endPos) {
+			uint32_t word = *(uint32_t*)&fileClusterBuffer[pos];
+			if (!WORD_HAS_BYTE_BELOW_0X40(word)) {
+				pos += 4;
+				continue;
+			}
+		}
+		if (xmlCharClasses.classes[(uint8_t)fileClusterBuffer[pos]] & charClass) {
+			break;
+		}
+		pos++;
+	}
+
+	return pos;
+}
+
+// Same deal, but for one specific char - newlib's memchr() does the word-at-a-time thing for us
+int32_t StorageManager::findCharInReadBuffer(char endChar, int32_t endPos) {
+	int32_t numBytesToSearch = endPos - fileBufferCurrentPos;
+	if (numBytesToSearch <= 0) {
+		return fileBufferCurrentPos;
+	}
+	char* found = (char*)memchr(&fileClusterBuffer[fileBufferCurrentPos], endChar, numBytesToSearch);
+	return found ? (found - fileClusterBuffer) : endPos;
+}
+
 // Only call this if IN_TAG_NAME
-// TODO: this is very sub-optimal and still calls readCharXML()
 char const* StorageManager::readTagName() {
+	int32_t charPos;
 
 	if (false) {
 skipToNextTag:
@@ -202,50 +260,72 @@ skipToNextTag:
 		skipUntilChar('<');
 	}
 
-	char thisChar;
-	int32_t charPos = 0;
+	charPos = 0;
 
-	while (readCharXML(&thisChar)) {
-		switch (thisChar) {
-		case '/':
-			goto skipPastRest;
+	do {
+		int32_t bufferPosAtStart = fileBufferCurrentPos;
+		fileBufferCurrentPos = findCharOfClassInReadBuffer(XML_CHAR_ENDS_TAG_NAME);
 
-		case ' ':
-		case '\r':
-		case '\n':
-		case '\t':
-			xmlArea = IN_TAG_PAST_NAME;
-			goto getOut;
+		int32_t numCharsHere = fileBufferCurrentPos - bufferPosAtStart;
+		if (numCharsHere > 0 && !charPos) {
+			tagDepthFile++;
+		}
 
-		case '?':
-			goto skipToNextTag;
+		if (fileBufferCurrentPos < currentReadBufferEndPos) {
+			char thisChar = fileClusterBuffer[fileBufferCurrentPos];
 
-		case '>':
-			xmlArea = BETWEEN_TAGS;
-			goto getOut;
+			switch (thisChar) {
+			case '?':
+				fileBufferCurrentPos++;
+				goto skipToNextTag;
 
-		default:
-			if (!charPos) {
-				tagDepthFile++;
+			case '/':
+				tagDepthFile--;
+				break;
+
+			case '>':
+				xmlArea = BETWEEN_TAGS;
+				break;
+
+			default: // Whitespace
+				xmlArea = IN_TAG_PAST_NAME;
 			}
 
-			// Store this character, if space in our un-ideal buffer
-			if (charPos < kFilenameBufferSize - 1) {
-				stringBuffer[charPos++] = thisChar;
+			// If the whole name was in this one buffer, we can just return a pointer to it right there
+			if (!charPos && thisChar != '/') {
+				fileClusterBuffer[fileBufferCurrentPos] = 0; // NULL end of the string we're returning
+				fileBufferCurrentPos++;                      // Gets us past the endChar
+				xmlReadDone();
+				return &fileClusterBuffer[bufferPosAtStart];
 			}
 		}
-	}
 
-getOut:
-	xmlReadDone();
+		// Otherwise, copy as much as fits in our un-ideal buffer. This also has to happen for a '/', because
+		// skipUntilChar() below might load the next cluster over the top of the name
+		int32_t numCharsToCopy = std::min<int32_t>(numCharsHere, kFilenameBufferSize - 1 - charPos);
+		if (numCharsToCopy > 0) {
+			memcpy(&stringBuffer[charPos], &fileClusterBuffer[bufferPosAtStart], numCharsToCopy);
+			charPos += numCharsToCopy;
+		}
 
-	if (false) {
-skipPastRest:
-		tagDepthFile--;
-		skipUntilChar('>');
-		xmlArea = BETWEEN_TAGS;
-	}
+		if (fileBufferCurrentPos < currentReadBufferEndPos) {
+			if (fileClusterBuffer[fileBufferCurrentPos] == '/') {
+				skipUntilChar('>');
+				xmlArea = BETWEEN_TAGS;
+			}
+			else {
+				fileBufferCurrentPos++; // Gets us past the endChar
+				xmlReadDone();
+			}
+			goto getOut;
+		}
+
+	} while (fileBufferCurrentPos >= currentReadBufferEndPos && readXMLFileClusterIfNecessary());
+
+	// If here, file ended
+	xmlReadDone();
 
+getOut:
 	stringBuffer[charPos] = 0;
 	return stringBuffer;
 }
@@ -253,33 +333,38 @@ skipPastRest:
 // Only call when IN_TAG_PAST_NAME
 char const* StorageManager::readNextAttributeName() {
 
-	char thisChar;
 	int32_t charPos = 0;
 
-	while (readCharXML(&thisChar)) {
-		switch (thisChar) {
-		case ' ':
-		case '\r':
-		case '\n':
-		case '\t':
-			break;
+	// Skip any whitespace
+	do {
+		while (fileBufferCurrentPos < currentReadBufferEndPos) {
+			char thisChar = fileClusterBuffer[fileBufferCurrentPos];
+			if (xmlCharClasses.classes[(uint8_t)thisChar] & XML_CHAR_WHITESPACE) {
+				fileBufferCurrentPos++;
+				continue;
+			}
 
-		case '/':
-			tagDepthFile--;
-			skipUntilChar('>');
-			// No break
+			switch (thisChar) {
+			case '/':
+				fileBufferCurrentPos++;
+				tagDepthFile--;
+				skipUntilChar('>');
+				xmlArea = BETWEEN_TAGS;
+				goto noMoreAttributes;
 
-		case '>':
-			xmlArea = BETWEEN_TAGS;
-			// No break
+			case '>':
+				xmlArea = BETWEEN_TAGS;
+				// No break
 
-		case '<': // This is an error - there definitely shouldn't be a '<' inside a tag! TODO: make way to return error
-			goto noMoreAttributes;
+			case '<': // This is an error - there definitely shouldn't be a '<' inside a tag! TODO: make way to return error
+				fileBufferCurrentPos++;
+				goto noMoreAttributes;
 
-		default:
-			goto doReadName;
+			default:
+				goto doReadName;
+			}
 		}
-	}
+	} while (fileBufferCurrentPos >= currentReadBufferEndPos && readXMLFileClusterIfNecessary());
 
 noMoreAttributes:
 	return "";
@@ -289,24 +374,16 @@ noMoreAttributes:
 doReadName:
 	xmlArea = IN_ATTRIBUTE_NAME;
 	tagDepthFile++;
-	fileBufferCurrentPos--; // This means we don't need to call readXMLFileClusterIfNecessary()
 
 	bool haveReachedNameEnd = false;
 
 	// This is basically copied and tweaked from readUntilChar()
 	do {
 		int32_t bufferPosAtStart = fileBufferCurrentPos;
-		while (fileBufferCurrentPos < currentReadBufferEndPos) {
-			char thisChar = fileClusterBuffer[fileBufferCurrentPos];
-
-			switch (thisChar) {
-			case ' ':
-			case '\r':
-			case '\n':
-			case '\t':
-				xmlArea = PAST_ATTRIBUTE_NAME;
-				goto reachedNameEnd;
+		fileBufferCurrentPos = findCharOfClassInReadBuffer(XML_CHAR_ENDS_ATTRIBUTE_NAME);
 
+		if (fileBufferCurrentPos < currentReadBufferEndPos) {
+			switch (fileClusterBuffer[fileBufferCurrentPos]) {
 			case '=':
 				xmlArea = PAST_EQUALS_SIGN;
 				goto reachedNameEnd;
@@ -317,9 +394,11 @@ doReadName:
 				goto noMoreAttributes;
 
 				// TODO: a '/' should get us outta here too...
-			}
 
-			fileBufferCurrentPos++;
+			default: // Whitespace
+				xmlArea = PAST_ATTRIBUTE_NAME;
+				goto reachedNameEnd;
+			}
 		}
 
 		if (false) {
@@ -349,7 +428,7 @@ reachedNameEnd:
 			return stringBuffer;
 		}
 
-	} while (fileBufferCurrentPos == currentReadBufferEndPos && readXMLFileClusterIfNecessary());
+	} while (fileBufferCurrentPos >= currentReadBufferEndPos && readXMLFileClusterIfNecessary());
 
 	// If here, file ended
 	return "";
@@ -524,10 +603,7 @@ void StorageManager::skipUntilChar(char endChar) {
 	readXMLFileClusterIfNecessary(); // Does this need to be here? Originally I didn't have it...
 
 	do {
-		while (fileBufferCurrentPos < currentReadBufferEndPos && fileClusterBuffer[fileBufferCurrentPos] != endChar) {
-			fileBufferCurrentPos++;
-		}
-
+		fileBufferCurrentPos = findCharInReadBuffer(endChar, currentReadBufferEndPos);
 	} while (fileBufferCurrentPos == currentReadBufferEndPos && readXMLFileClusterIfNecessary());
 
 	fileBufferCurrentPos++; // Gets us past the endChar
@@ -541,10 +617,7 @@ int32_t StorageManager::readStringUntilChar(String* string, char endChar) {
 	int32_t newStringPos = 0;
 
 	do {
-		int32_t bufferPosNow = fileBufferCurrentPos;
-		while (bufferPosNow < currentReadBufferEndPos && fileClusterBuffer[bufferPosNow] != endChar) {
-			bufferPosNow++;
-		}
+		int32_t bufferPosNow = findCharInReadBuffer(endChar, currentReadBufferEndPos);
 
 		int32_t numCharsHere = bufferPosNow - fileBufferCurrentPos;
 
@@ -574,9 +647,7 @@ char const* StorageManager::readUntilChar(char endChar) {
 
 	do {
 		int32_t bufferPosAtStart = fileBufferCurrentPos;
-		while (fileBufferCurrentPos < currentReadBufferEndPos && fileClusterBuffer[fileBufferCurrentPos] != endChar) {
-			fileBufferCurrentPos++;
-		}
+		fileBufferCurrentPos = findCharInReadBuffer(endChar, currentReadBufferEndPos);
 
 		// If possible, just return a pointer to the chars within the existing buffer
 		if (!charPos && fileBufferCurrentPos < currentReadBufferEndPos) {
@@ -618,11 +689,9 @@ char const* StorageManager::readNextCharsOfTagOrAttributeValue(int32_t numChars)
 
 		int32_t currentReadBufferEndPosNow = std::min<int32_t>(currentReadBufferEndPos, bufferPosAtEnd);
 
-		while (fileBufferCurrentPos < currentReadBufferEndPosNow) {
-			if (fileClusterBuffer[fileBufferCurrentPos] == charAtEndOfValue) {
-				goto reachedEndCharEarly;
-			}
-			fileBufferCurrentPos++;
+		fileBufferCurrentPos = findCharInReadBuffer(charAtEndOfValue, currentReadBufferEndPosNow);
+		if (fileBufferCurrentPos < currentReadBufferEndPosNow) {
+			goto reachedEndCharEarly;
 		}
 
 		int32_t numCharsHere = fileBufferCurrentPos - bufferPosAtStart;
@@ -686,33 +755,34 @@ char StorageManager::readNextCharOfTagOrAttributeValue() {
 // Will always skip up until the end-char, even if it doesn't like the contents it sees
 int32_t StorageManager::readIntUntilChar(char endChar) {
 	uint32_t number = 0;
-	char thisChar;
-
-	if (!readCharXML(&thisChar)) {
-		return 0;
-	}
+	bool isNegative = false;
+	bool isFirstChar = true;
 
-	bool isNegative = (thisChar == '-');
-	if (!isNegative) {
-		goto readDigit;
-	}
+	// Parse straight out of the buffer rather than going through readCharXML() for every digit
+	do {
+		while (fileBufferCurrentPos < currentReadBufferEndPos) {
+			char thisChar = fileClusterBuffer[fileBufferCurrentPos++];
 
-	while (readCharXML(&thisChar)) {
-readDigit:
-		if (!(thisChar >= '0' && thisChar <= '9')) {
-			goto getOut;
-		}
-		number *= 10;
-		number += (thisChar - '0');
-	}
+			if (isFirstChar) {
+				isFirstChar = false;
+				if (thisChar == '-') {
+					isNegative = true;
+					continue;
+				}
+			}
 
-	if (false) {
-getOut:
-		if (thisChar != endChar) {
-			skipUntilChar(endChar);
+			if (!(thisChar >= '0' && thisChar <= '9')) {
+				if (thisChar != endChar) {
+					skipUntilChar(endChar);
+				}
+				goto gotNumber;
+			}
+			number *= 10;
+			number += (thisChar - '0');
 		}
-	}
+	} while (fileBufferCurrentPos >= currentReadBufferEndPos && readXMLFileClusterIfNecessary());
 
+gotNumber:
 	if (isNegative) {
 		if (number >= 2147483648) {
 			return -2147483648;
@@ -807,12 +877,7 @@ int32_t StorageManager::readTagOrAttributeValueString(String* string) {
 
 int32_t StorageManager::getNumCharsRemainingInValue() {
 
-	int32_t pos = fileBufferCurrentPos;
-	while (pos < currentReadBufferEndPos && fileClusterBuffer[pos] != charAtEndOfValue) {
-		pos++;
-	}
-
-	return pos - fileBufferCurrentPos;
+	return findCharInReadBuffer(charAtEndOfValue, currentReadBufferEndPos) - fileBufferCurrentPos;
 }
 
 // Returns whether we're all good to go
@@ -141,6 +141,8 @@ private:
 	int32_t xmlReadCount;
 
 	void skipUntilChar(char endChar);
+	int32_t findCharOfClassInReadBuffer(uint8_t charClass);
+	int32_t findCharInReadBuffer(char endChar, int32_t endPos);
 	char const* readTagName();
 	char const* readNextAttributeName();
 	char const* readUntilChar(char endChar);
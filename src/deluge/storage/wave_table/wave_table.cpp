@@ -31,6 +31,7 @@
 #include "storage/storage_manager.h"
 #include "storage/wave_table/wave_table_reader.h"
 #include <new>
+#include <string.h>
 
 extern int32_t oscSyncRenderingBuffer[];
 
@@ -136,6 +137,224 @@ void dft_r2c(ne10_fft_cpx_int32_t* __restrict__ out, int32_t const* __restrict__
 #define WAVETABLE_NUM_DUPLICATE_SAMPLES_AT_END_OF_CYCLE 7 // That's in samples - it'll be twice as many bytes.
 #define SHOULD_DISCARD_WAVETABLE_DATA_WITH_INSUFFICIENT_HF_CONTENT 0
 
+// Setting up a WaveTable means a load of FFTs for every cycle, which for big WaveTables takes much longer than just
+// reading the results off the card. So once it's done, we write the bands out to a file next to the audio file, e.g.
+// "SAMPLES/WAVETABLE/SAW.WAV.wtcache", and next time just read them back in. The header records enough about the audio
+// file that if it's changed at all, we'll notice and set it up the slow way again, then overwrite the cache file.
+
+#define WAVETABLE_CACHE_FILE_MAGIC 0x43545744 // "DWTC"
+#define WAVETABLE_CACHE_FILE_VERSION 1
+#define WAVETABLE_CACHE_FILE_MAX_NUM_BANDS 16 // Cycles can't be anywhere near big enough to need this many
+
+struct WaveTableCacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t audioFileSize;
+	uint32_t audioFileDateTime;
+	uint32_t audioDataStartPosBytes;
+	uint32_t originalSampleLengthInSamples;
+	int32_t rawFileCycleSize;
+	uint8_t byteDepth;
+	uint8_t rawDataFormat;
+	uint8_t numBands;
+	uint8_t reserved;
+	int32_t numCycles;
+};
+
+// One of these follows the header for each band. Then the data for each band, for just its cycles which are in use
+struct WaveTableCacheFileBand {
+	uint32_t maxPhaseIncrement;
+	int32_t fromCycleNumber;
+	int32_t toCycleNumber;
+	uint16_t cycleSizeNoDuplicates;
+	uint8_t cycleSizeMagnitude;
+	uint8_t reserved;
+};
+
+FIL waveTableCacheFile;
+
+// Fills in all of the header except numBands and numCycles. Returns error
+int32_t WaveTable::getCacheFileHeader(String* cacheFilePath, WaveTableCacheFileHeader* header,
+                                      uint32_t audioDataStartPosBytes, uint32_t originalSampleLengthInSamples,
+                                      int32_t rawFileCycleSize, int32_t byteDepth, int32_t rawDataFormat) {
+	// If it got loaded from the song's alternate folder, that's where it really is
+	String* audioFilePath = loadedFromAlternatePath.isEmpty() ? &filePath : &loadedFromAlternatePath;
+
+	FILINFO fileInfo;
+	FRESULT result = f_stat(audioFilePath->get(), &fileInfo);
+	if (result != FR_OK) {
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	cacheFilePath->set(audioFilePath);
+	int32_t error = cacheFilePath->concatenate(".wtcache");
+	if (error) {
+		return error;
+	}
+
+	memset(header, 0, sizeof(WaveTableCacheFileHeader));
+	header->magic = WAVETABLE_CACHE_FILE_MAGIC;
+	header->version = WAVETABLE_CACHE_FILE_VERSION;
+	header->audioFileSize = fileInfo.fsize;
+	header->audioFileDateTime = ((uint32_t)fileInfo.fdate << 16) | fileInfo.ftime;
+	header->audioDataStartPosBytes = audioDataStartPosBytes;
+	header->originalSampleLengthInSamples = originalSampleLengthInSamples;
+	header->rawFileCycleSize = rawFileCycleSize;
+	header->byteDepth = byteDepth;
+	header->rawDataFormat = rawDataFormat;
+	return NO_ERROR;
+}
+
+// Returns error - including if there's no cache file or it's out of date, in which case we just set up the slow way
+int32_t WaveTable::readCacheFile(String* cacheFilePath, WaveTableCacheFileHeader* headerWanted) {
+	FRESULT result = f_open(&waveTableCacheFile, cacheFilePath->get(), FA_READ);
+	if (result != FR_OK) {
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	int32_t error = NO_ERROR;
+	UINT numBytesRead;
+	WaveTableCacheFileHeader header;
+	WaveTableCacheFileBand bandHeaders[WAVETABLE_CACHE_FILE_MAX_NUM_BANDS];
+
+	result = f_read(&waveTableCacheFile, &header, sizeof(header), &numBytesRead);
+	if (result != FR_OK || numBytesRead != sizeof(header)) {
+		goto corrupted;
+	}
+
+	// Everything but the number of bands, which we only find out from the cache file itself, must match
+	headerWanted->numBands = header.numBands;
+	if (memcmp(&header, headerWanted, sizeof(header)) || !header.numBands
+	    || header.numBands > WAVETABLE_CACHE_FILE_MAX_NUM_BANDS) {
+		error = ERROR_FILE_NOT_FOUND; // Out of date
+		goto closeAndGetOut;
+	}
+
+	result = f_read(&waveTableCacheFile, bandHeaders, header.numBands * sizeof(WaveTableCacheFileBand), &numBytesRead);
+	if (result != FR_OK || numBytesRead != header.numBands * sizeof(WaveTableCacheFileBand)) {
+		goto corrupted;
+	}
+
+	error = bands.insertAtIndex(0, header.numBands);
+	if (error) {
+		goto closeAndGetOut;
+	}
+
+	for (int32_t b = 0; b < header.numBands; b++) {
+		WaveTableCacheFileBand* bandHeader = &bandHeaders[b];
+		int32_t cycleSizeWithDuplicates =
+		    bandHeader->cycleSizeNoDuplicates + WAVETABLE_NUM_DUPLICATE_SAMPLES_AT_END_OF_CYCLE;
+		int32_t numCyclesInUse = bandHeader->toCycleNumber - bandHeader->fromCycleNumber;
+		if (bandHeader->fromCycleNumber < 0 || numCyclesInUse < 1 || bandHeader->toCycleNumber > numCycles
+		    || bandHeader->cycleSizeNoDuplicates != (1 << bandHeader->cycleSizeMagnitude)) {
+			// All bands from this one onwards still have undefined data
+			bands.deleteAtIndex(b, bands.getNumElements() - b);
+			goto corrupted;
+		}
+
+		int32_t bandDataSizeBytes = numCyclesInUse * cycleSizeWithDuplicates * sizeof(int16_t);
+		void* bandDataMemory =
+		    GeneralMemoryAllocator::get().alloc(bandDataSizeBytes + sizeof(WaveTableBandData), NULL, false,
+		                                        WAVETABLE_ALLOW_INTERNAL_MEMORY, true); // Stealable!
+		if (!bandDataMemory) {
+			bands.deleteAtIndex(b, bands.getNumElements() - b);
+			error = ERROR_INSUFFICIENT_RAM;
+			goto deleteBandsAndGetOut;
+		}
+
+		WaveTableBand* band = (WaveTableBand*)bands.getElementAddress(b);
+		band->data = new (bandDataMemory) WaveTableBandData(this);
+
+		// Same as if setup() had shortened the memory on the left
+		band->dataAccessAddress = (int16_t*)(band->data + 1) - bandHeader->fromCycleNumber * cycleSizeWithDuplicates;
+
+		band->maxPhaseIncrement = bandHeader->maxPhaseIncrement;
+		band->fromCycleNumber = bandHeader->fromCycleNumber;
+		band->toCycleNumber = bandHeader->toCycleNumber;
+		band->cycleSizeNoDuplicates = bandHeader->cycleSizeNoDuplicates;
+		band->cycleSizeMagnitude = bandHeader->cycleSizeMagnitude;
+	}
+
+	for (int32_t b = 0; b < header.numBands; b++) {
+		WaveTableBand* band = (WaveTableBand*)bands.getElementAddress(b);
+		int32_t bandDataSizeBytes = (band->toCycleNumber - band->fromCycleNumber)
+		                            * (band->cycleSizeNoDuplicates + WAVETABLE_NUM_DUPLICATE_SAMPLES_AT_END_OF_CYCLE)
+		                            * sizeof(int16_t);
+		result = f_read(&waveTableCacheFile, band->data + 1, bandDataSizeBytes, &numBytesRead);
+		if (result != FR_OK || numBytesRead != (UINT)bandDataSizeBytes) {
+			goto corrupted;
+		}
+	}
+
+	f_close(&waveTableCacheFile);
+
+	Debug::print("wavetable loaded from cache file, num bands: ");
+	Debug::println(bands.getNumElements());
+	return NO_ERROR;
+
+corrupted:
+	error = ERROR_FILE_CORRUPTED;
+deleteBandsAndGetOut:
+	deleteAllBandsAndData();
+closeAndGetOut:
+	f_close(&waveTableCacheFile);
+	return error;
+}
+
+// If that fails, no big deal - it'll just have to be set up the slow way again next time
+void WaveTable::writeCacheFile(String* cacheFilePath, WaveTableCacheFileHeader* header) {
+	header->numBands = bands.getNumElements();
+	header->numCycles = numCycles;
+
+	FRESULT result = f_open(&waveTableCacheFile, cacheFilePath->get(), FA_CREATE_ALWAYS | FA_WRITE);
+	if (result != FR_OK) {
+		return;
+	}
+
+	UINT numBytesWritten;
+	result = f_write(&waveTableCacheFile, header, sizeof(WaveTableCacheFileHeader), &numBytesWritten);
+
+	for (int32_t b = 0; b < bands.getNumElements() && result == FR_OK; b++) {
+		WaveTableBand* band = (WaveTableBand*)bands.getElementAddress(b);
+		WaveTableCacheFileBand bandHeader;
+		bandHeader.maxPhaseIncrement = band->maxPhaseIncrement;
+		bandHeader.fromCycleNumber = band->fromCycleNumber;
+		bandHeader.toCycleNumber = band->toCycleNumber;
+		bandHeader.cycleSizeNoDuplicates = band->cycleSizeNoDuplicates;
+		bandHeader.cycleSizeMagnitude = band->cycleSizeMagnitude;
+		bandHeader.reserved = 0;
+		result = f_write(&waveTableCacheFile, &bandHeader, sizeof(bandHeader), &numBytesWritten);
+	}
+
+	for (int32_t b = 0; b < bands.getNumElements() && result == FR_OK; b++) {
+		WaveTableBand* band = (WaveTableBand*)bands.getElementAddress(b);
+		int32_t cycleSizeWithDuplicates = band->cycleSizeNoDuplicates + WAVETABLE_NUM_DUPLICATE_SAMPLES_AT_END_OF_CYCLE;
+		result = f_write(&waveTableCacheFile, &band->dataAccessAddress[band->fromCycleNumber * cycleSizeWithDuplicates],
+		                 (band->toCycleNumber - band->fromCycleNumber) * cycleSizeWithDuplicates * sizeof(int16_t),
+		                 &numBytesWritten);
+	}
+
+	FRESULT closeResult = f_close(&waveTableCacheFile);
+
+	// Don't leave a half-written one lying around
+	if (result != FR_OK || closeResult != FR_OK) {
+		f_unlink(cacheFilePath->get());
+	}
+}
+
+void WaveTable::workOutCycleTransitions() {
+	numCyclesMagnitude = getMagnitude(numCycles);
+
+	if (numCycles > 1) {
+		int32_t numCycleTransitions = numCycles - 1;
+
+		numCycleTransitionsNextPowerOf2Magnitude = getMagnitudeOld(numCycleTransitions);
+		numCycleTransitionsNextPowerOf2 = 1 << numCycleTransitionsNextPowerOf2Magnitude;
+
+		waveIndexMultiplier = numCycleTransitions << (31 - numCycleTransitionsNextPowerOf2Magnitude);
+	}
+}
+
 int32_t WaveTable::setup(Sample* sample, int32_t rawFileCycleSize, uint32_t audioDataStartPosBytes,
                          uint32_t audioDataLengthBytes, int32_t byteDepth, int32_t rawDataFormat,
                          WaveTableReader* reader) {
@@ -199,6 +418,21 @@ int32_t WaveTable::setup(Sample* sample, int32_t rawFileCycleSize, uint32_t audi
 		}
 	}
 
+	// If we've set this file up before, the results might be on the card already
+	String cacheFilePath;
+	WaveTableCacheFileHeader cacheFileHeader;
+	bool canUseCacheFile =
+	    !getCacheFileHeader(&cacheFilePath, &cacheFileHeader, audioDataStartPosBytes, originalSampleLengthInSamples,
+	                        rawFileCycleSize, byteDepth, sample ? sample->rawDataFormat : rawDataFormat);
+	if (canUseCacheFile) {
+		AudioEngine::logAction("reading wavetable cache file");
+		cacheFileHeader.numCycles = numCycles;
+		if (!readCacheFile(&cacheFilePath, &cacheFileHeader)) {
+			workOutCycleTransitions();
+			return NO_ERROR;
+		}
+	}
+
 tryGettingFFTConfig:
 	AudioEngine::logAction("Getting fft config");
 	ne10_fft_r2c_cfg_int32_t fftCFGForInitialBand = FFTConfigManager::getConfig(initialBandCycleMagnitude);
@@ -220,6 +454,10 @@ tryGettingFFTConfig:
 		*/
 	}
 
+	// If we couldn't do all the bands we'd normally do (which only happens if short of RAM), don't write a cache file,
+	// or we'd be stuck with that
+	bool missingAnyBands = !fftCFGForInitialBand;
+
 	int32_t initialBandCycleSizeNoDuplicates =
 	    1
 	    << initialBandCycleMagnitude; // This will usually be the same as rawFileCycleSize, but not when that's not a power of two.
@@ -246,8 +484,6 @@ gotError2:
 		goto gotError;
 	}
 
-	numCyclesMagnitude = getMagnitude(numCycles);
-
 	AudioEngine::logAction("just started wavetable");
 	AudioEngine::
 	    routineWithClusterLoading(); // TODO: the routine calls in this function might be more than needed - I didn't profile very closely.
@@ -669,6 +905,7 @@ transformBandToTimeDomain:
 
 			// If couldn't get FFT config, gotta delete this band
 			if (!fftCFGThisBand) {
+				missingAnyBands = true;
 #if ALPHA_OR_BETA_VERSION
 				if (!b) {
 					display->freezeWithError("E390");
@@ -720,14 +957,7 @@ transformBandToTimeDomain:
 		audioFileManager.removeReasonFromCluster(cluster, "E385");
 	}
 
-	if (numCycles > 1) {
-		int32_t numCycleTransitions = numCycles - 1;
-
-		numCycleTransitionsNextPowerOf2Magnitude = getMagnitudeOld(numCycleTransitions);
-		numCycleTransitionsNextPowerOf2 = 1 << numCycleTransitionsNextPowerOf2Magnitude;
-
-		waveIndexMultiplier = numCycleTransitions << (31 - numCycleTransitionsNextPowerOf2Magnitude);
-	}
+	workOutCycleTransitions();
 
 	// Dispose of temp memory
 	GeneralMemoryAllocator::get().dealloc(currentCycleInt32);
@@ -791,6 +1021,11 @@ transformBandToTimeDomain:
 		}
 	}
 
+	if (canUseCacheFile && !missingAnyBands) {
+		AudioEngine::logAction("writing wavetable cache file");
+		writeCacheFile(&cacheFilePath, &cacheFileHeader);
+	}
+
 	return NO_ERROR;
 }
 
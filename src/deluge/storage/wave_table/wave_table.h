@@ -25,6 +25,7 @@
 
 class Sample;
 class WaveTableReader;
+struct WaveTableCacheFileHeader;
 
 class WaveTableBand {
 public:
@@ -67,6 +68,13 @@ protected:
 	void numReasonsDecreasedToZero(char const* errorCode);
 
 private:
+	int32_t getCacheFileHeader(String* cacheFilePath, WaveTableCacheFileHeader* header, uint32_t audioDataStartPosBytes,
+	                           uint32_t originalSampleLengthInSamples, int32_t rawFileCycleSize, int32_t byteDepth,
+	                           int32_t rawDataFormat);
+	int32_t readCacheFile(String* cacheFilePath, WaveTableCacheFileHeader* headerWanted);
+	void writeCacheFile(String* cacheFilePath, WaveTableCacheFileHeader* header);
+	void workOutCycleTransitions();
+
 	void doRenderingLoop(int32_t* __restrict__ thisSample, int32_t const* bufferEnd, int32_t firstCycleNumber,
 	                     WaveTableBand* __restrict__ bandHere, uint32_t phase, uint32_t phaseIncrement,
 	                     uint32_t waveIndexScaled, int32_t waveIndexIncrementScaled,
@@ -464,6 +464,41 @@ typedef struct {
 static FATFS* FatFs[FF_VOLUMES];	/* Pointer to the filesystem objects (logical drives) */
 static WORD Fsid;					/* Filesystem mount ID */
 
+// Added for the Deluge's directory index. Goes up whenever a directory entry gets created, removed or updated, so the
+// index can tell that nothing's changed since it last checked a folder without going through the folder again.
+// Index and cache files don't count - see below
+DWORD DirChangeCount;
+
+// Short names (as stored, with '?' matching any char) of files the Deluge keeps alongside the user's own ones: folder
+// indexes, the song index's temp file, and the .perc, .wtcache and .anl files next to samples. Long names get stored
+// with their short name's extension cut to 3 chars, so those show up as PER, WTC and ANL
+static const char* const IndexAndCacheNames[] = {
+	"????????IDX", "????????TMP", "????????PER", "????????WTC", "????????ANL",
+};
+
+static int sfn_matches (const BYTE* sfn, const char* pattern)
+{
+	UINT i;
+	for (i = 0; i < 11; i++) {
+		if (pattern[i] != '?' && sfn[i] != (BYTE)pattern[i]) return 0;
+	}
+	return 1;
+}
+
+static int is_index_or_cache_name (const BYTE* sfn)
+{
+	UINT i;
+	for (i = 0; i < sizeof IndexAndCacheNames / sizeof IndexAndCacheNames[0]; i++) {
+		if (sfn_matches(sfn, IndexAndCacheNames[i])) return 1;
+	}
+	return 0;
+}
+
+static void note_dir_change (const BYTE* sfn)
+{
+	if (!sfn || !is_index_or_cache_name(sfn)) DirChangeCount++;
+}
+
 #if FF_FS_RPATH != 0
 static BYTE CurrVol;				/* Current drive */
 #endif
@@ -2514,6 +2549,7 @@ static FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too
 		}
 
 		create_xdir(fs->dirbuf, fs->lfnbuf);	/* Create on-memory directory block to be written later */
+		note_dir_change(0);
 		return FR_OK;
 	}
 #endif
@@ -2559,6 +2595,7 @@ static FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too
 		if (res == FR_OK) {
 			memset(dp->dir, 0, SZDIRE);	/* Clean the entry */
 			memcpy(dp->dir + DIR_Name, dp->fn, 11);	/* Put SFN */
+			note_dir_change(dp->dir);
 #if FF_USE_LFN
 			dp->dir[DIR_NTres] = dp->fn[NSFLAG] & (NS_BODY | NS_EXT);	/* Put NT flag */
 #endif
@@ -2593,8 +2630,10 @@ static FRESULT dir_remove (	/* FR_OK:Succeeded, FR_DISK_ERR:A disk error */
 			res = move_window(fs, dp->sect);
 			if (res != FR_OK) break;
 			if (FF_FS_EXFAT && fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
+				if (dp->dptr == dp->blk_ofs) note_dir_change(0);
 				dp->dir[XDIR_Type] &= 0x7F;	/* Clear the entry InUse flag. */
 			} else {										/* On the FAT/FAT32 volume */
+				if (dp->dptr >= last) note_dir_change(dp->dir);	/* The SFN entry comes last */
 				dp->dir[DIR_Name] = DDEM;	/* Mark the entry 'deleted'. */
 			}
 			fs->wflag = 1;
@@ -2607,6 +2646,7 @@ static FRESULT dir_remove (	/* FR_OK:Succeeded, FR_DISK_ERR:A disk error */
 
 	res = move_window(fs, dp->sect);
 	if (res == FR_OK) {
+		note_dir_change(dp->dir);
 		dp->dir[DIR_Name] = DDEM;	/* Mark the entry 'deleted'.*/
 		fs->wflag = 1;
 	}
@@ -4155,6 +4195,7 @@ FRESULT f_sync (
 						fs->dirbuf[XDIR_ModTime10] = 0;
 						st_dword(fs->dirbuf + XDIR_AccTime, 0);
 						res = store_xdir(&dj);	/* Restore it to the directory */
+						note_dir_change(0);
 						if (res == FR_OK) {
 							res = sync_fs(fs);
 							fp->flag &= (BYTE)~FA_MODIFIED;
@@ -4168,6 +4209,7 @@ FRESULT f_sync (
 				res = move_window(fs, fp->dir_sect);
 				if (res == FR_OK) {
 					dir = fp->dir_ptr;
+					note_dir_change(dir);
 					dir[DIR_Attr] |= AM_ARC;						/* Set archive attribute to indicate that the file has been changed */
 					st_clust(fp->obj.fs, dir, fp->obj.sclust);		/* Update file allocation information  */
 					st_dword(dir + DIR_FileSize, (DWORD)fp->obj.objsize);	/* Update file size */
@@ -4721,9 +4763,10 @@ FRESULT f_readdir_get_filepointer (
 			if (res == FR_NO_FILE) res = FR_OK;	/* Ignore end of directory */
 			if (res == FR_OK) {				/* A valid entry is found */
 
-				// Just these two lines added
+				// Just these lines added
 				filePointer->objsize = ld_dword(dp->dir + DIR_FileSize);
 				filePointer->sclust = ld_clust(fs, dp->dir);
+				filePointer->modified = ld_dword(dp->dir + DIR_ModTime);
 
 				get_fileinfo(dp, fno);		/* Get the object information */
 				res = dir_next(dp, 0);		/* Increment index for next */
@@ -4736,6 +4779,65 @@ FRESULT f_readdir_get_filepointer (
 }
 
 
+
+// Added for the Deluge's directory index. Hashes the raw entries of a directory (including LFN and deleted ones,
+// but not last-accessed dates), so it can be told cheaply whether anything in it has changed, without getting file
+// information or assembling long names. Carries on from wherever the directory object is up to - call
+// f_readdir(dp, 0) first to rewind. Does up to maxEntries (plus however many it takes to finish a long name), then
+// returns, so the caller can do other things in between. *numEntriesDone comes back less than maxEntries once the end
+// of the directory is reached. Index and cache files, and their long names, aren't hashed.
+FRESULT f_dir_hash (
+	DIR* dp,			/* Pointer to the open directory object */
+	DWORD* hash,		/* Running hash, to be updated */
+	UINT maxEntries,
+	UINT* numEntriesDone
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	UINT n = 0;
+	DWORD h = *hash;
+	DWORD hBeforeLfn = h;
+	int inLfn = 0;
+
+
+	res = validate(&dp->obj, &fs);	/* Check validity of the directory object */
+	if (res == FR_OK) {
+		while ((n < maxEntries || inLfn) && dp->sect) {
+			res = move_window(fs, dp->sect);
+			if (res != FR_OK) break;
+			if (dp->dir[DIR_Name] == 0) {	/* End of table */
+				dp->sect = 0;
+				break;
+			}
+			if (dp->dir[DIR_Attr] == AM_LFN && !inLfn) {	/* Long name entries come before their short name one */
+				hBeforeLfn = h;
+				inLfn = 1;
+			}
+			if (dp->dir[DIR_Attr] != AM_LFN && is_index_or_cache_name(dp->dir)) {
+				if (inLfn) h = hBeforeLfn;	/* Its long name doesn't count either */
+			} else {
+				UINT i;
+				for (i = 0; i < SZDIRE; i++) {
+					if (dp->dir[DIR_Attr] != AM_LFN && (i == DIR_LstAccDate || i == DIR_LstAccDate + 1)) continue;
+					h = (h ^ dp->dir[i]) * 16777619;	/* FNV-1a */
+				}
+			}
+			if (dp->dir[DIR_Attr] != AM_LFN) inLfn = 0;
+			n++;
+			res = dir_next(dp, 0);
+			if (res == FR_NO_FILE) {
+				res = FR_OK;
+				break;
+			}
+			if (res != FR_OK) break;
+		}
+	}
+	*hash = h;
+	*numEntriesDone = n;
+	LEAVE_FF(fs, res);
+}
+
 #if FF_USE_FIND
 /*-----------------------------------------------------------------------*/
 /* Find Next File                                                        */
@@ -303,6 +303,7 @@ typedef enum {
 typedef struct {
 	DWORD	sclust;
 	FSIZE_t	objsize;
+	DWORD	modified;	/* Date << 16 | time, as in the dir entry. Only filled in by f_readdir_get_filepointer() */
 } FilePointer;
 
 /*--------------------------------------------------------------*/